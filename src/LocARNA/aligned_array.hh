@@ -0,0 +1,253 @@
+#ifndef LOCARNA_ALIGNED_ARRAY_HH
+#define LOCARNA_ALIGNED_ARRAY_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <algorithm>
+#include <new>
+
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>
+#endif
+
+namespace LocARNA {
+
+    /**
+     * @brief Array with cache line aligned storage
+     *
+     * Vector-like container for storing the entries of large
+     * dynamic programming matrices. The storage starts at a 64
+     * byte (cache line) boundary. Large arrays are aligned to
+     * huge pages and, where supported, advised to be backed by
+     * transparent huge pages, which saves TLB misses when
+     * traversing large tables.
+     *
+     * @tparam T element type
+     * @tparam Initialize if true, resize() value-initializes new
+     * elements like std::vector; otherwise, new elements are left
+     * uninitialized (which saves a pass over the memory if the
+     * array is filled anyway)
+     *
+     * @note Initialize=false is meant for element types without
+     * resources (which can be assigned without being constructed
+     * and need no destruction), like numbers and scores.
+     */
+    template <class T, bool Initialize=true>
+    class AlignedArray {
+    public:
+	typedef T value_type; //!< type of elements
+	typedef std::size_t size_type; //!< size type
+	typedef T &reference; //!< reference to element
+	typedef const T &const_reference; //!< const reference to element
+	typedef T *iterator; //!< iterator
+	typedef const T *const_iterator; //!< const iterator
+
+	//! alignment of the storage in bytes
+	static const size_type alignment = 64;
+
+	//! size of huge pages; larger arrays are aligned to huge pages
+	static const size_type huge_page_size = 2*1024*1024;
+
+    private:
+	T *data_; //!< storage
+	size_type size_; //!< number of elements
+	size_type capacity_; //!< number of allocated elements
+
+	/**
+	 * @brief Allocate aligned storage
+	 * @param n number of elements
+	 * @return pointer to uninitialized storage
+	 */
+	static
+	T *
+	allocate(size_type n) {
+	    size_type bytes = n*sizeof(T);
+	    size_type align = bytes>=huge_page_size ? huge_page_size : alignment;
+
+	    void *p;
+	    if (posix_memalign(&p,align,bytes)!=0) {
+		throw std::bad_alloc();
+	    }
+#if defined(HAVE_SYS_MMAN_H) && defined(MADV_HUGEPAGE)
+	    if (bytes>=huge_page_size) {
+		// only a hint; ignore failure
+		madvise(p,bytes,MADV_HUGEPAGE);
+	    }
+#endif
+	    return static_cast<T *>(p);
+	}
+
+	/**
+	 * @brief Destroy elements in range
+	 * @param first begin of range
+	 * @param last end of range
+	 */
+	static
+	void
+	destroy(T *first, T *last) {
+	    for (; first!=last; ++first) {
+		first->~T();
+	    }
+	}
+
+    public:
+
+	/**
+	 * @brief Construct empty
+	 */
+	AlignedArray()
+	    : data_(0L), size_(0), capacity_(0) {
+	}
+
+	/**
+	 * @brief Construct with size
+	 * @param n number of elements
+	 */
+	explicit
+	AlignedArray(size_type n)
+	    : data_(0L), size_(0), capacity_(0) {
+	    resize(n);
+	}
+
+	/**
+	 * @brief Copy constructor
+	 * @param a array to be copied
+	 */
+	AlignedArray(const AlignedArray &a)
+	    : data_(0L), size_(0), capacity_(0) {
+	    reserve(a.size_);
+	    std::uninitialized_copy(a.begin(),a.end(),data_);
+	    size_=a.size_;
+	}
+
+	/**
+	 * @brief Destructor
+	 */
+	~AlignedArray() {
+	    destroy(begin(),end());
+	    free(data_);
+	}
+
+	/**
+	 * @brief Assignment operator
+	 * @param a array to be copied
+	 * @return *this
+	 */
+	AlignedArray &
+	operator =(const AlignedArray &a) {
+	    AlignedArray tmp(a);
+	    swap(tmp);
+	    return *this;
+	}
+
+	/**
+	 * @brief Swap content with other array
+	 * @param a other array
+	 */
+	void
+	swap(AlignedArray &a) {
+	    std::swap(data_,a.data_);
+	    std::swap(size_,a.size_);
+	    std::swap(capacity_,a.capacity_);
+	}
+
+	/**
+	 * @brief Number of elements
+	 * @return size
+	 */
+	size_type
+	size() const {
+	    return size_;
+	}
+
+	/**
+	 * @brief Reserve storage
+	 * @param n number of elements
+	 * @post capacity is at least n; content is kept
+	 */
+	void
+	reserve(size_type n) {
+	    if (n<=capacity_) return;
+
+	    T *p = allocate(n);
+	    std::uninitialized_copy(begin(),end(),p);
+	    destroy(begin(),end());
+	    free(data_);
+	    data_=p;
+	    capacity_=n;
+	}
+
+	/**
+	 * @brief Resize
+	 * @param n new number of elements
+	 * @see Initialize
+	 */
+	void
+	resize(size_type n) {
+	    if (n<size_) {
+		destroy(data_+n,end());
+	    } else {
+		reserve(n);
+		if (Initialize) {
+		    std::uninitialized_fill(end(),data_+n,T());
+		}
+	    }
+	    size_=n;
+	}
+
+	/**
+	 * @brief Resize and set all elements
+	 * @param n new number of elements
+	 * @param val value of elements
+	 *
+	 * Like std::vector::assign(), this writes each element
+	 * once.
+	 */
+	void
+	assign(size_type n, const T &val) {
+	    clear();
+	    reserve(n);
+	    std::uninitialized_fill(data_,data_+n,val);
+	    size_=n;
+	}
+
+	/**
+	 * @brief Remove all elements
+	 * @note like std::vector::clear(), keep the storage
+	 */
+	void
+	clear() {
+	    destroy(begin(),end());
+	    size_=0;
+	}
+
+	//! @brief read access to element
+	const_reference
+	operator [](size_type i) const {
+	    return data_[i];
+	}
+
+	//! @brief read/write access to element
+	reference
+	operator [](size_type i) {
+	    return data_[i];
+	}
+
+	//! @brief begin iterator
+	iterator begin() { return data_; }
+	//! @brief end iterator
+	iterator end() { return data_+size_; }
+	//! @brief const begin iterator
+	const_iterator begin() const { return data_; }
+	//! @brief const end iterator
+	const_iterator end() const { return data_+size_; }
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_ALIGNED_ARRAY_HH
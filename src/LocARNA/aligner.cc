@@ -10,8 +10,15 @@
 #include <cassert>
 
 #include <queue>
+#include <deque>
+#include <set>
 
 #include <iostream>
+#include <sstream>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
 
 
 namespace LocARNA {
@@ -107,7 +114,9 @@ namespace LocARNA {
 	  alignment_(a.alignment_),
 	  def_scoring_view_(this),
 	  mod_scoring_view_(this),
-	  free_endgaps_(a.free_endgaps_)
+	  free_endgaps_(a.free_endgaps_),
+	  workers_(),
+	  last_lambda_(a.last_lambda_)
     {}
     
     Aligner::Aligner(const AlignerParams &ap) 
@@ -137,14 +146,15 @@ namespace LocARNA {
 	  alignment_(seqA,seqB),
           def_scoring_view_(this),
           mod_scoring_view_(this),
-          free_endgaps_(params_->free_endgaps_)
+          free_endgaps_(params_->free_endgaps_),
+	  workers_(),
+	  last_lambda_(0)
     {
 	Ms_.resize(params_->struct_local_?8:1);
 	Es_.resize(params_->struct_local_?4:1);
 	Fs_.resize(params_->struct_local_?4:1);
     
-	Dmat_.resize(bpsA_.num_bps(),bpsB_.num_bps());
-	Dmat_.fill(infty_score_t::neg_infty);
+	Dmat_.assign(bpsA_.num_bps(),bpsB_.num_bps(),infty_score_t::neg_infty);
     
 	for (size_t k=0; k<(params_->struct_local_?8:1); k++) {
 	    Ms_[k].resize(seqA_.length()+1,seqB_.length()+1);
@@ -162,6 +172,10 @@ namespace LocARNA {
     	if (mod_scoring_!=0) {
             delete mod_scoring_;
         }
+
+	for (size_t k=0; k<workers_.size(); ++k) {
+	    delete workers_[k];
+	}
     }
 
     Aligner::~Aligner() {
@@ -886,6 +900,34 @@ namespace LocARNA {
 	return max_score;
     }
 
+    void
+    AlignerImpl::local_prefix_scores(bool inA, std::vector<infty_score_t> &scores) const {
+	const M_matrix_t &M=Ms_[E_NO_NO];
+
+	// only entries to the right of (or at) the rightmost anchor
+	// constraint are scores of local alignments (see align_top_level_locally)
+	AnchorConstraints::size_pair_t right_anchor = params_->constraints_->rightmost_anchor();
+
+	// maxima of the rows or columns (0 is the score of the empty alignment)
+	scores.assign((inA ? r_.endA() : r_.endB())+1,(infty_score_t)0);
+
+	for (pos_type i=std::max(r_.startA(),right_anchor.first); i<=r_.endA(); i++) {
+	    pos_type min_col = std::max(std::max(r_.startB(),right_anchor.second),
+					params_->trace_controller_->min_col(i));
+	    pos_type max_col = std::min(r_.endB(),params_->trace_controller_->max_col(i));
+
+	    for (pos_type j=min_col; j<=max_col; j++) {
+		infty_score_t &entry = scores[inA ? i : j];
+		entry = std::max(entry,M(i,j));
+	    }
+	}
+
+	// prefix maxima
+	for (pos_type i=(inA ? r_.startA() : r_.startB()); i<scores.size(); i++) {
+	    scores[i] = std::max(scores[i],scores[i-1]);
+	}
+    }
+
 
     /*
     // special top level alignment for the scanning version
@@ -1347,7 +1389,14 @@ namespace LocARNA {
     }
 
     void
-    Aligner::trace() {pimpl_->trace(pimpl_->def_scoring_view_);}
+    Aligner::trace() {
+	// the matrices of Aligner are all needed for the score; we
+	// only guard against tracing after a score only run
+	if (pimpl_->params_->score_only_) {
+	    throw failure("Aligner: trace is not available in score only mode.");
+	}
+	pimpl_->trace(pimpl_->def_scoring_view_);
+    }
 
 
 
@@ -1363,10 +1412,40 @@ namespace LocARNA {
 
 
 
-    //! type of a task (used in computing k-best alignment)
-    typedef std::pair<AlignerRestriction,infty_score_t> task_t;
+    //! type of a task (used in computing k-best alignment): index in
+    //! the list of subproblems and score
+    typedef std::pair<size_t,infty_score_t> task_t;
+
+    infty_score_t
+    AlignerImpl::evaluate_subproblem(SuboptimalSubproblem &sp,
+				     score_t threshold,
+				     bool opt_normalized,
+				     score_t normalized_L,
+				     bool opt_verbose) {
+	r_=sp.r;
+
+	infty_score_t score;
+	if (opt_normalized) {
+	    // normalized_align() performs the trace
+	    std::ostringstream log;
+	    score = normalized_align(normalized_L,opt_verbose?&log:0L);
+	    if ( score < (infty_score_t)threshold+1 ) return score;
+	    sp.log = log.str();
+	} else {
+	    score = align();
+	    if ( score < (infty_score_t)threshold+1 ) return score;
+
+	    if (params_->sequ_local_) local_prefix_scores(sp.splitA(),sp.prefix_scores);
+
+	    trace(def_scoring_view_);
+	}
+
+	sp.alignment = alignment_;
+	sp.evaluated = true;
+
+	return score;
+    }
 
-    
     void Aligner::suboptimal(int k,
                              score_t threshold,
                              bool opt_normalized,
@@ -1379,14 +1458,45 @@ namespace LocARNA {
                              ) {
 	Aligner &a=*this;
 	
+	// Each subproblem is aligned only once: its alignment is traced
+	// and kept, when its score is computed. For sequence local
+	// alignment, the first split gets its score from the top level
+	// matrix of its parent and is aligned only when it is
+	// reported. Together with the D matrix, which is computed only
+	// once, this saves most top level alignments.
+
+	// subproblems are only appended; a deque keeps references to
+	// them valid and does not copy the alignments
+	std::deque<SuboptimalSubproblem> subproblems;
+
 	// compute alignment score for a
-	infty_score_t a_score = (!opt_normalized)?a.align():a.normalized_align(normalized_L,false);
+	subproblems.push_back(SuboptimalSubproblem(a.get_restriction(),
+						   pimpl_->seqA_,pimpl_->seqB_));
+	infty_score_t a_score =
+	    pimpl_->evaluate_subproblem(subproblems.back(),threshold,
+					opt_normalized,normalized_L,
+					opt_verbose);
+
+	// The two splits of a subproblem are independent; a copy of
+	// the aligner, which includes the D matrix computed above,
+	// evaluates the second split in parallel to the first. Fast
+	// normalized alignment runs its own workers instead.
+	bool parallel_splits = false;
+#ifdef _OPENMP
+	if ( omp_get_max_threads()>1
+	     && !(opt_normalized && pimpl_->params_->fast_normalized_) ) {
+	    if (pimpl_->workers_.empty()) {
+		pimpl_->workers_.push_back(new AlignerImpl(*pimpl_));
+	    }
+	    parallel_splits = true;
+	}
+#endif
     
 	// make priority queue tasks
 	std::priority_queue<task_t, std::vector<task_t>, greater_second<task_t> > tasks;
 	
 	// put a into tasks
-	tasks.push(task_t(a.get_restriction(),a_score));
+	tasks.push(task_t(0,a_score));
 	
 	size_t i=1;
     
@@ -1399,24 +1509,27 @@ namespace LocARNA {
 	    // pop topmost element
 	    tasks.pop();
 	
-	    AlignerRestriction &task_r=task.first;
+	    size_t task_idx=task.first;
 	    infty_score_t task_score=task.second;
 	
 	    if ( task_score < (infty_score_t)threshold+1 ) break;
 	
-	    a.set_restriction(task_r);
-	
-	    if (!opt_normalized) {
-		a.align(); // alignment needs to be recomputed (this is fast)!
-		// do backtrace and write tasks alignment
-		a.trace();
-	    } else {
-		a.normalized_align(normalized_L,opt_verbose);
+	    SuboptimalSubproblem &sp = subproblems[task_idx];
+
+	    // evaluate the task (if not done yet)
+	    if (!sp.evaluated) {
+		pimpl_->evaluate_subproblem(sp,threshold,
+					    opt_normalized,normalized_L,
+					    opt_verbose);
 	    }
-	
-	    Alignment alignment = a.get_alignment();
+	    
+	    assert(sp.evaluated);
+	    
+	    const Alignment &alignment = sp.alignment;
 	
 	    // std::cout << "SCORE: " << task_score << std::endl;
+
+	    std::cout << sp.log;
 	    
 	    {
 		// after major code changes, the following output was
@@ -1440,43 +1553,82 @@ namespace LocARNA {
 	    if (!opt_pos_output) std::cout << std::endl
 					   << std::endl;
 	
-	    if (k>=0 && i==(size_t)k) break; // break if enough solutions generated
+	    if (k>=0 && i==(size_t)k) { // break if enough solutions generated
+		break;
+	    }
 	
 	    // split the longer sequence according to local alignment
-	    pos_type lenA=task_r.endA()-task_r.startA();
-	    pos_type lenB=task_r.endB()-task_r.startB();
-	
-	    // make two clones of AlignerRestriction task_r
-	    AlignerRestriction r1(task_r);
-	    AlignerRestriction r2(task_r);
-	
-	    if (lenA>lenB) {
-		// split A
-		int splitA = (alignment.local_startA() + alignment.local_endA())/2;
-		if (opt_verbose) std::cout <<"Split A at "<<splitA<<std::endl;
-		r1.set_endA(splitA);
-		r2.set_startA(splitA);
+	    
+	    // make two clones of AlignerRestriction sp.r
+	    AlignerRestriction r1(sp.r);
+	    AlignerRestriction r2(sp.r);
+	    
+	    int split;
+	    if (sp.splitA()) {
+		split = (alignment.local_startA() + alignment.local_endA())/2;
+		if (opt_verbose) std::cout <<"Split A at "<<split<<std::endl;
+		r1.set_endA(split);
+		r2.set_startA(split);
 	    } else {
-		int splitB = (alignment.local_startB() + alignment.local_endB())/2;
-		if (opt_verbose) std::cout <<"Split B at "<<splitB<<std::endl;
-		r1.set_endB(splitB);
-		r2.set_startB(splitB);
+		split = (alignment.local_startB() + alignment.local_endB())/2;
+		if (opt_verbose) std::cout <<"Split B at "<<split<<std::endl;
+		r1.set_endB(split);
+		r2.set_startB(split);
 	    }
+	    
+	    // compute alignment scores for both splits; the score of the
+	    // first split is looked up, if possible
+	    
+	    size_t idx[2];
+	    infty_score_t split_score[2];
+	    bool evaluate[2] = {true,true};
+	    
+	    idx[0] = subproblems.size();
+	    subproblems.push_back(SuboptimalSubproblem(r1,pimpl_->seqA_,pimpl_->seqB_));
+	    if ( split>=0 && (size_t)split<sp.prefix_scores.size() ) {
+		split_score[0] = sp.prefix_scores[split];
+		evaluate[0] = false;
+	    }
+	    
+	    idx[1] = subproblems.size();
+	    subproblems.push_back(SuboptimalSubproblem(r2,pimpl_->seqA_,pimpl_->seqB_));
+	    
+	    // the reported subproblem is not needed anymore
+	    sp.alignment.clear();
+	    std::vector<infty_score_t>().swap(sp.prefix_scores);
+	    sp.log.clear();
+	    
+	    bool failed = false;
+	    std::string failure_msg;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static,1) if(parallel_splits && evaluate[0])
+#endif
+	    for (long c=0; c<2; ++c) {
+		if (!evaluate[c]) continue;
+		AlignerImpl &w = (c==1 && parallel_splits) ? *pimpl_->workers_[0] : *pimpl_;
+		try {
+		    split_score[c] = w.evaluate_subproblem(subproblems[idx[c]],threshold,
+							   opt_normalized,normalized_L,
+							   opt_verbose);
+		} catch (failure &f) {
+#ifdef _OPENMP
+#pragma omp critical (suboptimal_failure)
+#endif
+		    {
+			failed = true;
+			failure_msg = f.what();
+		    }
+		}
+	    }
+	    if (failed) throw failure(failure_msg);
 	
-	    // compute alignment scores for both splits
-	
-	    a.set_restriction(r1);
-	    infty_score_t a1_score = (!opt_normalized)?a.align():a.normalized_align(normalized_L,false);
-	    a.set_restriction(r2);
-	    infty_score_t a2_score = (!opt_normalized)?a.align():a.normalized_align(normalized_L,false);
-	
-	    // std::cout <<"a1_score: " << a1_score << std::endl;
-	    // std::cout <<"a2_score: " << a2_score << std::endl;
+	    // std::cout <<"a1_score: " << split_score[0] << std::endl;
+	    // std::cout <<"a2_score: " << split_score[1] << std::endl;
 		
 	    // put both splits into <tasks>
 	
-	    tasks.push(task_t(r1,a1_score));
-	    tasks.push(task_t(r2,a2_score));
+	    tasks.push(task_t(idx[0],split_score[0]));
+	    tasks.push(task_t(idx[1],split_score[1]));
 		
 	    ++i; // count enumerated alignments
 	}
@@ -1489,17 +1641,16 @@ namespace LocARNA {
     //
 
     infty_score_t
-    Aligner::normalized_align(score_t L, bool opt_verbose) {
+    AlignerImpl::normalized_align(score_t L, std::ostream *log) {
     
 	// The D matrix is filled as in non-normalized alignment. Because
 	// alignments of the subsequences enclosed by arcs are essentially
 	// global, their scores can be optimized in the same way as for
 	// non-normalized alignments.
-	if (!pimpl_->D_created_) pimpl_->align_D();
+	if (!D_created_) align_D();
+
+	if (params_->fast_normalized_) return normalized_align_fast(L,log);
 
-	if (pimpl_->mod_scoring_) delete pimpl_->mod_scoring_;
-	pimpl_->mod_scoring_=new Scoring(*pimpl_->scoring_); // make mod_scoring point to a copy of scoring
-    
 	// Apply Dinkelbach's algorithm
     
 	score_t new_lambda=0;
@@ -1511,43 +1662,207 @@ namespace LocARNA {
 	while ( lambda != new_lambda )
 	    {
 		++iteration;
-		if (opt_verbose) std::cout << "Perform Dinkelbach iteration "<<iteration<<std::endl;
+		if (log) *log << "Perform Dinkelbach iteration "<<iteration<<std::endl;
 	
 		lambda=new_lambda;
 		
-		// modify the scoring by lambda
-		pimpl_->mod_scoring_->modify_by_parameter(lambda);
-		pimpl_->mod_scoring_view_.set_lambda(lambda);
+		pos_type length;
+		infty_score_t score = align_modified(lambda,length);
 	
-		infty_score_t score = pimpl_->align_top_level_locally(pimpl_->mod_scoring_view_);
+		new_lambda = score.finite_value()/(length+L);
 	
-		pimpl_->alignment_.clear();
+		if (log) *log << "Score: "<<score<<" Length: "<<length<<" Normalized Score: "<<new_lambda<<std::endl;
+
+		if (log) {
+		    MultipleAlignment ma(alignment_,true);
+		    *log << "Score: "<<(infty_score_t)new_lambda<<std::endl;
+		    ma.write(*log,120,MultipleAlignment::FormatType::CLUSTAL);
+		}
+		
+		if (log) *log<<std::endl;
+	    }
+	return (infty_score_t)new_lambda;
+    }
+
+    infty_score_t
+    AlignerImpl::align_modified(score_t lambda, pos_type &length) {
+	// make mod_scoring point to a copy of scoring; the copy is kept
+	// for subsequent calls (e.g. for other restrictions in
+	// suboptimal()), since modify_by_parameter() only shifts the
+	// tables by the difference of lambdas
+	if (!mod_scoring_) mod_scoring_=new Scoring(*scoring_);
+
+	// modify the scoring by lambda
+	mod_scoring_->modify_by_parameter(lambda);
+	mod_scoring_view_.set_lambda(lambda);
 	
-		// perform a traceback for normalized alignment
-		pimpl_->trace(pimpl_->mod_scoring_view_);
+	infty_score_t score = align_top_level_locally(mod_scoring_view_);
 	
-		// compute length (of alignment) as sum of lengths of
-		// aligned subsequences from the trace
-		pos_type length=pimpl_->max_i_-pimpl_->min_i_+1+pimpl_->max_j_-pimpl_->min_j_+1;
+	alignment_.clear();
 	
-		// get score for the best alignment in the modified problem
-		// but for unmodified scoring. Because for each position,
-		// lambda was subtracted, we can just add length*lambda!
-		score += length*lambda;
+	// perform a traceback for normalized alignment
+	trace(mod_scoring_view_);
 	
-		new_lambda = score.finite_value()/(length+L);
+	// compute length (of alignment) as sum of lengths of
+	// aligned subsequences from the trace
+	length=max_i_-min_i_+1+max_j_-min_j_+1;
 	
-		if (opt_verbose) std::cout << "Score: "<<score<<" Length: "<<length<<" Normalized Score: "<<new_lambda<<std::endl;
+	// get score for the best alignment in the modified problem
+	// but for unmodified scoring. Because for each position,
+	// lambda was subtracted, we can just add length*lambda!
+	score += length*lambda;
 
-		if (opt_verbose) {
-		    MultipleAlignment ma(pimpl_->alignment_,true);
-		    std::cout << "Score: "<<(infty_score_t)new_lambda<<std::endl;
-		    ma.write(std::cout,120,MultipleAlignment::FormatType::CLUSTAL);
+	return score;
+    }
+
+    infty_score_t
+    AlignerImpl::normalized_align_fast(score_t L, std::ostream *log) {
+	// The D matrix does not depend on lambda; it is computed once
+	// and copied to the workers, which also keep their modified
+	// scoring between calls
+	if (!D_created_) align_D();
+
+#ifdef _OPENMP
+	size_t num_workers = omp_get_max_threads();
+#else
+	size_t num_workers = 1;
+#endif
+	// this aligner evaluates the first candidate
+	while (workers_.size()+1 < num_workers) {
+	    workers_.push_back(new AlignerImpl(*this));
+	}
+	for (size_t k=0; k<workers_.size(); ++k) {
+	    workers_[k]->r_=r_;
+	}
+
+	// The optimal normalized score lies in [lo,hi): lo is the
+	// normalized score of the best alignment found so far; an
+	// alignment that is optimal for the scores modified by c has
+	// normalized score below c only if all alignments do.
+	bool have_lo=false;
+	score_t lo=0;
+	bool have_hi=false;
+	score_t hi=0;
+
+	Alignment best_alignment(alignment_);
+	pos_type best_bounds[4]={0,0,0,0};
+
+	std::set<score_t> evaluated;
+	std::vector<score_t> candidates;
+	size_t round=0;
+
+	while ( !have_hi || !have_lo || lo+1 < hi ) {
+	    ++round;
+
+	    // the Dinkelbach step from lo and the smallest lambda that
+	    // can raise lo come first; further candidates bracket the
+	    // optimum
+	    candidates.clear();
+	    if (!have_lo) {
+		// below a known upper bound, restart from 0
+		candidates.push_back(have_hi ? 0 : last_lambda_);
+	    } else {
+		if (evaluated.find(lo)==evaluated.end()) candidates.push_back(lo);
+		candidates.push_back(lo+1);
+	    }
+	    if (candidates.size()>num_workers) candidates.resize(num_workers);
+	    score_t from = candidates.back()+1;
+	    size_t spread = num_workers-std::min(num_workers,candidates.size());
+	    for (size_t k=1; k<=spread; ++k) {
+		score_t c = have_hi
+		    ? from + (score_t)((hi-from)*k/(spread+1))
+		    : from + (score_t)(k-1)*std::max((score_t)1,from);
+		if ( c>candidates.back() && (!have_hi || c<hi) ) {
+		    candidates.push_back(c);
 		}
-		
-		if (opt_verbose) std::cout<<std::endl;
 	    }
-	return (infty_score_t)new_lambda;
+
+	    std::vector<infty_score_t> scores(candidates.size());
+	    std::vector<pos_type> lengths(candidates.size());
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static,1)
+#endif
+	    for (long k=0; k<(long)candidates.size(); ++k) {
+		AlignerImpl &w = (k==0) ? *this : *workers_[k-1];
+		scores[k] = w.align_modified(candidates[k],lengths[k]);
+	    }
+
+	    if (log) *log << "Bracketing round "<<round<<std::endl;
+
+	    for (size_t k=0; k<candidates.size(); ++k) {
+		score_t c = candidates[k];
+		score_t ratio = scores[k].finite_value()/(lengths[k]+L);
+		evaluated.insert(c);
+
+		// the traced alignment is empty if no alignment has a
+		// positive modified score
+		bool empty = scores[k].finite_value() <= (score_t)lengths[k]*c;
+
+		if (log) {
+		    *log << "Lambda: "<<c;
+		    if (empty) {
+			*log << " Empty alignment";
+		    } else {
+			*log << " Score: "<<scores[k]
+			     <<" Length: "<<lengths[k]
+			     <<" Normalized Score: "<<ratio;
+		    }
+		    *log <<std::endl;
+		}
+
+		if (empty) {
+		    // all alignments have a normalized score below c
+		    // (for L=0, at most c; like the empty alignment,
+		    // which wins such ties in the top level alignment,
+		    // they are not reported)
+		    if (!have_hi || c<hi) {
+			have_hi=true;
+			hi=c;
+		    }
+		    if (c>0 || have_lo) continue;
+		    // no alignment has a positive score
+		    ratio=0;
+		}
+
+		if (!have_lo || ratio>lo) {
+		    const AlignerImpl &w = (k==0) ? *this : *workers_[k-1];
+		    have_lo=true;
+		    lo=ratio;
+		    best_alignment=w.alignment_;
+		    best_bounds[0]=w.min_i_;
+		    best_bounds[1]=w.min_j_;
+		    best_bounds[2]=w.max_i_;
+		    best_bounds[3]=w.max_j_;
+		}
+		if (ratio<c && (!have_hi || c<hi)) {
+		    have_hi=true;
+		    hi=c;
+		}
+	    }
+	}
+
+	alignment_=best_alignment;
+	min_i_=best_bounds[0];
+	min_j_=best_bounds[1];
+	max_i_=best_bounds[2];
+	max_j_=best_bounds[3];
+
+	last_lambda_=lo;
+
+	if (log) {
+	    MultipleAlignment ma(alignment_,true);
+	    *log << "Certified normalized score: "<<lo<<" (after "<<round<<" rounds)"<<std::endl;
+	    ma.write(*log,120,MultipleAlignment::FormatType::CLUSTAL);
+	    *log<<std::endl;
+	}
+
+	return (infty_score_t)lo;
+    }
+
+    infty_score_t
+    Aligner::normalized_align(score_t L, bool opt_verbose) {
+	return pimpl_->normalized_align(L, opt_verbose ? &std::cout : 0L);
     }
 
     // ------------------------------------------------------------
@@ -1561,8 +1876,8 @@ namespace LocARNA {
     	// The D matrix is filled
     	if (!pimpl_->D_created_) pimpl_->align_D();
 
-        if (pimpl_->mod_scoring_) delete pimpl_->mod_scoring_;
-        pimpl_->mod_scoring_=new Scoring(*pimpl_->scoring_); // make mod_scoring point to a copy of scoring
+        // make mod_scoring point to a copy of scoring (reused, see normalized_align())
+        if (!pimpl_->mod_scoring_) pimpl_->mod_scoring_=new Scoring(*pimpl_->scoring_);
 
 
         // modify the scoring by lambda
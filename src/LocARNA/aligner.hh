@@ -122,7 +122,11 @@ namespace LocARNA {
 	infty_score_t
 	align();
     
-	//! offer trace as public method. Calls trace(def_scoring_view).
+	/**
+	 * @brief offer trace as public method. Calls trace(def_scoring_view).
+	 *
+	 * @note not available in score only mode
+	 */
 	void
 	trace();
     
@@ -16,7 +16,45 @@
 namespace LocARNA {
 
     class Sequence;
-    template <class T> class Matrix;
+
+    /**
+     * @brief Subproblem of the k-best alignment
+     *
+     * A subproblem is evaluated, when its alignment is known. For
+     * sequence local alignment, the evaluation additionally provides
+     * the scores of all restrictions that differ from the subproblem
+     * only by the end in the sequence that is split.
+     */
+    struct SuboptimalSubproblem {
+	AlignerRestriction r; //!< restriction
+	bool evaluated; //!< whether the alignment is known
+	Alignment alignment; //!< alignment (empty if not evaluated)
+	
+	//! scores of the subproblem for ends in the split sequence
+	//! (empty if not available)
+	std::vector<infty_score_t> prefix_scores;
+
+	//! verbose output of the evaluation, written when the
+	//! alignment is reported
+	std::string log;
+	
+	/**
+	 * @brief construct not evaluated subproblem
+	 * @param r_ restriction
+	 * @param seqA sequence A
+	 * @param seqB sequence B
+	 */
+	SuboptimalSubproblem(const AlignerRestriction &r_,
+			     const Sequence &seqA,
+			     const Sequence &seqB)
+	    : r(r_),evaluated(false),alignment(seqA,seqB),prefix_scores(),log() {}
+	
+	//! @brief whether sequence A is split (otherwise B)
+	bool
+	splitA() const {
+	    return r.endA()-r.startA() > r.endB()-r.startB();
+	}
+    };
 
     /**
      * @brief Implementation of Aligner
@@ -249,6 +287,14 @@ namespace LocARNA {
 	ModifiedScoringView mod_scoring_view_; //!< Modified scoring view for normalized alignment
 	FreeEndgapsDescription free_endgaps_;
 
+	//! copies of the aligner that evaluate further candidate
+	//! lambdas in fast normalized alignment (created on demand)
+	std::vector<AlignerImpl *> workers_;
+
+	//! result of the last fast normalized alignment, where the
+	//! next one starts
+	score_t last_lambda_;
+
 	// ============================================================
 	
 	/** 
@@ -363,6 +409,94 @@ namespace LocARNA {
 	 */
 	template<class ScoringView>
 	infty_score_t align_top_level_locally(ScoringView sv);
+
+	/**
+	 * @brief scores of local alignments in prefixes of the restriction
+	 *
+	 * The entries of the top level matrix of a sequence local
+	 * alignment do not depend on the ends of the restriction.
+	 * Therefore, after align_top_level_locally(), the score of the
+	 * restriction with end i in A (or j in B) is the maximum of the
+	 * entries in the rows up to i (columns up to j).
+	 *
+	 * @param inA whether to compute the scores for ends in A (otherwise B)
+	 * @param[out] scores scores[i] is the score for end i (start-1<=i<=end)
+	 *
+	 * @pre align_top_level_locally() was called for the current
+	 * restriction with default scoring view and the top level matrix
+	 * was not changed since (e.g. by trace())
+	 */
+	void
+	local_prefix_scores(bool inA, std::vector<infty_score_t> &scores) const;
+
+	/**
+	 * @brief evaluate subproblem of k-best alignment
+	 *
+	 * Aligns the restriction of the subproblem; if the score passes
+	 * the threshold, traces the alignment. For sequence local
+	 * alignment, additionally stores the prefix scores (see
+	 * local_prefix_scores()) for the sequence that is split.
+	 *
+	 * @param[in,out] sp subproblem
+	 * @param threshold score threshold
+	 * @param opt_normalized whether to use normalized alignment
+	 * @param normalized_L parameter L of normalized alignment
+	 * @param opt_verbose whether to log the Dinkelbach iterations
+	 * of normalized alignment (in sp.log)
+	 *
+	 * @return score of the subproblem
+	 */
+	infty_score_t
+	evaluate_subproblem(SuboptimalSubproblem &sp,
+			    score_t threshold,
+			    bool opt_normalized,
+			    score_t normalized_L,
+			    bool opt_verbose);
+
+	/**
+	 * @brief normalized local alignment (Dinkelbach's algorithm)
+	 *
+	 * @param L parameter L of normalized alignment
+	 * @param log stream for reporting the iterations (0L for no
+	 * report)
+	 *
+	 * @return normalized score; the alignment is traced
+	 */
+	infty_score_t
+	normalized_align(score_t L, std::ostream *log);
+
+	/**
+	 * @brief fast normalized local alignment
+	 *
+	 * Brackets the optimal normalized score by evaluating several
+	 * candidate lambdas in parallel (one per thread, each on its
+	 * own copy of the aligner). The first candidate is the result
+	 * of the last call (warm start); the bracketing stops when the
+	 * bounds certify the optimum.
+	 *
+	 * @param L parameter L of normalized alignment
+	 * @param log stream for reporting the rounds (0L for no report)
+	 *
+	 * @return normalized score; the alignment is traced
+	 * @see AlignerParams::fast_normalized()
+	 */
+	infty_score_t
+	normalized_align_fast(score_t L, std::ostream *log);
+
+	/**
+	 * @brief align with scores modified by lambda
+	 *
+	 * Aligns the top level locally, where each aligned position
+	 * is penalized by lambda, and traces the best alignment.
+	 *
+	 * @param lambda the penalty
+	 * @param[out] length length of the traced alignment (sum of
+	 * the lengths of the aligned subsequences)
+	 *
+	 * @return unmodified score of the traced alignment
+	 */
+	infty_score_t
+	align_modified(score_t lambda, pos_type &length);
     
 	//! align top level in the scanning version
 	// infty_score_t align_top_level_localB();
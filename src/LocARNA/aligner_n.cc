@@ -44,8 +44,10 @@ namespace LocARNA {
 	  Emat(a.Emat),
 	  Fmat(a.Fmat),
 	  M(a.M),
-	  gapCostAmat(a.gapCostAmat),
-	  gapCostBmat(a.gapCostBmat),
+	  gap_prefixA(a.gap_prefixA),
+	  gap_prefixB(a.gap_prefixB),
+	  anchor_countA(a.anchor_countA),
+	  anchor_countB(a.anchor_countB),
 	  min_i(a.min_i),
 	  min_j(a.min_j),
 	  max_i(a.max_i),
@@ -100,10 +102,6 @@ namespace LocARNA {
 	Emat.resize(mapperA.get_max_info_vec_size()+1, mapperB.get_max_info_vec_size()+1);
 	Fmat.resize(mapperA.get_max_info_vec_size()+1, mapperB.get_max_info_vec_size()+1);
 
-
-	gapCostAmat.resize(seqA.length()+3, seqA.length()+3);
-	gapCostBmat.resize(seqB.length()+3, seqB.length()+3);
-
 	trace_debugging_output=false; //!< a static switch to enable generating debugging logs
 	do_cond_bottom_up=false;
 
@@ -118,8 +116,10 @@ namespace LocARNA {
 	if (mod_scoring!=0) delete mod_scoring;
     }
 
-    // Computes and stores score of aligning a the subsequence between
-    // different possible leftSides & rightSides to the gap
+    // Computes and stores the cost of aligning each prefix of the
+    // sequence to the gap; by the anchor counts, this determines the
+    // score of aligning any subsequence to the gap (replacing a
+    // quadratic table of these scores)
     template <class ScoringView>
     void AlignerN::computeGapCosts(bool isA, ScoringView sv)
     {
@@ -127,46 +127,45 @@ namespace LocARNA {
 	    std::cout << "computeGapCosts " << (isA?'A':'B') << std::endl;
 	}
 	const Sequence& seqX = isA?seqA:seqB;
-	ScoreMatrix& gapCostXmat = isA?gapCostAmat:gapCostBmat;
-	for( pos_type leftSide = 0;  leftSide <= seqX.length(); leftSide++)
-	    {
-		infty_score_t gap_score = (infty_score_t)0;
-		gapCostXmat(leftSide, leftSide) = gap_score;
-		for( pos_type lastPos = leftSide+1;  lastPos <= seqX.length(); lastPos++)
-		    {
-			if ( (isA && params->constraints_->aligned_in_a(lastPos))
-			     || ( !isA && params->constraints_->aligned_in_b(lastPos)) ) {
-			    gap_score = infty_score_t::neg_infty;
-			    //		break;
-			}
-			else {
-			    gap_score += sv.scoring()->gapX( lastPos, isA);
-			}
-
-			gapCostXmat(leftSide,lastPos+1) = gap_score;
-		    }
-		/*for (;lastPos <= seqX.length(); lastPos++)
-		  {
-		  gapCostXmat(leftSide,lastPos+1) = gap_score;
-		  }*/
-	    }
+	std::vector<score_t> &gap_prefix = isA?gap_prefixA:gap_prefixB;
+	std::vector<size_type> &anchor_count = isA?anchor_countA:anchor_countB;
+	anchor_count.resize(seqX.length()+1);
+	anchor_count[0] = 0;
+
+	gap_prefix.resize(seqX.length()+1);
+	gap_prefix[0] = 0;
+	for (pos_type pos = 1; pos <= seqX.length(); pos++) {
+	    gap_prefix[pos] = gap_prefix[pos-1] + sv.scoring()->gapX(pos, isA);
+	    bool aligned = isA ? params->constraints_->aligned_in_a(pos)
+		: params->constraints_->aligned_in_b(pos);
+	    anchor_count[pos] = anchor_count[pos-1] + (aligned?1:0);
+	}
 	if (trace_debugging_output)
 	    std::cout << "computed computeGapCosts " << (isA?'A':'B') << std::endl;
 
     }
 
     // Returns score of aligning a the subsequence between leftSide &
-    // rightSide to the gap, not including right/left side
+    // rightSide to the gap, not including right/left side; -infinity
+    // if the subsequence contains positions that are aligned due to
+    // anchor constraints
     inline
     infty_score_t AlignerN::getGapCostBetween( pos_type leftSide, pos_type rightSide, bool isA)
-    //todo: Precompute the matrix?!
     {
-	//    if (trace_debugging_output) std::cout <<
-	//    "getGapCostBetween: leftSide:" << leftSide << "
-	//    rightSide:" << rightSide << "isA:" << isA << endl;
 	assert(leftSide < rightSide);
 
-	return (isA?gapCostAmat(leftSide,rightSide):gapCostBmat(leftSide, rightSide));
+	if (rightSide == leftSide+1) {
+	    return (infty_score_t)0;
+	}
+
+	const std::vector<score_t> &gap_prefix = isA?gap_prefixA:gap_prefixB;
+	const std::vector<size_type> &anchor_count = isA?anchor_countA:anchor_countB;
+	assert(rightSide-1 < gap_prefix.size());
+
+	if (anchor_count[rightSide-1] > anchor_count[leftSide]) {
+	    return infty_score_t::neg_infty;
+	}
+	return (infty_score_t)(gap_prefix[rightSide-1]-gap_prefix[leftSide]);
     }
 
 
@@ -916,10 +915,21 @@ namespace LocARNA {
 
 	// for al in r.endA() .. r.startA
 
+	// in score only mode, rows of D, IAD and IBD are released as
+	// soon as they cannot be read anymore
+	std::vector<ArcIdxVec> release_lists;
+	if (params->score_only_) {
+	    compute_release_lists(release_lists);
+	}
+
 	for (pos_type al=r.endA()+1; al>r.startA(); ) {
 	    al--;
 	    if (trace_debugging_output) std::cout << "align_D al: " << al << std::endl;
 
+	    if (params->score_only_) {
+		release_rows(release_lists[al+1]);
+	    }
+
 	    const BasePairs::LeftAdjList &adjlA = bpsA.left_adjlist(al);
 	    if ( adjlA.empty() )
 		{
@@ -1080,9 +1090,50 @@ namespace LocARNA {
 	if (trace_debugging_output) std::cout << "M matrix:" << std::endl << M << std::endl;
 	if (trace_debugging_output) std::cout << "D matrix:" << std::endl << Dmat << std::endl;
 
+	if (params->score_only_) {
+	    release_rows(release_lists[r.startA()]);
+	}
+
 	D_created=true; // now the matrix D is built up
     }
 
+    void
+    AlignerN::compute_release_lists(std::vector<ArcIdxVec> &release_lists) const {
+	// position, where the row of each arc is read for the last time
+	std::vector<pos_type> last_read(bpsA.num_bps());
+	for (ArcIdx idx=0; idx<bpsA.num_bps(); ++idx) {
+	    last_read[idx] = bpsA.arc(idx).left();
+	}
+
+	// loops indexed by their left ends; index r.startA()-1 is the
+	// top level
+	for (pos_type loop_left=0; loop_left<=seqA.length(); ++loop_left) {
+	    const SparsificationMapper::InfoForPosVec &infos =
+		mapperA.valid_seq_positions(loop_left);
+	    for (size_type k=0; k<infos.size(); ++k) {
+		const ArcIdxVec &arcs = infos[k].valid_arcs;
+		for (ArcIdxVec::const_iterator it=arcs.begin(); it!=arcs.end(); ++it) {
+		    last_read[*it] = std::min(last_read[*it],loop_left);
+		}
+	    }
+	}
+
+	release_lists.clear();
+	release_lists.resize(seqA.length()+2);
+	for (ArcIdx idx=0; idx<bpsA.num_bps(); ++idx) {
+	    release_lists[last_read[idx]].push_back(idx);
+	}
+    }
+
+    void
+    AlignerN::release_rows(const ArcIdxVec &arcs) {
+	for (ArcIdxVec::const_iterator it=arcs.begin(); it!=arcs.end(); ++it) {
+	    Dmat.release_row(*it);
+	    IADmat.release_row(*it);
+	    IBDmat.release_row(*it);
+	}
+    }
+
 
     // compute the alignment score
     infty_score_t
@@ -1907,6 +1958,10 @@ namespace LocARNA {
 
     void
     AlignerN::trace() {
+	if (params->score_only_) {
+	    throw failure("AlignerN: trace is not available in score only mode.");
+	}
+
 	stopwatch.start("trace");
 
 	trace(def_scoring_view);
@@ -14,7 +14,7 @@
 #include "params.hh"
 #include "scoring.hh"
 
-#include "matrix.hh"
+#include "matrices.hh"
 
 #include "aligner_restriction.hh"
 
@@ -48,6 +48,9 @@ namespace LocARNA {
 	//! type of matrix M
 	typedef ScoreMatrix M_matrix_t;
 
+	//! type of matrices D, IAD and IBD (rows indexed by arcs of A)
+	typedef RowMatrix<infty_score_t> D_matrix_t;
+
     private:
     bool trace_debugging_output; //!< a static switch to enable generating debugging logs
     bool do_cond_bottom_up;
@@ -76,7 +79,7 @@ namespace LocARNA {
 	AlignerRestriction r;
 
 	//! matrix indexed by the arc indices of rnas A and B
-	ScoreMatrix Dmat;
+	D_matrix_t Dmat;
 
 	//! matrix indexed by positions of elements of the seqA positions and the arc indices of RNA B
 	ScoreMatrix IAmat;
@@ -85,9 +88,9 @@ namespace LocARNA {
 
 
 	//! matrix indexed by positions of elements of the seqA positions and the arc indices of RNA B
-	ScoreMatrix IADmat;
+	D_matrix_t IADmat;
 	//! matrix indexed by positions of elements of the seqB positions and the arc indices of RNA A
-	ScoreMatrix IBDmat;
+	D_matrix_t IBDmat;
 
 	//! matrix for the affine gap cost model base deletion
 	ScoreMatrix Emat;
@@ -101,15 +104,21 @@ namespace LocARNA {
 	 */
 	M_matrix_t M;
 
-	//! matrix to store cost of deleting/inserting a subsequence
-	//! of sequence A, indexed by neighboring positions of the
-	//! range
-	ScoreMatrix gapCostAmat;
-	
-	//! matrix to store cost of deleting/inserting a subsequence
-	//! of sequence B, indexed by neighboring positions of the
-	//! range
-	ScoreMatrix gapCostBmat; 
+	//! gap_prefixA[i] is the cost of deleting/inserting the
+	//! prefix 1..i of sequence A (ignoring anchor constraints)
+	std::vector<score_t> gap_prefixA;
+
+	//! gap_prefixB[i] is the cost of deleting/inserting the
+	//! prefix 1..i of sequence B (ignoring anchor constraints)
+	std::vector<score_t> gap_prefixB;
+
+	//! number of positions of A up to each position that are
+	//! aligned due to anchor constraints
+	std::vector<size_type> anchor_countA;
+
+	//! number of positions of B up to each position that are
+	//! aligned due to anchor constraints
+	std::vector<size_type> anchor_countB;
 
 
 	int min_i; //!< subsequence of A left end, not used in sparse
@@ -306,7 +315,7 @@ namespace LocARNA {
 	void init_M_E_F(pos_type al, pos_type ar, pos_type bl, pos_type br,ScoringView sv);
 
 	/**
-	 * \brief compute and stores score of aligning subsequences to the gap
+	 * \brief compute and store prefix sums of the costs for aligning subsequences to the gap
 	 *
 	 * @param isA a switch to determine the target sequence A or B
 	 * @param sv the scoring view to be used
@@ -521,6 +530,28 @@ namespace LocARNA {
 	*/
 	void align_D();
 
+	/**
+	 * @brief determine when rows of D, IAD and IBD can be released
+	 *
+	 * @param[out] release_lists release_lists[al] lists the arcs
+	 * of A, whose rows are not read anymore after computing the
+	 * entries for arcs with left end al
+	 *
+	 * The row of an arc is read while aligning the arc itself
+	 * and the loops where the arc is valid. Arcs that are valid
+	 * at the top level are never released.
+	 *
+	 * @note used in score only mode
+	 */
+	void compute_release_lists(std::vector<ArcIdxVec> &release_lists) const;
+
+	/**
+	 * @brief release rows of D, IAD and IBD
+	 *
+	 * @param arcs indices of arcs in A
+	 */
+	void release_rows(const ArcIdxVec &arcs);
+
 	/**
 	 * fill in D the entries with left ends al,bl
 	 * @param al position in sequence A: left end of current arc match
@@ -663,7 +694,11 @@ namespace LocARNA {
 	infty_score_t
 	align();
 
-	//! offer trace as public method. Calls trace(def_scoring_view).
+	/**
+	 * @brief offer trace as public method. Calls trace(def_scoring_view).
+	 *
+	 * @note not available in score only mode
+	 */
 	void
 	trace();
 
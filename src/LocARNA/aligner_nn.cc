@@ -42,8 +42,11 @@ namespace LocARNA {
 	  Emat(a.Emat),
 	  Fmat(a.Fmat),
 	  M(a.M),
-	  gapCostAmat(a.gapCostAmat),
-	  gapCostBmat(a.gapCostBmat),
+	  gap_prefixA(a.gap_prefixA),
+	  gap_prefixB(a.gap_prefixB),
+	  anchor_countA(a.anchor_countA),
+	  anchor_countB(a.anchor_countB),
+	  free_endgaps(a.free_endgaps),
 	  min_i(a.min_i),
 	  min_j(a.min_j),
 	  max_i(a.max_i),
@@ -67,6 +70,7 @@ namespace LocARNA {
 	  bpsA(params->arc_matches_->get_base_pairsA()),
 	  bpsB(params->arc_matches_->get_base_pairsB()),
 	  r(1,1,params->seqA_->length(),params->seqB_->length()),
+	  free_endgaps(params->free_endgaps_),
 	  min_i(0),
 	  min_j(0),
 	  max_i(0),
@@ -95,9 +99,8 @@ namespace LocARNA {
 	Emat.resize(mapper_arcsA.get_max_info_vec_size()+1, mapper_arcsB.get_max_info_vec_size()+1);
 	Fmat.resize(mapper_arcsA.get_max_info_vec_size()+1, mapper_arcsB.get_max_info_vec_size()+1);
 
-
-	gapCostAmat.resize(seqA.length()+3, seqA.length()+3);
-	gapCostBmat.resize(seqB.length()+3, seqB.length()+3);
+	compute_anchor_counts(true, anchor_countA);
+	compute_anchor_counts(false, anchor_countB);
 
 	trace_debugging_output=false; //!< a static switch to enable generating debugging logs
 	do_cond_bottom_up=false;
@@ -113,8 +116,10 @@ namespace LocARNA {
 	if (mod_scoring!=0) delete mod_scoring;
     }
 
-    // Computes and stores score of aligning a the subsequence between
-    // different possible leftSides & rightSides to the gap
+    // Computes and stores the cost of aligning each prefix of the
+    // sequence to the gap; by the anchor counts, this determines the
+    // score of aligning any subsequence to the gap (replacing a
+    // quadratic table of these scores)
     template <class ScoringView>
     void AlignerNN::computeGapCosts(bool isA, ScoringView sv)
     {
@@ -122,49 +127,51 @@ namespace LocARNA {
 	    std::cout << "computeGapCosts " << (isA?'A':'B') << std::endl;
 	}
 	const Sequence& seqX = isA?seqA:seqB;
-	ScoreMatrix& gapCostXmat = isA?gapCostAmat:gapCostBmat;
-	for( pos_type leftSide = 0;  leftSide <= seqX.length(); leftSide++)
-	    {
-		infty_score_t gap_score = (infty_score_t)0;
-		gapCostXmat(leftSide, leftSide) = gap_score;
-		for( pos_type lastPos = leftSide+1;  lastPos <= seqX.length(); lastPos++)
-		    {
-			if ( (isA && params->constraints_->aligned_in_a(lastPos))
-			     || ( !isA && params->constraints_->aligned_in_b(lastPos)) ) {
-			    gap_score = infty_score_t::neg_infty;
-			    //		break;
-			}
-			else {
-			    gap_score += sv.scoring()->gapX( lastPos, isA);
-			}
-
-			gapCostXmat(leftSide,lastPos+1) = gap_score;
-		    }
-		/*for (;lastPos <= seqX.length(); lastPos++)
-		  {
-		  gapCostXmat(leftSide,lastPos+1) = gap_score;
-		  }*/
-	    }
+	std::vector<score_t> &gap_prefix = isA?gap_prefixA:gap_prefixB;
+	gap_prefix.resize(seqX.length()+1);
+	gap_prefix[0] = 0;
+	for (pos_type pos = 1; pos <= seqX.length(); pos++) {
+	    gap_prefix[pos] = gap_prefix[pos-1] + sv.scoring()->gapX(pos, isA);
+	}
 	if (trace_debugging_output)
 	    std::cout << "computed computeGapCosts " << (isA?'A':'B') << std::endl;
 
     }
 
     // Returns score of aligning a the subsequence between leftSide &
-    // rightSide to the gap, not including right/left side
+    // rightSide to the gap, not including right/left side; -infinity
+    // if the subsequence contains positions that are aligned due to
+    // anchor constraints
     inline
     infty_score_t AlignerNN::getGapCostBetween( pos_type leftSide, pos_type rightSide, bool isA)
-    //todo: Precompute the matrix?!
     {
-//	    if (trace_debugging_output) std::cout <<
-//	    "getGapCostBetween: leftSide:" << leftSide <<
-//	    "rightSide:" << rightSide << "isA:" << isA << std::endl;
-//	if (leftSide >= rightSide && rightSide == 0) // empty arc for domain ins
-//		return (infty_score_t)0;
-
 	assert(leftSide < rightSide);
 
-	return (isA?gapCostAmat(leftSide,rightSide):gapCostBmat(leftSide, rightSide));
+	if (rightSide == leftSide+1) {
+	    return (infty_score_t)0;
+	}
+
+	const std::vector<score_t> &gap_prefix = isA?gap_prefixA:gap_prefixB;
+	const std::vector<size_type> &anchor_count = isA?anchor_countA:anchor_countB;
+	assert(rightSide-1 < gap_prefix.size());
+
+	if (anchor_count[rightSide-1] > anchor_count[leftSide]) {
+	    return infty_score_t::neg_infty;
+	}
+	return (infty_score_t)(gap_prefix[rightSide-1]-gap_prefix[leftSide]);
+    }
+
+    void
+    AlignerNN::compute_anchor_counts(bool isA, std::vector<size_type> &anchor_count) const {
+	const Sequence& seqX = isA?seqA:seqB;
+	anchor_count.resize(seqX.length()+2);
+	anchor_count[0] = 0;
+	for (pos_type pos = 1; pos <= seqX.length()+1; pos++) {
+	    bool aligned = pos <= seqX.length()
+		&& ( isA ? params->constraints_->aligned_in_a(pos)
+		     : params->constraints_->aligned_in_b(pos) );
+	    anchor_count[pos] = anchor_count[pos-1] + (aligned?1:0);
+	}
     }
 
 
@@ -174,15 +181,17 @@ namespace LocARNA {
     AlignerNN::compute_IX(ArcIdx idxX, const Arc& arcY,
 			 matidx_t i_index, bool isA, ScoringView sv) {
 
-	//constraints are ignored,
-	//params->constraints_->aligned_in_a(i_seq_pos);
-	bool constraints_aligned_pos = false; 
 	const BasePairs &bpsX = isA? bpsA : bpsB;
 	const SparsificationMapper &mapper_arcsX = isA ? mapper_arcsA : mapper_arcsB;
 
 	pos_type xl = get_arc_leftend(idxX, isA);
 
 	seq_pos_t i_seq_pos = mapper_arcsX.get_pos_in_seq_new(idxX, i_index);
+
+	// anchored positions cannot be deleted
+	bool constraints_aligned_pos = isA
+	    ? params->constraints_->aligned_in_a(i_seq_pos)
+	    : params->constraints_->aligned_in_b(i_seq_pos);
 	
 	seq_pos_t i_prev_seq_pos = mapper_arcsX.get_pos_in_seq_new(idxX, i_index-1);
 	//TODO: Check border i_index==1,0
@@ -210,6 +219,12 @@ namespace LocARNA {
 	for (ArcIdxVec::const_iterator arcIdx = arcIdxVecX.begin(); 
 	     arcIdx != arcIdxVecX.end(); ++arcIdx) {
 	    const Arc& arcX = bpsX.arc(*arcIdx);
+	    // anchored ends cannot be deleted
+	    if ( isA
+		 ? (params->constraints_->aligned_in_a(arcX.left())
+		    || params->constraints_->aligned_in_a(arcX.right()))
+		 : (params->constraints_->aligned_in_b(arcX.left())
+		    || params->constraints_->aligned_in_b(arcX.right())) ) continue;
 	    infty_score_t gap_score =  getGapCostBetween(xl, arcX.left(), isA);
 	    if (gap_score.is_finite()) {
 		// convert the base gap score to the loop gap score
@@ -242,7 +257,7 @@ namespace LocARNA {
     infty_score_t
     AlignerNN::compute_E_entry(seq_pos_t al_seq_pos, matidx_t i_index, matidx_t j_index, seq_pos_t i_seq_pos, seq_pos_t i_prev_seq_pos, ScoringView sv)
     {
-	bool constraints_aligned_pos_A = false; // TOcheck: Probably unnecessary, constraints are not considered
+	bool constraints_aligned_pos_A = params->constraints_->aligned_in_a(i_seq_pos);
 	if (i_seq_pos <= al_seq_pos || constraints_aligned_pos_A) //check possibility of base deletion
 	    return infty_score_t::neg_infty;
 
@@ -263,8 +278,7 @@ namespace LocARNA {
 			      matidx_t i_index, matidx_t j_index,
 			      seq_pos_t j_seq_pos, seq_pos_t j_prev_seq_pos, ScoringView sv)
     {
-	bool constraints_aligned_pos_B = false;
-	// TOcheck: Probably unnecessary, constraints are not considered
+	bool constraints_aligned_pos_B = params->constraints_->aligned_in_b(j_seq_pos);
 	if (j_seq_pos <= bl_seq_pos || constraints_aligned_pos_B) //check possibility of base deletion
 	    return infty_score_t::neg_infty;
 
@@ -284,12 +298,11 @@ namespace LocARNA {
 							seq_pos_t al_seq_pos,seq_pos_t bl_seq_pos,
 				  matidx_t i_index, matidx_t j_index, ScoringView sv) {
 
-	bool constraints_alowed_edge = true;
-	// constraints are ignored,  params->constraints_->allowed_edge(i_seq_pos, j_seq_pos)
 	tainted_infty_score_t max_score = infty_score_t::neg_infty;
 	//define variables for sequence positions
 	seq_pos_t i_seq_pos = mapper_arcsA.get_pos_in_seq_new(idxA, i_index);
 	seq_pos_t j_seq_pos = mapper_arcsB.get_pos_in_seq_new(idxB, j_index);
+	bool constraints_alowed_edge = params->constraints_->allowed_edge(i_seq_pos, j_seq_pos);
 	seq_pos_t i_prev_seq_pos = mapper_arcsA.get_pos_in_seq_new(idxA, i_index-1);
 	//TODO: Check border i_index==1,0
 	seq_pos_t j_prev_seq_pos = mapper_arcsB.get_pos_in_seq_new(idxB, j_index-1);
@@ -312,30 +325,48 @@ namespace LocARNA {
 		opening_cost_B = sv.scoring()->indel_opening();
 	}
 
+	// at the top level, a free prefix (column/row 0) is gapped
+	// without cost, including the implicit gaps in front of the
+	// first match; sequence local alignments can start at any match
+	bool top_level = is_top_level(idxA, idxB);
+	bool free_prefixA = top_level && free_prefix(true);
+	bool free_prefixB = top_level && free_prefix(false);
+	bool local_start = top_level && params->sequ_local_;
+
 	// base match
 	if ( constraints_alowed_edge
 		 && mapper_arcsA.pos_unpaired(idxA, i_index)
 		 && mapper_arcsB.pos_unpaired(idxB, j_index) ) {
 
+		bool free_gapA = free_prefixA && j_index==1;
+		bool free_gapB = free_prefixB && i_index==1;
+
 		infty_score_t gap_match_score =
-		getGapCostBetween(i_prev_seq_pos, i_seq_pos, true)
-		+ getGapCostBetween(j_prev_seq_pos, j_seq_pos, false)
+		(free_gapA ? (infty_score_t)0 : getGapCostBetween(i_prev_seq_pos, i_seq_pos, true))
+		+ (free_gapB ? (infty_score_t)0 : getGapCostBetween(j_prev_seq_pos, j_seq_pos, false))
 		+ (sv.scoring()->basematch(i_seq_pos, j_seq_pos));
+		score_t match_opening_A = free_gapA ? 0 : opening_cost_A;
+		score_t match_opening_B = free_gapB ? 0 : opening_cost_B;
 
 		max_score =
 		std::max( max_score,
-			  gap_match_score + opening_cost_B
+			  gap_match_score + match_opening_B
 			  + Emat(i_index-1, j_index-1) );
 		max_score =
 		std::max( max_score,
-			  gap_match_score + opening_cost_A
+			  gap_match_score + match_opening_A
 			  + Fmat(i_index-1, j_index-1) );
 		max_score =
 		std::max( max_score,
 			  gap_match_score
-			  + opening_cost_A + opening_cost_B
+			  + match_opening_A + match_opening_B
 			  + M(i_index-1, j_index-1) );
 
+		if (local_start && local_start_allowed(i_seq_pos, j_seq_pos)) {
+			max_score =
+			std::max( max_score,
+				  (tainted_infty_score_t)sv.scoring()->basematch(i_seq_pos, j_seq_pos) );
+		}
 	}
 	// base del, for efficiency compute_E/F entry invoked within compute_M_entry
 	Emat(i_index, j_index) =
@@ -361,6 +392,8 @@ namespace LocARNA {
 			const Arc& arcA = bpsA.arc(*arcAIdx);
 			if(params->multiloop_deletion_< (arcA.right()-arcA.left()+1) ) // Todo: if the adjlist is sorted we can return instead of continue
 				continue;
+			if (anchors_between(arcA.left(), arcA.right(), true)>0) // anchored positions cannot be deleted
+				continue;
 			matidx_t  arcA_left_index_before   =
 			mapper_arcsA.first_valid_mat_pos_before(idxA, arcA.left(), al_seq_pos);
 			seq_pos_t arcA_left_seq_pos_before =
@@ -405,6 +438,8 @@ namespace LocARNA {
 			const Arc& arcB = bpsB.arc(*arcBIdx);
 			if(params->multiloop_deletion_< (arcB.right()-arcB.left()+1) ) // Todo: if the adjlist is sorted we can return instead of continue
 				continue;
+			if (anchors_between(arcB.left(), arcB.right(), false)>0) // anchored positions cannot be deleted
+				continue;
 
 			matidx_t  arcB_left_index_before   =
 			mapper_arcsB.first_valid_mat_pos_before(idxB, arcB.left(), bl_seq_pos);
@@ -441,6 +476,7 @@ namespace LocARNA {
 		}
 	}
 	// arc match
+	if ( !constraints_alowed_edge ) return max_score;
 	for (ArcIdxVec::const_iterator arcAIdx = arcsA.begin();
 		 arcAIdx != arcsA.end();
 		 ++arcAIdx) {
@@ -461,6 +497,7 @@ namespace LocARNA {
 		 ++arcBIdx) {
 		const Arc& arcB = bpsB.arc(*arcBIdx);
 
+		if (!params->constraints_->allowed_edge(arcA.left(), arcB.left())) continue;
 
 		matidx_t arcB_left_index_before =
 			mapper_arcsB.first_valid_mat_pos_before(idxB, arcB.left(), bl_seq_pos);
@@ -473,6 +510,11 @@ namespace LocARNA {
 			opening_cost_B = sv.scoring()->indel_opening();
 		}
 
+		bool free_gapA = free_prefixA && arcB_left_index_before==0;
+		bool free_gapB = free_prefixB && arcA_left_index_before==0;
+		score_t match_opening_A = free_gapA ? 0 : opening_cost_A;
+		score_t match_opening_B = free_gapB ? 0 : opening_cost_B;
+
 		if (trace_debugging_output) {
 			std::cout << "\tmatching arcs: arcA" << arcA << "arcB:" << arcB
 				  << " D(arcA,arcB)=" << sv.D( arcA, arcB )
@@ -484,13 +526,13 @@ namespace LocARNA {
 				  << std::endl;
 		}
 		infty_score_t gap_match_score =
-			getGapCostBetween( arcA_left_seq_pos_before, arcA.left(), true)
-			+ getGapCostBetween( arcB_left_seq_pos_before, arcB.left(), false)
+			(free_gapA ? (infty_score_t)0 : getGapCostBetween( arcA_left_seq_pos_before, arcA.left(), true))
+			+ (free_gapB ? (infty_score_t)0 : getGapCostBetween( arcB_left_seq_pos_before, arcB.left(), false))
 			+ sv.D( arcA, arcB ) + sv.scoring()->arcmatch(arcA, arcB);
 
 		tainted_infty_score_t arc_match_score =
 			gap_match_score
-			+ opening_cost_A + opening_cost_B
+			+ match_opening_A + match_opening_B
 			+ M(arcA_left_index_before, arcB_left_index_before);
 
 //		 if (trace_debugging_output) {
@@ -501,16 +543,23 @@ namespace LocARNA {
 		arc_match_score =
 			std::max( arc_match_score,
 				  (gap_match_score
-				   + opening_cost_B
+				   + match_opening_B
 				   + Emat(arcA_left_index_before,
 					  arcB_left_index_before)) );
 		arc_match_score =
 			std::max( arc_match_score,
 				  (gap_match_score
-				   + opening_cost_A
+				   + match_opening_A
 				   + Fmat(arcA_left_index_before,
 					  arcB_left_index_before)) );
 
+		if (local_start && local_start_allowed(arcA.left(), arcB.left())) {
+			arc_match_score =
+				std::max( arc_match_score,
+					  (tainted_infty_score_t)(sv.D( arcA, arcB )
+								  + sv.scoring()->arcmatch(arcA, arcB)) );
+		}
+
 		if (arc_match_score > max_score) {
 			max_score = arc_match_score;
 			is_innermost_arcA = false;
@@ -549,9 +598,18 @@ namespace LocARNA {
 	Fmat(0,0) = infty_score_t::neg_infty;//tocheck:validity
 
 
+	// at the top level, free prefixes are deleted/inserted without
+	// cost; then the first column/row does not end in a gap that
+	// could be extended (see compute_M_entry)
+	bool top_level = is_top_level(idxA,idxB);
+	bool free_prefixA = top_level && free_prefix(true);
+	bool free_prefixB = top_level && free_prefix(false);
+
 	// init first column
 	//
-	infty_score_t indel_score = (infty_score_t)(sv.scoring()->indel_opening());
+	infty_score_t indel_score = free_prefixA
+	    ? (infty_score_t)0
+	    : (infty_score_t)(sv.scoring()->indel_opening());
 	for (matidx_t i_index = 1; i_index < mapper_arcsA.number_of_valid_mat_pos(idxA); i_index++) {
 
 	    seq_pos_t i_seq_pos = mapper_arcsA.get_pos_in_seq_new(idxA,i_index);
@@ -562,16 +620,16 @@ namespace LocARNA {
 	    //invalid positions between valid gaps
 
 	    if (!indel_score.is_neg_infty()) { //checked for optimization
-		/*	    if (params->constraints_->aligned_in_a(i_seq_pos) )
-			    {
-			    indel_score=infty_score_t::neg_infty;
-			    }
-			    else */ {
+		if (params->constraints_->aligned_in_a(i_seq_pos) )
+		    {
+			indel_score=infty_score_t::neg_infty;
+		    }
+		else if (!free_prefixA) {
 		    seq_pos_t i_prev_seq_pos = mapper_arcsA.get_pos_in_seq_new(idxA,i_index-1);
 		    indel_score = indel_score + getGapCostBetween(i_prev_seq_pos, i_seq_pos, true) + sv.scoring()->gapA(i_seq_pos);
 		}
 	    }
-	    Emat(i_index, 0) = indel_score;
+	    Emat(i_index, 0) = free_prefixA ? infty_score_t::neg_infty : indel_score;
 	    Fmat(i_index, 0) = infty_score_t::neg_infty;
 	    M(i_index,0) = indel_score;//same as Emat(i_index, 0);
 
@@ -579,21 +637,23 @@ namespace LocARNA {
 
 	// init first row
 	//
-	indel_score = (infty_score_t)(sv.scoring()->indel_opening());
+	indel_score = free_prefixB
+	    ? (infty_score_t)0
+	    : (infty_score_t)(sv.scoring()->indel_opening());
 	for (matidx_t j_index=1; j_index < mapper_arcsB.number_of_valid_mat_pos(idxB); j_index++) {
 	    seq_pos_t j_seq_pos = mapper_arcsB.get_pos_in_seq_new(idxB,j_index);
 	    if (!indel_score.is_neg_infty()) { //checked for optimization
-		/* if (params->constraints_->aligned_in_b(j_seq_pos)) {
-		   indel_score=infty_score_t::neg_infty;
-		   }
-		   else*/ {
+		if (params->constraints_->aligned_in_b(j_seq_pos)) {
+		    indel_score=infty_score_t::neg_infty;
+		}
+		else if (!free_prefixB) {
 		    seq_pos_t j_prev_seq_pos = mapper_arcsB.get_pos_in_seq_new(idxB,j_index-1);
 
 		    indel_score = indel_score + getGapCostBetween(j_prev_seq_pos, j_seq_pos, false) + sv.scoring()->gapB(j_seq_pos); //toask: infty_score_t operator+ overloading
 		}
 	    }
 	    Emat(0,j_index) = infty_score_t::neg_infty;
-	    Fmat(0,j_index) = indel_score;
+	    Fmat(0,j_index) = free_prefixB ? infty_score_t::neg_infty : indel_score;
 	    M(0,j_index) = indel_score; // same as Fmat(0,j_index);
 
 	}
@@ -683,19 +743,31 @@ namespace LocARNA {
 	matidx_t max_i_index = mapper_arcsA.number_of_valid_mat_pos(idxA);
 	matidx_t max_j_index = mapper_arcsB.number_of_valid_mat_pos(idxB);
 	//std::cout << "max_ij_index set to " << max_i_index << " " << max_j_index << std::endl;
+	bool check_anchors = !params->constraints_->empty();
 	for (matidx_t i_index = 1;
 		 i_index < max_i_index ;
 		 i_index++) {
 		/*
-		//tomark: constraints
 		// limit entries due to trace controller
 		pos_type min_col = std::max(bl+1,params->trace_controller.min_col(i));
 		pos_type max_col = std::min(br-1,params->trace_controller.max_col(i));
 		*/
+		seq_pos_t i_seq_pos = mapper_arcsA.get_pos_in_seq_new(idxA, i_index);
 		for (matidx_t j_index = 1;
 		 j_index < max_j_index;
 		 j_index++) {
 
+		// skip entries, where the subsequences contain different
+		// anchors; no alignment satisfies the anchor constraints
+		if (check_anchors
+			&& !anchor_compatible(arcA.left(), arcB.left(), i_seq_pos,
+					      mapper_arcsB.get_pos_in_seq_new(idxB, j_index))) {
+			M(i_index,j_index) = infty_score_t::neg_infty;
+			Emat(i_index,j_index) = infty_score_t::neg_infty;
+			Fmat(i_index,j_index) = infty_score_t::neg_infty;
+			continue;
+		}
+
 		// E and F matrix entries will be computed by compute_M_entry
 		M(i_index,j_index) = compute_M_entry(idxA, idxB, arcA.left(), arcB.left(), i_index,j_index,def_scoring_view);
 		//toask: where should we care about non_default scoring views
@@ -851,6 +923,9 @@ namespace LocARNA {
 
 			if(params->multiloop_deletion_< (arcX->right()-arcX->left()+1) ) // Todo: if the adjlist is sorted we can return instead of continue
 				continue;
+			// domains with anchored positions cannot be deleted (D remains -infinity)
+			if (anchors_between(arcX->left(), arcX->right(), isA)>0)
+				continue;
 			if (trace_debugging_output) {
 				std::cout << "align_D domain insertion isA=" << isA  << "  arcX():" << *arcX << std::endl;
 				std::cout << "fill_IA_entries: " << xl << "," << arcX->right() <<   std::endl;
@@ -900,10 +975,21 @@ namespace LocARNA {
 
 	// for al in r.endA() .. r.startA
 
+	// in score only mode, rows of D, IAD and IBD are released as
+	// soon as they cannot be read anymore
+	std::vector<ArcIdxVec> release_lists;
+	if (params->score_only_) {
+	    compute_release_lists(release_lists);
+	}
+
 	for (pos_type al=r.endA()+1; al>r.startA(); ) {
 	    al--;
 	    if (trace_debugging_output) std::cout << "align_D al: " << al << std::endl;
 
+	    if (params->score_only_) {
+		release_rows(release_lists[al+1]);
+	    }
+
 	    const BasePairs::LeftAdjList &adjlA = bpsA.left_adjlist(al);
 	    if ( adjlA.empty() )
 		{
@@ -962,6 +1048,11 @@ namespace LocARNA {
 				adjlA.begin(); arcA != adjlA.end(); ++arcA) {
 			for (BasePairs::LeftAdjList::const_iterator arcB =
 					adjlB.begin(); arcB != adjlB.end(); ++arcB) {
+				// skip arc pairs that enclose different anchors:
+				// the loops cannot be aligned to each other
+				// (D, IAD and IBD remain -infinity)
+				if (!anchor_compatible(al, bl, arcA->right()-1, arcB->right()-1))
+					continue;
 				scoring->set_closing_arcs(*arcA, *arcB);
 				if (trace_debugging_output) {
 					std::cout << "align_D arcA:" << *arcA << ", arcB:" << *arcB << std::endl;
@@ -1025,9 +1116,51 @@ namespace LocARNA {
 	if (trace_debugging_output) std::cout << "M matrix:" << std::endl << M << std::endl;
 	if (trace_debugging_output) std::cout << "D matrix:" << std::endl << Dmat << std::endl;
 
+	if (params->score_only_) {
+	    release_rows(release_lists[r.startA()]);
+	}
+
 	D_created=true; // now the matrix D is built up
     }
 
+    void
+    AlignerNN::compute_release_lists(std::vector<ArcIdxVec> &release_lists) const {
+	// position, where the row of each arc is read for the last time
+	std::vector<pos_type> last_read(bpsA.num_bps());
+	for (ArcIdx idx=0; idx<bpsA.num_bps(); ++idx) {
+	    last_read[idx] = bpsA.arc(idx).left();
+	}
+
+	// loops of the arcs; the pseudo arc (index num_bps) encloses
+	// the top level
+	for (ArcIdx idx=0; idx<=bpsA.num_bps(); ++idx) {
+	    pos_type loop_left = idx<bpsA.num_bps() ? bpsA.arc(idx).left() : 0;
+	    const SparsificationMapper::InfoForPosVec &infos =
+		mapper_arcsA.valid_seq_positions(idx);
+	    for (size_type k=0; k<infos.size(); ++k) {
+		const ArcIdxVec &arcs = infos[k].valid_arcs;
+		for (ArcIdxVec::const_iterator it=arcs.begin(); it!=arcs.end(); ++it) {
+		    last_read[*it] = std::min(last_read[*it],loop_left);
+		}
+	    }
+	}
+
+	release_lists.clear();
+	release_lists.resize(seqA.length()+2);
+	for (ArcIdx idx=0; idx<bpsA.num_bps(); ++idx) {
+	    release_lists[last_read[idx]].push_back(idx);
+	}
+    }
+
+    void
+    AlignerNN::release_rows(const ArcIdxVec &arcs) {
+	for (ArcIdxVec::const_iterator it=arcs.begin(); it!=arcs.end(); ++it) {
+	    Dmat.release_row(*it);
+	    IADmat.release_row(*it);
+	    IBDmat.release_row(*it);
+	}
+    }
+
 
     // compute the alignment score
     infty_score_t
@@ -1042,62 +1175,120 @@ namespace LocARNA {
 		stopwatch.stop("alignD");
 	    }
 
-	if (params->sequ_local_) {
-	    throw failure("sequ_local is not supported by sparse");
-	} else { // sequence global alignment
-
-	    // align toplevel globally with potentially free endgaps
-	    //(as given by description params->free_endgaps) return
-	    //align_top_level_free_endgaps(); 
-	    //tomark: implement align_top_level_free_endgaps()
+	// align the top level in one pass over the pseudo arc match;
+	// free end gaps and sequence local alignment only change the
+	// initialization of M (free prefixes), the recursion (local
+	// starts, see compute_M_entry) and where the alignment ends
+	
+	seq_pos_t ps_ar = r.endA()+1; //right ends of pseudo-arc match
+	seq_pos_t ps_br = r.endB()+1;
+
+	matidx_t last_index_A = mapper_arcsA.number_of_valid_mat_pos(bpsA.num_bps())-1;
+	seq_pos_t last_valid_seq_pos_A = mapper_arcsA.get_pos_in_seq_new(bpsA.num_bps(), last_index_A);
+	matidx_t last_index_B = mapper_arcsB.number_of_valid_mat_pos(bpsB.num_bps())-1;
+	seq_pos_t last_valid_seq_pos_B = mapper_arcsB.get_pos_in_seq_new(bpsB.num_bps(), last_index_B);
+	if(trace_debugging_output) {
+	    std::cout << "Align top level with "
+		      << ", last_index_A:" << last_index_A 
+		      << "/last_seq_posA:" << last_valid_seq_pos_A 
+		      << ", last_index_B:" << last_index_B 
+		      << "/last_seq_posB:" << last_valid_seq_pos_B
+		      << std::endl;
+	}
 	    
-//	    seq_pos_t ps_al = r.startA()-1; //ends of pseudo-arc match
-	    seq_pos_t ps_ar = r.endA()+1;
-//	    seq_pos_t ps_bl = r.startB()-1;
-	    seq_pos_t ps_br = r.endB()+1;
-
-		//TODO: IMPORTANT: Hopefully index 0 is asigned to the pseudo arc!
-	    matidx_t last_index_A = mapper_arcsA.number_of_valid_mat_pos(bpsA.num_bps())-1;
-	    seq_pos_t last_valid_seq_pos_A = mapper_arcsA.get_pos_in_seq_new(bpsA.num_bps(), last_index_A);
-	    matidx_t last_index_B = mapper_arcsB.number_of_valid_mat_pos(bpsB.num_bps())-1;
-	    seq_pos_t last_valid_seq_pos_B = mapper_arcsB.get_pos_in_seq_new(bpsB.num_bps(), last_index_B);
-	    if(trace_debugging_output) {
-		std::cout << "Align top level with "
-			  << ", last_index_A:" << last_index_A 
-			  << "/last_seq_posA:" << last_valid_seq_pos_A 
-			  << ", last_index_B:" << last_index_B 
-			  << "/last_seq_posB:" << last_valid_seq_pos_B
-			  << std::endl;
-	    }
+	// stopwatch.start("align top level");
+	scoring->set_closing_arcs(BasePairs__Arc(bpsA.num_bps(), 0, seqA.length()+1),BasePairs__Arc(bpsB.num_bps(), 0, seqB.length()+1)); //TODO: check it
+	if (trace_debugging_output) std::cout << "align top level" << std::endl;
+
+	fill_M_entries(BasePairs__Arc(bpsA.num_bps(), 0, seqA.length()+1),BasePairs__Arc(bpsB.num_bps(), 0, seqB.length()+1));
+
+	// tocheck: always use get_startA-1 (not zero) in
+	// sparsification_mapper and other parts
+	// stopwatch.stop("align top level");
 	    
-	    // stopwatch.start("align top level");
-		scoring->set_closing_arcs(BasePairs__Arc(bpsA.num_bps(), 0, seqA.length()+1),BasePairs__Arc(bpsB.num_bps(), 0, seqB.length()+1)); //TODO: check it
-		std::cout << "align top level" << std::endl;
+	if (trace_debugging_output) std::cout << "M matrix: " << bpsA.num_bps() << " ," << last_index_A <<
+					"  , " <<  bpsB.num_bps() <<  "," << last_index_B << std::endl
+						<< M << std::endl;
+	if (trace_debugging_output) {
+	    std::cout << "M(" << last_index_A << "," 
+		      << last_index_B << ")=" 
+		      << M( last_index_A, last_index_B)
+		      << " getGapCostBetween are:"
+		      << getGapCostBetween( last_valid_seq_pos_A, ps_ar, true) << std::endl;
+	}
 
-		fill_M_entries(BasePairs__Arc(bpsA.num_bps(), 0, seqA.length()+1),BasePairs__Arc(bpsB.num_bps(), 0, seqB.length()+1));
+	// suffixes after the last valid positions are gapped, unless
+	// they are free
+	infty_score_t suffix_gapA = free_endgaps.allow_right_2()
+	    ? (infty_score_t)0
+	    : getGapCostBetween( last_valid_seq_pos_A, ps_ar, true);
+	infty_score_t suffix_gapB = free_endgaps.allow_right_1()
+	    ? (infty_score_t)0
+	    : getGapCostBetween( last_valid_seq_pos_B, ps_br, false);
 
-	    // tocheck: always use get_startA-1 (not zero) in
-	    // sparsification_mapper and other parts
-	    // stopwatch.stop("align top level");
+	// alignments have to end right of (or at) all anchored positions
+	size_type num_anchorsA = anchor_countA[seqA.length()];
+	size_type num_anchorsB = anchor_countB[seqB.length()];
+
+	infty_score_t max_score;
+	
+	if (params->sequ_local_) {
+	    // the empty alignment scores 0, if it satisfies the anchor constraints
+	    max_score = (num_anchorsA==0 && num_anchorsB==0)
+		? (infty_score_t)0
+		: infty_score_t::neg_infty;
+	    max_i = 0;
+	    max_j = 0;
 	    
-	    if (trace_debugging_output) std::cout << "M matrix: " << bpsA.num_bps() << " ," << last_index_A <<
-	    		"  , " <<  bpsB.num_bps() <<  "," << last_index_B << std::endl
-						  << M << std::endl;
-	    if (trace_debugging_output) {
-		std::cout << "M(" << last_index_A << "," 
-			  << last_index_B << ")=" 
-			  << M( last_index_A, last_index_B)
-			  << " getGapCostBetween are:"
-			  << getGapCostBetween( last_valid_seq_pos_A, ps_ar, true) << std::endl;
-		// << " " << getGapCostBetween( last_valid_seq_pos_B,ps_br, false)
-		// << std::endl;
+	    for (matidx_t i_index = 1; i_index <= last_index_A; i_index++) {
+		seq_pos_t i_seq_pos = mapper_arcsA.get_pos_in_seq_new(bpsA.num_bps(), i_index);
+		if (anchor_countA[i_seq_pos] < num_anchorsA) continue;
+		for (matidx_t j_index = 1; j_index <= last_index_B; j_index++) {
+		    seq_pos_t j_seq_pos = mapper_arcsB.get_pos_in_seq_new(bpsB.num_bps(), j_index);
+		    if (anchor_countB[j_seq_pos] < num_anchorsB) continue;
+		    if (M(i_index,j_index) > max_score) {
+			max_score = M(i_index,j_index);
+			max_i = i_index;
+			max_j = j_index;
+		    }
+		}
 	    }
+	    return max_score;
+	}
 
-	    return M( last_index_A, last_index_B)
-		//toask: where should we care about non_default scoring views
-		+ getGapCostBetween( last_valid_seq_pos_A, ps_ar, true)
-		+ getGapCostBetween( last_valid_seq_pos_B, ps_br, false); //no free end gaps
+	// sequence global alignment with potentially free end gaps
+	// (as given by description params->free_endgaps)
+	max_score = M(last_index_A, last_index_B) + suffix_gapA + suffix_gapB;
+	max_i = last_index_A;
+	max_j = last_index_B;
+
+	if (free_endgaps.allow_right_2()) {
+	    // free suffix of A: search maximum in the last column
+	    for (matidx_t i_index = 0; i_index < last_index_A; i_index++) {
+		seq_pos_t i_seq_pos = mapper_arcsA.get_pos_in_seq_new(bpsA.num_bps(), i_index);
+		if (anchor_countA[i_seq_pos] < num_anchorsA) continue;
+		infty_score_t score = M(i_index, last_index_B) + suffix_gapB;
+		if (score > max_score) {
+		    max_score = score;
+		    max_i = i_index;
+		    max_j = last_index_B;
+		}
+	    }
 	}
+	if (free_endgaps.allow_right_1()) {
+	    // free suffix of B: search maximum in the last row
+	    for (matidx_t j_index = 0; j_index < last_index_B; j_index++) {
+		seq_pos_t j_seq_pos = mapper_arcsB.get_pos_in_seq_new(bpsB.num_bps(), j_index);
+		if (anchor_countB[j_seq_pos] < num_anchorsB) continue;
+		infty_score_t score = M(last_index_A, j_index) + suffix_gapA;
+		if (score > max_score) {
+		    max_score = score;
+		    max_i = last_index_A;
+		    max_j = j_index;
+		}
+	    }
+	}
+	return max_score;
     }
 
     // ------------------------------------------------------------
@@ -1108,10 +1299,12 @@ namespace LocARNA {
     {
 	const BasePairs &bpsX = isA? bpsA : bpsB;
 	const SparsificationMapper &mapper_arcsX = isA ? mapper_arcsA: mapper_arcsB;
-	bool constraints_aligned_pos = false;
 	pos_type xl = get_arc_leftend(idxX, isA);
 
 	seq_pos_t i_seq_pos = mapper_arcsX.get_pos_in_seq_new(idxX, i_index);
+	bool constraints_aligned_pos = isA
+	    ? params->constraints_->aligned_in_a(i_seq_pos)
+	    : params->constraints_->aligned_in_b(i_seq_pos);
 	if (trace_debugging_output) std::cout << "****trace_IX****" << (isA?"A ":"B ") << " (" << xl << ","<< i_seq_pos << "] , " << arcY << std::endl;
 
 
@@ -1164,6 +1357,13 @@ namespace LocARNA {
 		const Arc& arcX = bpsX.arc(*arcIdx);
 		if (trace_debugging_output) std::cout << "arcX=" << arcX  << std::endl;
 
+		// anchored ends cannot be deleted
+		if ( isA
+		     ? (params->constraints_->aligned_in_a(arcX.left())
+			|| params->constraints_->aligned_in_a(arcX.right()))
+		     : (params->constraints_->aligned_in_b(arcX.left())
+			|| params->constraints_->aligned_in_b(arcX.right())) ) continue;
+
 	
 		infty_score_t gap_score =  getGapCostBetween(xl, arcX.left(), isA);
 
@@ -1622,15 +1822,23 @@ namespace LocARNA {
 	if ( i_seq_pos == al && j_seq_pos == bl )
 	    return;
 
+	// free prefixes at the top level end the trace (see init_M_E_F)
+	bool is_top = is_top_level(idxA, idxB);
+	bool free_prefixA = is_top && free_prefix(true);
+	bool free_prefixB = is_top && free_prefix(false);
+	if ( (j_index==0 && free_prefixA) || (i_index==0 && free_prefixB) )
+	    return;
+	bool local_start = is_top && params->sequ_local_;
+
 	seq_pos_t i_prev_seq_pos = al; //tocheck: Important
 	if ( i_seq_pos > al )
 	    i_prev_seq_pos = mapper_arcsA.get_pos_in_seq_new(idxA, i_index-1); //TODO: Check border i_index==1,0
 	seq_pos_t j_prev_seq_pos = bl;
 	if (j_seq_pos > bl )
 	    j_prev_seq_pos = mapper_arcsB.get_pos_in_seq_new(idxB, j_index-1); //TODO: Check border j_index==1,0
-	bool constraints_alowed_edge = true; // constraints are not considered,  params->constraints_->allowed_edge(i_seq_pos, j_seq_pos)
-	bool constraints_aligned_pos_A = false; // TOcheck: Probably unnecessary, constraints are not considered
-	bool constraints_aligned_pos_B = false; // TOcheck: Probably unnecessary, constraints are not considered
+	bool constraints_alowed_edge = params->constraints_->allowed_edge(i_seq_pos, j_seq_pos);
+	bool constraints_aligned_pos_A = params->constraints_->aligned_in_a(i_seq_pos);
+	bool constraints_aligned_pos_B = params->constraints_->aligned_in_b(j_seq_pos);
 	// determine where we get M(i,j) from
 
 
@@ -1658,8 +1866,24 @@ namespace LocARNA {
 		//------------------------------------
 		// base match
 
-		infty_score_t gap_match_score = getGapCostBetween(i_prev_seq_pos, i_seq_pos, true) +
-				getGapCostBetween(j_prev_seq_pos, j_seq_pos, false) + (sv.scoring()->basematch(i_seq_pos, j_seq_pos));
+		// sequence local alignment starts with this match
+		if (local_start && local_start_allowed(i_seq_pos, j_seq_pos)
+		    && M(i_index,j_index) == (infty_score_t)(sv.scoring()->basematch(i_seq_pos, j_seq_pos)) )
+		    {
+			if (trace_debugging_output) std::cout << "base match start" << i_index << " , " << j_index << std::endl;
+			alignment.append(i_seq_pos,j_seq_pos);
+			return;
+		    }
+
+		bool free_gapA = free_prefixA && j_index==1;
+		bool free_gapB = free_prefixB && i_index==1;
+		if (free_gapA) opening_cost_A = (infty_score_t)0;
+		if (free_gapB) opening_cost_B = (infty_score_t)0;
+
+		infty_score_t gap_match_score =
+		    (free_gapA ? (infty_score_t)0 : getGapCostBetween(i_prev_seq_pos, i_seq_pos, true)) +
+		    (free_gapB ? (infty_score_t)0 : getGapCostBetween(j_prev_seq_pos, j_seq_pos, false)) +
+		    (sv.scoring()->basematch(i_seq_pos, j_seq_pos));
 		//base match and continue with deletion
 		if (M(i_index,j_index) == (infty_score_t)(gap_match_score + opening_cost_B + Emat(i_index-1, j_index-1)) )
 		    {
@@ -1730,15 +1954,6 @@ namespace LocARNA {
 
 
 
-	// only consider arc match cases if edge (i,j) is allowed and valid! (assumed valid)
-	if ( ! constraints_alowed_edge  )
-	    {
-		std::cerr << "WARNING: unallowed edge" << std::endl;
-		return;
-	    }
-
-
-	// here (i,j) is allowed and valid,
 	const ArcIdxVec& arcsA = mapper_arcsA.valid_arcs_right_adj(idxA, i_index);
 	const ArcIdxVec& arcsB = mapper_arcsB.valid_arcs_right_adj(idxB, j_index);
 
@@ -1749,6 +1964,8 @@ namespace LocARNA {
 		 arcAIdx != arcsA.end();
 		 ++arcAIdx) {
 			const Arc& arcA = bpsA.arc(*arcAIdx);
+			if (anchors_between(arcA.left(), arcA.right(), true)>0) // anchored positions cannot be deleted
+				continue;
 			matidx_t  arcA_left_index_before   =
 			mapper_arcsA.first_valid_mat_pos_before(idxA, arcA.left(), al);
 			seq_pos_t arcA_left_seq_pos_before =
@@ -1800,6 +2017,8 @@ namespace LocARNA {
 		 arcBIdx != arcsB.end();
 		 ++arcBIdx) {
 			const Arc& arcB = bpsB.arc(*arcBIdx);
+			if (anchors_between(arcB.left(), arcB.right(), false)>0) // anchored positions cannot be deleted
+				continue;
 			matidx_t  arcB_left_index_before   =
 			mapper_arcsB.first_valid_mat_pos_before(idxB, arcB.left(), bl);
 			seq_pos_t arcB_left_seq_pos_before =
@@ -1845,6 +2064,13 @@ namespace LocARNA {
 
 		}
 	}
+	// only consider arc match cases if edge (i,j) is allowed and valid! (assumed valid)
+	if ( ! constraints_alowed_edge  )
+	    {
+		std::cerr << "WARNING: unallowed edge" << std::endl;
+		return;
+	    }
+
 	//  arc match
 
 
@@ -1871,6 +2097,7 @@ namespace LocARNA {
 
 			const Arc& arcB = bpsB.arc(*arcBIdx);
 			// std::cout << "trace_M_noex: arcA=" << arcA << " arcB=" << arcB << std::endl;
+			if (!params->constraints_->allowed_edge(arcA.left(), arcB.left())) continue;
 			matidx_t arcB_left_index_before =
 			    mapper_arcsB.first_valid_mat_pos_before(idxB, arcB.left(), bl);
 			seq_pos_t arcB_left_seq_pos_before =
@@ -1882,14 +2109,34 @@ namespace LocARNA {
 			    opening_cost_B = sv.scoring()->indel_opening();
 			}
 			sv.scoring()->set_closing_arcs(traceback_closing_arcA, traceback_closing_arcB);
+
+			// sequence local alignment starts with this arc match
+			if ( local_start && local_start_allowed(arcA.left(), arcB.left())
+			     && M(i_index, j_index) == sv.D( arcA, arcB ) + sv.scoring()->arcmatch(arcA, arcB) )
+			    {
+				if (trace_debugging_output) std::cout << "arcmatch start"<< arcA <<";"<< arcB << " :: "   << std::endl;
+
+				alignment.add_basepairA(arcA.left(), arcA.right());
+				alignment.add_basepairB(arcB.left(), arcB.right());
+				alignment.append(arcA.left(),arcB.left());
+				trace_D(arcA, arcB, sv);
+				alignment.append(arcA.right(),arcB.right());
+				return;
+			    }
+
+			bool free_gapA = free_prefixA && arcB_left_index_before==0;
+			bool free_gapB = free_prefixB && arcA_left_index_before==0;
+			score_t match_opening_A = free_gapA ? 0 : opening_cost_A;
+			score_t match_opening_B = free_gapB ? 0 : opening_cost_B;
+
 			infty_score_t gap_match_score =
-			    getGapCostBetween(arcA_left_seq_pos_before, arcA.left(), true)
-			    + getGapCostBetween(arcB_left_seq_pos_before, arcB.left(), false)
+			    (free_gapA ? (infty_score_t)0 : getGapCostBetween(arcA_left_seq_pos_before, arcA.left(), true))
+			    + (free_gapB ? (infty_score_t)0 : getGapCostBetween(arcB_left_seq_pos_before, arcB.left(), false))
 			    + sv.D( arcA, arcB ) + sv.scoring()->arcmatch(arcA, arcB);
 
 
 			//arc match, then continue with deletion
-			if ( M(i_index, j_index) ==	(infty_score_t)(gap_match_score + opening_cost_B + Emat (arcA_left_index_before, arcB_left_index_before)) )
+			if ( M(i_index, j_index) ==	(infty_score_t)(gap_match_score + match_opening_B + Emat (arcA_left_index_before, arcB_left_index_before)) )
 			    {
 				if (trace_debugging_output) std::cout << "arcmatch E"<< arcA <<";"<< arcB << " :: "   << std::endl;
 
@@ -1919,7 +2166,7 @@ namespace LocARNA {
 			    }
 			//arc match, then continue with insertion case
 			else if ( M(i_index, j_index) ==
-				  (infty_score_t)(gap_match_score + opening_cost_A + Fmat (arcA_left_index_before, arcB_left_index_before)) )
+				  (infty_score_t)(gap_match_score + match_opening_A + Fmat (arcA_left_index_before, arcB_left_index_before)) )
 			    {
 
 				if (trace_debugging_output) std::cout << "arcmatch F"<< arcA <<";"<< arcB << " :: "   << std::endl;
@@ -1948,7 +2195,7 @@ namespace LocARNA {
 
 			    }
 			//arc match, then continue with general M case
-			else if ( M(i_index, j_index) == gap_match_score  + opening_cost_A + opening_cost_B + M(arcA_left_index_before, arcB_left_index_before) )
+			else if ( M(i_index, j_index) == gap_match_score  + match_opening_A + match_opening_B + M(arcA_left_index_before, arcB_left_index_before) )
 			    {
 
 				if (trace_debugging_output) std::cout << "arcmatch M"<< arcA <<";"<< arcB << " :: "   << std::endl;
@@ -1986,8 +2233,6 @@ namespace LocARNA {
     void
     AlignerNN::trace_M(ArcIdx idxA, matidx_t i_index, ArcIdx idxB, matidx_t j_index, bool top_level, ScoringView sv) {
 	//pre: M matrices for arc computed
-	assert(! params->sequ_local_); //Local seq alignment not implemented yet.
-
 	seq_pos_t i_seq_pos = mapper_arcsA.get_pos_in_seq_new(idxA, i_index);
 	seq_pos_t j_seq_pos = mapper_arcsB.get_pos_in_seq_new(idxB, j_index);
 	if (trace_debugging_output) std::cout << "******trace_M***** " << " idxA:" << idxA << " i:" << i_seq_pos <<" idxB:"<< idxB << " j:" << j_seq_pos << " :: " <<  M(i_index,j_index) << std::endl;
@@ -2021,27 +2266,17 @@ namespace LocARNA {
     template<class ScoringView>
     void
     AlignerNN::trace(ScoringView sv) {
-	// pre: last call align_in_arcmatch(r.startA()-1,r.endA()+1,r.startB()-1,r.endB()+1);
-	//      or align_top_level_locally for sequ_local alignent
+	// pre: last call align(), which determined the end max_i,max_j
+	//      of the top level alignment
 
 	// reset the alignment strings (to empty strings)
 	// such that they can be written again during the trace
 	alignment.clear();
 
-	// free end gap version: trace_M(r.startA()-1,max_i,r.startB()-1,max_j,true,sv);
-//	seq_pos_t ps_al = r.startA() - 1;
-	matidx_t last_mat_idx_pos_A = mapper_arcsA.number_of_valid_mat_pos(bpsA.num_bps()) -1;//tocheck: check the correctness
-	//seq_pos_t last_seq_pos_A = mapperA.get_pos_in_seq_new(ps_al, last_mat_idx_pos_A);
-
-//	seq_pos_t ps_bl = r.startB() - 1;
-	matidx_t last_mat_idx_pos_B = mapper_arcsB.number_of_valid_mat_pos(bpsB.num_bps()) -1;//tocheck: check the correctness
-	//seq_pos_t last_seq_pos_B = mapperB.get_pos_in_seq_new(ps_bl, last_mat_idx_pos_B);
-
-
 	traceback_closing_arcA = Arc(bpsA.num_bps(), 0, seqA.length()+1);//TODO: What to set as index?
 	traceback_closing_arcB = Arc(bpsB.num_bps(), 0, seqB.length()+1);//TODO: What to set as index?
 
-	trace_M(bpsA.num_bps(), last_mat_idx_pos_A, bpsB.num_bps(), last_mat_idx_pos_B, true, sv); //TODO: right side for trace_M differs with align_M
+	trace_M(bpsA.num_bps(), max_i, bpsB.num_bps(), max_j, true, sv);
 	/*    for ( size_type k = last_seq_pos_A + 1; k <= r.endA(); k++)//tocheck: check the correctness
 	      {
 	      alignment.append(k, -1);
@@ -2055,6 +2290,10 @@ namespace LocARNA {
 
     void
     AlignerNN::trace() {
+	if (params->score_only_) {
+	    throw failure("AlignerNN: trace is not available in score only mode.");
+	}
+
 	stopwatch.start("trace");
 
 	trace(def_scoring_view);
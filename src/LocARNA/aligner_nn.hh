@@ -14,7 +14,7 @@
 #include "params.hh"
 #include "scoring.hh"
 
-#include "matrix.hh"
+#include "matrices.hh"
 
 #include "aligner_restriction.hh"
 
@@ -46,6 +46,9 @@ namespace LocARNA {
 	//! type of matrix M
 	typedef ScoreMatrix M_matrix_t;
 
+	//! type of matrices D, IAD and IBD (rows indexed by arcs of A)
+	typedef RowMatrix<infty_score_t> D_matrix_t;
+
     private:
 
     bool trace_debugging_output; //!< a static switch to enable generating debugging logs
@@ -73,7 +76,7 @@ namespace LocARNA {
 	AlignerRestriction r;
 
 	//! matrix indexed by the arc indices of rnas A and B
-	ScoreMatrix Dmat;
+	D_matrix_t Dmat;
 
 	//! matrix indexed by positions of elements of the seqA positions and the arc indices of RNA B
 	ScoreMatrix IAmat;
@@ -82,9 +85,9 @@ namespace LocARNA {
 
 
 	//! matrix indexed by positions of elements of the seqA positions and the arc indices of RNA B
-	ScoreMatrix IADmat;
+	D_matrix_t IADmat;
 	//! matrix indexed by positions of elements of the seqB positions and the arc indices of RNA A
-	ScoreMatrix IBDmat;
+	D_matrix_t IBDmat;
 
 	//! matrix for the affine gap cost model base deletion
 	ScoreMatrix Emat;
@@ -98,21 +101,30 @@ namespace LocARNA {
 	 */
 	M_matrix_t M;
 
-	//! matrix to store cost of deleting/inserting a subsequence
-	//! of sequence A, indexed by neighboring positions of the
-	//! range
-	ScoreMatrix gapCostAmat;
-	
-	//! matrix to store cost of deleting/inserting a subsequence
-	//! of sequence B, indexed by neighboring positions of the
-	//! range
-	ScoreMatrix gapCostBmat; 
+	//! gap_prefixA[i] is the cost of deleting/inserting the
+	//! prefix 1..i of sequence A (ignoring anchor constraints)
+	std::vector<score_t> gap_prefixA;
+
+	//! gap_prefixB[i] is the cost of deleting/inserting the
+	//! prefix 1..i of sequence B (ignoring anchor constraints)
+	std::vector<score_t> gap_prefixB;
+
+	//! number of positions of A up to each position that are
+	//! aligned due to anchor constraints
+	std::vector<size_type> anchor_countA;
 
+	//! number of positions of B up to each position that are
+	//! aligned due to anchor constraints
+	std::vector<size_type> anchor_countB;
+
+
+	//! free end gaps at the top level
+	FreeEndgapsDescription free_endgaps;
 
 	int min_i; //!< subsequence of A left end, not used in sparse
 	int min_j; //!< subsequence of B left end, not used in sparse
-	int max_i; //!< subsequence of A right end, not used in sparse
-	int max_j; //!< subsequence of B right end, not used in sparse
+	int max_i; //!< matrix index of the end of the top level alignment in A
+	int max_j; //!< matrix index of the end of the top level alignment in B
 
 	bool D_created; //!< flag, is D already created?
 
@@ -304,7 +316,7 @@ namespace LocARNA {
 
 
 	/**
-	 * \brief compute and stores score of aligning subsequences to the gap
+	 * \brief compute and store prefix sums of the costs for aligning subsequences to the gap
 	 *
 	 * @param isA a switch to determine the target sequence A or B
 	 * @param sv the scoring view to be used
@@ -328,6 +340,88 @@ namespace LocARNA {
 	 */
 	infty_score_t getGapCostBetween( pos_type leftSide, pos_type rightSide, bool isA);
 
+	/**
+	 * \brief count positions aligned due to anchor constraints
+	 *
+	 * @param isA a switch to determine the target sequence A or B
+	 * @param[out] anchor_count anchor_count[i] is the number of
+	 * positions up to i (0<=i<=length+1) that are aligned due to anchor constraints
+	 */
+	void compute_anchor_counts(bool isA, std::vector<size_type> &anchor_count) const;
+
+	/**
+	 * \brief number of anchored positions in a subsequence
+	 *
+	 * @param left left end of the subsequence
+	 * @param right right end of the subsequence
+	 * @param isA a switch to determine the target sequence A or B
+	 * @return number of positions in left..right that are aligned due to anchor constraints
+	 */
+	size_type anchors_between(pos_type left, pos_type right, bool isA) const {
+	    const std::vector<size_type> &anchor_count = isA ? anchor_countA : anchor_countB;
+	    return anchor_count[right]-anchor_count[left-1];
+	}
+
+	/**
+	 * \brief check subsequences for compatibility with anchor constraints
+	 *
+	 * The subsequences al+1..i of A and bl+1..j of B can be
+	 * aligned only if they contain the same anchors. Since anchor
+	 * constraints do not cross, this holds iff both contain
+	 * the same number of anchored positions and, if this number
+	 * is not zero, the same anchors occur before al and bl.
+	 *
+	 * @param al position before subsequence of A
+	 * @param bl position before subsequence of B
+	 * @param i right end of subsequence of A
+	 * @param j right end of subsequence of B
+	 * @return whether al+1..i and bl+1..j contain the same anchors
+	 */
+	bool anchor_compatible(pos_type al, pos_type bl, pos_type i, pos_type j) const {
+	    size_type num_anchorsA = anchor_countA[i]-anchor_countA[al];
+	    return num_anchorsA == anchor_countB[j]-anchor_countB[bl]
+		&& ( num_anchorsA==0 || anchor_countA[al]==anchor_countB[bl] );
+	}
+
+	/**
+	 * \brief check for free prefix at the top level
+	 *
+	 * @param isA a switch to determine the target sequence A or B
+	 * @return whether a prefix of A (B) can be deleted (inserted)
+	 * without cost at the top level, due to free end gaps or
+	 * sequence local alignment
+	 *
+	 * @note this includes the implicit gaps in front of the
+	 * first aligned position of the top level
+	 */
+	bool free_prefix(bool isA) const {
+	    return params->sequ_local_
+		|| (isA ? free_endgaps.allow_left_2() : free_endgaps.allow_left_1());
+	}
+
+	/**
+	 * \brief check for the top level
+	 *
+	 * @param idxA arc index in A
+	 * @param idxB arc index in B
+	 * @return whether both arcs are the pseudo arcs of the top level
+	 */
+	bool is_top_level(ArcIdx idxA, ArcIdx idxB) const {
+	    return idxA==bpsA.num_bps() && idxB==bpsB.num_bps();
+	}
+
+	/**
+	 * \brief check for anchors in front of a local alignment
+	 *
+	 * @param i first position of a local alignment in A
+	 * @param j first position of a local alignment in B
+	 * @return whether no anchored positions precede i and j,
+	 * i.e. whether a sequence local alignment can start at (i,j)
+	 */
+	bool local_start_allowed(pos_type i, pos_type j) const {
+	    return anchor_countA[i-1]==0 && anchor_countB[j-1]==0;
+	}
+
 
 	/**
 	 * \brief compute IA/IB value of single element
@@ -531,6 +625,28 @@ namespace LocARNA {
 	*/
 	void align_D();
 
+	/**
+	 * @brief determine when rows of D, IAD and IBD can be released
+	 *
+	 * @param[out] release_lists release_lists[al] lists the arcs
+	 * of A, whose rows are not read anymore after computing the
+	 * entries for arcs with left end al
+	 *
+	 * The row of an arc is read while aligning the arc itself
+	 * and the loops where the arc is valid. Arcs that are valid
+	 * at the top level are never released.
+	 *
+	 * @note used in score only mode
+	 */
+	void compute_release_lists(std::vector<ArcIdxVec> &release_lists) const;
+
+	/**
+	 * @brief release rows of D, IAD and IBD
+	 *
+	 * @param arcs indices of arcs in A
+	 */
+	void release_rows(const ArcIdxVec &arcs);
+
 
 	
 	/** 
@@ -666,7 +782,11 @@ namespace LocARNA {
 	infty_score_t
 	align();
 
-	//! offer trace as public method. Calls trace(def_scoring_view).
+	/**
+	 * @brief offer trace as public method. Calls trace(def_scoring_view).
+	 *
+	 * @note not available in score only mode
+	 */
 	void
 	trace();
 
@@ -21,13 +21,11 @@ namespace LocARNA {
     // allocate space for the inside matrices 
     void
     AlignerP::alloc_inside_matrices() {
-	Dmat.resize(bpsA.num_bps(), bpsB.num_bps());
-	Dmat.fill((pf_score_t )0); // this is essential, such that we can avoid to test validity of arc matches 
+	Dmat.assign(bpsA.num_bps(), bpsB.num_bps(), (pf_score_t)0); // this is essential, such that we can avoid to test validity of arc matches 
         
 	//std::cout << "Size of Dmat:" << sizeof(Dmat)+bpsA.num_bps()*bpsB.num_bps()*sizeof(pf_score_t) << std::endl;
   
-	M.resize(seqA.length()+1, seqB.length()+1);
-	M.fill((pf_score_t )0);
+	M.assign(seqA.length()+1, seqB.length()+1, (pf_score_t)0);
     
 	//std::cout << "Size of M:" << sizeof(M)+(seqA.length()+1)*(seqB.length()+1)*sizeof(pf_score_t) << std::endl;
     
@@ -40,12 +38,10 @@ namespace LocARNA {
     void
     AlignerP::alloc_outside_matrices() {
 
-	Dmatprime.resize(bpsA.num_bps(), bpsB.num_bps());
-	Dmatprime.fill((pf_score_t )0);
+	Dmatprime.assign(bpsA.num_bps(), bpsB.num_bps(), (pf_score_t)0);
   
 
-	Mprime.resize(seqA.length()+1, seqB.length()+1);
-	Mprime.fill((pf_score_t )0);
+	Mprime.assign(seqA.length()+1, seqB.length()+1, (pf_score_t)0);
   
 	Eprime.resize(seqB.length()+1); // size: one row of M/Mprime matrix
     
@@ -27,10 +27,10 @@ namespace LocARNA {
     typedef Matrix<double> ProbMatrix;
     
     //! sparse matrix for storing probabilities
-    typedef SparseMatrix<double> SparseProbMatrix; 
+    typedef SparseMatrix<double,FlatHashBackend> SparseProbMatrix; 
     
     //! sparse matrix for storing partition functions
-    typedef SparseMatrix<pf_score_t> SparsePFScoreMatrix; 
+    typedef SparseMatrix<pf_score_t,FlatHashBackend> SparsePFScoreMatrix; 
 
     //! restriction of AlignerP ( same as for Aligner )
     typedef AlignerRestriction AlignerPRestriction;
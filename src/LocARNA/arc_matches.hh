@@ -86,7 +86,8 @@ namespace LocARNA {
     typedef std::vector<ArcMatch> ArcMatchVec;
 
     //! Vector of arc match indices
-    typedef std::vector<ArcMatch::idx_type> ArcMatchIdxVec;
+    //! (allocated from the current memory arena)
+    typedef arena_vector<ArcMatch::idx_type>::type ArcMatchIdxVec;
 
     /**
        @brief Maintains the relevant arc matches and their scores
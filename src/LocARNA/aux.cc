@@ -6,6 +6,10 @@
 #include <iomanip>
 #include <algorithm>
 #include <iostream>
+#include <fstream>
+
+#include <sys/resource.h>
+#include <unistd.h>
 
 namespace LocARNA {
     failure::~failure() throw() {}
@@ -78,10 +82,11 @@ namespace LocARNA {
 
     bool
     has_prefix(const std::string &s, const std::string &p, size_t start) {
-	if (s.length()<p.length()-start) {
+	if (s.length()<start+p.length()) {
 	    return false;
 	}
-	return s.substr(start,p.length())==p;
+	// compare in place, avoid constructing substrings
+	return s.compare(start,p.length(),p)==0;
     }
 
 
@@ -129,7 +134,7 @@ namespace LocARNA {
 		
 		//  collect lines in case of quoted newline
 		while (line[line.length()-1]=='\\') {
-		    line=line.substr(0,line.length()-1);
+		    line.erase(line.length()-1);
 		    std::string line1;
 		    if (getline(in,line1)) {
 			line+=" "+line1;
@@ -140,7 +145,7 @@ namespace LocARNA {
 
 		// remove trailing white space
 		const size_t strEnd = line.find_last_not_of(whitespace);
-		line = line.substr(0, strEnd+1);
+		line.erase(strEnd+1);
 		return true;
 	    }
 	}
@@ -164,5 +169,31 @@ namespace LocARNA {
 	}
 	return 100 * D(n,m) / (double)std::min(n,m);
     }
-}
 
+    size_t
+    peak_memory_kb() {
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF,&usage)!=0) {
+	    return 0;
+	}
+#ifdef __APPLE__
+	// reported in bytes
+	return usage.ru_maxrss/1024;
+#else
+	return usage.ru_maxrss;
+#endif
+    }
+
+    size_t
+    current_memory_kb() {
+	// second field: resident pages
+	std::ifstream statm("/proc/self/statm");
+	size_t size;
+	size_t resident;
+	long page_size = sysconf(_SC_PAGESIZE);
+	if (statm >> size >> resident && page_size>0) {
+	    return resident*(size_t)page_size/1024;
+	}
+	return peak_memory_kb();
+    }
+}
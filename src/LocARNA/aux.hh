@@ -384,6 +384,24 @@ namespace LocARNA {
     double
     sequence_identity(const string1 &seqA, const string1 &seqB);
 
+    /**
+     * @brief Peak memory usage of the process
+     *
+     * @return maximum resident set size in kB, as reported by
+     * getrusage(); 0 if not available
+     */
+    size_t
+    peak_memory_kb();
+
+    /**
+     * @brief Current memory usage of the process
+     *
+     * @return resident set size in kB, as reported by
+     * /proc/self/statm; the peak memory if not available
+     */
+    size_t
+    current_memory_kb();
+
     
 }
 
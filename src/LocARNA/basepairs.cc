@@ -126,44 +126,16 @@ namespace LocARNA {
 
     void BasePairs::generateBPLists(const RnaData &rna_data) {
 	resize(len_);
-	//std::cout<<"getbplists : sequence lengthj "<<len_<<std::endl;
-	// traverse the entries in the prob matrices
-    
-	// handle all arcs
+
+	// traverse the base pairs of rna_data in a single pass over its
+	// sorted base pairs; arcs are registered by decreasing left
+	// ends and increasing right ends
 	for (int i=len_-3; i>=1 ; i--) {
-	    for (int j=i+3; j<=(int)len_; j++) {
-	    
-		double p = rna_data.arc_prob(i,j);
-	    
-		/*
-		double p2=0;
-		double p_cond=0;
-
-		if ( rna_data.get_arc_prob(i+1,j-1) > 0 && rna_data.get_arc_2_prob(i,j)>0 ) {
-		    p2 = rna_data.get_arc_2_prob(i,j);
-		    p_cond = p2/rna_data.get_arc_prob(i+1,j-1);
-		}
-		*/
-	    
-		if ( (p >= min_prob_) /* || (p2 >= min_prob_) */ ) {
-		
-		    // debugging output
-		    // double pe = 2.0/(len_);
-		    //
-		    // if (p_cond!=0) { 
-		    // 		    std::cout << i << " " << j << " "  
-		    // 			      << p << " " 
-		    // 			      << rna_data.get_arc_prob(i+1,j-1) << " "
-		    // 			      << p_cond << " "
-		    // 			      << pe << " "
-		    // 			      << round(200 * (1-log(p)/log(pe)))	<< " "
-		    // 			      << round(200 * (1-log(rna_data.get_arc_prob(i+1,j-1))/log(pe)))	<< " "
-		    // 			      << round(200 * (1-log(p_cond)/log(pe)))	<< " "
-		    // 			      << std::endl;
-		    // 		}
-		
+	    std::pair<size_type,size_type> row = rna_data.sorted_arcs(i);
+	    for (size_type k=row.first; k<row.second; k++) {
+		int j = rna_data.sorted_arc_right(k);
+		if ( j>=i+3 && rna_data.sorted_arc_prob(k) >= min_prob_ ) {
 		    register_arc(i,j);
-		
 		}
 	    }
 	}
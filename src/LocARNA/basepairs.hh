@@ -14,6 +14,7 @@
 
 #include "params.hh"
 #include "sparse_matrix.hh"
+#include "memory_arena.hh"
 
 namespace LocARNA {
 
@@ -163,13 +164,16 @@ namespace LocARNA {
 	*/
 	
 	//! type of left adjacency list
-	typedef std::vector<LeftAdjEntry> LeftAdjList; 
+	//! (allocated from the current memory arena)
+	typedef arena_vector<LeftAdjEntry>::type LeftAdjList; 
 	
 	//! type of right adjacency list
-	typedef std::vector<RightAdjEntry> RightAdjList; 
+	//! (allocated from the current memory arena)
+	typedef arena_vector<RightAdjEntry>::type RightAdjList; 
 	
-	//! type for matrix of arcs (actually arc indices)
-	typedef SparseMatrix<int> arc_matrix_t;
+	//! type for matrix of arcs (actually arc indices);
+	//! probed for every arc query, never iterated
+	typedef SparseMatrix<int,FlatHashBackend> arc_matrix_t;
 
 	//! type for pair of positions (base pairs)
 	typedef std::pair<size_type,size_type> bpair_t;
@@ -178,8 +182,8 @@ namespace LocARNA {
 	typedef std::set<bpair_t> bpair_set_t;
     
     private:
-	std::vector<LeftAdjList> left_;
-	std::vector<RightAdjList> right_;
+	arena_vector<LeftAdjList>::type left_;
+	arena_vector<RightAdjList>::type right_;
 
 	arc_vec_t arc_vec_;
 	arc_matrix_t arcs_;
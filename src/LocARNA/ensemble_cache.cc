@@ -0,0 +1,60 @@
+#include "ensemble_cache.hh"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+
+#include <stdint.h>
+#include <unistd.h>
+
+namespace LocARNA {
+
+    EnsembleCache::EnsembleCache(const std::string &dir)
+	: dir_(dir) {
+    }
+
+    std::string
+    EnsembleCache::hash(const std::string &key) {
+	uint64_t h = 14695981039346656037ULL;
+	for (std::string::const_iterator it=key.begin(); key.end()!=it; ++it) {
+	    h ^= (unsigned char)*it;
+	    h *= 1099511628211ULL;
+	}
+
+	std::ostringstream out;
+	out << std::hex << std::setfill('0') << std::setw(16) << h;
+	return out.str();
+    }
+
+    std::string
+    EnsembleCache::filename(const std::string &key) const {
+	return dir_+"/"+hash(key)+".pp";
+    }
+
+    bool
+    EnsembleCache::write(const std::string &filename, const std::string &content) {
+	// the temporary name must be unique among all writers of the
+	// (possibly shared) directory
+	char host[256];
+	if (gethostname(host,sizeof(host))!=0) {
+	    host[0]=0;
+	}
+	host[sizeof(host)-1]=0;
+
+	std::ostringstream tmpname;
+	tmpname << filename << ".tmp." << host << "." << getpid();
+
+	std::ofstream out(tmpname.str().c_str());
+	out << content;
+	out.close();
+
+	if (out.fail()
+	    || std::rename(tmpname.str().c_str(),filename.c_str())!=0) {
+	    std::remove(tmpname.str().c_str());
+	    return false;
+	}
+	return true;
+    }
+
+} // end namespace LocARNA
@@ -0,0 +1,80 @@
+#ifndef LOCARNA_ENSEMBLE_CACHE_HH
+#define LOCARNA_ENSEMBLE_CACHE_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string>
+
+namespace LocARNA {
+
+    /**
+     * @brief Content addressed directory of computed ensemble data
+     *
+     * Stores pair probabilities of RNAs (as written by RnaData and
+     * ExtRnaData) in files named by a hash of a key, which describes
+     * everything the probabilities depend on (sequences, folding
+     * parameters, cutoffs). The key is built by the data classes;
+     * this class only maps keys to files and writes entries.
+     *
+     * Entries are written to a temporary file that is renamed
+     * afterwards, such that concurrent processes (possibly on
+     * different hosts sharing the directory) never see partially
+     * written entries. Since entries for the same key are equal, it
+     * does not matter which of several concurrent writers wins.
+     *
+     * @see PFoldParams::set_ensemble_cache()
+     */
+    class EnsembleCache {
+	std::string dir_; //!< cache directory
+    public:
+	/**
+	 * @brief Construct
+	 *
+	 * @param dir cache directory; must exist
+	 */
+	explicit
+	EnsembleCache(const std::string &dir);
+
+	/**
+	 * @brief Hash of a key
+	 *
+	 * @param key key string
+	 *
+	 * @return 64 bit FNV-1a hash of key as hexadecimal string
+	 */
+	static
+	std::string
+	hash(const std::string &key);
+
+	/**
+	 * @brief Name of the cache file for a key
+	 *
+	 * @param key key string
+	 *
+	 * @return file name in the cache directory
+	 */
+	std::string
+	filename(const std::string &key) const;
+
+	/**
+	 * @brief Write a cache entry atomically
+	 *
+	 * @param filename name of the cache file
+	 * @param content content of the entry
+	 *
+	 * @return whether the entry was written
+	 *
+	 * Failures (e.g. unwritable directory) are not fatal, since
+	 * the cache is only an optimization; in this case, return
+	 * false and leave no temporary files behind.
+	 */
+	static
+	bool
+	write(const std::string &filename, const std::string &content);
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_ENSEMBLE_CACHE_HH
@@ -3,6 +3,11 @@
 #include "exact_matcher.hh"
 #include <iostream>
 #include <fstream>
+#include <deque>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
 
 namespace LocARNA {
 
@@ -58,22 +63,18 @@ namespace LocARNA {
     	if(verbose) std::cout << std::endl;
 
 
-    	L.resize(sparse_mapperA.get_max_info_vec_size(),sparse_mapperB.get_max_info_vec_size());
-    	L.fill(infty_score_t::neg_infty);
+    	L.assign(sparse_mapperA.get_max_info_vec_size(),sparse_mapperB.get_max_info_vec_size(),infty_score_t::neg_infty);
     	L.set(0,0,infty_score_t(0));
 
     	G_A.resize(sparse_mapperA.get_max_info_vec_size(),sparse_mapperB.get_max_info_vec_size());
     	G_AB.resize(sparse_mapperA.get_max_info_vec_size(),sparse_mapperB.get_max_info_vec_size());
 
-    	LR.resize(sparse_mapperA.get_max_info_vec_size(),sparse_mapperB.get_max_info_vec_size());
-    	LR.fill(infty_score_t::neg_infty);
+    	LR.assign(sparse_mapperA.get_max_info_vec_size(),sparse_mapperB.get_max_info_vec_size(),infty_score_t::neg_infty);
     	LR.set(0,0,infty_score_t(0));
 
-    	F.resize(seqA.length()+1,seqB.length()+1);
-    	F.fill(infty_score_t(0));
+    	F.assign(seqA.length()+1,seqB.length()+1,infty_score_t(0));
 
-    	Dmat.resize(bpsA.num_bps(),bpsB.num_bps());
-    	Dmat.fill(infty_score_t::neg_infty); //initialize all arcmatches with -inf
+    	Dmat.assign(bpsA.num_bps(),bpsB.num_bps(),infty_score_t::neg_infty); //initialize all arcmatches with -inf
     }
 
     // Destructor
@@ -200,11 +201,20 @@ namespace LocARNA {
     // compute arcmatch score by filling matrices L, G and LR (method compute_LGLR)
     // and computing the arcmatch score and store it in matrix D
     // store arcmatch_score with stacking and probs of outermost arcmatch
+    //
+    // arc matches are processed level by level, where the level of an
+    // arc match is the smaller nesting height of its arcs; since all
+    // arc matches that are nested in an arc match have a smaller
+    // level, the arc matches of one level can be computed in parallel
     void ExactMatcher::compute_arcmatch_score() {
 
-    	matpos_t last_filled_pos; //the last position that was filled in the matrices
+    	std::vector<size_type> heightsA;
+    	std::vector<size_type> heightsB;
+    	arc_heights(bpsA,heightsA);
+    	arc_heights(bpsB,heightsB);
 
-    	// for all arc matches from inside to outside
+    	// group the matching arc matches by levels
+    	std::vector< std::vector<size_type> > levels;
     	for(ArcMatchVec::const_iterator it=arc_matches.begin();it!=arc_matches.end();++it){
 
             pos_type al=it->arcA().left();
@@ -214,15 +224,64 @@ namespace LocARNA {
 
             // compute the arc match score only for matching arc matches
             if((nucleotide_match(al,bl) && nucleotide_match(ar,br)) || inexact_struct_match){
+                size_type level = std::min(heightsA[it->arcA().idx()],heightsB[it->arcB().idx()]);
+                if (level>=levels.size()) levels.resize(level+1);
+                levels[level].push_back(it->idx());
+            }
+    	}
 
-                last_filled_pos=compute_LGLR(it->arcA(),it->arcB(),false);
+#ifdef _OPENMP
+    	size_type num_threads = omp_get_max_threads();
+#else
+    	size_type num_threads = 1;
+#endif
+
+    	// matrices L, G_A, G_AB and LR for each thread; the first
+    	// thread uses the member matrices, G_AB is not used in the
+    	// heuristic case
+    	std::vector<ScoreMatrix> thread_mats(4*num_threads);
+    	for (size_type t=1; t<num_threads; ++t) {
+            ScoreMatrix &tL = thread_mats[4*t];
+            ScoreMatrix &tG_A = thread_mats[4*t+1];
+            ScoreMatrix &tLR = thread_mats[4*t+3];
+
+            tL.assign(sparse_mapperA.get_max_info_vec_size(),sparse_mapperB.get_max_info_vec_size(),infty_score_t::neg_infty);
+            tL.set(0,0,infty_score_t(0));
+
+            tG_A.resize(sparse_mapperA.get_max_info_vec_size(),sparse_mapperB.get_max_info_vec_size());
+
+            tLR.assign(sparse_mapperA.get_max_info_vec_size(),sparse_mapperB.get_max_info_vec_size(),infty_score_t::neg_infty);
+            tLR.set(0,0,infty_score_t(0));
+    	}
+
+    	// for all levels from inside to outside
+    	for(size_type level=0; level<levels.size(); ++level){
+            const std::vector<size_type> &level_ams = levels[level];
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+            for(long int k=0; k<(long int)level_ams.size(); ++k){
+#ifdef _OPENMP
+                size_type t = omp_get_thread_num();
+#else
+                size_type t = 0;
+#endif
+                LGLRMatrices mats = (t==0)
+                    ? LGLRMatrices(L,G_A,G_AB,LR)
+                    : LGLRMatrices(thread_mats[4*t],thread_mats[4*t+1],
+                                   thread_mats[4*t+2],thread_mats[4*t+3]);
+
+                const ArcMatch &am = arc_matches.arcmatch(level_ams[k]);
+
+                matpos_t last_filled_pos=compute_LGLR(am.arcA(),am.arcB(),false,mats);
 
                 matidx_t last_i = last_filled_pos.first;
                 matidx_t last_j = last_filled_pos.second;
 
                 // the arc match score is the maximum of the last matrix entry in
                 // matrices LR, L or G_A (as we used the heuristic computation)
-                D(*it) =max3(LR(last_i,last_j),L(last_i,last_j),G_A(last_i,last_j));
+                D(am) =max3(mats.LR(last_i,last_j),mats.L(last_i,last_j),mats.G_A(last_i,last_j));
             }
     	}
 
@@ -230,6 +289,49 @@ namespace LocARNA {
     	compute_F();
     }
 
+    // computes the nesting heights of all arcs: arcs are processed by
+    // increasing right ends; the maximal height of the arcs inside of
+    // an arc is looked up in a Fenwick tree over the left ends of
+    // the already processed arcs (reversed such that all arcs with
+    // larger left ends form a prefix)
+    void ExactMatcher::arc_heights(const BasePairs &bps, std::vector<size_type> &heights) {
+
+    	size_type n = bps.seqlen();
+    	heights.assign(bps.num_bps(),0);
+
+    	// arc indices sorted by right ends
+    	std::vector<std::vector<size_type> > arcs_by_right(n+1);
+    	for(size_type idx=0; idx<bps.num_bps(); ++idx){
+            arcs_by_right[bps.arc(idx).right()].push_back(idx);
+    	}
+
+    	// Fenwick tree of 1+height at positions n+1-left (0 for no arc)
+    	std::vector<size_type> tree(n+1,0);
+
+    	for(size_type right=1; right<=n; ++right){
+            const std::vector<size_type> &arcs = arcs_by_right[right];
+
+            // determine heights from the arcs with smaller right ends
+            for(size_type k=0; k<arcs.size(); ++k){
+                const Arc &arc = bps.arc(arcs[k]);
+                // maximum over left ends > arc.left()
+                size_type m=0;
+                for(size_type x=n-arc.left(); x>0; x-=x&(~x+1)){
+                    m=std::max(m,tree[x]);
+                }
+                heights[arcs[k]]=m;
+            }
+
+            // then register the arcs
+            for(size_type k=0; k<arcs.size(); ++k){
+                const Arc &arc = bps.arc(arcs[k]);
+                for(size_type x=n+1-arc.left(); x<=n; x+=x&(~x+1)){
+                    tree[x]=std::max(tree[x],heights[arcs[k]]+1);
+                }
+            }
+    	}
+    }
+
     // for debugging
     void ExactMatcher::test_arcmatch_score(){
     	matpos_t last_filled_pos;
@@ -278,13 +380,14 @@ namespace LocARNA {
     // store -inf in last cell of matrix LR if a gap between the
     // last matched positions and the right ends of the arcs exists
     // compute L, G_A (G matrix) and LR matrix
-    ExactMatcher::matpos_t ExactMatcher::compute_LGLR(const Arc &a, const Arc &b, bool suboptimal){
+    ExactMatcher::matpos_t ExactMatcher::compute_LGLR(const Arc &a, const Arc &b, bool suboptimal,
+                                                       const LGLRMatrices &mats){
 
     	// initialize matrices for using the sparse trace controller
-    	init_mat(L,a,b,infty_score_t(0),infty_score_t::neg_infty,infty_score_t::neg_infty);
-    	init_mat(LR,a,b,infty_score_t(0),infty_score_t::neg_infty,infty_score_t::neg_infty);
+    	init_mat(mats.L,a,b,infty_score_t(0),infty_score_t::neg_infty,infty_score_t::neg_infty);
+    	init_mat(mats.LR,a,b,infty_score_t(0),infty_score_t::neg_infty,infty_score_t::neg_infty);
     	if(!suboptimal){
-            init_mat(G_A,a,b,infty_score_t(0),infty_score_t(0),infty_score_t(0));
+            init_mat(mats.G_A,a,b,infty_score_t(0),infty_score_t(0),infty_score_t(0));
             // in suboptimal case we use the whole gap matrices, initialization is done once in the beginning
     	}
 
@@ -321,8 +424,8 @@ namespace LocARNA {
 
                     idx_pos_diag = sparse_trace_controller.diag_pos_bef(idxA,idxB,seq_pos,a.left(),b.left());
                     //compute entry only if idx pos is valid for the suboptimal case
-                    L(idx_i,idx_j)=compute_matrix_entry(a,b,mat_pos,idx_pos_diag,false,suboptimal);
-                    LR(idx_i,idx_j)=compute_matrix_entry(a,b,mat_pos,idx_pos_diag,true,suboptimal);
+                    mats.L(idx_i,idx_j)=compute_matrix_entry(a,b,mat_pos,idx_pos_diag,false,suboptimal,mats);
+                    mats.LR(idx_i,idx_j)=compute_matrix_entry(a,b,mat_pos,idx_pos_diag,true,suboptimal,mats);
 
                     // update last filled position
                     last_pos_filled.first=idx_i;
@@ -333,17 +436,17 @@ namespace LocARNA {
                 // as trace might leave the valid parts when we first insert the gaps in A and then in B
                 // for all valid positions, we are allowed to directly change from L to G_A (G_AB)
                 if(suboptimal){
-                    G_A(idx_i,idx_j)=G_A(idx_i-1,idx_j); //we fill whole matrix
+                    mats.G_A(idx_i,idx_j)=mats.G_A(idx_i-1,idx_j); //we fill whole matrix
 
                     if(sparse_trace_controller.is_valid_idx_pos(idxA,idxB,matpos_t(idx_i-1,idx_j))){
-                        G_A(idx_i,idx_j)=max(G_A(idx_i,idx_j),L(idx_i-1,idx_j));
+                        mats.G_A(idx_i,idx_j)=max(mats.G_A(idx_i,idx_j),mats.L(idx_i-1,idx_j));
                     }
 
-                    G_AB(idx_i,idx_j)=max(G_A(idx_i,idx_j-1),
-                                          G_AB(idx_i,idx_j-1)); //we fill whole matrix
+                    mats.G_AB(idx_i,idx_j)=max(mats.G_A(idx_i,idx_j-1),
+                                               mats.G_AB(idx_i,idx_j-1)); //we fill whole matrix
 
                     if(sparse_trace_controller.is_valid_idx_pos(idxA,idxB,matpos_t(idx_i,idx_j-1))){
-                        G_AB(idx_i,idx_j)=max(G_AB(idx_i,idx_j),L(idx_i,idx_j-1));
+                        mats.G_AB(idx_i,idx_j)=max(mats.G_AB(idx_i,idx_j),mats.L(idx_i,idx_j-1));
                     }
                 }
                 // heuristic case; we fill G_A only for valid matrix positions
@@ -353,8 +456,8 @@ namespace LocARNA {
                 // 3) we came from G_A from the left
                 else{
 
-                    G_A(idx_i,idx_j)=max4(L(idx_i,idx_j),G_A(idx_pos_diag.first,idx_pos_diag.second),
-                                          G_A(idx_i-1,idx_j),G_A(idx_i,idx_j-1));
+                    mats.G_A(idx_i,idx_j)=max4(mats.L(idx_i,idx_j),mats.G_A(idx_pos_diag.first,idx_pos_diag.second),
+                                               mats.G_A(idx_i-1,idx_j),mats.G_A(idx_i,idx_j-1));
                 }
             }
        	}
@@ -364,7 +467,7 @@ namespace LocARNA {
        	if((!sparse_trace_controller.matching_wo_gap(idxA,idxB,last_pos_filled,
                                                      pair_seqpos_t(a.right(),b.right())))
            && last_pos_filled.first>0 && last_pos_filled.second>0){
-            LR(last_pos_filled.first,last_pos_filled.second)=infty_score_t::neg_infty;
+            mats.LR(last_pos_filled.first,last_pos_filled.second)=infty_score_t::neg_infty;
        	}
        	return last_pos_filled;
     }
@@ -373,7 +476,8 @@ namespace LocARNA {
     // already taking into account the trace controller (not yet implemented for
     // the suboptimal case!)
     infty_score_t ExactMatcher::compute_matrix_entry(const Arc &a, const Arc &b,
-                                                     matpos_t mat_pos, matpos_t mat_pos_diag, bool matrixLR, bool suboptimal){
+                                                     matpos_t mat_pos, matpos_t mat_pos_diag, bool matrixLR, bool suboptimal,
+                                                     const LGLRMatrices &mats){
 
     	infty_score_t score_seq = infty_score_t::neg_infty; //score from sequential case
     	infty_score_t score_str =infty_score_t::neg_infty; //score from structural case
@@ -391,7 +495,7 @@ namespace LocARNA {
     	if(seq_matching(idxA,idxB,mat_pos,seq_pos)){
 
             score_seq = seq_str_matching(a,b,mat_pos_diag,seq_pos,
-                                         score_for_seq_match(),matrixLR,suboptimal);
+                                         score_for_seq_match(),matrixLR,suboptimal,mats);
 
     	}
     	//structural matching
@@ -416,7 +520,7 @@ namespace LocARNA {
                 score_t score_am_stacking=score_for_inner_am.finite_value()+score_for_stacking(a,b,inner_a,inner_b);
 
                 score_str = max(seq_str_matching(a,b,mat_pos_diag_str,
-                                                 last_seq_pos_to_be_matched,score_am_stacking,matrixLR,suboptimal),score_str);
+                                                 last_seq_pos_to_be_matched,score_am_stacking,matrixLR,suboptimal,mats),score_str);
 
             }
     	}
@@ -427,7 +531,8 @@ namespace LocARNA {
     // (either continue traceback in matrix mat, and if we are currently in matrix LR, we can continue
     // the traceback in L or G_A (the gap matrix)
     infty_score_t ExactMatcher::seq_str_matching(const Arc &a, const Arc &b, matpos_t mat_pos_diag,
-                                                 pair_seqpos_t seq_pos_to_be_matched, score_t add_score, bool matrixLR, bool suboptimal){
+                                                 pair_seqpos_t seq_pos_to_be_matched, score_t add_score, bool matrixLR, bool suboptimal,
+                                                 const LGLRMatrices &mats){
 
     	infty_score_t score = infty_score_t::neg_infty;
 
@@ -437,7 +542,7 @@ namespace LocARNA {
     	matidx_t idx_i_diag = mat_pos_diag.first;
     	matidx_t idx_j_diag = mat_pos_diag.second;
 
-    	ScoreMatrix &mat= matrixLR ? LR : L;
+    	ScoreMatrix &mat= matrixLR ? mats.LR : mats.L;
 
     	// if matching without a gap is possible we simply add add_score
     	if(sparse_trace_controller.matching_wo_gap(idxA,idxB,mat_pos_diag,seq_pos_to_be_matched)){
@@ -447,13 +552,13 @@ namespace LocARNA {
     	// if an entry in LR is computed, we can also come from L, G_A in the heuristic case and
     	// L, G_A and G_AB in the suboptimal case
     	if(matrixLR){
-            score=max(L(idx_i_diag,idx_j_diag)+add_score,score);
+            score=max(mats.L(idx_i_diag,idx_j_diag)+add_score,score);
             if(!suboptimal){
-                score = max(G_A(idx_i_diag,idx_j_diag)+add_score,score);
+                score = max(mats.G_A(idx_i_diag,idx_j_diag)+add_score,score);
             }
             if(suboptimal){
-                score = max(G_A(idx_i_diag,idx_j_diag)+add_score,score);
-                score = max(G_AB(idx_i_diag,idx_j_diag)+add_score,score);
+                score = max(mats.G_A(idx_i_diag,idx_j_diag)+add_score,score);
+                score = max(mats.G_AB(idx_i_diag,idx_j_diag)+add_score,score);
             }
     	}
     	return score;
@@ -705,8 +810,9 @@ namespace LocARNA {
     	static std::string seq1_id = seqA.seqentry(0).name();
     	static std::string seq2_id = seqB.seqentry(0).name();
 
-    	// sort the pattern vector of the current epm according
-    	// to increasing positions
+    	// resolve the inserted EPMs and sort the pattern vector of the
+    	// current epm according to increasing positions
+    	cur_epm.flatten();
     	cur_epm.sort_patVec();
 
     	// make sure that the current epm is valid
@@ -1076,6 +1182,10 @@ namespace LocARNA {
     	if(!count_EPMs){
             assert(validate_epm_list(found_epms));
     	}
+
+    	// all EPMs are stored in the PatternPairMap; free the EPMs of
+    	// the inner arc matches at once
+    	epm_pool.clear();
     }
 
     void ExactMatcher::apply_filter(epm_cont_t &found_epms){
@@ -1275,6 +1385,16 @@ namespace LocARNA {
 
     	//sort the epms according to the tolerance left in ascending order
     	found_epms.sort();
+
+    	// the EPMs of the inner arc matches are referenced by the EPMs in
+    	// found_epms; keep them in the pool (splicing does not move the
+    	// elements) until the EPMs are stored in the PatternPairMap
+    	if(!count_EPMs){
+            for(map_am_to_do_t::iterator it = map_am_to_do.begin();
+                it!=map_am_to_do.end();++it){
+                epm_pool.splice(epm_pool.end(),it->second.second);
+            }
+    	}
     }
 
     // traces a sequential or structural match for the suboptimal traceback
@@ -1795,23 +1915,32 @@ namespace LocARNA {
                 // if this is not the first insertion for the current epm
                 else{
 
-                    // copy the current epm
-                    found_epms.push_back(*cur_epm);
+                    // copy the current epm; if we came from the F-matrix, the epm is
+                    // only stored in the patternPairMap and we assemble it in the buffer
+                    EPM *new_epm;
+                    if(min_score!=-1){
+                        epm_buffer.assign_traced(*cur_epm);
+                        new_epm = &epm_buffer;
+                    }
+                    else{
+                        found_epms.push_back(*cur_epm);
+                        new_epm = &found_epms.back();
+                        new_epm->clear_am_to_do(); // delete arc matches to do
+                    }
 
                     if(!count_EPMs){
                         // insert the parts for the missing arc matches, not needed if just counting EPMs
                         for(std::vector<const EPM*>::const_iterator epm_to_insert = epms_to_insert.begin();
                             epm_to_insert!=epms_to_insert.end();++epm_to_insert){
-                            found_epms.back().insert_epm(**epm_to_insert);
+                            new_epm->insert_epm(**epm_to_insert);
                         }
                     }
 
-                    found_epms.back().set_max_tol_left(max_tol_left); // update tolerance left
-                    found_epms.back().clear_am_to_do(); // delete arc matches to do
+                    new_epm->set_max_tol_left(max_tol_left); // update tolerance left
 
                     if(min_score!=-1 && check_PPM()){ // we came from the F-matrix
-                        found_epms.back().set_score(min_score+max_tol_left); // set the final score of the epm
-                        add_foundEPM(found_epms.back(),count_EPMs); // store epm also in the patternPairMap
+                        new_epm->set_score(min_score+max_tol_left); // set the final score of the epm
+                        add_foundEPM(*new_epm,count_EPMs); // store epm also in the patternPairMap
                     }
                 }
             }
@@ -2014,12 +2143,17 @@ namespace LocARNA {
             ++it; //compare to all other epms after cur_epm
             bool equal;
 
+            EPM::pat_vec_t pattern1;
+            cur_epm->append_pattern(pattern1);
+
             for(;it!=found_epms.end();++it){
-                if(cur_epm->pat_vec_size() == it->pat_vec_size()){
+                EPM::pat_vec_t pattern2;
+                it->append_pattern(pattern2);
+                if(pattern1.size() == pattern2.size()){
                     equal = true;
-                    EPM::pat_vec_t::const_iterator it2 = it->begin();
-                    for(EPM::pat_vec_t::const_iterator it1 = cur_epm->begin();
-                        it1 != cur_epm->end();++it1,++it2){
+                    EPM::pat_vec_t::const_iterator it2 = pattern2.begin();
+                    for(EPM::pat_vec_t::const_iterator it1 = pattern1.begin();
+                        it1 != pattern1.end();++it1,++it2){
                         if(!(it1->first==it2->first && it1->second == it2->second && it1->third == it2->third)){
                             equal=false;
                         }
@@ -2201,10 +2335,41 @@ namespace LocARNA {
     {
 	//std::cout << std::endl << " execute destructor..." << std::endl;
 
-	EPM_Table2.clear();
-	holeOrdering2.clear();
+	chainEPMs.clear();
+	holes.clear();
     }
 
+    struct LCSEPM::ChainEPMStartLess {
+	bool operator()(const ChainEPM &x, const ChainEPM &y) const {
+	    return x.a1 < y.a1;
+	}
+	bool operator()(const ChainEPM &x, int a1) const {
+	    return x.a1 < a1;
+	}
+    };
+
+    struct LCSEPM::ChainEntryEndLess {
+	const std::vector<ChainEPM> &epms;
+	const chain_t &chain;
+	ChainEntryEndLess(const std::vector<ChainEPM> &epms_,const chain_t &chain_)
+	    : epms(epms_),chain(chain_) {}
+	bool operator()(size_type x, size_type y) const {
+	    return epms[chain[x].idx].a2 < epms[chain[y].idx].a2;
+	}
+    };
+
+    struct LCSEPM::HoleLess {
+	bool operator()(const HoleEntry &x, const HoleEntry &y) const {
+	    const intPPair &h1 = *x.hole;
+	    const intPPair &h2 = *y.hole;
+	    // first compare size of holes in A, then position
+	    unsigned int size1 = h1.first.second - h1.first.first;
+	    unsigned int size2 = h2.first.second - h2.first.first;
+	    if (size1 != size2) return size1 < size2;
+	    return h1 < h2;
+	}
+    };
+
     void
     LCSEPM::calculateLCSEPM(bool quiet)
     {
@@ -2216,21 +2381,21 @@ namespace LocARNA {
         preProcessing();
 	if (!quiet) {
             std::cout << " LCSEPM calculate holes..."  <<std::endl;
-            std::cout << "   holes to calculate = " << holeOrdering2.size() << std::endl;
+            std::cout << "   holes to calculate = " << holes.size() << std::endl;
 	}
-        calculateHoles3(quiet);
+        calculateHoles(quiet);
 	if (!quiet) {
             std::cout << " LCSEPM calculate outmost D_rec..."  <<std::endl;
 	}
         int i = 1;
 	int k = 1;
-	std::vector < std::vector<int> > last_vec;
-	int LCSEPMscore = D_rec2(i,seqA.length(),k,seqB.length(),last_vec,false);
+	chain_t chain;
+	int LCSEPMscore = chainRegion(i,seqA.length(),k,seqB.length(),chain);
 	if (!quiet) {
             std::cout << "    Score LCS-EPM: "<< LCSEPMscore <<std::endl;
             std::cout << " LCSEPM calculate traceback..."  <<std::endl;
 	}
-        calculateTraceback2(i,seqA.length(),k,seqB.length(),last_vec);
+        calculateTraceback(i,seqA.length(),k,seqB.length());
 	int LCSEPMsize = matchedEPMs.getMapBases();
         if (!quiet) {
             std::cout << "    #EPMs: "<< matchedEPMs.size() << " / matched Bases: "<< LCSEPMsize <<std::endl;
@@ -2258,128 +2423,135 @@ namespace LocARNA {
 
     void LCSEPM::preProcessing()
     {
-	// set EPM_Table size
-	EPM_Table2.resize(seqA.length()+1);
-        for (unsigned int i = 0; i < EPM_Table2.size();++i)
-	    EPM_Table2[i].resize(seqB.length()+1);
+	chainEPMs.clear();
+	chainEPMs.reserve(patterns.size());
+	holes.clear();
 
-	for (PatternPairMap::patListCITER myPair = patterns.getList().begin(); myPair != patterns.getList().end(); ++myPair)
+	size_type rank=0;
+	for (PatternPairMap::patListCITER myPair = patterns.getList().begin(); myPair != patterns.getList().end(); ++myPair, ++rank)
 	    {
 		calculatePatternBoundaries(*myPair);
 
-		// add EPM to EPM_table
-		EPM_Table2[(*myPair)->getOutsideBounds().first.second][(*myPair)->getOutsideBounds().second.second].push_back(*myPair);
-
-		// add all inside Holes from current EPM to holeOrdering multimap, sorted by holes size and exact position
+		const intPPair &bounds = (*myPair)->getOutsideBounds();
+		ChainEPM epm;
+		epm.a1 = bounds.first.first;
+		epm.a2 = bounds.first.second;
+		epm.b1 = bounds.second.first;
+		epm.b2 = bounds.second.second;
+		epm.rank = rank;
+		epm.epm = *myPair;
+		chainEPMs.push_back(epm);
+
+		// collect all inside holes of the current EPM
 		for(IntPPairCITER h = (*myPair)->getInsideBounds().begin(); h != (*myPair)->getInsideBounds().end(); ++h)
 		    {
-			// insert hole in multimap
-			intPPairPTR myH = &(*h);
-			holeOrdering2.insert(std::make_pair(myH,*myPair));
+			HoleEntry hole;
+			hole.hole = &(*h);
+			hole.epm = *myPair;
+			holes.push_back(hole);
 		    }
 	    }
+
+	// sort EPMs by start in A (ties keep the input order) and
+	// holes by size, such that identical holes are next to each
+	// other
+	std::stable_sort(chainEPMs.begin(),chainEPMs.end(),ChainEPMStartLess());
+	std::sort(holes.begin(),holes.end(),HoleLess());
     }
 
 
-    int LCSEPM::D_rec2(const int& i,const  int& j,const int& k,const int& l,std::vector < std::vector<int> >& D_h,const bool debug)
+    int LCSEPM::chainRegion(int i,int j,int k,int l,chain_t &chain) const
     {
+	chain.clear();
+
+	// collect the EPMs inside of the region in the order of their
+	// start in A
+	std::vector<ChainEPM>::const_iterator it =
+	    std::lower_bound(chainEPMs.begin(),chainEPMs.end(),i,ChainEPMStartLess());
+	for (; it!=chainEPMs.end() && it->a1<=j; ++it) {
+	    if (it->a2<=j && it->b1>=k && it->b2<=l) {
+		ChainEntry entry;
+		entry.idx = it-chainEPMs.begin();
+		entry.value = 0;
+		chain.push_back(entry);
+	    }
+	}
 
-	// initialize D_h matrix with 0
-	D_h.clear();
-	D_h.resize(j - i + 2);
-	for (unsigned int a = 0; a < D_h.size();++a)
-	    D_h[a].resize(l - k + 2,0);
-	    
-	//assert(i<=j);
-	//assert(k<=l);
-
-	for(unsigned int j_1 = 1; j_1 < size_t(j-i+2); ++j_1)
-	    for (unsigned int l_2 = 1; l_2 < size_t(l-k+2); ++l_2)
-		{
-		    if (debug==true){
-			//	std::cout << "debug " << j_1 << "," << l_2 << std::endl;
-		    }
-		    // check if EPMs ending at current position
-		    if (EPM_Table2[i + j_1-1][k + l_2-1].size() == 0)
-			{
-			    D_h[j_1][l_2] = (D_h[j_1-1][l_2]>D_h[j_1][l_2-1])? D_h[j_1-1][l_2]:D_h[j_1][l_2-1] ;
-			    // bug in old version? this is new: - No!
-			    //D_h[j_1][l_2] = max3(D_h[j_1-1][l_2],D_h[j_1][l_2-1],D_h[j_1-1][l_2-1]) ;
-			}
-		    else
-			{
-			    // get list of all EPMS ending at current pos
-			    std::vector<PatternPairMap::SelfValuePTR> EPM_list = EPM_Table2[i + j_1-1][k + l_2-1];
-			    int maxScore = 0;
-
-			    // iterate over all EPMS to get best score
-			    for (std::vector<PatternPairMap::SelfValuePTR>::iterator myIter = EPM_list.begin(); myIter < EPM_list.end(); ++myIter){
-
-				//std::cout << i+j_1-1 << "," << k+l_2-1 << " patid: " <<  (*myIter)->getId() << std::endl;
-
-				int pos_before_EPM_Str1 = (*myIter)->getOutsideBounds().first.first  - i;
-				int pos_before_EPM_Str2 = (*myIter)->getOutsideBounds().second.first - k;
-
-				int	score_EPM = 0;
-
-				// check if EPM fits into cuurent hole
-				if ((pos_before_EPM_Str1 >= 0) && (pos_before_EPM_Str2 >= 0)){
-				    score_EPM = D_h[pos_before_EPM_Str1][pos_before_EPM_Str2] + (*myIter)->getScore();
-				    //std::cout << (*myIter)->getId() << " FITS - EPM max score "<< score_EPM << " before " << pos_before_EPM_Str1+i <<","<< pos_before_EPM_Str2+k << " " << D_h[pos_before_EPM_Str1][pos_before_EPM_Str2] <<  std::endl;
-				}
-
-
-				if (score_EPM > maxScore) { maxScore = score_EPM; }
-				//std::cout << (*myIter)->getId() << " EPM max score "<< score_EPM << " before " << pos_before_EPM_Str1+i <<","<< pos_before_EPM_Str2+k <<  std::endl;
-			    }
-			    //std::cout << "score hole max "<< maxScore << std::endl;
-			    D_h[j_1][l_2] = max3(maxScore,D_h[j_1-1][l_2],D_h[j_1][l_2-1]);
-			}
-
+	size_type m = chain.size();
+	if (m==0) return 0;
+
+	// order of entries by end in A
+	std::vector<size_type> byEnd(m);
+	for (size_type x=0; x<m; ++x) byEnd[x]=x;
+	std::sort(byEnd.begin(),byEnd.end(),ChainEntryEndLess(chainEPMs,chain));
+
+	// compressed end positions in B
+	std::vector<int> endsB(m);
+	for (size_type x=0; x<m; ++x) endsB[x] = chainEPMs[chain[x].idx].b2;
+	std::sort(endsB.begin(),endsB.end());
+	endsB.erase(std::unique(endsB.begin(),endsB.end()),endsB.end());
+
+	// binary indexed tree for prefix maxima of chain scores over
+	// the end positions in B; chains of score <=0 are never
+	// extended, therefore initialize by 0
+	std::vector<int> tree(endsB.size()+1,0);
+
+	int best=0;
+	size_type next_end=0;
+	for (size_type x=0; x<m; ++x) {
+	    const ChainEPM &epm = chainEPMs[chain[x].idx];
+
+	    // make available all EPMs that end before epm starts in A
+	    for (; next_end<m
+		     && chainEPMs[chain[byEnd[next_end]].idx].a2 < epm.a1;
+		 ++next_end) {
+		const ChainEntry &entry = chain[byEnd[next_end]];
+		size_type pos = std::lower_bound(endsB.begin(),endsB.end(),
+						 chainEPMs[entry.idx].b2)
+		    - endsB.begin() + 1;
+		for (; pos<tree.size(); pos += pos & (~pos+1)) {
+		    tree[pos] = std::max(tree[pos],entry.value);
 		}
-	return (D_h[j - i + 1][l - k + 1]);
+	    }
+
+	    // best chain ending before epm starts in B
+	    size_type pos = std::lower_bound(endsB.begin(),endsB.end(),epm.b1)
+		- endsB.begin();
+	    int pred=0;
+	    for (; pos>0; pos -= pos & (~pos+1)) {
+		pred = std::max(pred,tree[pos]);
+	    }
+
+	    chain[x].value = epm.epm->getScore() + pred;
+	    best = std::max(best,chain[x].value);
+	}
+
+	return best;
     }
 
 
-    void LCSEPM::calculateHoles3(bool quiet)
+    void LCSEPM::calculateHoles(bool quiet)
     {
+	// holes are sorted by size; all EPMs inside of a hole have
+	// strictly smaller holes, such that their scores are final
+	// when the hole is chained
 	intPPairPTR lastHole 			= NULL;
-	//PatternPairMap::SelfValuePTR lastEPM 	= NULL;
 	int lastHoleScore 			= 0;
 	int skippedHoles			= 0;
-	for (HoleMapCITER2 t = holeOrdering2.begin();t != holeOrdering2.end();++t)
+	chain_t chain;
+	for (std::vector<HoleEntry>::const_iterator t = holes.begin();t != holes.end();++t)
 	    {
-		// check if current hole is exactly teh same as last hole
-		// then we do not need to calculate again the same hole
-		// ordering of "holeOrdering" ensures that similar holes are next to each other
-		if ((lastHole == NULL) || (lastHole->first.first   != (*t).first->first.first) ||
-		    (lastHole->first.second  != (*t).first->first.second) ||
-		    (lastHole->second.first  != (*t).first->second.first) ||
-		    (lastHole->second.second != (*t).first->second.second) ) {
-
-		    //std::cout << std::endl << (*t).second->getId() << std::endl <<  " new current hole " << (*t).first->first.first << "," << (*t).first->first.second;
-		    //std::cout << " - " << (*t).first->second.first << "," << (*t).first->second.second << std::endl;
-		    //std::cout << "score old " << (*t).second->getScore() << " " << (*t).second->get_struct() << std::endl;
-
-		    // calculate best score of hole
-		    bool deb=false;
-		    std::vector < std::vector<int> > vec;
-		    int holeScore = D_rec2((*t).first->first.first+1,(*t).first->first.second-1,(*t).first->second.first+1,(*t).first->second.second-1,vec,deb);
-		    (*t).second->setEPMScore(	(*t).second->getScore() + holeScore );
-
-		    //std::cout << "score new " << (*t).second->getScore() << std::endl;
-		    
-		    lastHole = (*t).first;
-		    //lastEPM = (*t).second;
-		    lastHoleScore = holeScore;
+		// identical holes are next to each other; compute
+		// each hole only once
+		if ((lastHole == NULL) || (*lastHole != *t->hole)) {
+		    const intPPair &h = *t->hole;
+		    lastHoleScore = chainRegion(h.first.first+1,h.first.second-1,h.second.first+1,h.second.second-1,chain);
+		    lastHole = t->hole;
 		} else{
-		    // add score of last hole to current EPM
-		    (*t).second->setEPMScore((*t).second->getScore() + lastHoleScore);
 		    skippedHoles++;
-		    //std::cout << std::endl << (*t).second->getId() << std::endl <<  " new current hole " << (*t).first->first.first << "," << (*t).first->first.second;
-		    //std::cout << " - " << (*t).first->second.first << "," << (*t).first->second.second <<  " " << (*t).second->get_struct() << std::endl;
-		    //std::cout << "score:"<< lastHoleScore << "-"<< (*t).second->getEPMScore() << "-" << (*t).second->getScore() << " - current hole is same as last hole. skip!" << std::endl;
 		}
+		// add score of hole to current EPM
+		t->epm->setEPMScore(t->epm->getScore() + lastHoleScore);
 	    }
         if (!quiet) {
             std::cout << "   skipped holes = " << skippedHoles << std::endl;
@@ -2387,68 +2559,68 @@ namespace LocARNA {
     }
 
 
-    void LCSEPM::calculateTraceback2(const int i,const  int j,const int k,const int l,std::vector < std::vector<int> > holeVec)
+    void LCSEPM::calculateTraceback(int i,int j,int k,int l)
     {
-	int j_1 = holeVec.size()-1;
-	int l_2 = holeVec[0].size()-1;
+	// deque keeps the regions in place while pushing
+	std::deque<TracebackRegion> stack;
+	stack.push_back(TracebackRegion());
+	stack.back().x = j;
+	stack.back().y = l;
+	chainRegion(i,j,k,l,stack.back().chain);
+
+	while (!stack.empty()) {
+	    TracebackRegion &region = stack.back();
+	    const chain_t &chain = region.chain;
+
+	    // best chain score in [..x]x[..y]
+	    int v=0;
+	    for (chain_t::const_iterator it=chain.begin(); it!=chain.end(); ++it) {
+		const ChainEPM &epm = chainEPMs[it->idx];
+		if (epm.a2<=region.x && epm.b2<=region.y) {
+		    v = std::max(v,it->value);
+		}
+	    }
+	    if (v<=0) {
+		stack.pop_back();
+		continue;
+	    }
 
-	while ((j_1 >= 1)&&(l_2 >= 1) && (holeVec[j_1][l_2]>0) )
-	    {
-		//std::cout << "traceback " << i+j_1-1 <<","<< k+l_2-1 << " score: "<<holeVec[j_1][l_2] << std::endl;
-		if (holeVec[j_1][l_2-1] == holeVec[j_1][l_2])
-		    --l_2;
-		else
-		    if (holeVec[j_1-1][l_2] == holeVec[j_1][l_2])
-			--j_1;
-		    else
-			{
-			    // get all EPMs which end at (i + j_1-1,k + l_2-1)
-			    std::vector<PatternPairMap::SelfValuePTR> EPM_list = EPM_Table2[i + j_1-1][k + l_2-1];
-
-
-			    // over all EPMs which end at (i+j_1-1,k+l_2-1)
-			    for (std::vector<PatternPairMap::SelfValuePTR>::iterator myIter = EPM_list.begin(); myIter < EPM_list.end(); ++myIter){
-				//std::cout << "here " << (*myIter)->getId() << std::endl;
-
-				// check if current EPM fits inside current hole
-				int x1 = (*myIter)->getOutsideBounds().first.first - i;
-				int x2 = (*myIter)->getOutsideBounds().second.first - k;
-				if  ( ( x1 >= 0 ) && ( x2 >= 0)){
-				    // check score
-
-				    //std::cout << "(j_1,l_2)=(" << j_1<< "," << l_2 <<")  "<< i <<","<< j << "-" << k << "," << l << "  outsidebounds first " <<  (*myIter)->getOutsideBounds().first.first << "," << (*myIter)->getOutsideBounds().second.first << std::endl;
-				    //std::cout << "score (j1,l2)="<< holeVec[j_1][l_2] << " score=" << (*myIter)->getScore() << "  EPM_score=" << (*myIter)->getEPMScore() << " before="<<holeVec[(*myIter)->getOutsideBounds().first.first-1][(*myIter)->getOutsideBounds().second.first-1];
-				    //std::cout << " " << (*myIter)->getOutsideBounds().first.first-1 << "," << (*myIter)->getOutsideBounds().second.first-1<< std::endl;
-				    int check = (*myIter)->getScore() + holeVec[x1][x2];
-				    if (holeVec[j_1][l_2] == check){
-
-					// add current EPM to traceback
-					//std::cout << "added traceback EPM "<< (*myIter)->getId() << std::endl;
-					matchedEPMs.add( *myIter );
-
-					// recurse with traceback into all holes of best EPM
-					for(IntPPairCITER h = (*myIter)->getInsideBounds().begin(); h != (*myIter)->getInsideBounds().end(); ++h)
-					    {
-						std::vector < std::vector<int> > tmpHoleVec;
-						tmpHoleVec.clear();
-						//std::cout << (*myIter)->getId() << " D_rec2 hole " << (*h).first.first+1 << "," << (*h).first.second-1 << "-" << (*h).second.first+1 << "," << (*h).second.second-1 << std::endl;
-						int sc = D_rec2((*h).first.first+1,(*h).first.second-1,(*h).second.first+1,(*h).second.second-1,tmpHoleVec,true);
-						// call traceback only if there is an EPM within hole
-						//std::cout << (*myIter)->getId() << "score "<< sc << " " << (*h).first.first+1 << "," << (*h).first.second-1 << "-" << (*h).second.first+1 << "," << (*h).second.second-1 << " hole traceback..." << std::endl;
-						if (sc > 0) {
-						    calculateTraceback2((*h).first.first+1,(*h).first.second-1,(*h).second.first+1,(*h).second.second-1,tmpHoleVec);
-						}
-					    }
-					// jump with traceback to position before EPM
-					j_1 = ( (*myIter)->getOutsideBounds().first.first ) - i;
-					l_2 = ( (*myIter)->getOutsideBounds().second.first) - k;
-					break;
-				    }
-				} // if EPM fits hole
-			    } // for
-
-			}
+	    // select the EPM like a traceback through the dense
+	    // matrix that prefers to step back in B, then in A: among
+	    // the optimal EPMs, take the one with minimal end in B,
+	    // then minimal end in A, then first in input order
+	    const ChainEPM *sel = NULL;
+	    for (chain_t::const_iterator it=chain.begin(); it!=chain.end(); ++it) {
+		const ChainEPM &epm = chainEPMs[it->idx];
+		if (it->value==v && epm.a2<=region.x && epm.b2<=region.y) {
+		    if (sel==NULL
+			|| epm.b2 < sel->b2
+			|| (epm.b2 == sel->b2
+			    && (epm.a2 < sel->a2
+				|| (epm.a2 == sel->a2 && epm.rank < sel->rank)))) {
+			sel = &epm;
+		    }
+		}
 	    }
+	    assert(sel!=NULL);
+
+	    // add current EPM to traceback
+	    matchedEPMs.add( sel->epm );
+
+	    // continue with traceback before the EPM
+	    region.x = sel->a1-1;
+	    region.y = sel->b1-1;
+
+	    // trace back into all holes of the EPM, in order
+	    const std::vector<intPPair> &inside = sel->epm->getInsideBounds();
+	    for (std::vector<intPPair>::const_reverse_iterator h = inside.rbegin(); h != inside.rend(); ++h) {
+		stack.push_back(TracebackRegion());
+		TracebackRegion &hole = stack.back();
+		hole.x = h->first.second-1;
+		hole.y = h->second.second-1;
+		chainRegion(h->first.first+1,h->first.second-1,h->second.first+1,h->second.second-1,hole.chain);
+	    }
+	}
     }
 
     char* LCSEPM::getStructure(PatternPairMap& myMap, bool firstSeq, int length)
@@ -387,31 +387,85 @@ namespace LocARNA {
 
     private:
 
-	struct HoleCompare2 {
-            bool operator()(const intPPairPTR & h1, const intPPairPTR & h2) const {
-                // first compare size of holes
-                if (h1->first.second - h1->first.first-1 < h2->first.second - h2->first.first-1){
-                    return true; }
-                // compare if holes are identical in both structures
-                if (h1->first.second - h1->first.first-1 == h2->first.second - h2->first.first-1){
-                    if ((h1->first.first == h2->first.first) && (h1->first.second == h2->first.second) &&
-                        (h1->second.first==h2->second.first) && (h1->second.second==h2->second.second))
-                        { return true; }
-                }
+	/**
+	 * @brief EPM together with its outside bounds
+	 *
+	 * The bounds are copied from the EPM for contiguous access
+	 * during chaining.
+	 */
+	struct ChainEPM {
+	    int a1; //!< first position in A
+	    int a2; //!< last position in A
+	    int b1; //!< first position in B
+	    int b2; //!< last position in B
+	    size_type rank; //!< position in list of input EPMs
+	    PatternPairMap::SelfValuePTR epm; //!< the EPM
+	};
 
-                return false;
-            }
+	//! @brief EPM (index in chainEPMs) with its best chain score in a hole
+	struct ChainEntry {
+	    size_type idx; //!< index in chainEPMs
+	    int value; //!< score of the best chain in the hole ending with the EPM
+	};
+
+	//! @brief hole of an EPM
+	struct HoleEntry {
+	    intPPairPTR hole; //!< the hole (bounds excluded)
+	    PatternPairMap::SelfValuePTR epm; //!< the EPM of the hole
 	};
 
-	typedef     std::multimap<intPPairPTR,PatternPairMap::SelfValuePTR,HoleCompare2>	HoleOrderingMapTYPE2;
-	typedef     HoleOrderingMapTYPE2::const_iterator HoleMapCITER2;
+	//! @brief order EPMs by start in A
+	struct ChainEPMStartLess;
+	//! @brief order chain entries by end in A
+	struct ChainEntryEndLess;
+	//! @brief order holes by size in A, then by position
+	struct HoleLess;
+
+	typedef std::vector<ChainEntry> chain_t; //!< chain entries of a hole
 
+	/**
+	 * @brief region on the traceback stack
+	 *
+	 * (x,y) is the current end of the traceback in the region
+	 */
+	struct TracebackRegion {
+	    chain_t chain; //!< chain entries of the region
+	    int x; //!< current end in A
+	    int y; //!< current end in B
+	};
 
 	void    preProcessing			();
-	void    calculateHoles3			(bool quiet);
+	void    calculateHoles			(bool quiet);
 	void    calculatePatternBoundaries	(PatternPair* myPair);
-	void 	calculateTraceback2		(const int i,const int j,const int k,const int l,std::vector < std::vector<int> > holeVec);
-	int 	D_rec2				(const int& i,const  int& j,const int& k,const int& l,std::vector < std::vector<int> >& D_h,const bool debug);
+
+	/**
+	 * @brief traceback of the best chain in a region
+	 *
+	 * Adds the EPMs of the best chain in the region and,
+	 * recursively, of the best chains in their holes to
+	 * matchedEPMs. The traceback is iterative.
+	 */
+	void 	calculateTraceback		(int i,int j,int k,int l);
+
+	/**
+	 * @brief chain the EPMs of a region
+	 *
+	 * Sparse dynamic programming over the EPMs that lie inside of
+	 * the region [i..j]x[k..l]: the EPMs are swept by their
+	 * position in A, while the best chain scores ending before a
+	 * position in B are maintained in a binary indexed tree.
+	 *
+	 * @param i first position in A
+	 * @param j last position in A
+	 * @param k first position in B
+	 * @param l last position in B
+	 * @param[out] chain EPMs of the region with their best chain
+	 * scores; ordered by start in A
+	 *
+	 * @return score of the best chain in the region
+	 * @note time O(m log m) for m EPMs in the region
+	 */
+	int 	chainRegion			(int i,int j,int k,int l,chain_t &chain) const;
 
 	int 	max3				(int a, int b, int c)
 	{
@@ -438,8 +492,8 @@ namespace LocARNA {
             return s;
 	}
 
-	std::vector< std::vector <std::vector<PatternPairMap::SelfValuePTR> > >	EPM_Table2;
-	HoleOrderingMapTYPE2    		holeOrdering2;
+	std::vector<ChainEPM>			chainEPMs; //!< EPMs sorted by start in A
+	std::vector<HoleEntry>			holes; //!< holes of all EPMs sorted by HoleLess
 	const 	Sequence&				seqA;
 	const 	Sequence& 				seqB;
 	PatternPairMap&				matchedEPMs;
@@ -657,6 +711,13 @@ namespace LocARNA {
 
     /**
      * \brief a class for the representation of exact pattern matches (EPM)
+     *
+     * In the suboptimal traceback, the EPMs of jumped over arc matches
+     * are not copied into an EPM, but only referenced (see
+     * insert_epm()); thus, EPMs of inner arc matches are shared by all
+     * EPMs that contain them. The pattern vector of an EPM (begin(),
+     * end(), pat_vec_size(), ...) contains only the elements that
+     * were added directly; flatten() resolves the references.
      */
     class EPM{
 
@@ -689,6 +750,9 @@ namespace LocARNA {
 
 	PairArcIdxVec am_to_do;//!< contains the pairs of arc indices which need to be traced
 
+	//! EPMs that are inserted into the EPM (shared, not owned)
+	std::vector<const EPM *> inserted_epms;
+
 	//! compare two elements of the pattern vector
 	struct compare_el_pat_vec {
 	public:
@@ -926,11 +990,62 @@ namespace LocARNA {
 	}
 
 	/**
-	 * inserts the pattern vector of the EPM epm_to_insert into the current EPM
+	 * inserts the EPM epm_to_insert into the current EPM
+	 *
+	 * The EPM is only referenced and its pattern vector is appended
+	 * on flatten().
+	 *
 	 * @param epm_to_insert EPM that is inserted
+	 * @note epm_to_insert must not be changed or destroyed before
+	 * the current EPM is flattened
 	 */
 	void insert_epm(const EPM &epm_to_insert){
-            pat_vec.insert(pat_vec.end(),epm_to_insert.begin(),epm_to_insert.end());
+            inserted_epms.push_back(&epm_to_insert);
+	}
+
+	/**
+	 * appends the pattern vector including all inserted EPMs
+	 * @param[out] out vector the elements are appended to
+	 */
+	void append_pattern(pat_vec_t &out) const{
+            out.insert(out.end(),pat_vec.begin(),pat_vec.end());
+            for(std::vector<const EPM *>::const_iterator it=inserted_epms.begin();
+                it!=inserted_epms.end();++it){
+                (*it)->append_pattern(out);
+            }
+	}
+
+	/**
+	 * appends the pattern vectors of all inserted EPMs to the
+	 * pattern vector and removes the references
+	 */
+	void flatten(){
+            for(std::vector<const EPM *>::const_iterator it=inserted_epms.begin();
+                it!=inserted_epms.end();++it){
+                (*it)->append_pattern(pat_vec);
+            }
+            inserted_epms.clear();
+	}
+
+	/**
+	 * assigns the EPM without the pairs of arc indices that need
+	 * to be computed and without inserted EPMs
+	 *
+	 * In contrast to the assignment operator, this reuses the memory
+	 * of the current EPM.
+	 *
+	 * @param epm EPM that is assigned
+	 */
+	void assign_traced(const EPM &epm){
+            pat_vec.assign(epm.pat_vec.begin(),epm.pat_vec.end());
+            score=epm.score;
+            state=epm.state;
+            cur_pos=epm.cur_pos;
+            max_tol_left=epm.max_tol_left;
+            first_insertion=epm.first_insertion;
+            invalid=epm.invalid;
+            am_to_do.clear();
+            inserted_epms.clear();
 	}
 
 	/**
@@ -966,13 +1081,15 @@ namespace LocARNA {
 	void print_epm(std::ostream &out, bool verbose) const{
             out << "_________________________________________________" << std::endl;
             out << "epm with score " << this->score << std::endl;
+            pat_vec_t pattern;
+            append_pattern(pattern);
             out << " ";
-            for(pat_vec_t::const_iterator it=pat_vec.begin();it!=pat_vec.end();++it){
+            for(pat_vec_t::const_iterator it=pattern.begin();it!=pattern.end();++it){
                 out << it->first << ":" << it->second << " ";
             }
             out << std::endl;
             out << " ";
-            for(pat_vec_t::const_iterator it=pat_vec.begin();it!=pat_vec.end();++it){
+            for(pat_vec_t::const_iterator it=pattern.begin();it!=pattern.end();++it){
                 out << it->third;
             }
             out << std::endl;
@@ -1102,6 +1219,17 @@ namespace LocARNA {
         ScoreMatrix F; //!< final matrix
         ScoreMatrix Dmat; //!< score matrix which stores for each arcmatch the score under the arcmatch
 
+        //! pool of the EPMs of inner arc matches in the suboptimal
+        //! traceback; the EPMs are referenced by the EPMs that contain
+        //! them and are freed together after all EPMs that are traced
+        //! from one position in F are stored in the PatternPairMap
+        epm_cont_t epm_pool;
+
+        //! buffer for assembling the EPMs that are traced from matrix F
+        //! in the suboptimal traceback before storing them in the
+        //! PatternPairMap
+        EPM epm_buffer;
+
         int alpha_1; //!< multiplier for sequential score
         int alpha_2; //!< multiplier for structural score
         int alpha_3; //!< multiplier for stacking score
@@ -1188,6 +1316,32 @@ namespace LocARNA {
                 nucleotide_match(i,j);
         }
 
+        /**
+         * @brief references to the matrices L, G_A, G_AB and LR
+         *
+         * compute_LGLR() fills the matrices of an arc match into these
+         * references. By default, these are the member matrices; when
+         * arc matches are scored in parallel, each thread fills its own
+         * matrices.
+         */
+        struct LGLRMatrices {
+            ScoreMatrix &L; //!< matrix L
+            ScoreMatrix &G_A; //!< matrix G_A
+            ScoreMatrix &G_AB; //!< matrix G_AB
+            ScoreMatrix &LR; //!< matrix LR
+
+            /**
+             * @brief construct
+             * @param L_ matrix L
+             * @param G_A_ matrix G_A
+             * @param G_AB_ matrix G_AB
+             * @param LR_ matrix LR
+             */
+            LGLRMatrices(ScoreMatrix &L_, ScoreMatrix &G_A_,
+                         ScoreMatrix &G_AB_, ScoreMatrix &LR_)
+                : L(L_), G_A(G_A_), G_AB(G_AB_), LR(LR_) {}
+        };
+
         // ----------------------------------------
         // fill matrices
 
@@ -1223,7 +1377,23 @@ namespace LocARNA {
          * @return returns the last position that was filled in the
          * 		   matrices for arcs a and b
          */
-        pair_seqpos_t compute_LGLR(const Arc &a, const Arc &b, bool suboptimal);
+        pair_seqpos_t compute_LGLR(const Arc &a, const Arc &b, bool suboptimal) {
+            return compute_LGLR(a,b,suboptimal,LGLRMatrices(L,G_A,G_AB,LR));
+        }
+
+        /**
+         * \brief computes matrices L, G (G_A,G_AB in suboptimal case) and LR
+         *
+         * @param a arc in first sequence
+         * @param b arc in second sequence
+         * @param suboptimal whether to compute the matrix entry for the suboptimal case
+         * @param mats the matrices that are filled
+         *
+         * @return returns the last position that was filled in the
+         * 		   matrices for arcs a and b
+         */
+        pair_seqpos_t compute_LGLR(const Arc &a, const Arc &b, bool suboptimal,
+                                   const LGLRMatrices &mats);
 
         /**
          * \brief computes one entry of the matrix L or LR
@@ -1234,11 +1404,13 @@ namespace LocARNA {
          * @param mat_pos_diag next diagonal matrix position
          * @param matrixLR if we compute an entry in LR, matrixLR is true, otherwise false
          * @param suboptimal whether to compute the matrix entry for the suboptimal case
+         * @param mats the matrices of arcs a and b
          *
          * @return the best score for matrix entry mat_pos
          */
         infty_score_t compute_matrix_entry(const Arc &a, const Arc &b,matpos_t mat_pos,
-                                           matpos_t mat_pos_diag, bool matrixLR, bool suboptimal);
+                                           matpos_t mat_pos_diag, bool matrixLR, bool suboptimal,
+                                           const LGLRMatrices &mats);
 
         /**
          * \brief computes a sequential match or structural match
@@ -1250,16 +1422,30 @@ namespace LocARNA {
          * @param add_score score that will be added for the sequential/structural match
          * @param matrixLR if we compute an entry in LR, matrixLR is true, otherwise false
          * @param suboptimal whether to compute the matrix entry for the suboptimal case
+         * @param mats the matrices of arcs a and b
          *
          * @return the best result for a sequential and structural matching, respectively
          */
         infty_score_t seq_str_matching(const Arc &a, const Arc &b, matpos_t mat_pos_diag,
                                        pair_seqpos_t seq_pos_to_be_matched, score_t add_score,bool matrixLR,
-                                       bool suboptimal);
+                                       bool suboptimal, const LGLRMatrices &mats);
 
         //! computes matrix F
         void compute_F();
 
+        /**
+         * \brief computes the nesting heights of the arcs
+         *
+         * The height of an arc is 1 plus the maximal height of all
+         * arcs that are nested strictly inside of it (0 for arcs
+         * without inner arcs).
+         *
+         * @param bps base pairs
+         * @param[out] heights height of each arc by arc index
+         */
+        static
+        void arc_heights(const BasePairs &bps, std::vector<size_type> &heights);
+
         // --------------------------------------------
         // helper functions
 
@@ -1604,8 +1790,18 @@ namespace LocARNA {
 
         ~ExactMatcher();
 
-        //! fills matrix D (i.e. computes all arc match scores) by filling
-        //! matrices L, G_A and LR
+        /**
+         * \brief fills matrix D (i.e. computes all arc match scores) by filling
+         * matrices L, G_A and LR
+         *
+         * The score of an arc match depends only on the scores of arc
+         * matches that are nested inside of it. Therefore, the arc
+         * matches are grouped into levels by the nesting heights of
+         * their arcs; the arc matches of a level are independent of
+         * each other and are computed in parallel if OpenMP is
+         * available, where each thread uses its own matrices L, G_A
+         * and LR.
+         */
         void compute_arcmatch_score();
 
         //! for debugging
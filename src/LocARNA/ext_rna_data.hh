@@ -61,7 +61,8 @@ namespace LocARNA {
 	/** 
 	 * @brief Construct from input file
 	 * 
-	 * @param filename input file name
+	 * @param filename input file name; "-" for standard input,
+	 * may be gzip compressed
 	 * @param p_bpcut cutoff probability for base pairs
 	 * @param p_bpilcut cutoff probability for base pairs in loops
 	 * @param p_uilcut cutoff probability for unpaired bases in loops
@@ -79,6 +80,35 @@ namespace LocARNA {
 		   double max_bpil_length_ratio,
 		   const PFoldParams &pfoldparams);
 
+	/**
+	 * @brief Construct as consensus of two aligned RNAs
+	 *
+	 * @param rna_dataA extended RNA ensemble data A
+	 * @param rna_dataB extended RNA ensemble data B
+	 * @param alignment Alignment of A and B
+	 * @param p_expA background probability for A
+	 * @param p_expB background probability for B
+	 * @param only_local if true, construct only local alignment
+	 *
+	 * Base pair probabilities are computed like in the
+	 * corresponding RnaData constructor. The in loop
+	 * probabilities of A and B are mapped through the alignment
+	 * edges to the consensus positions and combined by the same
+	 * consensus rule, using mean in loop cutoff
+	 * probabilities. Since only stored entries of A and B are
+	 * visited, this is linear in the size of the in loop
+	 * tables; in particular, no refolding is required.
+	 *
+	 * @pre rna_dataA and rna_dataB have in loop probabilities
+	 */
+	ExtRnaData(const ExtRnaData &rna_dataA,
+		   const ExtRnaData &rna_dataB,
+		   const Alignment &alignment,
+		   double p_expA,
+		   double p_expB,
+		   bool only_local=false
+		   );
+
     private:
 	/**
 	 * @brief copy constructor
@@ -233,6 +263,22 @@ namespace LocARNA {
 	init_from_rna_ensemble(const RnaEnsemble &rna_ensemble,
 			       const PFoldParams &pfoldparams);
 
+	/** 
+	 * @brief initialize by local folding in sliding windows
+	 * 
+	 * @param pfoldparams folding parameters
+	 * 
+	 * @note overloaded to initialize with additional information
+	 * (in loop probabilities); the in loop probabilities of a
+	 * base pair are averaged over the same windows as its base
+	 * pair probability
+	 *
+	 * @see RnaData::init_from_local_folding()
+	 */
+	virtual
+	void
+	init_from_local_folding(const PFoldParams &pfoldparams);
+
 	/**
 	 * @brief check in loop probabilities
 	 *
@@ -244,6 +290,30 @@ namespace LocARNA {
 	virtual
 	bool
 	inloopprobs_ok() const;
+
+	/**
+	 * @brief Key of the probabilities in the ensemble cache
+	 *
+	 * @param pfoldparams folding parameters
+	 *
+	 * @return key
+	 * @see RnaData::ensemble_cache_key()
+	 */
+	virtual
+	std::string
+	ensemble_cache_key(const PFoldParams &pfoldparams) const;
+
+	/**
+	 * @brief Write data in extended pp format with full precision
+	 *
+	 * @param out output stream
+	 *
+	 * @return stream
+	 * @see RnaData::write_pp_exact()
+	 */
+	virtual
+	std::ostream &
+	write_pp_exact(std::ostream &out) const;
 		
     }; // end class ExtRnaData
   
@@ -6,15 +6,18 @@
 #endif
 
 #include <iosfwd>
+#include <vector>
 #include "ext_rna_data.hh"
 #include "sequence.hh"
 #include "sparse_vector.hh"
+#include "alignment.hh"
 
 namespace LocARNA {
 
     // class Sequence;
     // class RnaEnsemble;
     // class PFoldParams;
+    class LocalFoldingWindows;
 
     /**
      * @brief Implementation of ExtRnaData
@@ -25,16 +28,16 @@ namespace LocARNA {
 	// TYPES
 	
 	//! vector of arc probabilities
-	typedef SparseVector<double> arc_prob_vector_t;
+	typedef SparseVector<double,FlatHashBackend> arc_prob_vector_t;
 	
 	//! matrix of arc probabilities
 	typedef RnaDataImpl::arc_prob_matrix_t arc_prob_matrix_t;
 	
 	//! matrix of arc probability vectors
-	typedef SparseMatrix<arc_prob_vector_t> arc_prob_vector_matrix_t;
+	typedef SparseMatrix<arc_prob_vector_t,FlatHashBackend> arc_prob_vector_matrix_t;
 
 	//! matrix of arc probability matrices
-	typedef SparseMatrix<arc_prob_matrix_t> arc_prob_matrix_matrix_t;
+	typedef SparseMatrix<arc_prob_matrix_t,FlatHashBackend> arc_prob_matrix_matrix_t;
 	
 	
 	// ----------------------------------------
@@ -121,6 +124,92 @@ namespace LocARNA {
 	void
 	init_from_ext_rna_ensemble(const RnaEnsemble &rna_ensemble);	
 
+	/**
+	 * @brief add in loop probabilities of a window for local folding
+	 *
+	 * @param window data of the window
+	 * @param offset position of the window in the sequence minus 1
+	 *
+	 * Adds the (cut off) in loop probabilities of the window to
+	 * the entries of arc_in_loop_probs_ and
+	 * unpaired_in_loop_probs_, which hold sums until
+	 * finish_local_folding(); the external loop of the window
+	 * maps to the external loop of the sequence.
+	 */
+	void
+	add_local_window(const ExtRnaData &window, size_type offset);
+
+	/**
+	 * @brief turn the accumulated window in loop probabilities
+	 * into averages
+	 *
+	 * @param windows the windows
+	 *
+	 * In loop probabilities of a base pair are averaged like the
+	 * probability of the base pair itself; in loop entries of
+	 * base pairs that were dropped from the arc probabilities are
+	 * removed.
+	 *
+	 * @pre base pair probabilities are final, i.e.
+	 * RnaDataImpl::finish_local_folding() was called
+	 */
+	void
+	finish_local_folding(const LocalFoldingWindows &windows);
+
+	/**
+	 * @brief initialize in loop probabilities as consensus of two
+	 * aligned RNAs
+	 *
+	 * @param edges alignment edges
+	 * @param rna_dataA extended rna data A
+	 * @param rna_dataB extended rna data B
+	 * @param p_expA background probability A
+	 * @param p_expB background probability B
+	 *
+	 * In loop entries are kept for the external loop and base
+	 * pairs of the consensus; the cutoffs are the weighted
+	 * geometric means of the cutoffs of A and B.
+	 *
+	 * @pre base pair probabilities are initialized as consensus,
+	 * i.e. RnaDataImpl::init_as_consensus_dot_plot() was called
+	 */
+	void
+	init_as_consensus(const Alignment::edges_t &edges,
+			  const ExtRnaData &rna_dataA,
+			  const ExtRnaData &rna_dataB,
+			  double p_expA,
+			  double p_expB);
+
+    private:
+	/**
+	 * @brief add consensus in loop probabilities for the entries
+	 * of one of the aligned RNAs
+	 *
+	 * @param x in loop data of the RNA, whose entries are visited
+	 * @param col_x consensus column of each position of x, 0 if
+	 * not aligned
+	 * @param y in loop data of the other RNA
+	 * @param pos_y position of y in each consensus column, 0 for
+	 * gaps
+	 * @param rows_x number of rows of x
+	 * @param rows_y number of rows of y
+	 * @param p_exp_x background probability of x
+	 * @param p_exp_y background probability of y
+	 * @param skip_shared if true, skip entries that are stored in y as
+	 * well (since they were already added from y)
+	 */
+	void
+	add_consensus_in_loop_probs(const ExtRnaDataImpl &x,
+				    const std::vector<size_type> &col_x,
+				    const ExtRnaDataImpl &y,
+				    const std::vector<size_type> &pos_y,
+				    size_t rows_x,
+				    size_t rows_y,
+				    double p_exp_x,
+				    double p_exp_y,
+				    bool skip_shared);
+    public:
+
 	/**
 	 * @brief read in loop probability section of pp-format
 	 *
@@ -160,6 +249,7 @@ namespace LocARNA {
 	 * @param p_outbpcut base pair probability cutoff
 	 * @param p_outbpilcut base pair in loop probability cutoff
 	 * @param p_outuilcut unpaired in loop probability cutoff
+	 * @param exact write probabilities with full precision
 	 * 
 	 * @return output stream
 	 */
@@ -167,52 +257,53 @@ namespace LocARNA {
 	write_pp_in_loop_probabilities(std::ostream &out,
 				       double p_outbpcut,
 				       double p_outbpilcut,
-				       double p_outuilcut
+				       double p_outuilcut,
+				       bool exact=false
 				       ) const;
 
 	/** 
 	 * @brief Write a line of in loop probabilities for one base pair
 	 * 
-	 * @param out output stream
+	 * @param buf output buffer; the line is appended
 	 * @param i left end
 	 * @param j right end
 	 * @param p_bpcut base pair in loop probability cutoff
 	 * @param p_ucut unpaired in loop probability cutoff
-	 * 
-	 * @return output stream
+	 * @param exact write probabilities with full precision
 	 */
-	std::ostream &
-	write_pp_in_loop_probability_line(std::ostream &out,
+	void
+	write_pp_in_loop_probability_line(std::string &buf,
 					  size_t i, size_t j,
 					  double p_bpcut,
-					  double p_ucut) const;
+					  double p_ucut,
+					  bool exact) const;
 	/** 
 	 * @brief Write in loop base pair probabilities for a specific base pair
 	 * 
-	 * @param out output stream 
+	 * @param buf output buffer; the probabilities are appended
 	 * @param probs in loop probability matrix of a base pair
 	 * @param p_cut base pair in loop probability cutoff
-	 * 
-	 * @return output stream
+	 * @param exact write probabilities with full precision
 	 */
-	std::ostream &
-	write_pp_basepair_in_loop_probabilities(std::ostream &out,
+	void
+	write_pp_basepair_in_loop_probabilities(std::string &buf,
 						const arc_prob_matrix_t &probs,
-						double p_cut) const;
+						double p_cut,
+						bool exact) const;
 	
 	/** 
 	 * @brief Write in loop unpaired probabilities for a specific base pair
 	 * 
-	 * @param out output stream 
+	 * @param buf output buffer; the probabilities are appended
 	 * @param probs in loop probability vector of a base pair
 	 * @param p_cut unpaired in loop probability cutoff
-	 * 
-	 * @return output stream
+	 * @param exact write probabilities with full precision
 	 */
-	std::ostream &
-	write_pp_unpaired_in_loop_probabilities(std::ostream &out,
+	void
+	write_pp_unpaired_in_loop_probabilities(std::string &buf,
 						const arc_prob_vector_t &probs,
-						double p_cut) const;
+						double p_cut,
+						bool exact) const;
 
 	/** 
 	 * @brief Drop in loop bases and base pairs without base pairs
@@ -21,8 +21,10 @@ namespace LocARNA {
 	    v[1][i] = sqdiff(x[i-1],c1) + std::min(v[1][i-1],v[0][i-1]+delta_01);
 	
 	    if (traceback) {
-		t[0][i] = (v[0][i-1] > v[1][i-1]+delta_10); // 0 for going to 0, 1 for going to 1
-		t[1][i] = !(v[1][i-1] > v[0][i-1]+delta_01);
+		// bit 0: predecessor of 0, bit 1: predecessor of 1
+		// (0 for coming from 0, 1 for coming from 1)
+		t[i] = (v[0][i-1] > v[1][i-1]+delta_10)
+		    | (!(v[1][i-1] > v[0][i-1]+delta_01))<<1;
 	    }
 	}
 
@@ -31,7 +33,7 @@ namespace LocARNA {
 	
 	    for (size_type i=x.size() ;i>0; --i) {
 		trace[i]=state;
-		state=t[state][i];
+		state=(t[i]>>state)&1;
 	    }
 	}
     
@@ -84,17 +86,24 @@ namespace LocARNA {
 
 
 
-    pf_t
-    FitOnOff::forward(double c0, double c1) {
-	v[0][0]=1;
-	v[1][0]=1;
+    double
+    FitOnOff::log_forward(double c0, double c1) {
+	v[0][0]=0.5;
+	v[1][0]=0.5;
+	double log_z=log(2.0);
     
 	for (size_type i=1;i<=x.size(); ++i) {
 	    v[0][i] = exp(-beta*sqdiff(x[i-1],c0)) * (v[0][i-1] + v[1][i-1]*exp_delta_10);
 	    v[1][i] = exp(-beta*sqdiff(x[i-1],c1)) * (v[1][i-1] + v[0][i-1]*exp_delta_01);
+
+	    // rescale to sum 1
+	    pf_t scale = v[0][i]+v[1][i];
+	    v[0][i] /= scale;
+	    v[1][i] /= scale;
+	    log_z += log(scale);
 	}
 
-	return v[0][x.size()] + v[1][x.size()];
+	return log_z;
     }
 
     std::pair<double,double>
@@ -106,22 +115,10 @@ namespace LocARNA {
 
 	bool converged=false;
     
-	std::vector<pf_t> theta; // factor for staying in numeric range
-	theta.resize(x.size()+1);
-    
-	std::vector<std::vector<std::vector<pf_t> > > dv; // partial derivations dv[x][y][i] of v[x][i] by cy
-	dv.resize(2);
-	dv[0].resize(2);
-	dv[1].resize(2);
-	dv[0][0].resize(x.size()+1);
-	dv[0][1].resize(x.size()+1);
-	dv[1][0].resize(x.size()+1);
-	dv[1][1].resize(x.size()+1);
-    
-	pf_t last2_c0=c1;
-	pf_t last2_c1=c0;
-	pf_t last_c0=c1;
-	pf_t last_c1=c0;
+	double last2_c0=c1;
+	double last2_c1=c0;
+	double last_c0=c1;
+	double last_c1=c0;
     
 
 	// perform iterations of optimization
@@ -129,61 +126,68 @@ namespace LocARNA {
 	size_type step=0;
 	while (!converged && step<max_steps) {
 	    step++;
-
-	
-	    // ----------------------------------------
-	    // compute thetas for c0,c1
-	    viterbi(c0,c1,false);
-	
-	    // pf_t Theta=1;
-	    theta[0]=1;
-	    for (size_type i=1;i<=x.size(); ++i) {
-		//theta[i]=1;
-		// estimate factor from difference between sum of viterbi scores at i and i-1
-		theta[i]=exp(beta*(v[0][i]+v[1][i]-v[0][i-1]-v[1][i-1])); // exp(-beta*viterbi_score/x.size());
-		// Theta *= theta[i];
-	    }
-	
 	
 	    // determine gradient
+	    //
+	    // The partition functions v0, v1 and their partial
+	    // derivations dv[x][y] by cy are only required for the
+	    // previous position. For staying in numeric range, all
+	    // values at a position are scaled by the same factor,
+	    // such that v0+v1=1. This scales the gradient by a
+	    // positive factor and preserves its direction, which is
+	    // all we need.
+	    //
+	    // The direction is preserved in exact arithmetic only.
+	    // Rounding differs from the former long double
+	    // computation with theta factors; close to the optimum,
+	    // where the steps oscillate, this can flip a step. The
+	    // fitted values then differ from those of the former
+	    // computation by about stepwidth (and the viterbi path
+	    // accordingly), or more if max_steps is reached before
+	    // convergence.
 	
 	    // initialize
-	    v[0][0]=1;
-	    v[1][0]=1;
+	    pf_t v0=0.5;
+	    pf_t v1=0.5;
 	
-	    dv[0][0][0] = 0;
-	    dv[0][1][0] = 0;
-	    dv[1][0][0] = 0;
-	    dv[1][1][0] = 0;
+	    pf_t dv00 = 0;
+	    pf_t dv01 = 0;
+	    pf_t dv10 = 0;
+	    pf_t dv11 = 0;
 	
 	    // recurse
 	    for (size_type i=1;i<=x.size(); ++i) {
-		pf_t exp_dev0=exp(-beta*sqdiff(x[i-1],c0)); // boltzmann weight of square devitation xi to c0
-		pf_t exp_dev1=exp(-beta*sqdiff(x[i-1],c1)); // boltzmann weight of square devitation xi to c1
-	    
-		v[0][i] = theta[i]*exp_dev0 * (v[0][i-1] + v[1][i-1]*exp_delta_10);
-		v[1][i] = theta[i]*exp_dev1 * (v[1][i-1] + v[0][i-1]*exp_delta_01);
-    	    
-		dv[0][0][i] = theta[i]*
-		    exp_dev0 * ( dv[0][0][i-1] + dv[1][0][i-1]*exp_delta_10
-				 +
-				 (v[0][i-1]+v[1][i-1]*exp_delta_10)*2*beta*(x[i-1]-c0));
-	    
-		dv[0][1][i] = theta[i] * exp_dev0 * ( dv[0][1][i-1] + dv[1][1][i-1]*exp_delta_10);
-	    
-		dv[1][0][i] = theta[i] * exp_dev1 * ( dv[1][0][i-1] + dv[0][0][i-1]*exp_delta_01);
+		double sqdev0=sqdiff(x[i-1],c0);
+		double sqdev1=sqdiff(x[i-1],c1);
+		double min_sqdev=std::min(sqdev0,sqdev1);
+
+		// boltzmann weights of square devitation xi to c0
+		// and c1, scaled by exp(beta*min_sqdev)
+		pf_t exp_dev0=exp(-beta*(sqdev0-min_sqdev));
+		pf_t exp_dev1=exp(-beta*(sqdev1-min_sqdev));
 	    
-		dv[1][1][i] = theta[i] *
-		    exp_dev1 * ( dv[1][1][i-1] + dv[0][1][i-1]*exp_delta_01
-				 +
-				 (v[1][i-1]+v[0][i-1]*exp_delta_01)*2*beta*(x[i-1]-c1));
+		pf_t in0 = v0 + v1*exp_delta_10;
+		pf_t in1 = v1 + v0*exp_delta_01;
+		
+		pf_t new_dv00 = exp_dev0 * ( dv00 + dv10*exp_delta_10 + in0*2*beta*(x[i-1]-c0) );
+		pf_t new_dv01 = exp_dev0 * ( dv01 + dv11*exp_delta_10 );
+		pf_t new_dv10 = exp_dev1 * ( dv10 + dv00*exp_delta_01 );
+		pf_t new_dv11 = exp_dev1 * ( dv11 + dv01*exp_delta_01 + in1*2*beta*(x[i-1]-c1) );
+		
+		v0 = exp_dev0 * in0;
+		v1 = exp_dev1 * in1;
+		
+		pf_t scale = 1/(v0+v1);
+		v0 *= scale;
+		v1 *= scale;
+		dv00 = new_dv00*scale;
+		dv01 = new_dv01*scale;
+		dv10 = new_dv10*scale;
+		dv11 = new_dv11*scale;
 	    }
 	
-	    //pf_t Z = v[0][x.size()]+v[1][x.size()];
-	
-	
-	    pf_t d0 = dv[0][0][x.size()] + dv[1][0][x.size()];	
-	    pf_t d1 = dv[0][1][x.size()] + dv[1][1][x.size()];
+	    pf_t d0 = dv00 + dv10;	
+	    pf_t d1 = dv01 + dv11;
 	
 	
 	    // normalize vector (d0,d1) in a numerically nice way
@@ -198,7 +202,7 @@ namespace LocARNA {
 	    c1+=d1;
 	
 	
-	    converged=fabsl(last2_c0-c0)<stepwidth/2 && fabsl(last2_c1-c1)<stepwidth/2;
+	    converged=fabs(last2_c0-c0)<stepwidth/2 && fabs(last2_c1-c1)<stepwidth/2;
 	    last2_c0=last_c0;
 	    last2_c1=last_c1;
 	    last_c0=c0;
@@ -271,8 +275,14 @@ namespace LocARNA {
     {
 	print_table("v0",v[0]);
 	print_table("v1",v[1]);
-	print_table("t0",t[0]);
-	print_table("t1",t[1]);
+	std::vector<bool> t0(t.size());
+	std::vector<bool> t1(t.size());
+	for (size_type i=0;i<t.size(); ++i) {
+	    t0[i] = t[i]&1;
+	    t1[i] = (t[i]>>1)&1;
+	}
+	print_table("t0",t0);
+	print_table("t1",t1);
 	print_table("tr",trace);
     }
 
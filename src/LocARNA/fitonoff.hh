@@ -15,7 +15,8 @@ namespace LocARNA {
     typedef std::vector<double> numseq_t;
     typedef std::vector<double>::size_type size_type;
 
-    typedef long double pf_t;
+    //! @brief type of partition functions; kept in numeric range by scaling
+    typedef double pf_t;
 
     /**
      * \brief Implements fitting of a two-step function to a number sequence 
@@ -33,7 +34,9 @@ namespace LocARNA {
     
 	std::vector<std::vector<pf_t> > v; //!< score/pf vectors 0 and 1
     
-	std::vector<std::vector<bool> > t; //!< trace vectors 0 and 1
+	//! packed trace vectors; bit s of t[i] is the predecessor state
+	//! of state s at position i
+	std::vector<unsigned char> t;
     
 	std::vector<bool> trace;
 
@@ -57,9 +60,7 @@ namespace LocARNA {
 	    v[0].resize(x.size()+1);
 	    v[1].resize(x.size()+1);
 	
-	    t.resize(2);
-	    t[0].resize(x.size()+1);
-	    t[1].resize(x.size()+1);
+	    t.resize(x.size()+1);
 	    trace.resize(x.size()+1);
 
 	    exp_delta_01 = exp(-beta*delta_01);
@@ -90,10 +91,12 @@ namespace LocARNA {
     
 	/**
 	 * compute forward partition functions
-	 * fills tables v
+	 * fills tables v with partition functions that are scaled to
+	 * sum up to 1 at each position
+	 * @return logarithm of the (unscaled) partition function
 	 */
-	pf_t
-	forward(double c0, double c1);
+	double
+	log_forward(double c0, double c1);
     
     
 	/**
@@ -0,0 +1,440 @@
+#ifndef LOCARNA_FLAT_HASH_MAP_HH
+#define LOCARNA_FLAT_HASH_MAP_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <iterator>
+#include <cstddef>
+#include <cassert>
+
+#include <stdint.h>
+
+#include "aux.hh"
+
+namespace LocARNA {
+
+    /**
+     * @brief Packing of keys of FlatHashMap into 64 bit words
+     *
+     * Specialized for the keys of sparse vectors (indices) and
+     * sparse matrices (pairs of indices, which are packed as two 32
+     * bit halves).
+     */
+    template <class Key>
+    struct flat_hash_key;
+
+    //! packing of index pairs
+    template <>
+    struct flat_hash_key< std::pair<size_t,size_t> > {
+	//! key type
+	typedef std::pair<size_t,size_t> key_type;
+
+	//! @brief pack key @pre both indices are less than 2^32
+	static
+	uint64_t
+	pack(const key_type &k) {
+	    assert((uint64_t)k.first < (1ULL<<32) && (uint64_t)k.second < (1ULL<<32));
+	    return ((uint64_t)k.first<<32) | (uint64_t)k.second;
+	}
+
+	//! unpack key
+	static
+	key_type
+	unpack(uint64_t x) {
+	    return key_type((size_t)(x>>32), (size_t)(x & 0xffffffffULL));
+	}
+    };
+
+    //! packing of indices
+    template <>
+    struct flat_hash_key<size_t> {
+	//! key type
+	typedef size_t key_type;
+
+	//! pack key
+	static
+	uint64_t
+	pack(const key_type &k) {
+	    return (uint64_t)k;
+	}
+
+	//! unpack key
+	static
+	key_type
+	unpack(uint64_t x) {
+	    return (key_type)x;
+	}
+    };
+
+    /**
+     * @brief Hash map with open addressing
+     *
+     * Stores keys (packed into 64 bit words) and values in two
+     * arrays of power of two capacity; collisions are resolved by
+     * linear probing, erasing uses backward shifting (no tomb
+     * stones). Compared to the node based unordered_map, this saves
+     * the per entry allocation and pointer overhead and makes
+     * probing cache friendly.
+     *
+     * Implements the subset of the unordered_map interface that is
+     * used by SparseMatrix and SparseVector. Dereferencing
+     * iterators yields proxies (with members first and second),
+     * since keys are not stored unpacked.
+     *
+     * @note value type T must be default constructible; erasing
+     * or inserting invalidates all iterators.
+     *
+     * @see FlatHashBackend
+     */
+    template <class Key, class T>
+    class FlatHashMap {
+    public:
+	typedef Key key_type; //!< key type
+	typedef T mapped_type; //!< mapped type
+	typedef std::pair<const Key,T> value_type; //!< value type
+	typedef size_t size_type; //!< size type
+
+    private:
+	typedef flat_hash_key<Key> packing_t;
+
+	//! marks empty slots; not a valid packed key
+	static const uint64_t empty_key_ = ~(uint64_t)0;
+
+	std::vector<uint64_t> keys_; //!< packed keys of slots
+	std::vector<T> vals_; //!< values of slots
+	size_type size_; //!< number of entries
+	size_type shift_; //!< 64 - log2(capacity)
+
+    public:
+
+	/**
+	 * @brief Entry proxy
+	 *
+	 * Returned on dereferencing iterators; Ref is a (const)
+	 * reference to the value.
+	 */
+	template <class Ref>
+	struct entry {
+	    const key_type first; //!< key
+	    Ref second; //!< value
+
+	    //! @brief construct from key and value
+	    entry(const key_type &k, Ref v): first(k), second(v) {}
+	};
+
+	/**
+	 * @brief Iterator over the entries
+	 *
+	 * const_iterator and iterator differ in the map pointer and
+	 * the value reference type; iterators convert to
+	 * const_iterators.
+	 */
+	template <class MapPtr, class Ref>
+	class basic_iterator {
+	    template <class MapPtr2, class Ref2>
+	    friend class basic_iterator;
+
+	    MapPtr m_;
+	    size_type idx_;
+
+	    //! proxy for operator->
+	    struct arrow {
+		entry<Ref> e_;
+		explicit arrow(const entry<Ref> &e): e_(e) {}
+		const entry<Ref> *operator ->() const { return &e_; }
+	    };
+
+	public:
+	    typedef std::input_iterator_tag iterator_category; //!< iterator category
+	    typedef entry<Ref> value_type; //!< value type
+	    typedef std::ptrdiff_t difference_type; //!< difference type
+	    typedef arrow pointer; //!< pointer type
+	    typedef entry<Ref> reference; //!< reference type
+
+	    //! @brief construct at slot idx of m; skip empty slots
+	    basic_iterator(MapPtr m, size_type idx)
+		: m_(m), idx_(idx) {
+		while (idx_<m_->keys_.size() && m_->keys_[idx_]==empty_key_) ++idx_;
+	    }
+
+	    //! @brief convert (iterator to const_iterator)
+	    template <class MapPtr2, class Ref2>
+	    basic_iterator(const basic_iterator<MapPtr2,Ref2> &it)
+		: m_(it.m_), idx_(it.idx_) {}
+
+	    //! @brief dereference
+	    reference
+	    operator *() const {
+		return reference(packing_t::unpack(m_->keys_[idx_]), m_->vals_[idx_]);
+	    }
+
+	    //! @brief member access
+	    pointer
+	    operator ->() const {
+		return pointer(**this);
+	    }
+
+	    //! @brief prefix increment
+	    basic_iterator &
+	    operator ++() {
+		++idx_;
+		while (idx_<m_->keys_.size() && m_->keys_[idx_]==empty_key_) ++idx_;
+		return *this;
+	    }
+
+	    //! @brief postfix increment
+	    basic_iterator
+	    operator ++(int) {
+		basic_iterator tmp(*this);
+		++(*this);
+		return tmp;
+	    }
+
+	    //! @brief equality
+	    bool
+	    operator ==(const basic_iterator &it) const {
+		return idx_==it.idx_;
+	    }
+
+	    //! @brief inequality
+	    bool
+	    operator !=(const basic_iterator &it) const {
+		return idx_!=it.idx_;
+	    }
+	};
+
+	//! iterator
+	typedef basic_iterator<FlatHashMap *, T &> iterator;
+	//! const iterator
+	typedef basic_iterator<const FlatHashMap *, const T &> const_iterator;
+
+	//! @brief construct empty map
+	FlatHashMap(): keys_(), vals_(), size_(0), shift_(64) {}
+
+	//! @brief number of entries
+	size_type
+	size() const { return size_; }
+
+	//! @brief check for emptiness
+	bool
+	empty() const { return size_==0; }
+
+	//! @brief remove all entries (releases the storage)
+	void
+	clear() {
+	    std::vector<uint64_t>().swap(keys_);
+	    std::vector<T>().swap(vals_);
+	    size_=0;
+	    shift_=64;
+	}
+
+	//! @brief begin iterator
+	iterator begin() { return iterator(this,0); }
+	//! @brief end iterator
+	iterator end() { return iterator(this,keys_.size()); }
+	//! @brief begin const iterator
+	const_iterator begin() const { return const_iterator(this,0); }
+	//! @brief end const iterator
+	const_iterator end() const { return const_iterator(this,keys_.size()); }
+
+	/**
+	 * @brief Find entry
+	 * @param k key
+	 * @return iterator to the entry of k; end() if there is none
+	 */
+	iterator
+	find(const key_type &k) {
+	    return iterator(this,slot(packing_t::pack(k)));
+	}
+
+	//! @brief find entry (const)
+	const_iterator
+	find(const key_type &k) const {
+	    return const_iterator(this,slot(packing_t::pack(k)));
+	}
+
+	/**
+	 * @brief Insert entry
+	 * @param x key and value
+	 * @return iterator to the entry of x.first and whether x was
+	 * inserted (like unordered_map, an existing entry is not
+	 * overwritten)
+	 */
+	std::pair<iterator,bool>
+	insert(const value_type &x) {
+	    uint64_t pk = packing_t::pack(x.first);
+	    size_type idx = slot(pk);
+	    if (idx!=keys_.size()) {
+		return std::pair<iterator,bool>(iterator(this,idx),false);
+	    }
+	    idx = insert_new(pk);
+	    vals_[idx] = x.second;
+	    return std::pair<iterator,bool>(iterator(this,idx),true);
+	}
+
+	/**
+	 * @brief Access value, insert default value if not present
+	 * @param k key
+	 * @return reference to value of k
+	 */
+	mapped_type &
+	operator [](const key_type &k) {
+	    uint64_t pk = packing_t::pack(k);
+	    size_type idx = slot(pk);
+	    if (idx==keys_.size()) {
+		idx = insert_new(pk);
+	    }
+	    return vals_[idx];
+	}
+
+	/**
+	 * @brief Erase entry
+	 * @param k key
+	 * @return number of erased entries
+	 */
+	size_type
+	erase(const key_type &k) {
+	    size_type i = slot(packing_t::pack(k));
+	    if (i==keys_.size()) return 0;
+
+	    // shift back following entries of the probe chain, unless
+	    // this would move them before their home slot
+	    using std::swap;
+	    size_type mask = keys_.size()-1;
+	    size_type j = i;
+	    while (true) {
+		j = (j+1) & mask;
+		if (keys_[j]==empty_key_) break;
+		size_type h = home(keys_[j]);
+		if (((j-h) & mask) >= ((j-i) & mask)) {
+		    keys_[i] = keys_[j];
+		    // swap, such that values holding maps are not copied
+		    swap(vals_[i],vals_[j]);
+		    i = j;
+		}
+	    }
+	    keys_[i] = empty_key_;
+	    T empty_val = T();
+	    swap(vals_[i],empty_val);
+	    --size_;
+	    return 1;
+	}
+
+	//! @brief swap with other map
+	void
+	swap(FlatHashMap &m) {
+	    keys_.swap(m.keys_);
+	    vals_.swap(m.vals_);
+	    std::swap(size_,m.size_);
+	    std::swap(shift_,m.shift_);
+	}
+
+    private:
+
+	//! @brief home slot of packed key (Fibonacci hashing)
+	size_type
+	home(uint64_t pk) const {
+	    return (size_type)((pk * 0x9E3779B97F4A7C15ULL) >> shift_);
+	}
+
+	//! @brief slot of packed key; capacity if not present
+	size_type
+	slot(uint64_t pk) const {
+	    assert(pk!=empty_key_);
+	    if (size_==0) return keys_.size();
+	    size_type mask = keys_.size()-1;
+	    for (size_type idx = home(pk); ; idx = (idx+1) & mask) {
+		if (keys_[idx]==pk) return idx;
+		if (keys_[idx]==empty_key_) return keys_.size();
+	    }
+	}
+
+	//! @brief insert packed key that is not present; grow if necessary
+	//! @return slot of new entry (holding the default value)
+	size_type
+	insert_new(uint64_t pk) {
+	    // keep the load at most 0.7
+	    if (10*(size_+1) > 7*keys_.size()) {
+		rehash(keys_.empty() ? 16 : 2*keys_.size());
+	    }
+	    size_type mask = keys_.size()-1;
+	    size_type idx = home(pk);
+	    while (keys_[idx]!=empty_key_) idx = (idx+1) & mask;
+	    keys_[idx] = pk;
+	    ++size_;
+	    return idx;
+	}
+
+	//! @brief rehash to new capacity (power of two)
+	void
+	rehash(size_type capacity) {
+	    std::vector<uint64_t> keys(capacity,empty_key_);
+	    std::vector<T> vals(capacity);
+	    keys.swap(keys_);
+	    vals.swap(vals_);
+
+	    shift_ = 64;
+	    for (size_type c=capacity; c>1; c>>=1) --shift_;
+
+	    size_type mask = capacity-1;
+	    for (size_type k=0; k<keys.size(); ++k) {
+		if (keys[k]==empty_key_) continue;
+		size_type idx = home(keys[k]);
+		while (keys_[idx]!=empty_key_) idx = (idx+1) & mask;
+		keys_[idx] = keys[k];
+		using std::swap;
+		swap(vals_[idx],vals[k]);
+	    }
+	}
+    };
+
+    template <class Key, class T>
+    const uint64_t FlatHashMap<Key,T>::empty_key_;
+
+    /**
+     * @brief Backend of SparseMatrix and SparseVector using
+     * unordered_map (default)
+     *
+     * Iteration order and iterator stability are those of
+     * unordered_map.
+     */
+    struct StdHashBackend {
+	//! map type for key and value type
+	template <class Key, class T>
+	struct map {
+	    typedef typename unordered_map<Key,T>::type type; //!< map type
+	};
+
+	//! map type for index pairs
+	template <class T>
+	struct map<std::pair<size_t,size_t>,T> {
+	    //! map type
+	    typedef typename unordered_map<std::pair<size_t,size_t>,T,pair_of_size_t_hash>::type type;
+	};
+    };
+
+    /**
+     * @brief Backend of SparseMatrix and SparseVector using
+     * FlatHashMap
+     *
+     * Faster and smaller for small value types, which are
+     * frequently probed. Select it only where no code depends on
+     * the iteration order and no entries are erased while
+     * iterating.
+     */
+    struct FlatHashBackend {
+	//! map type for key and value type
+	template <class Key, class T>
+	struct map {
+	    typedef FlatHashMap<Key,T> type; //!< map type
+	};
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_FLAT_HASH_MAP_HH
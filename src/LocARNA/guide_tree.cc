@@ -0,0 +1,188 @@
+#include "guide_tree.hh"
+
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace LocARNA {
+
+    GuideTree::GuideTree(const score_matrix_t &scores, Method::type method)
+	: num_leaves_(scores.sizes().first),
+	  nodes_() {
+	assert(num_leaves_>=1);
+	assert(scores.sizes().second==num_leaves_);
+
+	nodes_.reserve(2*num_leaves_-1);
+	for (size_type i=0; i<num_leaves_; ++i) {
+	    node_t leaf;
+	    leaf.left = leaf.right = i;
+	    leaf.size = 1;
+	    nodes_.push_back(leaf);
+	}
+
+	if (method==Method::UPGMA) {
+	    upgma(scores);
+	} else {
+	    neighbor_joining(scores);
+	}
+    }
+
+    size_type
+    GuideTree::join(size_type left, size_type right) {
+	node_t node;
+	node.left = left;
+	node.right = right;
+	node.size = nodes_[left].size + nodes_[right].size;
+	nodes_.push_back(node);
+	return nodes_.size()-1;
+    }
+
+    // UPGMA with average linkage on similarities; clusters are
+    // merged into the matrix row of their first member (as in
+    // MLocarna::upgma_tree)
+    void
+    GuideTree::upgma(score_matrix_t scores) {
+	std::vector<size_type> slots; // active rows of the score matrix
+	std::vector<size_type> node_of(num_leaves_);
+	for (size_type i=0; i<num_leaves_; ++i) {
+	    slots.push_back(i);
+	    node_of[i]=i;
+	}
+
+	while (slots.size()>1) {
+	    // find the most similar pair of clusters
+	    size_type best_a=0;
+	    size_type best_b=1;
+	    for (size_type a=0; a<slots.size(); ++a) {
+		for (size_type b=a+1; b<slots.size(); ++b) {
+		    if (scores(slots[a],slots[b]) > scores(slots[best_a],slots[best_b])) {
+			best_a=a;
+			best_b=b;
+		    }
+		}
+	    }
+
+	    size_type si=slots[best_a];
+	    size_type sj=slots[best_b];
+	    double size_i = nodes_[node_of[si]].size;
+	    double size_j = nodes_[node_of[sj]].size;
+
+	    // average the scores to the remaining clusters
+	    for (size_type a=0; a<slots.size(); ++a) {
+		size_type sk=slots[a];
+		if (sk==si || sk==sj) continue;
+		double s = (size_i*scores(si,sk) + size_j*scores(sj,sk)) / (size_i+size_j);
+		scores(si,sk) = s;
+		scores(sk,si) = s;
+	    }
+
+	    node_of[si] = join(node_of[si],node_of[sj]);
+	    slots.erase(slots.begin()+best_b);
+	}
+    }
+
+    void
+    GuideTree::neighbor_joining(const score_matrix_t &scores) {
+	// transform scores to distances
+	double max_score=0;
+	bool first=true;
+	for (size_type i=0; i<num_leaves_; ++i) {
+	    for (size_type j=i+1; j<num_leaves_; ++j) {
+		if (first || scores(i,j)>max_score) {
+		    max_score=scores(i,j);
+		    first=false;
+		}
+	    }
+	}
+
+	score_matrix_t dist(num_leaves_,num_leaves_);
+	for (size_type i=0; i<num_leaves_; ++i) {
+	    dist(i,i)=0;
+	    for (size_type j=i+1; j<num_leaves_; ++j) {
+		dist(i,j) = dist(j,i) = max_score - scores(i,j);
+	    }
+	}
+
+	std::vector<size_type> slots;
+	std::vector<size_type> node_of(num_leaves_);
+	for (size_type i=0; i<num_leaves_; ++i) {
+	    slots.push_back(i);
+	    node_of[i]=i;
+	}
+
+	while (slots.size()>1) {
+	    size_type m = slots.size();
+	    size_type best_a=0;
+	    size_type best_b=1;
+
+	    if (m>2) {
+		// row sums of the distances
+		std::vector<double> r(m,0.0);
+		for (size_type a=0; a<m; ++a) {
+		    for (size_type b=0; b<m; ++b) {
+			r[a] += dist(slots[a],slots[b]);
+		    }
+		}
+
+		// minimize the Q criterion; on ties (e.g. always for the
+		// last four clusters), prefer the closer pair, since the
+		// tree is rooted at the last join
+		double best_q=0;
+		first=true;
+		for (size_type a=0; a<m; ++a) {
+		    for (size_type b=a+1; b<m; ++b) {
+			double d = dist(slots[a],slots[b]);
+			double q = (m-2)*d - r[a] - r[b];
+			double eps = 1e-9*std::max(1.0,std::abs(best_q));
+			if (first
+			    || q < best_q-eps
+			    || (q <= best_q+eps && d < dist(slots[best_a],slots[best_b]))) {
+			    best_q=q;
+			    best_a=a;
+			    best_b=b;
+			    first=false;
+			}
+		    }
+		}
+	    }
+
+	    size_type si=slots[best_a];
+	    size_type sj=slots[best_b];
+
+	    for (size_type a=0; a<m; ++a) {
+		size_type sk=slots[a];
+		if (sk==si || sk==sj) continue;
+		double d = (dist(si,sk) + dist(sj,sk) - dist(si,sj)) / 2;
+		dist(si,sk) = d;
+		dist(sk,si) = d;
+	    }
+
+	    node_of[si] = join(node_of[si],node_of[sj]);
+	    slots.erase(slots.begin()+best_b);
+	}
+    }
+
+    void
+    GuideTree::write_newick(std::ostream &out,
+			    size_type node,
+			    const std::vector<std::string> &names) const {
+	if (is_leaf(node)) {
+	    out << names[node];
+	} else {
+	    out << "(";
+	    write_newick(out,left(node),names);
+	    out << ",";
+	    write_newick(out,right(node),names);
+	    out << ")";
+	}
+    }
+
+    std::ostream &
+    GuideTree::write_newick(std::ostream &out,
+			    const std::vector<std::string> &names) const {
+	write_newick(out,root(),names);
+	return out << ";";
+    }
+
+} // end namespace LocARNA
@@ -0,0 +1,129 @@
+#ifndef LOCARNA_GUIDE_TREE_HH
+#define LOCARNA_GUIDE_TREE_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <vector>
+#include <string>
+
+#include "aux.hh"
+#include "matrix.hh"
+
+namespace LocARNA {
+
+    /**
+     * @brief Binary guide tree for progressive multiple alignment
+     *
+     * The tree is constructed from a symmetric matrix of pairwise
+     * alignment scores (similarities) of n sequences. Nodes are
+     * numbered such that the leaves are 0..n-1 (in order of the
+     * sequences) and the inner nodes are n..2n-2 in the order of
+     * their construction; consequently, the children of a node
+     * always have smaller numbers than the node itself and the root
+     * is node 2n-2.
+     *
+     * Supported methods are UPGMA on the scores (like in mlocarna)
+     * and neighbor joining on the distances max_score-score, where
+     * max_score is the maximum pairwise score.
+     */
+    class GuideTree {
+    public:
+	//! type of score matrix
+	typedef Matrix<double> score_matrix_t;
+
+	//! @brief tree construction methods
+	struct Method {
+	    //! inner type
+	    enum type {
+		UPGMA, //!< UPGMA on the scores
+		NJ     //!< neighbor joining on derived distances
+	    };
+	};
+
+    private:
+	//! @brief node of the tree
+	struct node_t {
+	    size_type left;  //!< left child
+	    size_type right; //!< right child
+	    size_type size;  //!< number of leaves in the subtree
+	};
+
+	size_type num_leaves_; //!< number of leaves
+	std::vector<node_t> nodes_; //!< nodes of the tree
+
+	//! @brief add inner node and return its index
+	size_type
+	join(size_type left, size_type right);
+
+	//! @brief construct by UPGMA
+	void
+	upgma(score_matrix_t scores);
+
+	//! @brief construct by neighbor joining
+	void
+	neighbor_joining(const score_matrix_t &scores);
+
+	//! @brief write subtree in newick format
+	void
+	write_newick(std::ostream &out,
+		     size_type node,
+		     const std::vector<std::string> &names) const;
+
+    public:
+	/**
+	 * @brief Construct from pairwise scores
+	 * @param scores symmetric n x n matrix of pairwise scores;
+	 * the diagonal is ignored
+	 * @param method construction method
+	 * @pre n>=1
+	 */
+	GuideTree(const score_matrix_t &scores, Method::type method);
+
+	//! @brief number of leaves
+	size_type
+	num_leaves() const { return num_leaves_; }
+
+	//! @brief number of nodes
+	size_type
+	num_nodes() const { return nodes_.size(); }
+
+	//! @brief root node
+	size_type
+	root() const { return nodes_.size()-1; }
+
+	/**
+	 * @brief test for leaf
+	 * @param node node index
+	 * @return whether the node is a leaf, i.e. a sequence
+	 */
+	bool
+	is_leaf(size_type node) const { return node < num_leaves_; }
+
+	//! @brief left child of inner node
+	size_type
+	left(size_type node) const { return nodes_[node].left; }
+
+	//! @brief right child of inner node
+	size_type
+	right(size_type node) const { return nodes_[node].right; }
+
+	//! @brief number of leaves in subtree of node
+	size_type
+	size(size_type node) const { return nodes_[node].size; }
+
+	/**
+	 * @brief write tree in newick format
+	 * @param out output stream
+	 * @param names names of the leaves
+	 * @return stream
+	 */
+	std::ostream &
+	write_newick(std::ostream &out,
+		     const std::vector<std::string> &names) const;
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_GUIDE_TREE_HH
@@ -0,0 +1,203 @@
+#include "input_file.hh"
+
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#if defined(HAVE_LIBZ) && defined(HAVE_ZLIB_H)
+#  include <zlib.h>
+#endif
+
+#include "aux.hh"
+
+namespace LocARNA {
+
+    //! @brief check for gzip magic bytes
+    static
+    bool
+    is_gzip(const char *magic, std::streamsize n) {
+	return n>=2
+	    && (unsigned char)magic[0]==0x1f
+	    && (unsigned char)magic[1]==0x8b;
+    }
+
+#if defined(HAVE_LIBZ) && defined(HAVE_ZLIB_H)
+    /**
+     * @brief Stream buffer that decompresses gzip input
+     *
+     * Reads the compressed data in chunks from a source stream and
+     * inflates them into a fixed size buffer; concatenated gzip
+     * members are decompressed one after the other. The buffer can
+     * only be positioned to the beginning, which restarts the
+     * decompression (and requires a seekable source).
+     */
+    class InflateStreambuf : public std::streambuf {
+	std::istream &src_;          //!< source of the compressed data
+	z_stream zs_;                //!< decompression state
+	std::vector<char> in_buf_;   //!< compressed chunk
+	std::vector<char> out_buf_;  //!< decompressed chunk
+	bool in_member_;             //!< whether a gzip member is incomplete
+	bool end_;                   //!< whether the source is exhausted
+
+	//! @brief copy constructor (forbidden)
+	InflateStreambuf(const InflateStreambuf &);
+	//! @brief assignment operator (forbidden)
+	InflateStreambuf &operator =(const InflateStreambuf &);
+
+    public:
+	/**
+	 * @brief Construct
+	 * @param src source of the compressed data, positioned at its beginning
+	 */
+	explicit
+	InflateStreambuf(std::istream &src)
+	    : src_(src),
+	      in_buf_(65536),
+	      out_buf_(65536),
+	      in_member_(false),
+	      end_(false) {
+	    zs_.zalloc = Z_NULL;
+	    zs_.zfree = Z_NULL;
+	    zs_.opaque = Z_NULL;
+	    zs_.next_in = Z_NULL;
+	    zs_.avail_in = 0;
+
+	    // 16+MAX_WBITS: expect gzip header
+	    if (inflateInit2(&zs_, 16+MAX_WBITS) != Z_OK) {
+		throw failure("Cannot initialize decompression.");
+	    }
+	    setg(&out_buf_[0],&out_buf_[0],&out_buf_[0]);
+	}
+
+	~InflateStreambuf() {
+	    inflateEnd(&zs_);
+	}
+
+    protected:
+	//! @brief decompress the next chunk
+	int_type
+	underflow() {
+	    if (gptr()<egptr()) return traits_type::to_int_type(*gptr());
+
+	    size_t n=0;
+	    while (n==0 && !end_) {
+		if (zs_.avail_in==0) {
+		    src_.read(&in_buf_[0],in_buf_.size());
+		    zs_.next_in = (Bytef *)&in_buf_[0];
+		    zs_.avail_in = src_.gcount();
+		    if (zs_.avail_in==0) {
+			end_=true;
+			if (in_member_) {
+			    throw failure("Cannot decompress gzip input (truncated).");
+			}
+			break;
+		    }
+		}
+
+		zs_.next_out = (Bytef *)&out_buf_[0];
+		zs_.avail_out = out_buf_.size();
+		int ret = inflate(&zs_, Z_NO_FLUSH);
+		if (ret==Z_STREAM_END) {
+		    // a further member of a concatenated file may follow
+		    inflateReset(&zs_);
+		    in_member_=false;
+		} else if (ret==Z_OK) {
+		    in_member_=true;
+		} else {
+		    end_=true;
+		    throw failure("Cannot decompress gzip input.");
+		}
+		n = out_buf_.size()-zs_.avail_out;
+	    }
+
+	    setg(&out_buf_[0],&out_buf_[0],&out_buf_[0]+n);
+	    return n>0 ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+	}
+
+	//! @brief position to the beginning (only)
+	pos_type
+	seekpos(pos_type pos, std::ios_base::openmode which) {
+	    if (pos!=pos_type(0) || !(which & std::ios_base::in)) {
+		return pos_type(off_type(-1));
+	    }
+	    src_.clear();
+	    src_.seekg(0);
+	    inflateReset(&zs_);
+	    zs_.avail_in = 0;
+	    in_member_=false;
+	    end_=false;
+	    setg(&out_buf_[0],&out_buf_[0],&out_buf_[0]);
+	    return pos;
+	}
+
+	//! @brief position to the beginning (only)
+	pos_type
+	seekoff(off_type off, std::ios_base::seekdir dir,
+		std::ios_base::openmode which) {
+	    if (off!=0 || dir!=std::ios_base::beg) {
+		return pos_type(off_type(-1));
+	    }
+	    return seekpos(pos_type(0),which);
+	}
+    };
+#else
+    //! @brief gzip input is not supported without zlib
+    class InflateStreambuf : public std::streambuf {
+    public:
+	explicit
+	InflateStreambuf(std::istream &) {
+	    throw failure("Cannot read gzip compressed input (built without zlib).");
+	}
+    };
+#endif
+
+    InputFile::InputFile(const std::string &filename)
+	: file_(),
+	  buffer_(),
+	  inflate_buf_(0L),
+	  inflated_(0L),
+	  in_(0L) {
+
+	std::istream *raw;
+	if (filename=="-") {
+	    // standard input cannot be rewound; buffer it
+	    std::string data((std::istreambuf_iterator<char>(std::cin)),
+			     std::istreambuf_iterator<char>());
+	    buffer_.str(data);
+	    raw = &buffer_;
+	} else {
+	    file_.open(filename.c_str(), std::ios::in | std::ios::binary);
+	    if (!file_.is_open()) {
+		throw failure("Cannot open file "+filename+" for reading.");
+	    }
+	    raw = &file_;
+	}
+
+	char magic[2];
+	raw->read(magic,2);
+	bool gzip = is_gzip(magic,raw->gcount());
+	raw->clear();
+	raw->seekg(0);
+
+	if (gzip) {
+	    inflate_buf_ = new InflateStreambuf(*raw);
+	    inflated_.rdbuf(inflate_buf_);
+	    // pass decompression failures on to the reader
+	    inflated_.exceptions(std::ios::badbit);
+	    in_ = &inflated_;
+	} else {
+	    in_ = raw;
+	}
+    }
+
+    InputFile::~InputFile() {
+	delete inflate_buf_;
+    }
+
+    void
+    InputFile::rewind() {
+	in_->clear();
+	in_->seekg(0);
+    }
+
+} // end namespace LocARNA
@@ -0,0 +1,80 @@
+#ifndef LOCARNA_INPUT_FILE_HH
+#define LOCARNA_INPUT_FILE_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string>
+#include <fstream>
+#include <sstream>
+
+namespace LocARNA {
+
+    class InflateStreambuf;
+
+    /**
+     * @brief Input file that is opened once and can be rewound
+     *
+     * Provides a single input stream for a file name. The name "-"
+     * denotes standard input. Gzip compressed input (recognized by
+     * its magic bytes, not by the file name) is decompressed on the
+     * fly in chunks, such that compressed files and pipes are read
+     * without temporary files or a decompressed copy in memory.
+     * Only standard input is buffered in memory (as it is, i.e.
+     * compressed or not), since it cannot be rewound otherwise.
+     *
+     * Rewinding allows parsing the input after inspecting its first
+     * lines (e.g. for detecting the format) without opening it
+     * again. For compressed input, rewinding restarts the
+     * decompression.
+     */
+    class InputFile {
+	std::ifstream file_;        //!< input file
+	std::istringstream buffer_; //!< buffered standard input
+	InflateStreambuf *inflate_buf_; //!< decompressing buffer (or 0L)
+	std::istream inflated_;     //!< decompressed input (via inflate_buf_)
+	std::istream *in_;          //!< the input stream
+
+	//! @brief copy constructor (forbidden)
+	InputFile(const InputFile &);
+	//! @brief assignment operator (forbidden)
+	InputFile &operator =(const InputFile &);
+
+    public:
+	/**
+	 * @brief Open input
+	 *
+	 * @param filename name of the input file or "-" for standard input
+	 *
+	 * @note throws failure if the input cannot be opened; reading
+	 * from the stream throws failure if compressed input cannot be
+	 * decompressed
+	 */
+	explicit
+	InputFile(const std::string &filename);
+
+	/**
+	 * @brief Destructor
+	 */
+	~InputFile();
+
+	/**
+	 * @brief Input stream
+	 * @return stream
+	 */
+	std::istream &
+	stream() {
+	    return *in_;
+	}
+
+	/**
+	 * @brief Rewind to the beginning of the input
+	 */
+	void
+	rewind();
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_INPUT_FILE_HH
@@ -433,6 +433,187 @@ namespace LocARNA {
 	
     };
 
+    // ----------------------------------------
+    //! @brief Matrix class with rows that are allocated on demand
+    //! and can be released
+    //!
+    //! Rows are allocated (and set to the fill value) on the first
+    //! write access; before that, read access yields the fill
+    //! value. Once a row is not needed anymore, it can be released
+    //! to free its memory. Accessing a released row is an error.
+    //!
+    //! @note Used for the matrices of the sparse aligners, which are
+    //! indexed by arcs. In score only mode, the aligners release the
+    //! rows of arcs that will not be read again, such that only the
+    //! rows of 'active' arcs are kept in memory.
+    //!
+    template <class elem_t>
+    class RowMatrix {
+    public:
+	typedef typename std::vector<elem_t>::size_type size_type; //!< size type
+	typedef std::pair<size_type,size_type> size_pair_type; //!< type for pair of sizes
+
+    protected:
+	std::vector< std::vector<elem_t> > rows_; //!< rows of the matrix
+	std::vector<bool> released_; //!< whether the row was released
+	size_type xdim_; //!< first dimension
+	size_type ydim_; //!< second dimension
+	elem_t fill_; //!< value of entries in not yet allocated rows
+
+	/**
+	 * Get row for write access, allocate it if necessary
+	 *
+	 * @param i row index
+	 *
+	 * @return row i
+	 */
+	std::vector<elem_t> &
+	row(size_type i) {
+	    assert(i<xdim_);
+	    assert(!released_[i]);
+	    if (rows_[i].empty()) {
+		rows_[i].assign(ydim_,fill_);
+	    }
+	    return rows_[i];
+	}
+
+    public:
+	/**
+	 * Empty constructor
+	 */
+	RowMatrix()
+	    : rows_(),released_(),xdim_(0),ydim_(0),fill_() {
+	}
+
+	/**
+	 * Construct with dimensions
+	 *
+	 * @param xdim first dimension of matrix
+	 * @param ydim second dimension of matrix
+	 */
+	RowMatrix(size_type xdim, size_type ydim)
+	    : rows_(xdim),released_(xdim,false),xdim_(xdim),ydim_(ydim),fill_() {
+	}
+
+	/**
+	 * Access size
+	 *
+	 * @return size of matrix as pair of dimensions
+	 */
+	size_pair_type
+	sizes() const {
+	    return size_pair_type(xdim_,ydim_);
+	}
+
+	/**
+	 * Resize both dimensions
+	 *
+	 * @param xdim first dimension
+	 * @param ydim second dimension
+	 *
+	 * @post all rows are unallocated
+	 */
+	void
+	resize(size_type xdim, size_type ydim) {
+	    rows_.clear();
+	    rows_.resize(xdim);
+	    released_.assign(xdim,false);
+	    xdim_=xdim;
+	    ydim_=ydim;
+	}
+
+	/**
+	 * Read access to matrix element
+	 *
+	 * @param i
+	 * @param j
+	 *
+	 * @return entry (i,j)
+	 */
+	const elem_t &
+	operator() (size_type i,size_type j) const {
+	    assert(i<xdim_);
+	    assert(j<ydim_);
+	    assert(!released_[i]);
+	    return rows_[i].empty() ? fill_ : rows_[i][j];
+	}
+
+	/**
+	 * Read/write access to matrix element
+	 *
+	 * @param i
+	 * @param j
+	 *
+	 * @return reference to entry (i,j)
+	 * @note allocates row i, if necessary
+	 */
+	elem_t &
+	operator() (size_type i,size_type j) {
+	    assert(j<ydim_);
+	    return row(i)[j];
+	}
+
+	/**
+	 * @brief Fill the whole matrix with the given value
+	 *
+	 * @param val value assigned to each entry
+	 * @post all matrix entries are set to val; later allocated
+	 * rows are initialized with val
+	 */
+	void
+	fill(const elem_t &val) {
+	    fill_=val;
+	    for (size_type i=0; i<xdim_; ++i) {
+		std::fill(rows_[i].begin(),rows_[i].end(),val);
+	    }
+	}
+
+	/**
+	 * @brief Release row
+	 *
+	 * @param i row index
+	 *
+	 * @post the memory of row i is freed; the row must not be
+	 * accessed anymore
+	 */
+	void
+	release_row(size_type i) {
+	    assert(i<xdim_);
+	    std::vector<elem_t>().swap(rows_[i]);
+	    released_[i]=true;
+	}
+
+	/**
+	 * Clear the matrix
+	 * @post the matrix is resized to dimensions (0,0)
+	 */
+	void
+	clear() {
+	    resize(0,0);
+	}
+    };
+
+    /**
+     * Output operator for writing row matrix to output stream
+     *
+     * @param out the output stream
+     * @param mat the matrix to be written
+     *
+     * @return output stream after writing matrix mat
+     */
+    template <class T>
+    std::ostream & operator << (std::ostream &out, const RowMatrix<T> &mat) {
+	typename RowMatrix<T>::size_pair_type sizes = mat.sizes();
+
+	for (typename RowMatrix<T>::size_type i=0; i<sizes.first; i++) {
+	    for (typename RowMatrix<T>::size_type j=0; j<sizes.second; j++) {
+		out << mat(i,j) << " ";
+	    }
+	    out << std::endl;
+	}
+	return out;
+    }
+
 } // end namespace LocARNA
 
 #endif // LOCARNA_MATRICES_HH
@@ -11,12 +11,121 @@
 
 #include <iostream>
 #include <vector>
+#include <cstddef>
 #include <assert.h>
 
 #include <algorithm>
 
+#include "matrix_fwd.hh"
+
 namespace LocARNA {
 
+    /*
+      Layouts of the matrix entries in the 1D storage of class
+      Matrix.  A layout is initialized with the matrix dimensions
+      and the element size, returns the required storage size, and
+      maps matrix indices to storage indices.
+    */
+
+    //! @brief Row major layout of matrix entries (default)
+    class RowMajorLayout {
+	std::size_t ydim_; //!< second dimension
+    public:
+	//! @brief construct for 0x0-matrix
+	RowMajorLayout(): ydim_(0) {}
+
+	/**
+	 * @brief Initialize for dimensions
+	 * @param xdim first dimension
+	 * @param ydim second dimension
+	 * @param elem_size size of matrix elements in bytes
+	 * @return required storage size (in elements)
+	 */
+	std::size_t
+	init(std::size_t xdim, std::size_t ydim, std::size_t elem_size) {
+	    (void)elem_size;
+	    ydim_=ydim;
+	    return xdim*ydim;
+	}
+
+	//! @brief storage index of entry (i,j)
+	std::size_t
+	operator () (std::size_t i, std::size_t j) const {
+	    return i*ydim_+j;
+	}
+    };
+
+    /**
+     * @brief Row major layout with aligned rows
+     *
+     * Each row is padded to a multiple of Alignment bytes, such
+     * that all rows start at the same cache line offset as row
+     * 0. In combination with aligned storage (AlignedArray), rows
+     * start at cache line boundaries.
+     *
+     * @tparam Alignment row alignment in bytes
+     */
+    template <std::size_t Alignment=64>
+    class AlignedRowLayout {
+	std::size_t stride_; //!< distance of rows in the storage
+    public:
+	//! @brief construct for 0x0-matrix
+	AlignedRowLayout(): stride_(0) {}
+
+	//! @brief initialize for dimensions
+	//! @see RowMajorLayout::init()
+	std::size_t
+	init(std::size_t xdim, std::size_t ydim, std::size_t elem_size) {
+	    stride_=ydim;
+	    if (elem_size<=Alignment && Alignment%elem_size==0) {
+		std::size_t per_line = Alignment/elem_size;
+		stride_ = (ydim+per_line-1)/per_line*per_line;
+	    }
+	    return xdim*stride_;
+	}
+
+	//! @brief storage index of entry (i,j)
+	std::size_t
+	operator () (std::size_t i, std::size_t j) const {
+	    return i*stride_+j;
+	}
+    };
+
+    /**
+     * @brief Blocked (tiled) layout
+     *
+     * Stores the matrix in row major order of BlockSize x
+     * BlockSize blocks, each of which is stored in row major
+     * order. Entries that are close in both dimensions are close
+     * in memory, which benefits traversals that are not row-wise
+     * (e.g. along anti-diagonals or columns).
+     *
+     * @tparam BlockSize side length of blocks
+     */
+    template <std::size_t BlockSize=8>
+    class BlockedLayout {
+	std::size_t blocks_per_row_; //!< number of blocks in one block row
+    public:
+	//! @brief construct for 0x0-matrix
+	BlockedLayout(): blocks_per_row_(0) {}
+
+	//! @brief initialize for dimensions
+	//! @see RowMajorLayout::init()
+	std::size_t
+	init(std::size_t xdim, std::size_t ydim, std::size_t elem_size) {
+	    (void)elem_size;
+	    blocks_per_row_ = (ydim+BlockSize-1)/BlockSize;
+	    return (xdim+BlockSize-1)/BlockSize * blocks_per_row_ * BlockSize*BlockSize;
+	}
+
+	//! @brief storage index of entry (i,j)
+	std::size_t
+	operator () (std::size_t i, std::size_t j) const {
+	    return ((i/BlockSize)*blocks_per_row_ + j/BlockSize) * BlockSize*BlockSize
+		+ (i%BlockSize)*BlockSize + j%BlockSize;
+	}
+    };
+
     /*
       Define classes for the dynamic programming
       matrices.
@@ -26,19 +135,28 @@ namespace LocARNA {
       in the overlapping sub-matrix
     */
 
-    //! simple 2D matrix class, provides access via operator (int,int) 
-    template <class T>
+    /**
+     * @brief simple 2D matrix class, provides access via operator (int,int)
+     *
+     * @tparam T type of elements
+     * @tparam Storage vector-like container of the entries,
+     * e.g. AlignedArray for aligned and huge page backed storage
+     * @tparam Layout layout of the entries in the storage,
+     * e.g. AlignedRowLayout or BlockedLayout
+     */
+    template <class T, class Storage, class Layout>
     class Matrix {
     public:
 	typedef T elem_t; //!< type of elements
-	typedef typename std::vector<elem_t>::size_type size_type; //!< size type (from underlying vector)
+	typedef typename Storage::size_type size_type; //!< size type (from underlying vector)
 	
 	typedef std::pair<size_type,size_type> size_pair_type; //!< type for pair of sizes
     
     protected:
-	std::vector<elem_t> mat_; //!< vector storing the matrix entries
+	Storage mat_; //!< vector storing the matrix entries
 	size_type xdim_; //!< first dimension
 	size_type ydim_; //!< second dimension
+	Layout layout_; //!< layout of the entries in mat_
     
 	/** 
 	 * Computes address/index in 1D vector from 2D matrix indices
@@ -52,7 +170,7 @@ namespace LocARNA {
 	size_type addr(size_type i, size_type j) const {
 	    assert(0<=i && i<this->xdim_);
 	    assert(0<=j && j<this->ydim_);
-	    return i*ydim_+j;
+	    return layout_(i,j);
 	}
 
     public:
@@ -61,7 +179,7 @@ namespace LocARNA {
 	 * 
 	 */
 	Matrix() 
-	    : mat_(),xdim_(0),ydim_(0) {
+	    : mat_(),xdim_(0),ydim_(0),layout_() {
 	}
     
 	/** 
@@ -75,7 +193,8 @@ namespace LocARNA {
 	 *
 	 */
 	Matrix(size_type xdim, size_type ydim, const elem_t *from=0L)
-	    : mat_(xdim*ydim),xdim_(xdim),ydim_(ydim) {
+	    : mat_(),xdim_(xdim),ydim_(ydim),layout_() {
+	    mat_.resize(layout_.init(xdim_,ydim_,sizeof(elem_t)));
 	    if (from!=0L) {
 		for (size_type i=0; i<xdim_; i++) {
 		    for (size_type j=0; j<ydim_; j++) {
@@ -105,7 +224,25 @@ namespace LocARNA {
 	    xdim_=xdim;
 	    ydim_=ydim;
 	
-	    mat_.resize(xdim_*ydim_);
+	    mat_.resize(layout_.init(xdim_,ydim_,sizeof(elem_t)));
+	}
+
+	/** 
+	 * Resize both dimensions and set all entries
+	 *
+	 * @param xdim first dimension
+	 * @param ydim second dimension
+	 * @param val value assigned to each entry
+	 *
+	 * @note equivalent to resize() followed by fill(), but
+	 * writes each entry only once
+	 */
+	void
+	assign(size_type xdim, size_type ydim, const elem_t &val) {
+	    xdim_=xdim;
+	    ydim_=ydim;
+	
+	    mat_.assign(layout_.init(xdim_,ydim_,sizeof(elem_t)),val);
 	}
     
 	/** 
@@ -165,8 +302,7 @@ namespace LocARNA {
 	 */
 	void 
 	fill(const elem_t &val) {
-	    for (size_type i=0; i<xdim_*ydim_; ++i)
-		mat_[i]=val;
+	    std::fill(mat_.begin(),mat_.end(),val);
 	}
 
 	/** 
@@ -202,12 +338,12 @@ namespace LocARNA {
      * 
      * @return output stream after writing matrix mat
      */
-    template <class T>
-    std::ostream & operator << (std::ostream &out, Matrix<T> mat) {
-	typename Matrix<T>::size_pair_type sizes = mat.sizes();
+    template <class T, class S, class L>
+    std::ostream & operator << (std::ostream &out, const Matrix<T,S,L> &mat) {
+	typename Matrix<T,S,L>::size_pair_type sizes = mat.sizes();
     
-	for (typename Matrix<T>::size_type i=0; i<sizes.first; i++) {
-	    for (typename Matrix<T>::size_type j=0; j<sizes.second; j++) {
+	for (typename Matrix<T,S,L>::size_type i=0; i<sizes.first; i++) {
+	    for (typename Matrix<T,S,L>::size_type j=0; j<sizes.second; j++) {
 		out << mat(i,j) << " ";
 	    }
 	    out << std::endl;
@@ -223,11 +359,11 @@ namespace LocARNA {
      * 
      * @return input stream after reading matrix mat
      */
-    template <class T>
-    std::istream & operator >> (std::istream &in, Matrix<T> &mat) {
-	typename Matrix<T>::size_pair_type sizes = mat.sizes();
-	for (typename Matrix<T>::size_type i=0; i<=mat.sizes().first; i++) {
-	    for (typename Matrix<T>::size_type j=0; j<=mat.sizes().second; j++) {
+    template <class T, class S, class L>
+    std::istream & operator >> (std::istream &in, Matrix<T,S,L> &mat) {
+	typename Matrix<T,S,L>::size_pair_type sizes = mat.sizes();
+	for (typename Matrix<T,S,L>::size_type i=0; i<=mat.sizes().first; i++) {
+	    for (typename Matrix<T,S,L>::size_type j=0; j<=mat.sizes().second; j++) {
 		in >> mat(i,j);
 	    }
 	}
@@ -0,0 +1,22 @@
+#ifndef LOCARNA_MATRIX_FWD_HH
+#define LOCARNA_MATRIX_FWD_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <vector>
+
+namespace LocARNA {
+
+    class RowMajorLayout;
+
+    //! simple 2D matrix class, see matrix.hh
+    template <class T,
+	      class Storage = std::vector<T>,
+	      class Layout = RowMajorLayout>
+    class Matrix;
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_MATRIX_FWD_HH
@@ -0,0 +1,94 @@
+#include "memory_arena.hh"
+
+#include <cstdlib>
+#include <algorithm>
+
+namespace LocARNA {
+
+    const std::size_t MemoryArena::alignment;
+    const std::size_t MemoryArena::header_size;
+    const std::size_t MemoryArena::max_chunk_size;
+
+    //! current arena of the thread
+    static MemoryArena *current_arena = 0L;
+#ifdef _OPENMP
+#pragma omp threadprivate(current_arena)
+#endif
+
+    MemoryArena::MemoryArena(std::size_t chunk_size)
+	: chunks_(0L),
+	  pos_(0L),
+	  end_(0L),
+	  chunk_size_(std::max(chunk_size,alignment)),
+	  allocated_bytes_(0),
+	  reserved_bytes_(0) {
+    }
+
+    MemoryArena::~MemoryArena() {
+	release();
+    }
+
+    char *
+    MemoryArena::new_chunk(std::size_t size) {
+	// large requests get a chunk of their own; they do not
+	// replace the current chunk
+	bool own_chunk = size > chunk_size_/2;
+	std::size_t chunk_size = own_chunk ? size : chunk_size_;
+
+	chunk_header *chunk =
+	    static_cast<chunk_header *>(std::malloc(header_size+chunk_size));
+	if (chunk==0L) {
+	    throw std::bad_alloc();
+	}
+	reserved_bytes_ += header_size+chunk_size;
+
+	char *mem = reinterpret_cast<char *>(chunk)+header_size;
+
+	if (own_chunk && chunks_!=0L) {
+	    // insert behind the current chunk
+	    chunk->next = chunks_->next;
+	    chunks_->next = chunk;
+	    return mem;
+	}
+
+	chunk->next = chunks_;
+	chunks_ = chunk;
+	pos_ = mem+size;
+	end_ = mem+chunk_size;
+	chunk_size_ = std::min(2*chunk_size_,max_chunk_size);
+	return mem;
+    }
+
+    void
+    MemoryArena::release() {
+	while (chunks_!=0L) {
+	    chunk_header *next = chunks_->next;
+	    std::free(chunks_);
+	    chunks_ = next;
+	}
+	pos_ = 0L;
+	end_ = 0L;
+	allocated_bytes_ = 0;
+	reserved_bytes_ = 0;
+    }
+
+    MemoryArena *
+    MemoryArena::current() {
+	return current_arena;
+    }
+
+    ArenaScope::ArenaScope(MemoryArena &arena)
+	: previous_(current_arena) {
+	current_arena = &arena;
+    }
+
+    ArenaScope::ArenaScope(MemoryArena *arena)
+	: previous_(current_arena) {
+	current_arena = arena;
+    }
+
+    ArenaScope::~ArenaScope() {
+	current_arena = previous_;
+    }
+
+} // end namespace LocARNA
@@ -0,0 +1,363 @@
+#ifndef LOCARNA_MEMORY_ARENA_HH
+#define LOCARNA_MEMORY_ARENA_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#if __cplusplus >= 201103L
+#  include <type_traits>
+#endif
+
+namespace LocARNA {
+
+    /**
+     * @brief Memory arena (bump allocator)
+     *
+     * Hands out memory from large chunks by advancing a pointer;
+     * single deallocations are no-ops. All memory is released at
+     * once by release() or the destructor. This avoids the
+     * overhead and the lock contention of many small heap
+     * allocations and frees the transient data of a job without
+     * fragmenting the heap.
+     *
+     * Containers use an arena via ArenaAllocator; typically, an
+     * arena is made the current arena of a thread by ArenaScope
+     * for the duration of one job (e.g. one pairwise alignment).
+     *
+     * @note An arena is not thread-safe; it must be used by one
+     * thread at a time. All objects that use an arena must be
+     * destroyed before it is released.
+     */
+    class MemoryArena {
+    public:
+	//! alignment of all allocated memory
+	static const std::size_t alignment = 16;
+
+    private:
+	//! header of a chunk; the chunk memory follows the header
+	struct chunk_header {
+	    chunk_header *next; //!< previously allocated chunk
+	};
+
+	//! size of the chunk header, rounded up to the alignment
+	static const std::size_t header_size =
+	    (sizeof(chunk_header)+alignment-1)/alignment*alignment;
+
+	//! maximal size of regular chunks
+	static const std::size_t max_chunk_size = 16*1024*1024;
+
+	chunk_header *chunks_; //!< list of chunks, last allocated first
+	char *pos_; //!< next free byte in current chunk
+	char *end_; //!< end of current chunk
+	std::size_t chunk_size_; //!< size of the next regular chunk
+	std::size_t allocated_bytes_; //!< total size of allocations
+	std::size_t reserved_bytes_; //!< total size of chunks
+
+	//! @brief copy constructor (forbidden)
+	MemoryArena(const MemoryArena &);
+	//! @brief assignment operator (forbidden)
+	MemoryArena &operator =(const MemoryArena &);
+
+	/**
+	 * @brief Allocate new chunk
+	 * @param size minimal size of the chunk memory
+	 * @return chunk memory
+	 */
+	char *
+	new_chunk(std::size_t size);
+
+    public:
+	/**
+	 * @brief Construct empty arena
+	 * @param chunk_size size of the first chunk; the sizes
+	 * of further chunks grow geometrically
+	 */
+	explicit
+	MemoryArena(std::size_t chunk_size=64*1024);
+
+	/**
+	 * @brief Destructor, releases all memory
+	 */
+	~MemoryArena();
+
+	/**
+	 * @brief Allocate memory
+	 * @param bytes size in bytes
+	 * @return aligned memory
+	 * @note throws std::bad_alloc if out of memory
+	 */
+	void *
+	allocate(std::size_t bytes) {
+	    bytes = (bytes+alignment-1)/alignment*alignment;
+	    allocated_bytes_ += bytes;
+	    if ((std::size_t)(end_-pos_) < bytes) {
+		return new_chunk(bytes);
+	    }
+	    void *p = pos_;
+	    pos_ += bytes;
+	    return p;
+	}
+
+	/**
+	 * @brief Release all memory
+	 * @post the arena is empty and can be reused
+	 */
+	void
+	release();
+
+	/**
+	 * @brief Total size of allocations since last release
+	 * @return size in bytes
+	 */
+	std::size_t
+	allocated_bytes() const {
+	    return allocated_bytes_;
+	}
+
+	/**
+	 * @brief Total size of the chunks held by the arena
+	 * @return size in bytes
+	 */
+	std::size_t
+	reserved_bytes() const {
+	    return reserved_bytes_;
+	}
+
+	/**
+	 * @brief Current arena of the calling thread
+	 * @return arena or 0L if no arena is current
+	 * @see ArenaScope
+	 */
+	static
+	MemoryArena *
+	current();
+
+	friend class ArenaScope;
+    };
+
+    /**
+     * @brief Make an arena the current arena of the calling thread
+     *
+     * While the scope object exists, default constructed
+     * ArenaAllocators (and thus the containers that use them) of
+     * the thread allocate from the arena. Scopes can be nested;
+     * the destructor reinstates the previous arena.
+     */
+    class ArenaScope {
+	MemoryArena *previous_; //!< previously current arena
+
+	//! @brief copy constructor (forbidden)
+	ArenaScope(const ArenaScope &);
+	//! @brief assignment operator (forbidden)
+	ArenaScope &operator =(const ArenaScope &);
+    public:
+	/**
+	 * @brief Construct, making arena current
+	 * @param arena memory arena
+	 */
+	explicit
+	ArenaScope(MemoryArena &arena);
+
+	/**
+	 * @brief Construct, making arena or the heap current
+	 * @param arena memory arena or 0L for the heap
+	 */
+	explicit
+	ArenaScope(MemoryArena *arena);
+
+	/**
+	 * @brief Destruct, reinstating the previous arena
+	 */
+	~ArenaScope();
+    };
+
+    /**
+     * @brief Allocator that allocates from a memory arena
+     *
+     * The allocator binds to the current arena of the thread
+     * (MemoryArena::current()) at its construction; without
+     * current arena, it uses the heap. Containers keep the
+     * allocator of their construction, such that objects that
+     * are constructed outside of an arena scope behave like
+     * objects with std::allocator.
+     *
+     * Copies of the allocator bind to the current arena as well
+     * (C++98 containers do not support
+     * select_on_container_copy_construction). Consequently, a copy
+     * of a container, which is made outside of an arena scope,
+     * lives on the heap, even if the original lives in an arena
+     * that is released before the copy. Elements are constructed
+     * with the arena of their container being current, such that
+     * nested containers live in the same arena (or on the heap)
+     * as their container.
+     *
+     * Moves keep the arena (in C++11 and later): a moved container
+     * keeps its memory, which the allocator of the original must
+     * deallocate. For the same reason, containers exchange their
+     * allocators on swap and move assignment.
+     *
+     * @note get_allocator() of a container returns a copy, thus it
+     * reports the current arena, not the arena of the container.
+     *
+     * @tparam T type of allocated objects
+     */
+    template <class T>
+    class ArenaAllocator {
+	MemoryArena *arena_; //!< arena or 0L for heap
+
+    public:
+	typedef T value_type; //!< type of allocated objects
+	typedef T *pointer; //!< pointer type
+	typedef const T *const_pointer; //!< const pointer type
+	typedef T &reference; //!< reference type
+	typedef const T &const_reference; //!< const reference type
+	typedef std::size_t size_type; //!< size type
+	typedef std::ptrdiff_t difference_type; //!< difference type
+
+	//! @brief allocator for another type
+	template <class U>
+	struct rebind {
+	    typedef ArenaAllocator<U> other; //!< rebound allocator type
+	};
+
+	//! @brief construct for the current arena of the thread
+	ArenaAllocator()
+	    : arena_(MemoryArena::current()) {
+	}
+
+	/**
+	 * @brief construct for arena
+	 * @param arena memory arena or 0L for heap
+	 */
+	explicit
+	ArenaAllocator(MemoryArena *arena)
+	    : arena_(arena) {
+	}
+
+	/**
+	 * @brief copy constructor, binds to the current arena of the thread
+	 *
+	 * This makes copies of containers independent of the arena
+	 * of the original.
+	 */
+	ArenaAllocator(const ArenaAllocator &)
+	    : arena_(MemoryArena::current()) {
+	}
+
+#if __cplusplus >= 201103L
+	//! @brief move constructor, keeps the arena of a
+	ArenaAllocator(ArenaAllocator &&a)
+	    : arena_(a.arena_) {
+	}
+
+	//! containers exchange allocators along with their memory
+	typedef std::true_type propagate_on_container_swap;
+	//! containers take the allocator along with the memory
+	typedef std::true_type propagate_on_container_move_assignment;
+#endif
+
+	//! @brief assignment, takes the arena of a
+	ArenaAllocator &
+	operator =(const ArenaAllocator &a) {
+	    arena_ = a.arena_;
+	    return *this;
+	}
+
+	//! @brief construct from allocator for another type
+	template <class U>
+	ArenaAllocator(const ArenaAllocator<U> &a)
+	    : arena_(a.arena()) {
+	}
+
+	//! @brief memory arena or 0L for heap
+	MemoryArena *
+	arena() const {
+	    return arena_;
+	}
+
+	//! @brief address of object
+	pointer address(reference x) const { return &x; }
+	//! @brief address of object
+	const_pointer address(const_reference x) const { return &x; }
+
+	//! @brief allocate memory for n objects
+	pointer
+	allocate(size_type n, const void * =0L) {
+	    if (arena_) {
+		return static_cast<pointer>(arena_->allocate(n*sizeof(T)));
+	    }
+	    return static_cast<pointer>(::operator new(n*sizeof(T)));
+	}
+
+	//! @brief deallocate memory (no-op for arena memory)
+	void
+	deallocate(pointer p, size_type) {
+	    if (!arena_) {
+		::operator delete(p);
+	    }
+	}
+
+	//! @brief maximal number of objects
+	size_type
+	max_size() const {
+	    return size_type(-1)/sizeof(T);
+	}
+
+	//! @brief construct object; with the arena of the container
+	//! being current, such that copies of nested containers use it
+	void
+	construct(pointer p, const T &x) {
+	    ArenaScope scope(arena_);
+	    new((void *)p) T(x);
+	}
+
+	//! @brief destroy object
+	void
+	destroy(pointer p) {
+	    p->~T();
+	}
+    };
+
+    //! @brief allocators are equal if they use the same arena
+    template <class T, class U>
+    bool
+    operator ==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+	return a.arena()==b.arena();
+    }
+
+    //! @brief allocators are equal if they use the same arena
+    template <class T, class U>
+    bool
+    operator !=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+	return a.arena()!=b.arena();
+    }
+
+    /**
+     * @brief Swap allocators
+     *
+     * Containers swap their allocators along with their memory;
+     * unlike std::swap, this does not copy construct allocators
+     * (which would rebind them to the current arena).
+     */
+    template <class T>
+    void
+    swap(ArenaAllocator<T> &a, ArenaAllocator<T> &b) {
+	MemoryArena *arena = a.arena();
+	a = b;
+	b = ArenaAllocator<T>(arena);
+    }
+
+    //! @brief vector that allocates from the current arena
+    template <class T>
+    struct arena_vector {
+	//! vector type
+	typedef std::vector<T, ArenaAllocator<T> > type;
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_MEMORY_ARENA_HH
@@ -0,0 +1,280 @@
+#include "memory_planner.hh"
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <cctype>
+#include <limits>
+
+#include "aux.hh"
+#include "scoring_fwd.hh"
+#include "arc_matches.hh"
+#include "sparsification_mapper.hh"
+
+namespace LocARNA {
+
+    const MemoryPlanner::size_type
+    MemoryPlanner::unlimited = std::numeric_limits<size_type>::max();
+
+    // the estimates are upper bounds for the matrices, but miss
+    // allocator overhead and small objects
+    const double MemoryPlanner::margin_ = 0.125;
+
+    MemoryPlanner::MemoryPlanner(Aligner::type aligner,
+				 size_type budget,
+				 const ExtRnaData *rna_dataA,
+				 const ExtRnaData *rna_dataB,
+				 double prob_unpaired_in_loop_threshold,
+				 double prob_basepair_in_loop_threshold)
+	: aligner_(aligner),
+	  budget_(budget),
+	  baseline_((size_type)current_memory_kb()*1024),
+	  rna_dataA_(rna_dataA),
+	  rna_dataB_(rna_dataB),
+	  prob_unpaired_in_loop_threshold_(prob_unpaired_in_loop_threshold),
+	  prob_basepair_in_loop_threshold_(prob_basepair_in_loop_threshold),
+	  steps_(),
+	  mapperA_(0L),
+	  mapperB_(0L) {
+    }
+
+    MemoryPlanner::~MemoryPlanner() {
+	delete mapperA_;
+	delete mapperB_;
+    }
+
+    SparsificationMapper *
+    MemoryPlanner::new_mapper(const BasePairs &bps,
+			      const ExtRnaData &rna_data) const {
+	// AlignerN indexes by common left ends, AlignerNN by arcs
+	return new SparsificationMapper(bps, rna_data,
+					prob_unpaired_in_loop_threshold_,
+					prob_basepair_in_loop_threshold_,
+					aligner_==Aligner::N);
+    }
+
+    MemoryPlanner::size_type
+    MemoryPlanner::estimate(Aligner::type aligner,
+			    size_type lenA,
+			    size_type lenB,
+			    size_type bpsA,
+			    size_type bpsB,
+			    size_type infoA,
+			    size_type infoB,
+			    size_type arc_matches) {
+	// sequence position pairs
+	size_type pos_pairs = (lenA+1)*(lenB+1);
+
+	// arc matches: arc match objects, scores, index lists by
+	// common left and right ends, inner arc matches; the lists
+	// for all position pairs
+	size_type mem = arc_matches * (sizeof(ArcMatch)+sizeof(score_t)
+				       +3*sizeof(ArcMatch::idx_type))
+	    + 2*pos_pairs*sizeof(ArcMatchIdxVec);
+
+	// scoring: base match scores
+	mem += pos_pairs*sizeof(score_t);
+
+	// sparsification mappers: per index, the info vector and the
+	// matrix positions for all sequence positions
+	size_type mapA = (infoA+1)*sizeof(SparsificationMapper::info_for_pos)
+	    + (lenA+2)*sizeof(SparsificationMapper::matidx_t);
+	size_type mapB = (infoB+1)*sizeof(SparsificationMapper::info_for_pos)
+	    + (lenB+2)*sizeof(SparsificationMapper::matidx_t);
+
+	switch(aligner) {
+	case Aligner::N:
+	    // D, IAD, IBD; IA, IB; M, E, F
+	    mem += sizeof(infty_score_t)
+		* ( 3*bpsA*bpsB
+		    + (infoA+1)*bpsB + bpsA*(infoB+1)
+		    + 3*(infoA+1)*(infoB+1) );
+	    // mappers indexed by left ends and by arcs
+	    mem += (lenA+1+bpsA+1)*mapA + (lenB+1+bpsB+1)*mapB;
+	    break;
+	case Aligner::NN:
+	    // like N, with additional entries for empty arcs
+	    mem += sizeof(infty_score_t)
+		* ( 3*(bpsA+1)*(bpsB+1)
+		    + (infoA+1)*(bpsB+1) + (bpsA+1)*(infoB+1)
+		    + 3*(infoA+1)*(infoB+1) );
+	    // mappers indexed by arcs
+	    mem += (bpsA+1)*mapA + (bpsB+1)*mapB;
+	    break;
+	case Aligner::P:
+	    // D, D'; M, M', Mrev, Erev, Frev; Boltzmann weights of
+	    // base matches; sparse arc match probabilities
+	    mem += sizeof(pf_score_t) * ( 2*bpsA*bpsB + 6*pos_pairs )
+		+ arc_matches * 2*(sizeof(double)+sizeof(std::pair<size_type,size_type>));
+	    break;
+	}
+
+	return mem;
+    }
+
+    bool
+    MemoryPlanner::add_step(const ArcMatches &arc_matches, double min_prob) {
+	const BasePairs &bpsA = arc_matches.get_base_pairsA();
+	const BasePairs &bpsB = arc_matches.get_base_pairsB();
+
+	size_type infoA=0;
+	size_type infoB=0;
+	if (aligner_!=Aligner::P && rna_dataA_ && rna_dataB_) {
+	    // keep the mappers for the aligner, if this is the last step
+	    delete mapperA_;
+	    delete mapperB_;
+	    mapperA_ = 0L;
+	    mapperB_ = 0L;
+	    mapperA_ = new_mapper(bpsA, *rna_dataA_);
+	    mapperB_ = new_mapper(bpsB, *rna_dataB_);
+	    infoA = mapperA_->get_max_info_vec_size();
+	    infoB = mapperB_->get_max_info_vec_size();
+	} else {
+	    // without sparsification, info vectors cover the sequences
+	    infoA = bpsA.seqlen()+1;
+	    infoB = bpsB.seqlen()+1;
+	}
+
+	step_t step;
+	step.min_prob = min_prob;
+	step.bpsA = bpsA.num_bps();
+	step.bpsB = bpsB.num_bps();
+	step.arc_matches = arc_matches.num_arc_matches();
+	size_type mem = estimate(aligner_,
+				 bpsA.seqlen(),
+				 bpsB.seqlen(),
+				 step.bpsA,
+				 step.bpsB,
+				 infoA,
+				 infoB,
+				 step.arc_matches);
+	step.estimate = baseline_ + (size_type)(mem*(1+margin_));
+	steps_.push_back(step);
+
+	return step.estimate <= budget_;
+    }
+
+    ArcMatches *
+    MemoryPlanner::fit_arc_matches(const RnaData &rna_dataA,
+				   const RnaData &rna_dataB,
+				   double &min_prob,
+				   size_type max_length_diff,
+				   size_type max_diff_at_am,
+				   const MatchController &trace_controller,
+				   const AnchorConstraints &constraints) {
+	ArcMatches *arc_matches=0L;
+	do {
+	    if (arc_matches) {
+		delete arc_matches;
+		min_prob = tighter_cutoff(min_prob);
+	    }
+	    arc_matches = new ArcMatches(rna_dataA,
+					 rna_dataB,
+					 min_prob,
+					 max_length_diff,
+					 max_diff_at_am,
+					 trace_controller,
+					 constraints);
+	} while (has_budget()
+		 && !add_step(*arc_matches,min_prob)
+		 && min_prob<1);
+
+	return arc_matches;
+    }
+
+    bool
+    MemoryPlanner::fits() const {
+	return !has_budget()
+	    || (!steps_.empty() && steps_.back().estimate <= budget_);
+    }
+
+    const SparsificationMapper &
+    MemoryPlanner::sparsification_mapperA(const BasePairs &bps) {
+	if (!mapperA_) {
+	    mapperA_ = new_mapper(bps, *rna_dataA_);
+	}
+	return *mapperA_;
+    }
+
+    const SparsificationMapper &
+    MemoryPlanner::sparsification_mapperB(const BasePairs &bps) {
+	if (!mapperB_) {
+	    mapperB_ = new_mapper(bps, *rna_dataB_);
+	}
+	return *mapperB_;
+    }
+
+    double
+    MemoryPlanner::tighter_cutoff(double min_prob) {
+	return std::min(1.0, std::max(2*min_prob, 0.0001));
+    }
+
+    MemoryPlanner::size_type
+    MemoryPlanner::parse_size(const std::string &s) {
+	const char *p = s.c_str();
+	char *end;
+	double x = strtod(p,&end);
+	if (end==p || x<0) {
+	    throw failure("Cannot parse memory size "+s+".");
+	}
+
+	double factor=1;
+	switch(toupper(*end)) {
+	case 0: break;
+	case 'K': factor=1024.0; break;
+	case 'M': factor=1024.0*1024; break;
+	case 'G': factor=1024.0*1024*1024; break;
+	case 'T': factor=1024.0*1024*1024*1024; break;
+	default:
+	    throw failure("Cannot parse memory size "+s+".");
+	}
+	if (*end!=0) {
+	    ++end;
+	    // optional B, as in MB
+	    if (toupper(*end)=='B') ++end;
+	    if (*end!=0) {
+		throw failure("Cannot parse memory size "+s+".");
+	    }
+	}
+
+	return (size_type)(x*factor);
+    }
+
+    std::string
+    MemoryPlanner::format_size(size_type bytes) {
+	const char *units[] = {"B","K","M","G","T"};
+	double x=bytes;
+	size_t u=0;
+	while (x>=1024 && u<4) {
+	    x/=1024;
+	    ++u;
+	}
+
+	std::ostringstream out;
+	if (u==0) {
+	    out << bytes << units[0];
+	} else {
+	    out << std::fixed << std::setprecision(1) << x << units[u];
+	}
+	return out.str();
+    }
+
+    std::ostream &
+    MemoryPlanner::write(std::ostream &out) const {
+	out << "Memory plan (budget " << format_size(budget_)
+	    << ", in use " << format_size(baseline_) << "):" << std::endl;
+	for (size_type k=0; k<steps_.size(); ++k) {
+	    const step_t &step = steps_[k];
+	    out << "  min-prob " << step.min_prob
+		<< ": " << step.bpsA << " x " << step.bpsB << " base pairs, "
+		<< step.arc_matches << " arc matches, estimated "
+		<< format_size(step.estimate)
+		<< (step.estimate<=budget_ ? " (fits)" : "")
+		<< std::endl;
+	}
+	return out;
+    }
+
+} // end namespace LocARNA
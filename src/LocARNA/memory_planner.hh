@@ -0,0 +1,295 @@
+#ifndef LOCARNA_MEMORY_PLANNER_HH
+#define LOCARNA_MEMORY_PLANNER_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace LocARNA {
+
+    class ArcMatches;
+    class BasePairs;
+    class RnaData;
+    class ExtRnaData;
+    class MatchController;
+    class AnchorConstraints;
+    class SparsificationMapper;
+
+    /**
+     * @brief Plan the memory of a pairwise alignment
+     *
+     * Estimates the memory of the alignment algorithms from the
+     * numbers of base pairs and arc matches, the sizes of the
+     * sparsification info vectors and the sequence lengths, before
+     * any DP matrix is allocated. The estimates are upper bounds:
+     * matrices with rows allocated on demand are counted with all
+     * rows.
+     *
+     * The estimate of a step adds a safety margin to the estimate of
+     * the algorithm as well as the memory that the process currently
+     * uses when the planner is constructed (resident set size; the
+     * sequences, RNA data with in-loop probabilities, the process
+     * itself). Memory that was freed before does not count, such
+     * that the decision does not depend on earlier, transient peaks.
+     *
+     * The driver programs use the planner to fit a job into a
+     * memory budget: as long as the estimate exceeds the budget,
+     * fit_arc_matches() tightens the base pair cutoff (see
+     * tighter_cutoff()) and recomputes the arc matches. Each
+     * considered cutoff is recorded as a step of the plan, which can
+     * be reported. The sparsification mappers built for the
+     * estimate of the last step are passed on to the aligner (see
+     * sparsification_mapperA()).
+     *
+     * @note The estimates ignore banding (max-diff), since the
+     * aligners allocate their matrices in full size. In score-only
+     * mode, AlignerN and AlignerNN release rows of D, IAD and IBD
+     * as soon as they cannot be read anymore; the estimates still
+     * count all rows, i.e. they overestimate such jobs.
+     */
+    class MemoryPlanner {
+    public:
+	typedef std::size_t size_type; //!< size type
+
+	//! @brief alignment algorithms
+	struct Aligner {
+	    //! inner type
+	    enum type {
+		N,  //!< AlignerN (sparse)
+		NN, //!< AlignerNN (pankov)
+		P   //!< AlignerP (locarna_p)
+	    };
+	};
+
+    private:
+	//! @brief step of the plan
+	struct step_t {
+	    double min_prob; //!< base pair cutoff
+	    size_type bpsA; //!< number of base pairs in A
+	    size_type bpsB; //!< number of base pairs in B
+	    size_type arc_matches; //!< number of arc matches
+	    size_type estimate; //!< estimated memory
+	};
+
+	Aligner::type aligner_; //!< alignment algorithm
+	size_type budget_; //!< memory budget in bytes
+	size_type baseline_; //!< memory in use at construction (resident set)
+
+	const ExtRnaData *rna_dataA_; //!< RNA data A (for sparsification)
+	const ExtRnaData *rna_dataB_; //!< RNA data B (for sparsification)
+	double prob_unpaired_in_loop_threshold_; //!< sparsification threshold
+	double prob_basepair_in_loop_threshold_; //!< sparsification threshold
+
+	std::vector<step_t> steps_; //!< the steps of the plan
+
+	SparsificationMapper *mapperA_; //!< mapper A of the last step
+	SparsificationMapper *mapperB_; //!< mapper B of the last step
+
+	//! @brief safety margin of the estimates (fraction of the
+	//! estimate)
+	static const double margin_;
+
+	//! @brief forbid copying
+	MemoryPlanner(const MemoryPlanner &);
+
+	//! @brief forbid assignment
+	MemoryPlanner &operator =(const MemoryPlanner &);
+
+	/**
+	 * @brief Sparsification mapper for the aligner
+	 * @param bps base pairs
+	 * @param rna_data RNA data
+	 * @return newly allocated mapper
+	 */
+	SparsificationMapper *
+	new_mapper(const BasePairs &bps, const ExtRnaData &rna_data) const;
+
+    public:
+	//! @brief budget without limit
+	static const size_type unlimited;
+
+	/**
+	 * @brief Construct
+	 *
+	 * @param aligner alignment algorithm
+	 * @param budget memory budget in bytes; unlimited for no
+	 * budget
+	 * @param rna_dataA RNA data A
+	 * @param rna_dataB RNA data B
+	 * @param prob_unpaired_in_loop_threshold threshold for
+	 * unpaired bases in loops
+	 * @param prob_basepair_in_loop_threshold threshold for base
+	 * pairs in loops
+	 *
+	 * RNA data and thresholds are required for the sparsified
+	 * aligners N and NN, which size their matrices by the info
+	 * vectors of the sparsification mappers.
+	 *
+	 * The memory in use by the process at construction is counted
+	 * in the estimate of each step.
+	 */
+	MemoryPlanner(Aligner::type aligner,
+		      size_type budget,
+		      const ExtRnaData *rna_dataA=0L,
+		      const ExtRnaData *rna_dataB=0L,
+		      double prob_unpaired_in_loop_threshold=0,
+		      double prob_basepair_in_loop_threshold=0);
+
+	//! @brief destruct, freeing the mappers
+	~MemoryPlanner();
+
+	/**
+	 * @brief Whether the plan has a memory budget
+	 * @return true iff the budget is not unlimited
+	 */
+	bool
+	has_budget() const { return budget_!=unlimited; }
+
+	/**
+	 * @brief Estimate memory of an alignment
+	 *
+	 * @param aligner alignment algorithm
+	 * @param lenA length of sequence A
+	 * @param lenB length of sequence B
+	 * @param bpsA number of base pairs in A
+	 * @param bpsB number of base pairs in B
+	 * @param infoA maximal info vector size of A (sparsification)
+	 * @param infoB maximal info vector size of B (sparsification)
+	 * @param arc_matches number of arc matches
+	 *
+	 * @return estimated memory in bytes, including the
+	 * sparsification mappers of the aligners N and NN; without
+	 * safety margin and memory in use
+	 */
+	static
+	size_type
+	estimate(Aligner::type aligner,
+		 size_type lenA,
+		 size_type lenB,
+		 size_type bpsA,
+		 size_type bpsB,
+		 size_type infoA,
+		 size_type infoB,
+		 size_type arc_matches);
+
+	/**
+	 * @brief Add step to the plan
+	 *
+	 * @param arc_matches arc matches for the base pair cutoff
+	 * @param min_prob base pair cutoff
+	 *
+	 * @return whether the estimated memory fits the budget
+	 *
+	 * For the sparsified aligners, builds the sparsification
+	 * mappers for the base pairs of the arc matches; they replace
+	 * the mappers of the previous step.
+	 */
+	bool
+	add_step(const ArcMatches &arc_matches, double min_prob);
+
+	/**
+	 * @brief Construct arc matches that fit the budget
+	 *
+	 * @param rna_dataA RNA data A
+	 * @param rna_dataB RNA data B
+	 * @param[in,out] min_prob base pair cutoff; tightened until
+	 * the estimate fits the budget or the cutoff reaches 1
+	 * @param max_length_diff maximal difference of arc lengths
+	 * @param max_diff_at_am maximal difference at arc match ends
+	 * @param trace_controller trace controller
+	 * @param constraints anchor constraints
+	 *
+	 * @return arc matches of the last step (owned by the caller)
+	 *
+	 * Without budget, the arc matches are constructed once and no
+	 * step is added. The arc matches are returned even if they
+	 * do not fit; check with fits().
+	 */
+	ArcMatches *
+	fit_arc_matches(const RnaData &rna_dataA,
+			const RnaData &rna_dataB,
+			double &min_prob,
+			size_type max_length_diff,
+			size_type max_diff_at_am,
+			const MatchController &trace_controller,
+			const AnchorConstraints &constraints);
+
+	/**
+	 * @brief Whether the last step fits the budget
+	 * @return true iff there is no budget or the estimate of the
+	 * last step is within the budget
+	 */
+	bool
+	fits() const;
+
+	/**
+	 * @brief Tighter base pair cutoff
+	 * @param min_prob base pair cutoff
+	 * @return next larger cutoff, at most 1
+	 */
+	static
+	double
+	tighter_cutoff(double min_prob);
+
+	/**
+	 * @brief Sparsification mapper A
+	 *
+	 * @param bps base pairs of A, from the arc matches of the last
+	 * step if there is one
+	 *
+	 * @return the mapper of the last step; built on first call if
+	 * no step built it. The mapper is indexed like the aligner of
+	 * the plan expects (by common left ends for N, by arcs for
+	 * NN) and is owned by the planner.
+	 */
+	const SparsificationMapper &
+	sparsification_mapperA(const BasePairs &bps);
+
+	/**
+	 * @brief Sparsification mapper B
+	 * @param bps base pairs of B
+	 * @return the mapper of the last step
+	 * @see sparsification_mapperA()
+	 */
+	const SparsificationMapper &
+	sparsification_mapperB(const BasePairs &bps);
+
+	/**
+	 * @brief Parse memory size
+	 *
+	 * @param s size in bytes, optionally with suffix K, M, G or T
+	 * (binary multiples)
+	 *
+	 * @return size in bytes
+	 * @note throws failure on syntax error
+	 */
+	static
+	size_type
+	parse_size(const std::string &s);
+
+	/**
+	 * @brief Format memory size
+	 * @param bytes size in bytes
+	 * @return human readable size
+	 */
+	static
+	std::string
+	format_size(size_type bytes);
+
+	/**
+	 * @brief Write plan
+	 * @param out output stream
+	 * @return stream
+	 */
+	std::ostream &
+	write(std::ostream &out) const;
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_MEMORY_PLANNER_HH
@@ -8,6 +8,8 @@
 #include "basepairs.hh"
 #include "alignment.hh"
 #include "multiple_alignment.hh"
+#include "multiple_alignment_comparison.hh"
+#include "sequence_profile.hh"
 #include "sequence_annotation.hh"
 
 #include <limits>
@@ -17,6 +19,9 @@
 
 namespace LocARNA {
 
+    //! white space characters that separate tokens in input lines
+    static const char *whitespace_chars=" \t\n\v\f\r";
+
 
     /* NOTE / TODO :
        reading and writing of clustal-like format and stockholm can be done in a very similar way;
@@ -54,14 +59,16 @@ namespace LocARNA {
     MultipleAlignment::MultipleAlignment() 
 	: alig_(),
 	  annotations_(),
-	  name2idx_() {
+	  name2idx_(),
+	  profile_(0L) {
         init_annotation_tags();
     }
     
     MultipleAlignment::MultipleAlignment(std::istream &in, FormatType::type format)
     	: alig_(),
 	  annotations_(),
-	  name2idx_() {
+	  name2idx_(),
+	  profile_(0L) {
 	
 	if (!in.good()) {
 	    throw(failure("Cannot read input stream."));
@@ -69,25 +76,14 @@ namespace LocARNA {
 
         init_annotation_tags();
 
-	if (format==FormatType::FASTA) {
-	    read_fasta(in);
-	} else if (format==FormatType::CLUSTAL) {
-	    read_clustalw(in);
-	} else if (format==FormatType::PP) {
-	    read_clustallike(in,format);
-	} else if (format==FormatType::STOCKHOLM) {
-            read_stockholm(in);
-        } else {
-	    throw failure("Unknown format.");
-	}
-	
-	create_name2idx_map();
+	read(in,format);
     }
     
     MultipleAlignment::MultipleAlignment(const std::string &filename, FormatType::type format)
 	: alig_(),
 	  annotations_(),
-	  name2idx_() {
+	  name2idx_(),
+	  profile_(0L) {
 	
 	try {
 	    std::ifstream in(filename.c_str());
@@ -120,7 +116,8 @@ namespace LocARNA {
 					 const std::string &sequence)
 	: alig_(),
 	  annotations_(),
-	  name2idx_() {
+	  name2idx_(),
+	  profile_(0L) {
 
         init_annotation_tags();
 	
@@ -135,7 +132,8 @@ namespace LocARNA {
 					 const std::string &aliB)
 	: alig_(),
 	  annotations_(),
-	  name2idx_() {
+	  name2idx_(),
+	  profile_(0L) {
 	
         std::string nameA=in_nameA;
         std::string nameB=in_nameB;
@@ -164,7 +162,8 @@ namespace LocARNA {
                                          bool only_local, bool special_gap_symbols)
 	:alig_(),
 	 annotations_(),
-	 name2idx_() {
+	 name2idx_(),
+	 profile_(0L) {
 	SequenceAnnotation
 	    anchors(alignment.alignment_edges(only_local),
 		 alignment.seqA().annotation(AnnoType::anchors),
@@ -188,7 +187,8 @@ namespace LocARNA {
 					 const Sequence &seqB)
 	:alig_(),
 	 annotations_(),
-	 name2idx_() {
+	 name2idx_(),
+	 profile_(0L) {
 
         init_annotation_tags();
 
@@ -269,6 +269,39 @@ namespace LocARNA {
 
     
     MultipleAlignment::~MultipleAlignment() {
+	delete profile_;
+    }
+
+    MultipleAlignment::MultipleAlignment(const MultipleAlignment &ma)
+	: alig_(ma.alig_),
+	  annotations_(ma.annotations_),
+	  name2idx_(ma.name2idx_),
+	  profile_(0L) {
+    }
+
+    MultipleAlignment &
+    MultipleAlignment::operator =(const MultipleAlignment &ma) {
+	if (this != &ma) {
+	    alig_ = ma.alig_;
+	    annotations_ = ma.annotations_;
+	    name2idx_ = ma.name2idx_;
+	    invalidate_profile();
+	}
+	return *this;
+    }
+
+    const SequenceProfile &
+    MultipleAlignment::profile() const {
+	if (profile_ == 0L) {
+	    profile_ = new SequenceProfile(*this);
+	}
+	return *profile_;
+    }
+
+    void
+    MultipleAlignment::invalidate_profile() {
+	delete profile_;
+	profile_ = 0L;
     }
 
     const Sequence & MultipleAlignment::as_sequence() const {
@@ -277,6 +310,7 @@ namespace LocARNA {
 
     void
     MultipleAlignment::create_name2idx_map() {
+	name2idx_.clear();
 	for (std::vector<SeqEntry>::size_type i=0;
 	     i<alig_.size();
 	     ++i) {
@@ -284,6 +318,26 @@ namespace LocARNA {
 	}
     }
 
+    void
+    MultipleAlignment::read(std::istream &in, FormatType::type format) {
+	invalidate_profile();
+	annotations_.clear();
+	
+	if (format==FormatType::FASTA) {
+	    read_fasta(in);
+	} else if (format==FormatType::CLUSTAL) {
+	    read_clustalw(in);
+	} else if (format==FormatType::PP) {
+	    read_clustallike(in,format);
+	} else if (format==FormatType::STOCKHOLM) {
+            read_stockholm(in);
+        } else {
+	    throw failure("Unknown format.");
+	}
+	
+	create_name2idx_map();
+    }
+
     void
     MultipleAlignment::read_stockholm(std::istream &in) {
         // require STOCKHOLM header 
@@ -307,12 +361,6 @@ namespace LocARNA {
     MultipleAlignment::read_clustallike(std::istream &in,
                             FormatType::type format) {
 
-	std::string name;
-	std::string seqstr;
-    
-	std::map<std::string,std::string> seq_map;
-	std::vector<std::string> names;
-    
 	std::string line;
 
 	std::vector<std::string> anchors;
@@ -321,10 +369,10 @@ namespace LocARNA {
 	std::string fixed_structure_string="";
 	
 	alig_.clear();
+	name2idx_.clear();
 	
 	get_nonempty_line(in,line);
 	
-        std::string format_header;
         if (format == FormatType::CLUSTAL) {
             // accept and ignore CLUSTAL header line (this is optional!)
             if (has_prefix(line,"CLUSTAL"))  {
@@ -336,19 +384,24 @@ namespace LocARNA {
 	const std::string structure_tag = "#"+annotation_tags[format][AnnoType::structure];
 	const std::string fixed_structure_tag = "#"+annotation_tags[format][AnnoType::fixed_structure];
 	
+	// row that we expect next; in interleaved (multi-block) input
+	// the rows of each block occur in the same order, such that
+	// names are resolved without map look up after the first block
+	size_type expected_row=0;
+	
 	do {
             // for STOCKHOLM end at '//', which allows multiple entries in one stream
             if (format == FormatType::STOCKHOLM && line=="//") {
                 break;
             }
-	    if (line[0]=='#') {
+	    if (!line.empty() && line[0]=='#') {
 		if (format==FormatType::PP && has_prefix(line,"#END")) { // recognize END in pp files
 		    // section end
 		    break;
 		}
 		else if (has_prefix(line,anchors_tag)) {
 		    // anchor constraint
-		    std::istringstream in(line.substr(2));
+		    std::istringstream in(line.substr(anchors_tag.length()));
 		    int idx;
 		    std::string astr;
 		    in >> idx >> astr;
@@ -397,33 +450,53 @@ namespace LocARNA {
                 }
                 
 	    } else {
-	    	std::istringstream in(line);
-		in >> name;
-		if ( in.fail() || name.empty()) {
+		// tokenize "<name> <seq>" in place
+		size_t name_len = line.find_first_of(whitespace_chars);
+		if (name_len==std::string::npos) {
+		    name_len=line.length();
+		}
+		if (name_len==0) {
 		    throw syntax_error_failure("Unexpected line while reading clustal format");
 		}
-                
-		in >> seqstr;
-                if ( in.fail() ) {
-                    seqstr="";
-                }
-                
-		if (seq_map.find(name)==seq_map.end()) {
-		    seq_map[name] = "";
-		    names.push_back(name);
+		
+		size_t seq_begin = line.find_first_not_of(whitespace_chars,name_len);
+		size_t seq_len = 0;
+		if (seq_begin==std::string::npos) {
+		    seq_begin = line.length();
+		} else {
+		    size_t seq_end = line.find_first_of(whitespace_chars,seq_begin);
+		    if (seq_end==std::string::npos) {
+			seq_end = line.length();
+		    }
+		    seq_len = seq_end-seq_begin;
+		}
+		
+		size_type row;
+		if (expected_row<alig_.size()
+		    && line.compare(0,name_len,alig_[expected_row].name())==0) {
+		    row=expected_row;
+		} else {
+		    const std::string name = line.substr(0,name_len);
+		    str2idx_map_t::const_iterator it = name2idx_.find(name);
+		    if (it==name2idx_.end()) {
+			row=alig_.size();
+			name2idx_[name]=row;
+			alig_.push_back(SeqEntry(name,""));
+		    } else {
+			row=it->second;
+		    }
 		}
-		seq_map[name] += seqstr;
+		
+		// append the block directly to the row
+		alig_[row].append(line,seq_begin,seq_len);
+		
+		expected_row = (row+1<alig_.size()) ? row+1 : 0;
 	    }
 	    // if format is CLUSTAL, stop when reading a "CLUSTAL" header line again, this
 	    // allows reading multiple clustal entries from one file
 	} while (get_nonempty_line(in,line) 
 		 && !(format==FormatType::CLUSTAL && has_prefix(line,"CLUSTAL")));
     
-	// store the name/sequence pairs in the vector alig
-	for (std::vector<std::string>::const_iterator it=names.begin(); it!=names.end(); ++it) {
-	    alig_.push_back( SeqEntry(*it,seq_map[*it]) );
-	}
-
 	// check anchor constraints
 	if (anchors.size()>0) {
 	    size_t len = anchors[0].size();
@@ -472,9 +545,6 @@ namespace LocARNA {
     
     void
     MultipleAlignment::read_fasta(std::istream &in) {
-	std::string name;
-	std::string description;
-	
 	std::string line;
     
 	alig_.clear();
@@ -484,32 +554,36 @@ namespace LocARNA {
 	while(in) {
 	    
 	    if (line.length()>0 && line[0]=='>') {
-		std::istringstream sin(line);
-		sin.get(); // this eats '>'
-		sin >> name; // gets the first non-whitespace substring after '>' of the line
-		
-		if (sin.fail() || name.empty()) {
+		// the name is the first non-whitespace substring after '>' of the line
+		const size_t name_begin = line.find_first_not_of(whitespace_chars,1);
+		if (name_begin==std::string::npos) {
 		    throw syntax_error_failure("Cannot read sequence header after '>'");
 		}
+		size_t name_end = line.find_first_of(whitespace_chars,name_begin);
+		if (name_end==std::string::npos) {
+		    name_end = line.length();
+		}
 		
 		// todo: this does not eat off blanks at begining of description yet
-		std::stringbuf sb;
-		sin.get(sb);
-		description=sb.str();
-
-		std::string seqstr="";
+		alig_.push_back( SeqEntry(line.substr(name_begin,name_end-name_begin),
+					  line.substr(name_end),
+					  "") );
+		SeqEntry &entry = alig_.back();
+		
     		getline(in,line);
 		while((in) && (line.size()==0 || line[0]!='>')) {
-		    // remove whitespace and add to seqstr
-		    std::istringstream sin(line);
-		    std::string seqstr1;
-		    while(sin >> seqstr1) {
-			seqstr += seqstr1;
+		    // remove whitespace and append to the sequence
+		    size_t begin = line.find_first_not_of(whitespace_chars);
+		    while (begin!=std::string::npos) {
+			size_t end = line.find_first_of(whitespace_chars,begin);
+			if (end==std::string::npos) {
+			    end = line.length();
+			}
+			entry.append(line,begin,end-begin);
+			begin = line.find_first_not_of(whitespace_chars,end);
 		    }
 		    getline(in,line);
 		}
-		
-		alig_.push_back( SeqEntry(name,description,seqstr) );
 	    } else {
 		throw syntax_error_failure("Unexpected line while reading fasta");
 	    }
@@ -583,6 +657,7 @@ namespace LocARNA {
     }
     
     void MultipleAlignment::normalize_rna_symbols() {
+	invalidate_profile();
 	for (std::vector<SeqEntry>::iterator it = alig_.begin();
 	     alig_.end() != it; ++it) {
 	    std::string seq = it->seq().str();
@@ -626,358 +701,26 @@ namespace LocARNA {
 	return false;
     }
 
-    size_type
-    MultipleAlignment::deviation2(const string1 &a1,
-				  const string1 &a2,
-				  const string1 &ref1,
-				  const string1 &ref2
-				  ) {
-    
-	//determine the cut deviation between to pariwise alignments
-	// compute the maximum over the minimum distance of cut c1 in a to a cut c2 in b 
-    
-	size_type d=0;
-    
-	size_type i1=0;
-	size_type j1=0;
-	for (size_type c1=0; c1<=a1.length(); c1++) {
-	
-	    size_type dprime=std::numeric_limits<size_type>::max();
-	
-	    if (c1>0) {
-		if (!is_gap_symbol(a1[c1])) i1++;
-		if (!is_gap_symbol(a2[c1])) j1++;
-	    }
-
-	    size_type i2=0;
-	    size_type j2=0;
-	    for (size_type c2=0; c2<=ref1.length(); c2++) {
-	    
-		if (c2>0) {
-		    if (!is_gap_symbol(ref1[c2])) i2++;
-		    if (!is_gap_symbol(ref2[c2])) j2++;
-		}
-
-		size_type dc =
-		    labs((long int)i1-(long int)i2)
-		    +labs((long int)j1-(long int)j2);
-
-		dprime = std::min(dprime,dc);
-	    }
-
-	    d=std::max(d,dprime);
-	}
-	return d;
-    }
-
-
     size_type
     MultipleAlignment::deviation(const MultipleAlignment &ma) const {
-    
-	//determine maximal deviation2 of pairwise subalignments
-    
-	size_type d=0;
-    
-	//traverse all pairs of sequences in *this and ma
-	for (size_type x=0; x<ma.alig_.size(); x++) {
-	    const std::string &namex = ma.seqentry(x).name();
-	    for (size_type y=x+1; y<ma.alig_.size(); y++) {
-		const std::string &namey = ma.seqentry(y).name();
-	    
-		size_type d2 =
-		    deviation2(ma.seqentry(x).seq(),ma.seqentry(y).seq(),
-			       seqentry(namex).seq(),seqentry(namey).seq()
-			       );
-
-		d = std::max(d, d2);
-	    }
-	}
-	return d;
+	return MultipleAlignmentComparison(ma,*this).deviation();
     }
     
     double
     MultipleAlignment::sps(const MultipleAlignment &ma, bool compalign) const {
-	double sps=0.0;
-	
-	
-	//traverse all pairs of sequences in *this and ma
-	for (size_type x=0; x<ma.alig_.size(); x++) {
-	    const std::string &namex = ma.seqentry(x).name();
-	    for (size_type y=x+1; y<ma.alig_.size(); y++) {
-		const std::string &namey = ma.seqentry(y).name();
-		
-		size_t len1 = seqentry(namex).length_wogaps(); 
-		size_t len2 = seqentry(namey).length_wogaps(); 
-		
-		// compute pairwise score
-				
-		double match_score =
-		    pairwise_match_score(ma.seqentry(x),ma.seqentry(y),
-					 seqentry(namex),seqentry(namey),
-					 compalign
-					 );
-		
-		if (compalign) {
-		    match_score +=
-			pairwise_match_score(ma.seqentry(y),ma.seqentry(x),
-					     seqentry(namey),seqentry(namex),
-					     compalign
-					     );
-		
-		    match_score /= len1+len2;
-		} else {
-		    match_score *= 2;
-		    match_score /= 
-			count_matches(ma.seqentry(x),ma.seqentry(y))
-			+ count_matches(seqentry(namey),seqentry(namex));
-		}
-			
-		sps += match_score;
-	    }
-	}
-	
-	size_t K=ma.num_of_rows();
-	
-	return sps*2.0/K/(K-1);
+	return MultipleAlignmentComparison(ma,*this).sps(compalign);
     }
 
     double
     MultipleAlignment::avg_deviation_score(const MultipleAlignment &ma) const {
-	double score=0.0;
-	
-	
-	//traverse all pairs of sequences in *this and ma
-	for (size_type x=0; x<ma.alig_.size(); x++) {
-	    const std::string &namex = ma.seqentry(x).name();
-	    for (size_type y=x+1; y<ma.alig_.size(); y++) {
-		const std::string &namey = ma.seqentry(y).name();
-		
-		size_t len1 = seqentry(namex).length_wogaps(); 
-		size_t len2 = seqentry(namey).length_wogaps(); 
-		
-		// compute pairwise score
-		double pw_score =
-		    pairwise_deviation_score(ma.seqentry(x),ma.seqentry(y),
-					     seqentry(namex),seqentry(namey));
-		
-		pw_score +=
-		    pairwise_deviation_score(ma.seqentry(y),ma.seqentry(x),
-					     seqentry(namey),seqentry(namex));
-		
-		pw_score /= len1+len2;
-			
-		score += pw_score;
-	    }
-	}
-	
-	size_t K=ma.num_of_rows();
-	
-	return score*2.0/K/(K-1);
+	return MultipleAlignmentComparison(ma,*this).avg_deviation_score();
     }
 
-    
-    std::vector<int> 
-    MultipleAlignment::match_vector(const string1 &s,
-				    const string1 &t) {
-	size_t len=s.length();
-	assert(len == t.length());
-	
-	size_t posT=0;
-	
-	std::vector<int> res;
-	res.push_back(-1);
-
-	for (size_t col=1; col<=len; col++) {
-	    int entry=-1;
-	    if (!is_gap_symbol(t[col])) {
-		posT++;
-		entry=posT;
-	    }
-	    if (!is_gap_symbol(s[col])) {
-		res.push_back(entry);
-	    }
-	}
-
-	return res;
-    }
-
-    std::vector<int> 
-    MultipleAlignment::match_vector2(const string1 &s,
-				    const string1 &t) {
-	size_t len=s.length();
-	assert(len == t.length());
-	
-	size_t posT=0;
-	
-	std::vector<int> res;
-	res.push_back(-1);
-
-	for (size_t col=1; col<=len; col++) {
-	    if (!is_gap_symbol(t[col])) {
-		posT++;
-	    }
-	    if (!is_gap_symbol(s[col])) {
-		res.push_back(posT);
-	    }
-	}
-
-	return res;
-    }
-
-
     double
     MultipleAlignment::cmfinder_realignment_score(const MultipleAlignment &ma) const {
-	size_t matches=0; // count matches in ma
-	size_t exclusive_matches=0; // count matches in ma that are not found in reference
-	
-	//traverse all pairs of sequences in *this and ma
-	for (size_type x=0; x<ma.alig_.size(); x++) {
-	    const std::string &namex = ma.seqentry(x).name();
-	    for (size_type y=x+1; y<ma.alig_.size(); y++) {
-		const std::string &namey = ma.seqentry(y).name();
-				
-		// compute pairwise score
-				
-		matches += count_matches(ma.seqentry(x),ma.seqentry(y));
-
-		exclusive_matches += count_exclusive_matches(ma.seqentry(x),ma.seqentry(y),
-							     seqentry(namex),seqentry(namey)
-							     );
-		
-	    }
-	}
-	
-	// std::cout << exclusive_matches << " " << matches << " " << std::endl;
-	
-	return exclusive_matches / (double)matches;
+	return MultipleAlignmentComparison(ma,*this).cmfinder_realignment_score();
     } 
     
-    size_t
-    MultipleAlignment::count_matches(const SeqEntry &a1,
-				     const SeqEntry &a2) {
-
-	size_t matches=0;
-
-	size_t len_a=a1.seq().length();
-	
-	assert(len_a == a2.seq().length());
-
-	for (size_t col=1; col<=len_a; col++) {
-	    if ((!is_gap_symbol(a1.seq()[col]))
-		&& (!is_gap_symbol(a2.seq()[col]))
-		) {
-		matches++;
-	    }
-	}
-	
-	return matches;
-    }
-    
-    size_t
-    MultipleAlignment::count_exclusive_matches(const SeqEntry &a1,
-					       const SeqEntry &a2,
-					       const SeqEntry &ref1,
-					       const SeqEntry &ref2
-					       ) {
-	size_t matches=0;
-	
-	size_t len_a=a1.seq().length();
-	
-	assert(len_a == a2.seq().length());
-	assert(ref1.seq().length() == ref2.seq().length());
-	
-	const std::vector<int> matchvecA = match_vector(a1.seq(),a2.seq());
-	const std::vector<int> matchvecRef = match_vector(ref1.seq(),ref2.seq());
-	
-	// count exclusive matches alignments a
-	size_t i=1;
-	for (size_t col=1; col<=len_a; col++) {
-	    if (!is_gap_symbol(a1.seq()[col])) {
-		
-		if (
-		    (matchvecA[i]!=-1)
-		    &&
-		    (matchvecA[i]!=matchvecRef[i])) {
-		    matches+=1;
-		}
-		i++;
-	    }
-	}
-	
-	return matches;
-    }
-
-    
-    double
-    MultipleAlignment::pairwise_match_score(const SeqEntry &a1,
-					    const SeqEntry &a2,
-					    const SeqEntry &ref1,
-					    const SeqEntry &ref2,
-					    bool score_common_gaps
-					    ) {
-	size_t s=0;
-	
-	size_t len_a=a1.seq().length();
-	
-	assert(len_a == a2.seq().length());
-	assert(ref1.seq().length() == ref2.seq().length());
-	
-	const std::vector<int> matchvecA = match_vector(a1.seq(),a2.seq());
-	const std::vector<int> matchvecRef = match_vector(ref1.seq(),ref2.seq());
-	
-	// count common matches in the two alignments
-	size_t i=1;
-	for (size_t col=1; col<=len_a; col++) {
-	    if (!is_gap_symbol(a1.seq()[col])) {
-		
-		// add one to score, if position i of the first
-		// sequence is matched to the same position by both
-		// alignments
-		if ((score_common_gaps || (matchvecA[i]!=-1))
-		    && 
-		    (matchvecA[i]==matchvecRef[i])) {
-		    s+=1;
-		}
-		i++;
-	    }
-	}
-	
-	return (double)s;
-    }
-    
-    double
-    MultipleAlignment::pairwise_deviation_score(const SeqEntry &a1,
-						const SeqEntry &a2,
-						const SeqEntry &ref1,
-						const SeqEntry &ref2
-						) {
-	double s=0.0;
-	
-	size_t len_a=a1.seq().length();
-	
-	assert(len_a == a2.seq().length());
-	assert(ref1.seq().length() == ref2.seq().length());
-	
-	const std::vector<int> matchvecA = match_vector2(a1.seq(),a2.seq());
-	const std::vector<int> matchvecRef = match_vector2(ref1.seq(),ref2.seq());
-	
-	// count common matches in the two alignments
-	size_t i=1;
-	for (size_t col=1; col<=len_a; col++) {
-	    if (!is_gap_symbol(a1.seq()[col])) {
-		
-		double j_A = matchvecA[i] + ((matchvecA[i]==matchvecA[i-1])?0.5:0); 
-		double j_Ref = matchvecRef[i] + ((matchvecRef[i]==matchvecRef[i-1])?0.5:0); 
-		
-		s += fabs(j_A-j_Ref);
-		
-		i++;
-	    }
-	}
-	
-	return s;
-    }
-    
     void
     MultipleAlignment::write_debug(std::ostream &out) const {
 	for (size_type i=0; i<alig_.size(); ++i) {
@@ -1141,6 +884,7 @@ namespace LocARNA {
     
     void 
     MultipleAlignment::reverse() {
+	invalidate_profile();
 	for (std::vector<SeqEntry>::iterator it=alig_.begin(); alig_.end()!=it; ++it) {
 	    it->reverse();
 	}
@@ -1160,11 +904,13 @@ namespace LocARNA {
     }
 
     void MultipleAlignment::append(const SeqEntry &seqentry) {
+	invalidate_profile();
 	name2idx_[seqentry.name()]=alig_.size(); // keep map name->index up to date 	
 	alig_.push_back(seqentry);
     }
 
     void MultipleAlignment::prepend(const SeqEntry &seqentry) {
+	invalidate_profile();
 	alig_.insert(alig_.begin(),seqentry);
 	
 	name2idx_.clear();
@@ -1173,6 +919,7 @@ namespace LocARNA {
     
     void
     MultipleAlignment::operator += (const AliColumn &c) {
+	invalidate_profile();
 	for (size_type i=0; i<alig_.size(); ++i) {
 	    alig_[i].push_back(c[i]);
 	}
@@ -1180,11 +927,30 @@ namespace LocARNA {
 
     void
     MultipleAlignment::operator += (char c) {    
+	invalidate_profile();
 	for (size_type i=0; i<alig_.size(); ++i) {
 	    alig_[i].push_back(c);
 	}
     }
 
+    MultipleAlignmentReader::MultipleAlignmentReader(std::istream &in,
+						     MultipleAlignment::FormatType::type format)
+	: in_(in),
+	  format_(format) {
+    }
+
+    bool
+    MultipleAlignmentReader::next(MultipleAlignment &ma) {
+	// skip white space between entries; stop at end of input
+	in_ >> std::ws;
+	if (!in_.good()) {
+	    return false;
+	}
+	
+	ma.read(in_,format_);
+	return true;
+    }
+
     std::ostream &
     operator << (std::ostream &out, const MultipleAlignment &ma) {
 	ma.write(out,MultipleAlignment::FormatType::CLUSTAL);
@@ -28,6 +28,7 @@ namespace LocARNA {
     class BasePairs;
     class Scoring;
     class Sequence;
+    class SequenceProfile;
     
 /**
  * @brief Represents a multiple alignment
@@ -266,6 +267,17 @@ public:
 	//! @brief write access to seq
 	void
 	set_seq(const string1 &seq) {seq_=seq;}
+
+	/** 
+	 * @brief append substring to sequence
+	 * @param s string
+	 * @param pos start position of substring in s (0-based)
+	 * @param n length of substring
+	 */
+	void
+	append(const std::string &s, size_t pos, size_t n) {
+	    seq_.str().append(s,pos,n);
+	}
     };
     
     /**
@@ -363,6 +375,12 @@ private:
      * locate sequences by name in log time
      */
     str2idx_map_t name2idx_;
+
+    /**
+     * encoded profile of the alignment; constructed on demand and
+     * discarded by all modifying operations
+     */
+    mutable SequenceProfile *profile_;
     
     // end attributes
     //************************************************************
@@ -371,6 +389,22 @@ private:
     void
     create_name2idx_map();
 
+    //! @brief discard the profile after modification
+    void
+    invalidate_profile();
+
+    /**
+     * @brief Read alignment from input stream in given format
+     *
+     * @param in input stream
+     * @param format format type of input
+     * @note overwrites/clears existing data
+     */
+    void
+    read(std::istream &in, FormatType::type format);
+
+    friend class MultipleAlignmentReader;
+
 
     /**
      * @brief Read alignment from input stream; helper for uniform
@@ -379,6 +413,8 @@ private:
      * @param in input stream
      * @param format format type of input (CLUSTAL, PP, or STOCKHOLM)
      * @note overwrites/clears existing data
+     * @note lines are tokenized in place and sequence blocks are
+     * appended directly to the rows
      */
     void
     read_clustallike(std::istream &in, FormatType::type format);
@@ -531,6 +567,36 @@ public:
      */
     virtual
     ~MultipleAlignment();
+
+    /**
+     * @brief copy constructor
+     * @param ma multiple alignment
+     * @note the profile is not copied
+     */
+    MultipleAlignment(const MultipleAlignment &ma);
+
+    /**
+     * @brief assignment
+     * @param ma multiple alignment
+     * @return *this
+     * @note the profile is not copied
+     */
+    MultipleAlignment &
+    operator =(const MultipleAlignment &ma);
+
+    /**
+     * @brief Encoded profile of the alignment
+     *
+     * The profile provides symbol codes and column profiles for
+     * use in tight loops. It is constructed on
+     * first access and kept until the alignment is modified.
+     *
+     * @return profile
+     * @note the first access is not thread-safe
+     * @see SequenceProfile
+     */
+    const SequenceProfile &
+    profile() const;
     
     /**
      * @brief "cast" multiple alignment to sequence
@@ -698,6 +764,9 @@ public:
      * reference alignment as preformed when --max-diff-aln is given with
      * --max-diff to locarna.
      * @pre the sequences of ma have to occur in the alignment *this 
+     *
+     * @note to compute several comparison scores of the same pair of
+     * alignments, use MultipleAlignmentComparison directly
     */
     size_type
     deviation(const MultipleAlignment &ma) const; 
@@ -905,136 +974,6 @@ public:
     bool 
     checkAlphabet(const Alphabet<char> &alphabet) const;
     
-private:
-        
-    /**
-     * @brief Deviation of a pairwise alignment from a pairwise reference alignment
-     * @param a1 first alignment string of alignment a
-     * @param a2 second alignment string of alignment a
-     * @param ref1 first alignment string of reference alignment ref
-     * @param ref2 second alignment string of reference alignment ref
-     *
-     * @return deviation of alignment a from reference alignment ref
-     */
-    static
-    size_type
-    deviation2(const string1 &a1,
-	       const string1 &a2,
-	       const string1 &ref1,
-	       const string1 &ref2
-	       );
-
-    
-    /** 
-    * @brief Pairwise match score for calculation of match_sps
-    * 
-    * @param a1 row 1 of test alignment
-    * @param a2 row 2 of test alignment
-    * @param ref1 row 1 of reference alignment
-    * @param ref2 row 2 of reference alignment
-    * @param score_common_gaps whehter to score common gaps
-    * 
-    * @return alignment comparison match score for pairwise alignments (a1,a2) and (ref1,ref2)
-    *
-    * @see sps()
-    */
-    static
-    double
-    pairwise_match_score(const SeqEntry &a1,
-			 const SeqEntry &a2,
-			 const SeqEntry &ref1,
-			 const SeqEntry &ref2,
-			 bool score_common_gaps
-			 );
-    
-    /** 
-     * @brief Determine matching positions for each string position
-     * 
-     * @param s string 1
-     * @param t string 2
-     * 
-     * @return vector v of length length(s+1), such that for each
-     * position i in s (1<=i<=|s|), v[i] is the matching position in t
-     * or -1 if there is no match.
-     */
-    static
-    std::vector<int>
-    match_vector(const string1 &s,
-		 const string1 &t);
-    
-    /** 
-     * @brief Determine matching positions for each string position
-     * 
-     * @param s string 1
-     * @param t string 2
-     * 
-     * @return vector v of length length(s+1), such that for each
-     * position i in s (1<=i<=|s|), v[i] is the matching position in t
-     * or the position after that i is deleted.
-     */
-    static
-    std::vector<int>
-    match_vector2(const string1 &s,
-		  const string1 &t);
-
-    /** 
-     * @brief Count matches in pairwise alignment
-     * 
-     * @param a1 alignment string 1
-     * @param a2 alignment string 2
-     * 
-     * @return number of matches
-     */
-    static
-    size_t
-    count_matches(const SeqEntry &a1,
-		  const SeqEntry &a2);
-    
-    /** 
-     * @brief Count matches in pairwise alignment that do not occur in
-     * a second alignment
-     * 
-     * @param a1 alignment string 1
-     * @param a2 alignment string1 
-     * @param ref1 reference alignment string 1
-     * @param ref2 reference alignment string 1
-     * 
-     * @return number of matches exclusively in alignment a (and not
-     * in reference)
-     */
-    static
-    size_t
-    count_exclusive_matches(const SeqEntry &a1,
-			    const SeqEntry &a2,
-			    const SeqEntry &ref1,
-			    const SeqEntry &ref2
-			    );
-
-    /** 
-     * @brief Average deviation score for pairwise alignment
-     * 
-     * @param a1 alignment string 1
-     * @param a2 alignment string1 
-     * @param ref1 reference alignment string 1
-     * @param ref2 reference alignment string 1
-     * 
-     * @return avg deviation score for alignment (a1,a2) from
-     * reference alignment (ref1,ref2)
-     *
-     * @note This score averages over the differences of positions j_a
-     * and j_ref for all positions i and computes a sum-of-pairs
-     * score. In case i is matched to a gap between j^left and
-     * j^right, we define j as the average value (for j in {j_a,
-     * j_ref}).
-     */
-    static
-    double
-    pairwise_deviation_score(const SeqEntry &a1,
-			     const SeqEntry &a2,
-			     const SeqEntry &ref1,
-			     const SeqEntry &ref2
-			     );
-
 public:
 
     /** 
@@ -1045,6 +984,46 @@ public:
     write_debug(std::ostream &out=std::cout) const;
 };
     
+    /**
+     * @brief Read multiple alignments one at a time from a stream
+     *
+     * Supports input with several alignment entries, like Stockholm
+     * files with several entries terminated by '//' (e.g. the Rfam
+     * seed alignments) or clustal files with repeated CLUSTAL
+     * headers. Only the current alignment is kept in memory.
+     *
+     * Usage:
+     * @code
+     * MultipleAlignmentReader reader(in,MultipleAlignment::FormatType::STOCKHOLM);
+     * MultipleAlignment ma;
+     * while (reader.next(ma)) { ... }
+     * @endcode
+     */
+    class MultipleAlignmentReader {
+	std::istream &in_; //!< input stream
+	MultipleAlignment::FormatType::type format_; //!< input format
+    public:
+	/**
+	 * @brief Construct from stream
+	 *
+	 * @param in input stream
+	 * @param format format of the entries (@see MultipleAlignment::FormatType)
+	 */
+	MultipleAlignmentReader(std::istream &in,
+				MultipleAlignment::FormatType::type
+				format=MultipleAlignment::FormatType::STOCKHOLM);
+
+	/**
+	 * @brief Read next alignment
+	 *
+	 * @param[out] ma multiple alignment; overwritten by the next entry
+	 * @return whether an entry was read; false at end of input
+	 * @throw failure on read errors
+	 */
+	bool
+	next(MultipleAlignment &ma);
+    };
+
     /**
      * @brief Write multiple alignment to stream
      * @param out output stream
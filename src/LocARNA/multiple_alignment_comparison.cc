@@ -0,0 +1,379 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include <deque>
+
+#include "multiple_alignment_comparison.hh"
+#include "multiple_alignment.hh"
+
+namespace LocARNA {
+
+    AlignmentRowIndex::AlignmentRowIndex(const string1 &row)
+	: col_to_pos_(row.length()+1),
+	  pos_to_col_(1,0) {
+	col_to_pos_[0]=0;
+	for (size_type col=1; col<=row.length(); col++) {
+	    col_to_pos_[col]=col_to_pos_[col-1];
+	    if (!is_gap_symbol(row[col])) {
+		col_to_pos_[col]++;
+		pos_to_col_.push_back(col);
+	    }
+	}
+    }
+
+    MultipleAlignmentComparison::row_index_vec_t
+    MultipleAlignmentComparison::index_rows(const MultipleAlignment &ma) {
+	row_index_vec_t rows;
+	rows.reserve(ma.num_of_rows());
+	for (MultipleAlignment::const_iterator it=ma.begin(); ma.end()!=it; ++it) {
+	    rows.push_back(AlignmentRowIndex(it->seq()));
+	}
+	return rows;
+    }
+
+    MultipleAlignmentComparison::MultipleAlignmentComparison(const MultipleAlignment &ma,
+							     const MultipleAlignment &ref)
+	: num_of_rows_(ma.num_of_rows()),
+	  deviation_(num_of_rows_,num_of_rows_),
+	  match_sps_(num_of_rows_,num_of_rows_),
+	  compalign_sps_(num_of_rows_,num_of_rows_),
+	  avg_deviation_(num_of_rows_,num_of_rows_),
+	  matches_(num_of_rows_,num_of_rows_),
+	  exclusive_matches_(num_of_rows_,num_of_rows_) {
+
+	const size_type K=num_of_rows_;
+
+	// index the rows of both alignments once; look up
+	// reference rows by name only once per row of ma
+	const row_index_vec_t rows = index_rows(ma);
+	const row_index_vec_t all_ref_rows = index_rows(ref);
+
+	std::vector<const AlignmentRowIndex *> ref_rows(K);
+	for (size_type x=0; x<K; x++) {
+	    const std::string &name = ma.seqentry(x).name();
+	    if (!ref.contains(name)) {
+		throw failure("Sequence "+name+" does not occur in the reference alignment.");
+	    }
+	    ref_rows[x] = &all_ref_rows[ref.index(name)];
+	}
+
+	// enumerate pairs x<y
+	std::vector<std::pair<size_type,size_type> > pairs;
+	pairs.reserve(K*(K-(K>0))/2);
+	for (size_type x=0; x<K; x++) {
+	    for (size_type y=x+1; y<K; y++) {
+		pairs.push_back(std::make_pair(x,y));
+	    }
+	}
+
+	// evaluate all pairs independently; every pair writes only to
+	// its own matrix entries
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (long int p=0; p<(long int)pairs.size(); p++) {
+	    const size_type x = pairs[p].first;
+	    const size_type y = pairs[p].second;
+
+	    const AlignmentRowIndex &ax = rows[x];
+	    const AlignmentRowIndex &ay = rows[y];
+	    const AlignmentRowIndex &rx = *ref_rows[x];
+	    const AlignmentRowIndex &ry = *ref_rows[y];
+
+	    size_t len1 = rx.length_wogaps();
+	    size_t len2 = ry.length_wogaps();
+
+	    size_type matches = count_matches(ax,ay);
+
+	    deviation_(x,y) = deviation2(ax,ay,rx,ry);
+
+	    double compalign_score =
+		(double)pairwise_match_score(ax,ay,rx,ry,true);
+	    compalign_score +=
+		(double)pairwise_match_score(ay,ax,ry,rx,true);
+	    compalign_score /= len1+len2;
+	    compalign_sps_(x,y) = compalign_score;
+
+	    double match_score =
+		(double)pairwise_match_score(ax,ay,rx,ry,false);
+	    match_score *= 2;
+	    match_score /= matches + count_matches(ry,rx);
+	    match_sps_(x,y) = match_score;
+
+	    double dev_score = pairwise_deviation_score(ax,ay,rx,ry);
+	    dev_score += pairwise_deviation_score(ay,ax,ry,rx);
+	    dev_score /= len1+len2;
+	    avg_deviation_(x,y) = dev_score;
+
+	    matches_(x,y) = matches;
+	    exclusive_matches_(x,y) = count_exclusive_matches(ax,ay,rx,ry);
+	}
+
+	// complete symmetric matrices
+	for (size_type x=0; x<K; x++) {
+	    for (size_type y=x+1; y<K; y++) {
+		deviation_(y,x) = deviation_(x,y);
+		compalign_sps_(y,x) = compalign_sps_(x,y);
+		match_sps_(y,x) = match_sps_(x,y);
+		avg_deviation_(y,x) = avg_deviation_(x,y);
+		matches_(y,x) = matches_(x,y);
+		exclusive_matches_(y,x) = exclusive_matches_(x,y);
+	    }
+	}
+    }
+
+    size_type
+    MultipleAlignmentComparison::deviation() const {
+	size_type d=0;
+	for (size_type x=0; x<num_of_rows_; x++) {
+	    for (size_type y=x+1; y<num_of_rows_; y++) {
+		d = std::max(d, deviation_(x,y));
+	    }
+	}
+	return d;
+    }
+
+    double
+    MultipleAlignmentComparison::sps(bool compalign) const {
+	const Matrix<double> &scores = pairwise_sps(compalign);
+
+	// sum up in the order of the serial computation
+	double sps=0.0;
+	for (size_type x=0; x<num_of_rows_; x++) {
+	    for (size_type y=x+1; y<num_of_rows_; y++) {
+		sps += scores(x,y);
+	    }
+	}
+
+	size_t K=num_of_rows_;
+
+	return sps*2.0/K/(K-1);
+    }
+
+    double
+    MultipleAlignmentComparison::avg_deviation_score() const {
+	double score=0.0;
+	for (size_type x=0; x<num_of_rows_; x++) {
+	    for (size_type y=x+1; y<num_of_rows_; y++) {
+		score += avg_deviation_(x,y);
+	    }
+	}
+
+	size_t K=num_of_rows_;
+
+	return score*2.0/K/(K-1);
+    }
+
+    double
+    MultipleAlignmentComparison::cmfinder_realignment_score() const {
+	size_t matches=0;
+	size_t exclusive_matches=0;
+	for (size_type x=0; x<num_of_rows_; x++) {
+	    for (size_type y=x+1; y<num_of_rows_; y++) {
+		matches += matches_(x,y);
+		exclusive_matches += exclusive_matches_(x,y);
+	    }
+	}
+	return exclusive_matches / (double)matches;
+    }
+
+    size_type
+    MultipleAlignmentComparison::deviation2(const AlignmentRowIndex &a1,
+					    const AlignmentRowIndex &a2,
+					    const AlignmentRowIndex &ref1,
+					    const AlignmentRowIndex &ref2) {
+	// A cut c of a pairwise alignment is the pair of positions
+	// (i(c),j(c)); both coordinates are non-decreasing in c.
+	//
+	// For a cut (i1,j1) of a, the cuts c2 of ref with
+	// i(c2)<=i1 and j(c2)<=j1 form a prefix 0..lo of the cuts; there
+	// the distance is non-increasing. The cuts with i(c2)>=i1 and
+	// j(c2)>=j1 form a suffix hi..len; there the distance is
+	// non-decreasing. For all cuts strictly in between, the
+	// distance is |(i(c2)-j(c2)) - (i1-j1)| where the sign is the same
+	// for all of them. Since lo and hi are non-decreasing in c1,
+	// the minimum and maximum of i(c2)-j(c2) over this window are
+	// maintained in monotone queues.
+
+	const long int len_ref = ref1.length();
+
+	size_type d=0;
+
+	long int lo=0;
+	long int hi=0;
+	long int next=0; // next cut to enter the window
+
+	std::deque<long int> minq;
+	std::deque<long int> maxq;
+
+	for (size_type c1=0; c1<=a1.length(); c1++) {
+	    const long int i1 = a1.residues_upto(c1);
+	    const long int j1 = a2.residues_upto(c1);
+
+	    while (lo+1<=len_ref
+		   && (long int)ref1.residues_upto(lo+1)<=i1
+		   && (long int)ref2.residues_upto(lo+1)<=j1) {
+		lo++;
+	    }
+	    while (hi<=len_ref
+		   && !((long int)ref1.residues_upto(hi)>=i1
+			&& (long int)ref2.residues_upto(hi)>=j1)) {
+		hi++;
+	    }
+
+	    size_type dprime =
+		labs(i1-(long int)ref1.residues_upto(lo))
+		+labs(j1-(long int)ref2.residues_upto(lo));
+
+	    if (hi<=len_ref) {
+		dprime = std::min(dprime,
+				  (size_type)(labs(i1-(long int)ref1.residues_upto(hi))
+					      +labs(j1-(long int)ref2.residues_upto(hi))));
+	    }
+
+	    // window lo+1..hi-1
+	    for (; next<hi; next++) {
+		const long int diff =
+		    (long int)ref1.residues_upto(next)
+		    - (long int)ref2.residues_upto(next);
+		while (!minq.empty()
+		       && ((long int)ref1.residues_upto(minq.back())
+			   - (long int)ref2.residues_upto(minq.back())) >= diff) {
+		    minq.pop_back();
+		}
+		minq.push_back(next);
+		while (!maxq.empty()
+		       && ((long int)ref1.residues_upto(maxq.back())
+			   - (long int)ref2.residues_upto(maxq.back())) <= diff) {
+		    maxq.pop_back();
+		}
+		maxq.push_back(next);
+	    }
+	    while (!minq.empty() && minq.front()<=lo) minq.pop_front();
+	    while (!maxq.empty() && maxq.front()<=lo) maxq.pop_front();
+
+	    if (!minq.empty()) {
+		const long int diff1 = i1-j1;
+		// decide the sign by any cut of the window
+		if ((long int)ref1.residues_upto(minq.front()) > i1) {
+		    const long int c2=minq.front();
+		    dprime = std::min(dprime,
+				      (size_type)(((long int)ref1.residues_upto(c2)
+						   - (long int)ref2.residues_upto(c2))
+						  - diff1));
+		} else {
+		    const long int c2=maxq.front();
+		    dprime = std::min(dprime,
+				      (size_type)(diff1
+						  - ((long int)ref1.residues_upto(c2)
+						     - (long int)ref2.residues_upto(c2))));
+		}
+	    }
+
+	    d=std::max(d,dprime);
+	}
+	return d;
+    }
+
+    size_type
+    MultipleAlignmentComparison::count_matches(const AlignmentRowIndex &a1,
+					       const AlignmentRowIndex &a2) {
+	assert(a1.length()==a2.length());
+
+	size_type matches=0;
+	for (size_type i=1; i<=a1.length_wogaps(); i++) {
+	    if (!a2.is_gap(a1.pos_to_col(i))) {
+		matches++;
+	    }
+	}
+	return matches;
+    }
+
+    size_type
+    MultipleAlignmentComparison::pairwise_match_score(const AlignmentRowIndex &a1,
+						      const AlignmentRowIndex &a2,
+						      const AlignmentRowIndex &ref1,
+						      const AlignmentRowIndex &ref2,
+						      bool score_common_gaps) {
+	assert(a1.length()==a2.length());
+	assert(ref1.length()==ref2.length());
+	assert(a1.length_wogaps()==ref1.length_wogaps());
+
+	size_type s=0;
+	for (size_type i=1; i<=a1.length_wogaps(); i++) {
+	    const pos_type col = a1.pos_to_col(i);
+	    const pos_type ref_col = ref1.pos_to_col(i);
+
+	    const bool gap = a2.is_gap(col);
+	    const bool ref_gap = ref2.is_gap(ref_col);
+
+	    // add one to score, if position i of the first sequence is
+	    // matched to the same position (or optionally, gap) by both
+	    // alignments
+	    if (gap) {
+		if (score_common_gaps && ref_gap) {
+		    s++;
+		}
+	    } else if (!ref_gap
+		       && a2.residues_upto(col) == ref2.residues_upto(ref_col)) {
+		s++;
+	    }
+	}
+	return s;
+    }
+
+    size_type
+    MultipleAlignmentComparison::count_exclusive_matches(const AlignmentRowIndex &a1,
+							 const AlignmentRowIndex &a2,
+							 const AlignmentRowIndex &ref1,
+							 const AlignmentRowIndex &ref2) {
+	assert(a1.length()==a2.length());
+	assert(ref1.length()==ref2.length());
+	assert(a1.length_wogaps()==ref1.length_wogaps());
+
+	size_type matches=0;
+	for (size_type i=1; i<=a1.length_wogaps(); i++) {
+	    const pos_type col = a1.pos_to_col(i);
+	    const pos_type ref_col = ref1.pos_to_col(i);
+
+	    if (!a2.is_gap(col)
+		&& (ref2.is_gap(ref_col)
+		    || a2.residues_upto(col) != ref2.residues_upto(ref_col))) {
+		matches++;
+	    }
+	}
+	return matches;
+    }
+
+    double
+    MultipleAlignmentComparison::pairwise_deviation_score(const AlignmentRowIndex &a1,
+							  const AlignmentRowIndex &a2,
+							  const AlignmentRowIndex &ref1,
+							  const AlignmentRowIndex &ref2) {
+	assert(a1.length()==a2.length());
+	assert(ref1.length()==ref2.length());
+	assert(a1.length_wogaps()==ref1.length_wogaps());
+
+	double s=0.0;
+
+	// positions matched to position i-1
+	long int prev=-1;
+	long int prev_ref=-1;
+
+	for (size_type i=1; i<=a1.length_wogaps(); i++) {
+	    // position of a2 that is matched to i or after that i is deleted
+	    const long int j = a2.residues_upto(a1.pos_to_col(i));
+	    const long int j_ref = ref2.residues_upto(ref1.pos_to_col(i));
+
+	    double j_A = j + ((j==prev)?0.5:0);
+	    double j_Ref = j_ref + ((j_ref==prev_ref)?0.5:0);
+
+	    s += fabs(j_A-j_Ref);
+
+	    prev=j;
+	    prev_ref=j_ref;
+	}
+	return s;
+    }
+
+} // end namespace LocARNA
@@ -0,0 +1,235 @@
+#ifndef LOCARNA_MULTIPLE_ALIGNMENT_COMPARISON_HH
+#define LOCARNA_MULTIPLE_ALIGNMENT_COMPARISON_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <vector>
+
+#include "aux.hh"
+#include "matrix.hh"
+
+namespace LocARNA {
+
+    class MultipleAlignment;
+    class string1;
+
+    /**
+     * @brief Column/residue index of one alignment row
+     *
+     * Precomputes the mapping between alignment columns and sequence
+     * positions of a row, such that both directions are answered in
+     * constant time. Columns and positions are 1-based.
+     */
+    class AlignmentRowIndex {
+	//! number of non-gap symbols in columns 1..col (index 0..length)
+	std::vector<pos_type> col_to_pos_;
+	//! column of sequence position (index 0..length_wogaps)
+	std::vector<pos_type> pos_to_col_;
+    public:
+	/**
+	 * @brief Construct from alignment row
+	 * @param row alignment string of the row
+	 */
+	explicit
+	AlignmentRowIndex(const string1 &row);
+
+	//! @brief number of columns
+	pos_type
+	length() const { return col_to_pos_.size()-1; }
+
+	//! @brief length without gaps
+	pos_type
+	length_wogaps() const { return pos_to_col_.size()-1; }
+
+	/**
+	 * @brief number of residues up to column
+	 * @param col column (0..length)
+	 * @return number of non-gap symbols in columns 1..col
+	 */
+	pos_type
+	residues_upto(pos_type col) const { return col_to_pos_[col]; }
+
+	/**
+	 * @brief test for gap
+	 * @param col column (1..length)
+	 * @return whether the row has a gap in column col
+	 */
+	bool
+	is_gap(pos_type col) const { return col_to_pos_[col]==col_to_pos_[col-1]; }
+
+	/**
+	 * @brief map sequence position to column
+	 * @param pos sequence position (1..length_wogaps)
+	 * @return column of position pos
+	 */
+	pos_type
+	pos_to_col(pos_type pos) const { return pos_to_col_[pos]; }
+    };
+
+    /**
+     * @brief Comparison of a multiple alignment to a reference alignment
+     *
+     * Computes deviation, sum-of-pairs scores, average deviation score
+     * and cmfinder realignment score of an alignment with respect to
+     * a reference alignment in a single pass over all pairs of
+     * rows. The rows of both alignments are indexed once; the pairs
+     * are evaluated in parallel if OpenMP is available.
+     *
+     * Besides the total scores, the pairwise scores are available as
+     * matrices that are indexed by the rows of the test alignment.
+     *
+     * @see MultipleAlignment::sps(), MultipleAlignment::deviation(),
+     * MultipleAlignment::avg_deviation_score(),
+     * MultipleAlignment::cmfinder_realignment_score()
+     */
+    class MultipleAlignmentComparison {
+    public:
+	//! vector of row indices
+	typedef std::vector<AlignmentRowIndex> row_index_vec_t;
+
+    private:
+	size_type num_of_rows_; //!< number of rows of the test alignment
+
+	Matrix<size_type> deviation_; //!< pairwise deviation
+	Matrix<double> match_sps_; //!< pairwise match sps
+	Matrix<double> compalign_sps_; //!< pairwise compalign sps
+	Matrix<double> avg_deviation_; //!< pairwise average deviation score
+	Matrix<size_type> matches_; //!< pairwise number of matches in test alignment
+	Matrix<size_type> exclusive_matches_; //!< pairwise number of test matches not in reference
+
+    public:
+	/**
+	 * @brief Construct and compute comparison
+	 *
+	 * @param ma multiple alignment (test alignment)
+	 * @param ref reference alignment
+	 *
+	 * @pre the sequences of ma have to occur in ref
+	 * @throw failure if a sequence of ma does not occur in ref
+	 */
+	MultipleAlignmentComparison(const MultipleAlignment &ma,
+				    const MultipleAlignment &ref);
+
+	/**
+	 * @brief Index all rows of a multiple alignment
+	 * @param ma multiple alignment
+	 * @return vector of row indices in the order of rows in ma
+	 */
+	static
+	row_index_vec_t
+	index_rows(const MultipleAlignment &ma);
+
+	//! @brief number of rows of the test alignment
+	size_type
+	num_of_rows() const { return num_of_rows_; }
+
+	/**
+	 * @brief Deviation
+	 * @return maximal pairwise deviation
+	 * @see MultipleAlignment::deviation()
+	 */
+	size_type
+	deviation() const;
+
+	/**
+	 * @brief Sum-of-pairs score
+	 * @param compalign whether to compute score like compalign
+	 * @return sum-of-pairs score
+	 * @see MultipleAlignment::sps()
+	 */
+	double
+	sps(bool compalign=true) const;
+
+	/**
+	 * @brief Average deviation score
+	 * @return average deviation score
+	 * @see MultipleAlignment::avg_deviation_score()
+	 */
+	double
+	avg_deviation_score() const;
+
+	/**
+	 * @brief Cmfinder realignment score
+	 * @return cmfinder realignment score
+	 * @see MultipleAlignment::cmfinder_realignment_score()
+	 */
+	double
+	cmfinder_realignment_score() const;
+
+	//! @brief matrix of pairwise deviations
+	const Matrix<size_type> &
+	pairwise_deviation() const { return deviation_; }
+
+	/**
+	 * @brief matrix of pairwise sum-of-pairs scores
+	 * @param compalign whether to return compalign scores
+	 */
+	const Matrix<double> &
+	pairwise_sps(bool compalign=true) const {
+	    return compalign ? compalign_sps_ : match_sps_;
+	}
+
+	//! @brief matrix of pairwise average deviation scores
+	const Matrix<double> &
+	pairwise_avg_deviation() const { return avg_deviation_; }
+
+    private:
+
+	/**
+	 * @brief Deviation of a pairwise alignment from a pairwise
+	 * reference alignment
+	 *
+	 * Computes the maximum over all cuts of the first alignment of
+	 * the minimal distance to a cut of the reference. Cuts of both
+	 * alignments are monotone, which allows to maintain the
+	 * candidates of the minimum in a sliding window.
+	 *
+	 * @note time O(length(a1)+length(ref1))
+	 */
+	static
+	size_type
+	deviation2(const AlignmentRowIndex &a1,
+		   const AlignmentRowIndex &a2,
+		   const AlignmentRowIndex &ref1,
+		   const AlignmentRowIndex &ref2);
+
+	/**
+	 * @brief Count common matches (and optionally gaps) of position
+	 * of a1 in the two pairwise alignments
+	 */
+	static
+	size_type
+	pairwise_match_score(const AlignmentRowIndex &a1,
+			     const AlignmentRowIndex &a2,
+			     const AlignmentRowIndex &ref1,
+			     const AlignmentRowIndex &ref2,
+			     bool score_common_gaps);
+
+	//! @brief count matches in pairwise alignment
+	static
+	size_type
+	count_matches(const AlignmentRowIndex &a1,
+		      const AlignmentRowIndex &a2);
+
+	//! @brief count matches of a that do not occur in ref
+	static
+	size_type
+	count_exclusive_matches(const AlignmentRowIndex &a1,
+				const AlignmentRowIndex &a2,
+				const AlignmentRowIndex &ref1,
+				const AlignmentRowIndex &ref2);
+
+	//! @brief average deviation score of pairwise alignment
+	static
+	double
+	pairwise_deviation_score(const AlignmentRowIndex &a1,
+				 const AlignmentRowIndex &a2,
+				 const AlignmentRowIndex &ref1,
+				 const AlignmentRowIndex &ref2);
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_MULTIPLE_ALIGNMENT_COMPARISON_HH
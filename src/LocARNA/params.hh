@@ -138,6 +138,10 @@ namespace LocARNA {
 
 	int multiloop_deletion_; //!< whether to allow aligning an entire branch of a multiloop to gap
 
+	bool score_only_; //!< compute only the optimal score, without keeping traceback state
+
+	bool fast_normalized_; //!< normalized alignment by parallel bracketing of lambda
+
 	const AnchorConstraints *constraints_; //!< anchor constraints
 
 
@@ -267,6 +271,38 @@ namespace LocARNA {
 	AlignerParams &
 	multiloop_deletion(int multiloop_deletion) {multiloop_deletion_=multiloop_deletion; return *this;}
 
+	/**
+	 * @brief set parameter score_only
+	 * @param score_only whether to compute only the score
+	 *
+	 * In score only mode, the aligner drops state that is needed
+	 * only for the traceback; consequently, trace() is not
+	 * available.
+	 *
+	 * @note Only AlignerN and AlignerNN save memory this way (by
+	 * releasing rows of D, IAD and IBD early). Aligner reads all of
+	 * its matrices for the score, such that it merely disables
+	 * the traceback.
+	 */
+	AlignerParams &
+	score_only(bool score_only) {score_only_=score_only; return *this;}
+
+	/**
+	 * @brief set parameter fast_normalized
+	 * @param fast_normalized whether normalized alignment brackets
+	 * lambda by evaluating several candidates in parallel
+	 *
+	 * In the fast mode, Dinkelbach's iteration is replaced by a
+	 * bracketing of the optimal normalized score, which starts
+	 * from the result of the previous normalized alignment of the
+	 * aligner and stops as soon as bounds certify the optimum
+	 * (in integer scores). Each additional thread works on a copy
+	 * of the alignment matrices. The certified optimum can be
+	 * higher than the fixed point of the standard iteration.
+	 */
+	AlignerParams &
+	fast_normalized(bool fast_normalized) {fast_normalized_=fast_normalized; return *this;}
+
 
 	/**
 	 * @brief set parameter constraints
@@ -298,6 +334,8 @@ namespace LocARNA {
 	    min_bm_prob_(0),	   
 	    stacking_(false),
 	    track_closing_bp_(false),
+	    score_only_(false),
+	    fast_normalized_(false),
 	    constraints_(0L)
 	{}
 
@@ -11,7 +11,9 @@ namespace LocARNA {
                              )
         : 
         md_(),
-        stacking_(stacking)
+        stacking_(stacking),
+        window_size_(0),
+        ensemble_cache_()
     {
         vrna_md_set_default(&md_);
         if (noLP) {md_.noLP=1;}
@@ -10,6 +10,7 @@ extern "C" {
 }
 
 #include <limits>
+#include <string>
 #include "aux.hh"
 
 
@@ -31,6 +32,8 @@ namespace LocARNA {
     class PFoldParams {
 	vrna_md_t md_; //!< ViennaRNA model details
 	int stacking_; //!< calculate stacking probabilities
+	size_t window_size_; //!< window size for local folding (0: global)
+	std::string ensemble_cache_; //!< ensemble cache directory (empty: off)
     public:
 	/** 
 	 * Construct with all parameters
@@ -100,6 +103,65 @@ namespace LocARNA {
 	 */
 	int dangling() const {return md_.dangles;}
 
+	/**
+	 * @brief Set window size for local folding
+	 *
+	 * @param window_size size of the sliding windows; 0 turns
+	 * local folding off
+	 *
+	 * In local folding mode (like RNAplfold), probabilities of
+	 * sequences longer than the window size are averaged over
+	 * overlapping windows, where the maximum base pair span is
+	 * limited to the window size.
+	 *
+	 * @see RnaData::init_from_local_folding()
+	 */
+	void
+	set_window_size(size_t window_size) {window_size_=window_size;}
+
+	/**
+	 * @brief Get window size for local folding
+	 *
+	 * @return window size; 0 if local folding is off
+	 */
+	size_t
+	window_size() const {return window_size_;}
+
+	/**
+	 * @brief Check for local folding
+	 *
+	 * @param length sequence length
+	 * @return whether a sequence of the given length is folded
+	 * in windows
+	 */
+	bool
+	local_folding(size_t length) const {
+	    return window_size_>0 && length>window_size_;
+	}
+
+	/**
+	 * @brief Set ensemble cache directory
+	 *
+	 * @param dir directory for cached probabilities; empty
+	 * string turns caching off
+	 *
+	 * When reading input without (sufficient) probabilities,
+	 * RnaData and ExtRnaData look up the probabilities in this
+	 * directory before folding and store them after folding.
+	 *
+	 * @see EnsembleCache
+	 */
+	void
+	set_ensemble_cache(const std::string &dir) {ensemble_cache_=dir;}
+
+	/**
+	 * @brief Get ensemble cache directory
+	 *
+	 * @return directory; empty if caching is off
+	 */
+	const std::string &
+	ensemble_cache() const {return ensemble_cache_;}
+
     };
 
 
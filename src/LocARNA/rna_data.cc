@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <ctype.h> // import isspace
+#include <string.h> // import strstr, memmove
+#include <locale.h> // import localeconv
 
 #include <math.h> // import log
 
@@ -17,6 +19,8 @@
 #include "ext_rna_data_impl.hh"
 #include "rna_structure.hh"
 #include "base_pair_filter.hh"
+#include "ensemble_cache.hh"
+#include "input_file.hh"
 
 #include "LocARNA/global_stopwatch.hh"
 
@@ -39,6 +43,8 @@ namespace LocARNA {
 	if (max_bps_length_ratio > 0.0) {
 	    pimpl_->drop_worst_bps(max_bps_length_ratio*pimpl_->sequence_.length());
 	}
+
+	pimpl_->init_arc_index();
     }
     
     RnaData::RnaData(const std::string &filename,
@@ -52,21 +58,42 @@ namespace LocARNA {
 				 )) {
 	bool complete=
 	    read_autodetect(filename, pfoldparams);
+
+	std::string cache_file;
+	if (!complete && !pfoldparams.ensemble_cache().empty()) {
+	    cache_file = EnsembleCache(pfoldparams.ensemble_cache())
+		.filename(ensemble_cache_key(pfoldparams));
+	    complete = read_ensemble_cache(cache_file);
+	    if (complete) cache_file="";
+	}
     	
 	if (!complete) {
-	    // recompute all probabilities
-            RnaEnsemble
-		rna_ensemble(pimpl_->sequence_,
-			     pfoldparams,false,true); // use given parameters, no in loop, use alifold
-	    
-	    // initialize from RnaEnsemble; note: method is virtual
-	    init_from_rna_ensemble(rna_ensemble,
-				   pfoldparams);
+	    if (pfoldparams.local_folding(pimpl_->sequence_.length())) {
+		// fold in windows (for long sequences)
+		init_from_local_folding(pfoldparams);
+	    } else {
+		// recompute all probabilities
+		RnaEnsemble
+		    rna_ensemble(pimpl_->sequence_,
+				 pfoldparams,false,true); // use given parameters, no in loop, use alifold
+		
+		// initialize from RnaEnsemble; note: method is virtual
+		init_from_rna_ensemble(rna_ensemble,
+				       pfoldparams);
+	    }
+	}
+
+	if (!cache_file.empty()) {
+	    // the pp writers iterate over the base pair index
+	    pimpl_->init_arc_index();
+	    write_ensemble_cache(cache_file);
 	}
 	
 	if (max_bps_length_ratio > 0.0) {
 	    pimpl_->drop_worst_bps(max_bps_length_ratio*pimpl_->sequence_.length());
 	}
+
+	pimpl_->init_arc_index();
     }
     
     // do almost nothing
@@ -128,6 +155,7 @@ namespace LocARNA {
 				   p_expA,
 				   p_expB,
 				   rna_dataA.has_stacking() && rna_dataB.has_stacking());
+	init_arc_index();
     }
 
 
@@ -162,15 +190,34 @@ namespace LocARNA {
 
 	bool complete=
 	    read_autodetect(filename,pfoldparams);
+
+	std::string cache_file;
+	if (!complete && !pfoldparams.ensemble_cache().empty()) {
+	    cache_file = EnsembleCache(pfoldparams.ensemble_cache())
+		.filename(ensemble_cache_key(pfoldparams));
+	    complete = read_ensemble_cache(cache_file);
+	    if (complete) cache_file="";
+	}
     	
 	if (!complete) {
-	    // recompute all probabilities
-            RnaEnsemble
-		rna_ensemble(sequence(),
-			     pfoldparams,true,true); // use given parameters, in-loop, use alifold
-	    
-	    // initialize
-	    init_from_rna_ensemble(rna_ensemble,pfoldparams);
+	    if (pfoldparams.local_folding(length())) {
+		// fold in windows (for long sequences)
+		init_from_local_folding(pfoldparams);
+	    } else {
+		// recompute all probabilities
+		RnaEnsemble
+		    rna_ensemble(sequence(),
+				 pfoldparams,true,true); // use given parameters, in-loop, use alifold
+		
+		// initialize
+		init_from_rna_ensemble(rna_ensemble,pfoldparams);
+	    }
+	}
+
+	if (!cache_file.empty()) {
+	    // the pp writers iterate over the base pair index
+	    pimpl_->init_arc_index();
+	    write_ensemble_cache(cache_file);
 	}
 	
 	if (max_bps_length_ratio > 0.0) {
@@ -183,6 +230,7 @@ namespace LocARNA {
 	    ext_pimpl_->drop_worst_bpil_precise(max_bpil_length_ratio);
 	}
 
+	pimpl_->init_arc_index();
     }
 
     ExtRnaDataImpl::ExtRnaDataImpl(ExtRnaData *self,
@@ -221,7 +269,34 @@ namespace LocARNA {
 	if (max_bpil_length_ratio > 0.0) {
 	    	ext_pimpl_->drop_worst_bpil(max_bpil_length_ratio*length());
 	}
-	
+
+	// the base pairs were initialized again
+	pimpl_->init_arc_index();
+    }
+
+    // "consensus" constructor
+    ExtRnaData::ExtRnaData(const ExtRnaData &rna_dataA,
+			   const ExtRnaData &rna_dataB,
+			   const Alignment &alignment,
+			   double p_expA,
+			   double p_expB,
+			   bool only_local
+			   )
+	:
+	RnaData(rna_dataA,
+		rna_dataB,
+		alignment,
+		p_expA,
+		p_expB,
+		only_local),
+	ext_pimpl_(new ExtRnaDataImpl(this,
+				      0.0,
+				      0.0)) {
+	ext_pimpl_->init_as_consensus(alignment.alignment_edges(only_local),
+				      rna_dataA,
+				      rna_dataB,
+				      p_expA,
+				      p_expB);
     }
 
     ExtRnaData::~ExtRnaData() {
@@ -231,8 +306,8 @@ namespace LocARNA {
     bool
     RnaData::read_autodetect(const std::string &filename,
 			     const PFoldParams &pfoldparams) {
-	bool failed=true;  //flag for signalling a failed attempt to
-			   //read a certain file format
+	bool failed=false;  //flag for signalling a failed attempt to
+			    //read the file
 	
 	bool sequence_only=false; 
 	// does the file format contain only sequence information or
@@ -240,116 +315,76 @@ namespace LocARNA {
 
 	pimpl_->has_stacking_ = pfoldparams.stacking();
 
-	// try dot plot ps format
-	if (failed) {
-	    sequence_only=false;
-	    failed=false;
+	// open the input only once (and support stdin and gzip)
+	InputFile input(filename);
+	std::istream &in = input.stream();
+	
+	// determine the format from the first (non-empty) line; then,
+	// parse the input from its beginning
+	std::string first_line;
+	getline(in,first_line);
+	std::string line = first_line;
+	if (line.empty() || isspace(line[0])) {
+	    get_nonempty_line(in,line);
+	}
+	input.rewind();
+
+	// whether to read a clustal or stockholm alignment
+	bool alignment=false;
+	MultipleAlignment::FormatType::type alignment_format
+	    = MultipleAlignment::FormatType::CLUSTAL;
+
+	if (first_line=="%!PS-Adobe-3.0 EPSF-3.0") {
+	    // dot plot ps format
 	    try {
-		read_ps(filename);
-		if (!pimpl_->sequence_.is_proper() || pimpl_->sequence_.empty() ) {
-		    failed=true;
-		}
+		read_ps(in);
 	    } catch (wrong_format_failure &f) {
 		failed=true;
 	    }
-	}
-
-	// try pp 2.0
-	if (failed) {
-	    sequence_only=false;
-	    failed=false;
+	} else if (has_prefix(first_line,"#PP 2")) {
+	    // pp 2.0
 	    try {
-		read_pp(filename);
-		if (!pimpl_->sequence_.is_proper() || pimpl_->sequence_.empty() ) {
-		    failed=true;
-		}
+		read_pp(in);
 	    } catch (wrong_format_failure &f) {
 		failed=true;
 	    }
-	}
-	
-
-	// try fasta format
-	if (failed) {
+	} else if (has_prefix(first_line,">")) {
+	    // fasta format
 	    sequence_only = true;
-	    failed=false;
 	    try {
-		MultipleAlignment ma(filename, MultipleAlignment::FormatType::FASTA);
-		pimpl_->sequence_ = ma;
-		// even if reading does not fail, we still want to
-		// make sure that the result is reasonable. Otherwise,
-		// we assume that the file is in a different format.
-		if (!pimpl_->sequence_.is_proper() || pimpl_->sequence_.empty() ) {
-		    failed=true;
-		}
+		pimpl_->sequence_ = MultipleAlignment(in, MultipleAlignment::FormatType::FASTA);
 	    } catch (failure &f) {
 		failed=true;
 	    }
-	}
-	
-	// try old pp
-	if (failed) {
-	    sequence_only=false;
-	    failed=false;
+	} else if (has_prefix(line,"# STOCKHOLM 1.")) {
+	    alignment=true;
+	    alignment_format = MultipleAlignment::FormatType::STOCKHOLM;
+	} else if (has_prefix(line,"CLUSTAL")) {
+	    alignment=true;
+	} else {
+	    // the old pp format and clustal format without header
+	    // cannot be told apart by their first lines; try old pp
 	    try {
-		read_old_pp(filename);
+		read_old_pp(in);
 		if (!pimpl_->sequence_.is_proper() || pimpl_->sequence_.empty() ) {
-		    failed=true;
+		    alignment=true;
 		}
 	    } catch (wrong_format_failure &f) {
-		failed=true;
+		alignment=true;
 	    }
-	}
-        
-        // try stockholm format
-        if (failed) {
-            sequence_only=true;
-	    failed=false;
-	    try {
-		MultipleAlignment ma(filename, MultipleAlignment::FormatType::STOCKHOLM);
-                
-		pimpl_->sequence_ = ma;
-	    	// even if reading does not fail, we still want to
-		// make sure that the result is reasonable. Otherwise,
-		// we assume that the file is in a different format.
-		if (!pimpl_->sequence_.is_proper() || pimpl_->sequence_.empty() ) {
-		    failed=true;
-		}
-
-                // handle potential fixed structure in MA
-		if (!failed) {
-                    typedef MultipleAlignment::AnnoType TA;
-
-		    if (ma.has_annotation(TA::fixed_structure)) {
-                        RnaStructure structure( ma.annotation(TA::fixed_structure).single_string() );
-                        structure.
-                            apply_bpfilter(BasePairFilter::
-                                           SpanRange(0, pfoldparams.max_bp_span()));
-                        if (pfoldparams.noLP()) {
-                            structure.remove_lonely_pairs();
-                        }
-                        init_from_fixed_structure(structure, pfoldparams);
-
-                        sequence_only=false;
-		    }
-		}
-
-            } catch (wrong_format_failure &f) {
-                failed=true;
-            }catch (syntax_error_failure &f) {
-		throw failure((std::string)"RnaData: Cannot read input data from stockholm file.\n\t"+f.what());
-	    } catch (failure &f) {
-		failed=true;
+	    if (alignment) {
+		input.rewind();
 	    }
-        }
+	}
 
-	// try clustal format
-	if (failed) {
+	if (alignment) {
 	    sequence_only=true;
-	    failed=false;
+	    const std::string format_name =
+		alignment_format==MultipleAlignment::FormatType::STOCKHOLM
+		? "stockholm"
+		: "clustal";
 	    try {
-		// std::cerr << "Try reading clustal "<<filename<<" ..."<<std::endl;
-		MultipleAlignment ma(filename, MultipleAlignment::FormatType::CLUSTAL);
+		MultipleAlignment ma(in, alignment_format);
 
 		pimpl_->sequence_ = ma;
 	    	// even if reading does not fail, we still want to
@@ -378,13 +413,17 @@ namespace LocARNA {
 		}
 		
 	    } catch (syntax_error_failure &f) {
-		throw failure((std::string)"RnaData: Cannot read input data from clustal file.\n\t"+f.what());
-	    }
-	    catch (failure &f) {
+		throw failure("RnaData: Cannot read input data from "+format_name+" file.\n\t"+f.what());
+	    } catch (failure &f) {
 		failed=true;
 	    }
-	    // if (failed) std::cerr << "  ... did not succeed."<<std::endl;
-	    // else std::cerr << "  ... success."<<std::endl;
+	}
+
+	// even if reading does not fail, we still want to make sure
+	// that the result is reasonable
+	if (!failed
+	    && (!pimpl_->sequence_.is_proper() || pimpl_->sequence_.empty())) {
+	    failed=true;
 	}
 	
 	if (failed) {
@@ -697,6 +736,383 @@ namespace LocARNA {
 	return;
     } // end method init_from_ext_rna_ensemble
 
+    LocalFoldingWindows::LocalFoldingWindows(size_type length,
+					     size_type window_size,
+					     size_type span)
+	: window_size_(std::min(window_size,length)),
+	  span_(std::min(span,window_size_)),
+	  starts_() {
+	assert(window_size_>0);
+
+	// shift by about half of the slack, such that base pairs of
+	// maximal span are still contained in at least one window
+	size_type step = std::max((size_type)1, (window_size_-span_+1)/2);
+
+	size_type last = length-window_size_+1;
+	for (size_type start=1; start<last; start+=step) {
+	    starts_.push_back(start);
+	}
+	starts_.push_back(last);
+    }
+
+    size_type
+    LocalFoldingWindows::count(size_type i, size_type j) const {
+	assert(i<=j);
+	// windows starting in max(1,j-window_size_+1)..i
+	size_type first = (j>=window_size_) ? j-window_size_+1 : 1;
+	if (first>i) return 0;
+	return
+	    std::upper_bound(starts_.begin(),starts_.end(),i)
+	    - std::lower_bound(starts_.begin(),starts_.end(),first);
+    }
+
+    void
+    RnaData::init_from_local_folding(const PFoldParams &pfoldparams) {
+	LocalFoldingWindows windows(length(),
+				    pfoldparams.window_size(),
+				    pfoldparams.max_bp_span());
+	PFoldParams window_params(pfoldparams.noLP(),
+				  pfoldparams.stacking(),
+				  windows.span(),
+				  pfoldparams.dangling());
+
+	pimpl_->arc_probs_.clear();
+	pimpl_->arc_2_probs_.clear();
+
+	// fold one window after the other, such that only the
+	// McCaskill matrices of a single window are kept
+	for (std::vector<size_type>::const_iterator it=windows.starts().begin();
+	     windows.starts().end()!=it; ++it) {
+	    RnaEnsemble
+		rna_ensemble(pimpl_->window_sequence(*it,windows.window_size()),
+			     window_params,false,true);
+	    RnaData window(rna_ensemble, pimpl_->p_bpcut_, 0, window_params);
+	    pimpl_->add_local_window(window, *it-1);
+	}
+	
+	pimpl_->finish_local_folding(windows,pfoldparams);
+    }
+
+    void
+    ExtRnaData::init_from_local_folding(const PFoldParams &pfoldparams) {
+	LocalFoldingWindows windows(length(),
+				    pfoldparams.window_size(),
+				    pfoldparams.max_bp_span());
+	PFoldParams window_params(pfoldparams.noLP(),
+				  pfoldparams.stacking(),
+				  windows.span(),
+				  pfoldparams.dangling());
+
+	pimpl_->arc_probs_.clear();
+	pimpl_->arc_2_probs_.clear();
+	ext_pimpl_->arc_in_loop_probs_.clear();
+	ext_pimpl_->unpaired_in_loop_probs_.clear();
+	
+	for (std::vector<size_type>::const_iterator it=windows.starts().begin();
+	     windows.starts().end()!=it; ++it) {
+	    RnaEnsemble
+		rna_ensemble(pimpl_->window_sequence(*it,windows.window_size()),
+			     window_params,true,true);
+	    ExtRnaData window(rna_ensemble,
+			      pimpl_->p_bpcut_,
+			      ext_pimpl_->p_bpilcut_,
+			      ext_pimpl_->p_uilcut_,
+			      0, 0, 0,
+			      window_params);
+	    pimpl_->add_local_window(window, *it-1);
+	    ext_pimpl_->add_local_window(window, *it-1);
+	}
+	
+	pimpl_->finish_local_folding(windows,pfoldparams);
+	ext_pimpl_->finish_local_folding(windows);
+    }
+
+    MultipleAlignment
+    RnaDataImpl::window_sequence(size_type start, size_type window_size) const {
+	if (sequence_.has_annotation(MultipleAlignment::AnnoType::structure)) {
+	    throw failure("Structure constraints are not supported in local folding.");
+	}
+	
+	MultipleAlignment window;
+	for (size_type row=0; row<sequence_.num_of_rows(); ++row) {
+	    const MultipleAlignment::SeqEntry &entry = sequence_.seqentry(row);
+	    window.append(MultipleAlignment::SeqEntry(entry.name(),
+						      entry.seq().str().substr(start-1,window_size)));
+	}
+	return window;
+    }
+
+    void
+    RnaDataImpl::add_local_window(const RnaData &window, size_type offset) {
+	const RnaDataImpl &w = *window.pimpl_;
+	for (arc_prob_matrix_t::const_iterator it=w.arc_probs_.begin();
+	     w.arc_probs_.end()!=it; ++it) {
+	    arc_probs_.ref(it->first.first+offset, it->first.second+offset)
+		+= it->second;
+	}
+	for (arc_prob_matrix_t::const_iterator it=w.arc_2_probs_.begin();
+	     w.arc_2_probs_.end()!=it; ++it) {
+	    arc_2_probs_.ref(it->first.first+offset, it->first.second+offset)
+		+= it->second;
+	}
+    }
+
+    void
+    RnaDataImpl::finish_local_folding(const LocalFoldingWindows &windows,
+				      const PFoldParams &pfoldparams) {
+	arc_prob_matrix_t arc_probs(0.0);
+	for (arc_prob_matrix_t::const_iterator it=arc_probs_.begin();
+	     arc_probs_.end()!=it; ++it) {
+	    size_type i = it->first.first;
+	    size_type j = it->first.second;
+	    double p = it->second / windows.count(i,j);
+	    if (p > p_bpcut_) {
+		arc_probs.set(i,j,p);
+	    }
+	}
+	arc_probs_ = arc_probs;
+
+	// stacking probabilities are averaged over the windows
+	// containing the outer base pair
+	arc_prob_matrix_t arc_2_probs(0.0);
+	has_stacking_ = pfoldparams.stacking();
+	if (has_stacking_) {
+	    for (arc_prob_matrix_t::const_iterator it=arc_2_probs_.begin();
+		 arc_2_probs_.end()!=it; ++it) {
+		size_type i = it->first.first;
+		size_type j = it->first.second;
+		double p2 = it->second / windows.count(i,j);
+		if (p2 > p_bpcut_ && arc_probs_(i,j) > 0) {
+		    arc_2_probs.set(i,j,p2);
+		}
+	    }
+	}
+	arc_2_probs_ = arc_2_probs;
+    }
+
+    void
+    ExtRnaDataImpl::add_local_window(const ExtRnaData &window, size_type offset) {
+	const ExtRnaDataImpl &w = *window.ext_pimpl_;
+	size_type ext_w = window.length()+1;
+	size_type ext = self_->length()+1;
+
+	for (arc_prob_matrix_matrix_t::const_iterator it=w.arc_in_loop_probs_.begin();
+	     w.arc_in_loop_probs_.end()!=it; ++it) {
+	    size_type i = it->first.first;
+	    size_type j = it->first.second;
+	    arc_prob_matrix_t &m = (i==0 && j==ext_w)
+		? arc_in_loop_probs_.ref(0,ext)
+		: arc_in_loop_probs_.ref(i+offset,j+offset);
+	    for (arc_prob_matrix_t::const_iterator it2=it->second.begin();
+		 it->second.end()!=it2; ++it2) {
+		m.ref(it2->first.first+offset, it2->first.second+offset)
+		    += it2->second;
+	    }
+	}
+
+	for (arc_prob_vector_matrix_t::const_iterator it=w.unpaired_in_loop_probs_.begin();
+	     w.unpaired_in_loop_probs_.end()!=it; ++it) {
+	    size_type i = it->first.first;
+	    size_type j = it->first.second;
+	    arc_prob_vector_t &v = (i==0 && j==ext_w)
+		? unpaired_in_loop_probs_.ref(0,ext)
+		: unpaired_in_loop_probs_.ref(i+offset,j+offset);
+	    for (arc_prob_vector_t::const_iterator it2=it->second.begin();
+		 it->second.end()!=it2; ++it2) {
+		v[it2->first+offset] += it2->second;
+	    }
+	}
+    }
+
+    void
+    ExtRnaDataImpl::finish_local_folding(const LocalFoldingWindows &windows) {
+	size_type ext = self_->length()+1;
+
+	arc_prob_matrix_matrix_t arc_in_loop_probs(arc_prob_matrix_t(0.0));
+	for (arc_prob_matrix_matrix_t::const_iterator it=arc_in_loop_probs_.begin();
+	     arc_in_loop_probs_.end()!=it; ++it) {
+	    size_type i = it->first.first;
+	    size_type j = it->first.second;
+	    bool external = (i==0 && j==ext);
+	    if (!external && !(self_->pimpl_->arc_probs_(i,j) > 0)) continue;
+
+	    arc_prob_matrix_t m(0.0);
+	    for (arc_prob_matrix_t::const_iterator it2=it->second.begin();
+		 it->second.end()!=it2; ++it2) {
+		size_type ip = it2->first.first;
+		size_type jp = it2->first.second;
+		// in the external loop, average over the windows
+		// containing the inner base pair
+		double p = it2->second / (external
+					  ? windows.count(ip,jp)
+					  : windows.count(i,j));
+		if (p > p_bpilcut_) {
+		    m.set(ip,jp,p);
+		}
+	    }
+	    if (!m.empty()) {
+		arc_in_loop_probs.set(i,j,m);
+	    }
+	}
+	arc_in_loop_probs_ = arc_in_loop_probs;
+
+	arc_prob_vector_matrix_t unpaired_in_loop_probs(arc_prob_vector_t(0.0));
+	for (arc_prob_vector_matrix_t::const_iterator it=unpaired_in_loop_probs_.begin();
+	     unpaired_in_loop_probs_.end()!=it; ++it) {
+	    size_type i = it->first.first;
+	    size_type j = it->first.second;
+	    bool external = (i==0 && j==ext);
+	    if (!external && !(self_->pimpl_->arc_probs_(i,j) > 0)) continue;
+
+	    arc_prob_vector_t v(0.0);
+	    for (arc_prob_vector_t::const_iterator it2=it->second.begin();
+		 it->second.end()!=it2; ++it2) {
+		size_type k = it2->first;
+		double p = it2->second / (external
+					  ? windows.count(k,k)
+					  : windows.count(i,j));
+		if (p > p_uilcut_) {
+		    v[k] = p;
+		}
+	    }
+	    if (!v.empty()) {
+		unpaired_in_loop_probs.set(i,j,v);
+	    }
+	}
+	unpaired_in_loop_probs_ = unpaired_in_loop_probs;
+
+	has_in_loop_probs_=true;
+    }
+
+    void
+    ExtRnaDataImpl::init_as_consensus(const Alignment::edges_t &edges,
+				      const ExtRnaData &rna_dataA,
+				      const ExtRnaData &rna_dataB,
+				      double p_expA,
+				      double p_expB) {
+	size_t rowsA = rna_dataA.sequence().num_of_rows();
+	size_t rowsB = rna_dataB.sequence().num_of_rows();
+
+	p_bpilcut_ =
+	    exp((log(rna_dataA.arc_in_loop_cutoff_prob())*rowsA
+		 + log(rna_dataB.arc_in_loop_cutoff_prob())*rowsB)
+		/ (rowsA+rowsB));
+	p_uilcut_ =
+	    exp((log(rna_dataA.unpaired_in_loop_cutoff_prob())*rowsA
+		 + log(rna_dataB.unpaired_in_loop_cutoff_prob())*rowsB)
+		/ (rowsA+rowsB));
+
+	size_type ext = edges.size()+1;
+	size_type extA = rna_dataA.length()+1;
+	size_type extB = rna_dataB.length()+1;
+
+	// map positions to columns and vice versa; the bounds of the
+	// external loop map to each other
+	std::vector<size_type> colA(extA+1,0);
+	std::vector<size_type> colB(extB+1,0);
+	std::vector<size_type> posA(ext+1,0);
+	std::vector<size_type> posB(ext+1,0);
+	colA[extA] = ext;
+	colB[extB] = ext;
+	posA[ext] = extA;
+	posB[ext] = extB;
+	for (size_type c=0; c<edges.size(); c++) {
+	    if (!edges.first[c].is_gap()) {
+		colA[edges.first[c]] = c+1;
+		posA[c+1] = edges.first[c];
+	    }
+	    if (!edges.second[c].is_gap()) {
+		colB[edges.second[c]] = c+1;
+		posB[c+1] = edges.second[c];
+	    }
+	}
+
+	// entries of A, then entries that occur only in B
+	add_consensus_in_loop_probs(*rna_dataA.ext_pimpl_, colA,
+				    *rna_dataB.ext_pimpl_, posB,
+				    rowsA, rowsB, p_expA, p_expB,
+				    false);
+	add_consensus_in_loop_probs(*rna_dataB.ext_pimpl_, colB,
+				    *rna_dataA.ext_pimpl_, posA,
+				    rowsB, rowsA, p_expB, p_expA,
+				    true);
+
+	has_in_loop_probs_=true;
+    }
+
+    void
+    ExtRnaDataImpl::add_consensus_in_loop_probs(const ExtRnaDataImpl &x,
+						const std::vector<size_type> &col_x,
+						const ExtRnaDataImpl &y,
+						const std::vector<size_type> &pos_y,
+						size_t rows_x,
+						size_t rows_y,
+						double p_exp_x,
+						double p_exp_y,
+						bool skip_shared) {
+	size_type ext_x = col_x.size()-1;
+
+	for (arc_prob_matrix_matrix_t::const_iterator it=x.arc_in_loop_probs_.begin();
+	     x.arc_in_loop_probs_.end()!=it; ++it) {
+	    size_type i = col_x[it->first.first];
+	    size_type j = col_x[it->first.second];
+	    bool external = (it->first.first==0 && it->first.second==ext_x);
+	    if (!external && (i==0 || j==0 || !(self_->arc_prob(i,j) > 0))) continue;
+
+	    // the loop in y is empty if one of its ends is a gap
+	    bool in_y = external || (pos_y[i]!=0 && pos_y[j]!=0);
+	    const arc_prob_matrix_t &m_y = y.arc_in_loop_probs_(pos_y[i],pos_y[j]);
+
+	    for (arc_prob_matrix_t::const_iterator it2=it->second.begin();
+		 it->second.end()!=it2; ++it2) {
+		size_type ip = col_x[it2->first.first];
+		size_type jp = col_x[it2->first.second];
+		if (ip==0 || jp==0) continue;
+
+		double p_y = (in_y && pos_y[ip]!=0 && pos_y[jp]!=0)
+		    ? m_y(pos_y[ip],pos_y[jp])
+		    : 0.0;
+		if (skip_shared && p_y > 0) continue;
+
+		double p = RnaDataImpl::consensus_probability(it2->second, p_y,
+							      rows_x, rows_y,
+							      p_exp_x, p_exp_y,
+							      p_bpilcut_);
+		if (p > p_bpilcut_) {
+		    arc_in_loop_probs_.ref(i,j).set(ip,jp,p);
+		}
+	    }
+	}
+
+	for (arc_prob_vector_matrix_t::const_iterator it=x.unpaired_in_loop_probs_.begin();
+	     x.unpaired_in_loop_probs_.end()!=it; ++it) {
+	    size_type i = col_x[it->first.first];
+	    size_type j = col_x[it->first.second];
+	    bool external = (it->first.first==0 && it->first.second==ext_x);
+	    if (!external && (i==0 || j==0 || !(self_->arc_prob(i,j) > 0))) continue;
+
+	    bool in_y = external || (pos_y[i]!=0 && pos_y[j]!=0);
+	    const arc_prob_vector_t &v_y = y.unpaired_in_loop_probs_(pos_y[i],pos_y[j]);
+
+	    for (arc_prob_vector_t::const_iterator it2=it->second.begin();
+		 it->second.end()!=it2; ++it2) {
+		size_type k = col_x[it2->first];
+		if (k==0) continue;
+
+		double p_y = (in_y && pos_y[k]!=0) ? v_y[pos_y[k]] : 0.0;
+		if (skip_shared && p_y > 0) continue;
+
+		double p = RnaDataImpl::consensus_probability(it2->second, p_y,
+							      rows_x, rows_y,
+							      p_exp_x, p_exp_y,
+							      p_uilcut_);
+		if (p > p_uilcut_) {
+		    unpaired_in_loop_probs_.ref(i,j).set(k,p);
+		}
+	    }
+	}
+    }
+
     bool
     ExtRnaData::inloopprobs_ok() const {
 	return ext_pimpl_->has_in_loop_probs_;
@@ -722,9 +1138,85 @@ namespace LocARNA {
 	return pimpl_->p_bpcut_;
     }
     
+    void
+    RnaDataImpl::init_arc_index() {
+	size_type len = sequence_.length();
+
+	typedef std::pair<arc_prob_matrix_t::key_t, double> entry_t;
+	std::vector<entry_t> arcs;
+	arcs.reserve(arc_probs_.size());
+	for (arc_prob_matrix_t::const_iterator it=arc_probs_.begin();
+	     arc_probs_.end()!=it; ++it) {
+	    assert(it->first.first < it->first.second);
+	    assert(it->first.second <= len);
+	    arcs.push_back(entry_t(it->first,it->second));
+	}
+	// sort by left end, then right end
+	std::sort(arcs.begin(),arcs.end());
+
+	arc_row_.assign(len+2,0);
+	arc_right_.resize(arcs.size());
+	arc_row_probs_.resize(arcs.size());
+	arc_row_joint_probs_.resize(arcs.size());
+	prob_paired_upstream_.assign(len+1,0.0);
+	prob_paired_downstream_.assign(len+1,0.0);
+
+	// the sums are accumulated in order of the partner positions
+	for (size_type k=0; k<arcs.size(); ++k) {
+	    size_type i = arcs[k].first.first;
+	    size_type j = arcs[k].first.second;
+	    double p = arcs[k].second;
+
+	    arc_right_[k] = j;
+	    arc_row_probs_[k] = p;
+	    arc_row_joint_probs_[k] = arc_2_probs_(i,j);
+	    ++arc_row_[i+1];
+
+	    prob_paired_upstream_[i] += p;
+	    prob_paired_downstream_[j] += p;
+	}
+	for (size_type i=1; i<arc_row_.size(); ++i) {
+	    arc_row_[i] += arc_row_[i-1];
+	}
+    }
+
+    size_type
+    RnaDataImpl::arc_index(pos_type i, pos_type j) const {
+	assert(arc_row_.size()==sequence_.length()+2);
+
+	if (i+1 >= arc_row_.size()) return arc_right_.size();
+
+	std::vector<pos_type>::const_iterator row_end = arc_right_.begin()+arc_row_[i+1];
+	std::vector<pos_type>::const_iterator it =
+	    std::lower_bound(arc_right_.begin()+arc_row_[i], row_end, j);
+
+	return (it!=row_end && *it==j) ? (size_type)(it-arc_right_.begin()) : arc_right_.size();
+    }
+
     double 
     RnaData::arc_prob(pos_type i, pos_type j) const {
-	return pimpl_->arc_probs_(i,j);
+	size_type k = pimpl_->arc_index(i,j);
+	return k<pimpl_->arc_right_.size() ? pimpl_->arc_row_probs_[k] : 0.0;
+    }
+
+    std::pair<size_type,size_type>
+    RnaData::sorted_arcs(pos_type i) const {
+	assert(pimpl_->arc_row_.size()==length()+2);
+	if (i+1 >= pimpl_->arc_row_.size()) {
+	    return std::pair<size_type,size_type>(0,0);
+	}
+	return std::pair<size_type,size_type>(pimpl_->arc_row_[i],
+					      pimpl_->arc_row_[i+1]);
+    }
+
+    pos_type
+    RnaData::sorted_arc_right(size_type k) const {
+	return pimpl_->arc_right_[k];
+    }
+
+    double
+    RnaData::sorted_arc_prob(size_type k) const {
+	return pimpl_->arc_row_probs_[k];
     }
     
     RnaData::arc_probs_const_iterator
@@ -740,39 +1232,34 @@ namespace LocARNA {
 
     double
     RnaData::joint_arc_prob(pos_type i, pos_type j) const {
-	return pimpl_->arc_2_probs_(i,j);
+	size_type k = pimpl_->arc_index(i,j);
+	return k<pimpl_->arc_right_.size() ? pimpl_->arc_row_joint_probs_[k] : 0.0;
     }
     
     double 
     RnaData::stacked_arc_prob(pos_type i, pos_type j) const {
-	assert(pimpl_->arc_probs_(i+1,j-1)!=0);
+	assert(arc_prob(i+1,j-1)!=0);
 	
 	return
-	    pimpl_->arc_2_probs_(i,j)
+	    joint_arc_prob(i,j)
 	    /
-	    pimpl_->arc_probs_(i+1,j-1);
+	    arc_prob(i+1,j-1);
     }
 
     double 
     RnaData::prob_paired_upstream(size_type i) const {
-	double prob_paired=0.0;
-	
-	for (size_type j=i+1; j<=length(); j++) {
-	    prob_paired += pimpl_->arc_probs_(i,j); 
-	}
-	
-	return prob_paired;
+	assert(pimpl_->arc_row_.size()==length()+2);
+	return i<pimpl_->prob_paired_upstream_.size()
+	    ? pimpl_->prob_paired_upstream_[i]
+	    : 0.0;
     }
     
     double
     RnaData::prob_paired_downstream(size_type i) const {
-	double prob_paired=0.0;
-	
-	for (size_type j=1; j<i; j++) {
-	    prob_paired += pimpl_->arc_probs_(j,i); 
-	}
-	
-	return prob_paired;
+	assert(pimpl_->arc_row_.size()==length()+2);
+	return i<pimpl_->prob_paired_downstream_.size()
+	    ? pimpl_->prob_paired_downstream_[i]
+	    : 0.0;
     }
     
     double
@@ -817,9 +1304,8 @@ namespace LocARNA {
 	return v_ext[k];
     }
 
-    void RnaData::read_ps(const std::string &filename) {
+    void RnaData::read_ps(std::istream &in) {
 	
-	std::ifstream in(filename.c_str());
 	std::string line;
 		
 	getline(in,line);
@@ -895,7 +1381,7 @@ namespace LocARNA {
 		    //std::cout << i << " " << j << std::endl;
                     
 		    if (! (1<=i && i<j && j<=pimpl_->sequence_.length())) {
-			std::cerr << "WARNING: Input dotplot "<<filename
+			std::cerr << "WARNING: Input dotplot"
                                   <<" contains invalid line " << line
                                   << " (indices out of range)" << std::endl;
 		    } else {
@@ -915,9 +1401,8 @@ namespace LocARNA {
 	}
     } // end read_ps
 
-    void RnaData::read_old_pp(const std::string &filename) {
+    void RnaData::read_old_pp(std::istream &in) {
 	
-	std::ifstream in(filename.c_str());
 	
 	std::string name;
 	std::string seqstr;
@@ -1212,7 +1697,7 @@ namespace LocARNA {
 
         // if base pair i,j was dropped before, ignore its inloop probs
         // (unless i,j is the external pseudo-basepair)
-        if ( !(i==0 && j==self_->length()+1) && self_->arc_prob(i,j)==0.0 ) {
+        if ( !(i==0 && j==self_->length()+1) && self_->pimpl_->arc_probs_(i,j)==0.0 ) {
             std::cerr << "Ignore inloops of bp "<<i<<","<<j<<std::endl;
             return;
         }
@@ -1302,6 +1787,115 @@ namespace LocARNA {
 	
     	return out;
     }
+
+    std::ostream &
+    RnaData::write_pp_exact(std::ostream &out) const {
+	out << "#PP 2.0"
+	    << std::endl
+	    << std::endl;
+	
+	pimpl_->write_pp_sequence(out);
+	pimpl_->write_pp_arc_probabilities(out,0.0,pimpl_->has_stacking_,true);
+	
+	return out;
+    }
+
+    std::ostream &
+    ExtRnaData::write_pp_exact(std::ostream &out) const {
+	RnaData::write_pp_exact(out);
+	ext_pimpl_->write_pp_in_loop_probabilities(out,0.0,0.0,0.0,true);
+	
+	return out;
+    }
+
+    std::string
+    RnaData::ensemble_cache_key(const PFoldParams &pfoldparams) const {
+	typedef MultipleAlignment::AnnoType TA;
+
+	std::ostringstream key;
+	key.precision(17);
+
+	key << "LocARNA ensemble cache 1";
+#ifdef PACKAGE_VERSION
+	key << " " << PACKAGE_VERSION;
+#endif
+	key << std::endl;
+
+	const MultipleAlignment &ma = pimpl_->sequence_;
+	for (MultipleAlignment::const_iterator it=ma.begin(); ma.end()!=it; ++it) {
+	    key << it->seq().str() << std::endl;
+	}
+	if (ma.has_annotation(TA::structure)) {
+	    key << "#S " << ma.annotation(TA::structure).single_string() << std::endl;
+	}
+	if (ma.has_annotation(TA::fixed_structure)) {
+	    key << "#FS " << ma.annotation(TA::fixed_structure).single_string() << std::endl;
+	}
+
+	const vrna_md_t &md = pfoldparams.model_details();
+	key << "noLP " << md.noLP
+	    << " stacking " << pfoldparams.stacking()
+	    << " maxBPspan " << md.max_bp_span
+	    << " dangles " << md.dangles
+	    << " temperature " << md.temperature
+	    << " window " << pfoldparams.window_size()
+	    << std::endl;
+	key << "bpcut " << pimpl_->p_bpcut_ << std::endl;
+
+	return key.str();
+    }
+
+    std::string
+    ExtRnaData::ensemble_cache_key(const PFoldParams &pfoldparams) const {
+	std::ostringstream key;
+	key.precision(17);
+
+	key << RnaData::ensemble_cache_key(pfoldparams)
+	    << "bpilcut " << ext_pimpl_->p_bpilcut_
+	    << " uilcut " << ext_pimpl_->p_uilcut_
+	    << std::endl;
+
+	return key.str();
+    }
+
+    bool
+    RnaData::read_ensemble_cache(const std::string &filename) {
+	std::ifstream in(filename.c_str());
+	if (!in.is_open()) {
+	    return false;
+	}
+
+	MultipleAlignment sequence = pimpl_->sequence_;
+	bool has_stacking = pimpl_->has_stacking_;
+	pimpl_->arc_probs_.clear();
+	pimpl_->arc_2_probs_.clear();
+
+	bool complete;
+	try {
+	    read_pp(in);
+	    complete = inloopprobs_ok()
+		&& pimpl_->has_stacking_ == has_stacking
+		&& pimpl_->sequence_.num_of_rows() == sequence.num_of_rows();
+	    for (size_type i=0; complete && i<sequence.num_of_rows(); ++i) {
+		complete = pimpl_->sequence_.seqentry(i).seq().str()
+		    == sequence.seqentry(i).seq().str();
+	    }
+	} catch (failure &f) {
+	    complete = false;
+	}
+
+	pimpl_->sequence_ = sequence;
+	pimpl_->has_stacking_ = has_stacking;
+
+	return complete;
+    }
+
+    void
+    RnaData::write_ensemble_cache(const std::string &filename) const {
+	std::ostringstream out;
+	write_pp_exact(out);
+	EnsembleCache::write(filename,out.str());
+    }
     
 
     std::ostream &
@@ -1315,32 +1909,97 @@ namespace LocARNA {
     }
 
 
+    //! size of buffers for formatted probabilities
+    static const size_t pp_prob_buf_size=32;
+
     /** 
      * @brief output format for probabilities in pp files
      * use limited precision; use scientific notation if it is shorter
+     *
+     * @param buf buffer of at least pp_prob_buf_size characters
+     * @param prob probability
+     * @param exact if true, use full precision, such that reading
+     * reproduces prob exactly
+     *
+     * @return length of the written string
+     *
+     * @note writes the same as the iostream operators with
+     * precision 3 (or scientific with precision 2, resp. 17 if
+     * exact), but avoids stream construction; the decimal point is
+     * always '.'
      */
-    std::string
-    format_prob(double prob) {
-	std::ostringstream outd;
-	outd.precision(3);
-	outd << prob;
-	
-	if (outd.str().length()<=6) {
-	    return outd.str();
+    static
+    size_t
+    format_prob(char *buf, double prob, bool exact) {
+	int n;
+	if (exact) {
+	    n = snprintf(buf,pp_prob_buf_size,"%.17g",prob);
+	} else {
+	    n = snprintf(buf,pp_prob_buf_size,"%.3g",prob);
+	    if (n>6) {
+		n = snprintf(buf,pp_prob_buf_size,"%.2e",prob);
+		char *e = strstr(buf,"e-0");
+		if (e!=NULL) {
+		    memmove(e+2,e+3,strlen(e+3)+1);
+		    n--;
+		}
+	    }
 	}
 
-	std::ostringstream outs;
-	outs.setf( std::ios::scientific, std:: ios::floatfield );
-	outs.precision(2);
-	outs << prob;
-	
-	std::string s=outs.str();
-	size_t pos = s.find("e-0");
-	if (pos!=std::string::npos) {
-	    s.replace(pos,3,"e-");
+	// independent of the locale's decimal point
+	const char point = *localeconv()->decimal_point;
+	if (point!='.') {
+	    std::replace(buf,buf+n,point,'.');
+	}
+	return n;
+    }
+
+    /** 
+     * @brief output format for probabilities in pp files
+     *
+     * @param prob probability
+     * @param exact if true, use full precision
+     *
+     * @return formatted probability
+     * @see format_prob(char *,double,bool)
+     */
+    std::string
+    format_prob(double prob, bool exact=false) {
+	char buf[pp_prob_buf_size];
+	size_t n=format_prob(buf,prob,exact);
+	return std::string(buf,n);
+    }
+
+    //! @brief append probability in pp format to buffer
+    static
+    void
+    append_prob(std::string &buf, double prob, bool exact) {
+	char s[pp_prob_buf_size];
+	size_t n=format_prob(s,prob,exact);
+	buf.append(s,n);
+    }
+
+    //! @brief append (non-negative) index to buffer
+    static
+    void
+    append_index(std::string &buf, size_t i) {
+	char s[24];
+	char *p=s+sizeof(s);
+	do {
+	    *--p = '0'+(i%10);
+	    i/=10;
+	} while (i>0);
+	buf.append(p,s+sizeof(s)-p);
+    }
+
+    //! @brief write buffer to stream if it is large, then clear it
+    static
+    void
+    flush_pp_buffer(std::ostream &out, std::string &buf, size_t min_size=65536) {
+	if (buf.size()>=min_size) {
+	    out.write(buf.data(),buf.size());
+	    buf.clear();
 	}
-	
-	return s;
     }
     
     /**
@@ -1352,13 +2011,14 @@ namespace LocARNA {
     std::ostream &
     RnaDataImpl::write_pp_arc_probabilities(std::ostream &out,
 					    double p_outbpcut,
-					    bool stacking
+					    bool stacking,
+					    bool exact
 					    ) const {
 	
 	out << std::endl
 	    << "#SECTION BASEPAIRS" << std::endl
 	    << std::endl
-	    << "#BPCUT "<<format_prob(std::max(p_bpcut_,p_outbpcut)) << std::endl;
+	    << "#BPCUT "<<format_prob(std::max(p_bpcut_,p_outbpcut),exact) << std::endl;
 	
 	if (stacking) {
 	    out << "#STACK"<<std::endl;
@@ -1374,19 +2034,29 @@ namespace LocARNA {
 	}
 #     endif
 	
-	for (arc_prob_matrix_t::const_iterator it = arc_probs_.begin();
-	     arc_probs_.end() != it;
-	     ++it) {
-	    size_t i=it->first.first;
-	    size_t j=it->first.second;
-	    if (it->second > p_outbpcut) {
-		out << i << " " << j << " " << format_prob(it->second);
-		if (stacking && has_stacking_ && arc_2_probs_(i,j)>p_bpcut_) {
-		    out << " " << format_prob(arc_2_probs_(i,j));
+	// write in canonical order (by left, then right end); lines
+	// are collected in a buffer, which is written in large blocks
+	assert(arc_row_.size()==sequence_.length()+2);
+	std::string buf;
+	for (size_t i=1; i+1<arc_row_.size(); ++i) {
+	    for (size_type k=arc_row_[i]; k<arc_row_[i+1]; ++k) {
+		size_t j=arc_right_[k];
+		if (arc_row_probs_[k] > p_outbpcut) {
+		    append_index(buf,i);
+		    buf += ' ';
+		    append_index(buf,j);
+		    buf += ' ';
+		    append_prob(buf,arc_row_probs_[k],exact);
+		    if (stacking && has_stacking_ && arc_row_joint_probs_[k]>p_bpcut_) {
+			buf += ' ';
+			append_prob(buf,arc_row_joint_probs_[k],exact);
+		    }
+		    buf += '\n';
 		}
-		out << std::endl;
 	    }
+	    flush_pp_buffer(out,buf);
 	}
+	flush_pp_buffer(out,buf,0);
 
 	out << std::endl
 	    << "#END" << std::endl;
@@ -1398,33 +2068,41 @@ namespace LocARNA {
     ExtRnaDataImpl::write_pp_in_loop_probabilities(std::ostream &out,
 						   double p_outbpcut,
 						   double p_outbpilcut,
-						   double p_outuilcut
+						   double p_outuilcut,
+						   bool exact
 						   ) const {
 	out << std::endl
 	    << "#SECTION INLOOP" << std::endl
 	    << std::endl
-	    << "#BPILCUT " << format_prob(std::max(p_bpilcut_,p_outbpilcut)) << std::endl
-	    << "#UILCUT  " << format_prob(std::max(p_uilcut_,p_outuilcut)) << std::endl
+	    << "#BPILCUT " << format_prob(std::max(p_bpilcut_,p_outbpilcut),exact) << std::endl
+	    << "#UILCUT  " << format_prob(std::max(p_uilcut_,p_outuilcut),exact) << std::endl
 	    << std::endl;
 	
-	// write in-loop probabilities for all arcs with probability greater than p_outbpcut
-	for (arc_prob_matrix_t::const_iterator it = self_->arc_probs_begin();
-	     self_->arc_probs_end() != it;
-	     ++it) {
-	    if (it->second > p_outbpcut) {
-		write_pp_in_loop_probability_line(out,
-						  it->first.first,
-						  it->first.second,
-						  p_outbpilcut,
-						  p_outuilcut);
+	// write in-loop probabilities for all arcs with probability
+	// greater than p_outbpcut in canonical order
+	std::string buf;
+	for (size_type i=1; i<=self_->length(); ++i) {
+	    std::pair<size_type,size_type> row = self_->sorted_arcs(i);
+	    for (size_type k=row.first; k<row.second; ++k) {
+		if (self_->sorted_arc_prob(k) > p_outbpcut) {
+		    write_pp_in_loop_probability_line(buf,
+						      i,
+						      self_->sorted_arc_right(k),
+						      p_outbpilcut,
+						      p_outuilcut,
+						      exact);
+		}
 	    }
+	    flush_pp_buffer(out,buf);
 	}
 
 	// write in loop probs for external loop
-	write_pp_in_loop_probability_line(out,
+	write_pp_in_loop_probability_line(buf,
 					  0,self_->length()+1,
 					  p_outbpilcut,
-					  p_outuilcut);
+					  p_outuilcut,
+					  exact);
+	flush_pp_buffer(out,buf,0);
 	
 	out << std::endl
 	    << "#END" << std::endl;
@@ -1432,55 +2110,81 @@ namespace LocARNA {
 	return out;
     }
     
-    std::ostream &
-    ExtRnaDataImpl::write_pp_in_loop_probability_line(std::ostream &out,
+    void
+    ExtRnaDataImpl::write_pp_in_loop_probability_line(std::string &buf,
 						      size_t i, size_t j,
 						      double p_bpilcut,
-						      double p_uilcut) const {
-	out << i << " " << j << " :";
-	// if (arc_in_loop_probs_(i,j).size()>=5) {
-	//     out << std::endl << "   ";
-	// }
+						      double p_uilcut,
+						      bool exact) const {
+	append_index(buf,i);
+	buf += ' ';
+	append_index(buf,j);
+	buf += " :";
 	
-	write_pp_basepair_in_loop_probabilities(out, arc_in_loop_probs_(i,j),
-						p_bpilcut);
+	const arc_prob_matrix_t &bp_probs = arc_in_loop_probs_(i,j);
+	const arc_prob_vector_t &u_probs = unpaired_in_loop_probs_(i,j);
 	
-	out << " ;"; // separate base pair and unpaired probabilities
-	if (arc_in_loop_probs_(i,j).size()>=4 && unpaired_in_loop_probs_(i,j).size()>=4) {
-	    out << "\\" << std::endl << "   ";
-	}
+	write_pp_basepair_in_loop_probabilities(buf, bp_probs,
+						p_bpilcut, exact);
 	
-	write_pp_unpaired_in_loop_probabilities(out, unpaired_in_loop_probs_(i,j),
-						p_uilcut);
-	out << std::endl;
+	buf += " ;"; // separate base pair and unpaired probabilities
+	if (bp_probs.size()>=4 && u_probs.size()>=4) {
+	    buf += "\\\n   ";
+	}
 	
-	return out;
+	write_pp_unpaired_in_loop_probabilities(buf, u_probs,
+						p_uilcut, exact);
+	buf += '\n';
     }
     
-    std::ostream &
-    ExtRnaDataImpl::write_pp_basepair_in_loop_probabilities(std::ostream &out,
+    void
+    ExtRnaDataImpl::write_pp_basepair_in_loop_probabilities(std::string &buf,
 							    const arc_prob_matrix_t &probs,
-							    double p_cut) const {
+							    double p_cut,
+							    bool exact) const {
+	// sort the (few) entries for canonical output
+	typedef std::pair<arc_prob_matrix_t::key_t,double> entry_t;
+	std::vector<entry_t> entries;
+	entries.reserve(probs.size());
 	for (arc_prob_matrix_t::const_iterator it=probs.begin(); probs.end()!=it; ++it) {
+	    entries.push_back(entry_t(it->first,it->second));
+	}
+	std::sort(entries.begin(),entries.end());
+
+	for (std::vector<entry_t>::const_iterator it=entries.begin(); entries.end()!=it; ++it) {
 	    if (it->second > p_cut) {
-		out << " " << it->first.first
-		    << " " << it->first.second
-		    << " " << format_prob(it->second);
+		buf += ' ';
+		append_index(buf,it->first.first);
+		buf += ' ';
+		append_index(buf,it->first.second);
+		buf += ' ';
+		append_prob(buf,it->second,exact);
 	    }
 	}
-	return out;
     }
 
-    std::ostream &
-    ExtRnaDataImpl::write_pp_unpaired_in_loop_probabilities(std::ostream &out,
+    void
+    ExtRnaDataImpl::write_pp_unpaired_in_loop_probabilities(std::string &buf,
 							    const arc_prob_vector_t &probs,
-							    double p_cut) const {
+							    double p_cut,
+							    bool exact) const {
+	// sort the (few) entries for canonical output
+	typedef std::pair<arc_prob_vector_t::key_t,double> entry_t;
+	std::vector<entry_t> entries;
+	entries.reserve(probs.size());
 	for (arc_prob_vector_t::const_iterator it=probs.begin(); probs.end()!=it; ++it) {
+	    entries.push_back(entry_t(it->first,it->second));
+	}
+	std::sort(entries.begin(),entries.end());
+
+	for (std::vector<entry_t>::const_iterator it=entries.begin(); entries.end()!=it; ++it) {
 	    if (it->second > p_cut) {
-		out << " " << it->first << " " << format_prob(it->second);
+		buf += ' ';
+		append_index(buf,it->first);
+		buf += ' ';
+		append_prob(buf,it->second,exact);
 	    }
 	}
-	return out;
     }
 
     
@@ -1538,46 +2242,91 @@ namespace LocARNA {
 		);
 	
 	p_bpcut_ = p_minMean;
-	
-	for (size_type i=0; i<edges.size(); i++) {
-	    for (size_type j=i+1; j<edges.size(); j++) {
-		// here we compute consensus pair probabilities
-		
-		double pA =
-		    (edges.first[i].is_gap() || edges.first[j].is_gap())
-		    ? 0
-		    : rna_dataA.arc_prob(edges.first[i], edges.first[j]);
 
-		double pB =
-		    (edges.second[i].is_gap() || edges.second[j].is_gap())
-		    ? 0
-		    : rna_dataB.arc_prob(edges.second[i], edges.second[j]);
+	size_type cols = edges.size();
+
+	// map columns to positions (0 for gaps) and positions to
+	// columns (0 for positions outside of a local alignment)
+	std::vector<size_type> posA(cols+1,0);
+	std::vector<size_type> posB(cols+1,0);
+	std::vector<size_type> colA(rna_dataA.length()+1,0);
+	std::vector<size_type> colB(rna_dataB.length()+1,0);
+	for (size_type c=0; c<cols; c++) {
+	    if (!edges.first[c].is_gap()) {
+		posA[c+1] = edges.first[c];
+		colA[edges.first[c]] = c+1;
+	    }
+	    if (!edges.second[c].is_gap()) {
+		posB[c+1] = edges.second[c];
+		colB[edges.second[c]] = c+1;
+	    }
+	}
+
+	// Only column pairs that are base pairs in A or B can have a
+	// consensus probability above p_minMean, since the
+	// probabilities of other pairs are raised to at most
+	// 0.75*p_minMean. For each left column, merge the sorted base
+	// pairs of A and B (their columns are sorted as well); the
+	// columns are independent, such that they are processed in
+	// parallel. Finally, insert the entries in column order.
+
+	typedef std::pair<double,double> probs_t; // probability, stacking probability
+	typedef std::vector< std::pair<size_type,probs_t> > row_t;
+	std::vector<row_t> rows(cols+1);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (long li=1; li<=(long)cols; li++) {
+	    size_type i=li;
+	    std::pair<size_type,size_type> arcsA(0,0);
+	    std::pair<size_type,size_type> arcsB(0,0);
+	    if (posA[i]!=0) arcsA = rna_dataA.sorted_arcs(posA[i]);
+	    if (posB[i]!=0) arcsB = rna_dataB.sorted_arcs(posB[i]);
+
+	    size_type kA=arcsA.first;
+	    size_type kB=arcsB.first;
+	    while (true) {
+		// skip right ends without column
+		while (kA<arcsA.second && colA[rna_dataA.sorted_arc_right(kA)]==0) kA++;
+		while (kB<arcsB.second && colB[rna_dataB.sorted_arc_right(kB)]==0) kB++;
+		if (kA==arcsA.second && kB==arcsB.second) break;
+
+		size_type jA = (kA<arcsA.second) ? colA[rna_dataA.sorted_arc_right(kA)] : cols+1;
+		size_type jB = (kB<arcsB.second) ? colB[rna_dataB.sorted_arc_right(kB)] : cols+1;
+		size_type j = std::min(jA,jB);
+
+		double pA = (jA==j) ? rna_dataA.sorted_arc_prob(kA) : 0;
+		double pB = (jB==j) ? rna_dataB.sorted_arc_prob(kB) : 0;
 
 		double p = consensus_probability(pA,pB,rowsA,rowsB,p_expA,p_expB);
 
 		if (stacking) {
-		    double st_pA =
-			(edges.first[i].is_gap() || edges.first[j].is_gap())
-			? 0
-			: rna_dataA.joint_arc_prob(edges.first[i], edges.first[j]);
-		    
-		    double st_pB =
-			(edges.second[i].is_gap() || edges.second[j].is_gap())
-			? 0
-			: rna_dataB.joint_arc_prob(edges.second[i], edges.second[j]);
+		    double st_pA = (jA==j) ? rna_dataA.joint_arc_prob(posA[i],posA[j]) : 0;
+		    double st_pB = (jB==j) ? rna_dataB.joint_arc_prob(posB[i],posB[j]) : 0;
 
 		    double st_p = consensus_probability(st_pA,st_pB,rowsA,rowsB,p_expA,p_expB);
 
 		    if (p > p_minMean || st_p > p_minMean) {
-			arc_probs_(i+1,j+1) = p;
-			arc_2_probs_(i+1,j+1) = st_p;
+			rows[i].push_back(row_t::value_type(j,probs_t(p,st_p)));
 		    }
-
 		} else {
 		    if (p > p_minMean) {
-			arc_probs_(i+1,j+1) = p;
+			rows[i].push_back(row_t::value_type(j,probs_t(p,0.0)));
 		    }
 		}
+
+		if (jA==j) kA++;
+		if (jB==j) kB++;
+	    }
+	}
+
+	for (size_type i=1; i<=cols; i++) {
+	    for (row_t::const_iterator it=rows[i].begin(); rows[i].end()!=it; ++it) {
+		arc_probs_(i,it->first) = it->second.first;
+		if (stacking) {
+		    arc_2_probs_(i,it->first) = it->second.second;
+		}
 	    }
 	}
     }
@@ -1586,8 +2335,16 @@ namespace LocARNA {
     RnaDataImpl::consensus_probability(double pA, double pB,
 				       size_t sizeA,size_t sizeB,
 				       double p_expA, double p_expB) const {
-	pA = std::max(std::min(p_expA,p_bpcut_*0.75), pA);
-	pB = std::max(std::min(p_expB,p_bpcut_*0.75), pB);
+	return consensus_probability(pA,pB,sizeA,sizeB,p_expA,p_expB,p_bpcut_);
+    }
+
+    double
+    RnaDataImpl::consensus_probability(double pA, double pB,
+				       size_t sizeA,size_t sizeB,
+				       double p_expA, double p_expB,
+				       double p_cut) {
+	pA = std::max(std::min(p_expA,p_cut*0.75), pA);
+	pB = std::max(std::min(p_expB,p_cut*0.75), pB);
 
 	// weighted geometric mean
 	double p = exp(
@@ -1615,7 +2372,7 @@ namespace LocARNA {
 	for (arc_prob_matrix_t::const_iterator it=arc_probs_.begin();
 	     arc_probs_.end() != it;
 	     ++it ) {
-	    vec.push_back(*it);
+	    vec.push_back(kv_t::kvpair_t(it->first,it->second));
 	}
 
 	std::make_heap(vec.begin(),vec.end(),kv_t::comp);
@@ -1637,37 +2394,54 @@ namespace LocARNA {
 	RnaDataImpl *rdimpl = static_cast<RnaData *>(self_)->pimpl_;
 	rdimpl->drop_worst_bps(keep);
 	
+	// the tables must not be changed while iterating over them;
+	// therefore, collect the keys of entries to be freed first
+
 	// free unpaired in loop where arc prob is 0
+	std::vector<arc_prob_vector_matrix_t::key_t> uil_keys;
 	for (arc_prob_vector_matrix_t::const_iterator it = unpaired_in_loop_probs_.begin();
 	     unpaired_in_loop_probs_.end() != it;
 	     ++it) {
 	    arc_prob_vector_matrix_t::key_t key = it->first;
 	    if ( rdimpl->arc_probs_(key.first,key.second) == 0.0 ) {
 		if (key.first==0) continue;
-		unpaired_in_loop_probs_.reset(key.first,key.second);
+		uil_keys.push_back(key);
 	    }
 	}
+	for (size_t k=0; k<uil_keys.size(); ++k) {
+	    unpaired_in_loop_probs_.reset(uil_keys[k].first,uil_keys[k].second);
+	}
 	
 	// free base pairs in loop where arc prob is 0
+	typedef std::pair< arc_prob_matrix_matrix_t::key_t, arc_prob_matrix_t::key_t > bpil_key_t;
+	std::vector<arc_prob_matrix_matrix_t::key_t> loop_keys;
+	std::vector<bpil_key_t> bpil_keys;
 	for (arc_prob_matrix_matrix_t::const_iterator it = arc_in_loop_probs_.begin();
 	     arc_in_loop_probs_.end() != it;
 	     ++it) {
 	    arc_prob_matrix_matrix_t::key_t key = it->first; 
 	    if ( rdimpl->arc_probs_(key.first,key.second) == 0.0 ) {
 		if (key.first==0) continue;
-		arc_in_loop_probs_.reset(key.first,key.second);
+		loop_keys.push_back(key);
 	    } else {
 		for (arc_prob_matrix_t::const_iterator it2 = it->second.begin();
 		     it->second.end() != it2;
 		     ++it2) {
 		    arc_prob_matrix_matrix_t::key_t key2 = it2->first; 
 		    if ( rdimpl->arc_probs_(key2.first,key2.second) == 0.0 ) {
-			arc_in_loop_probs_.ref(key.first,key.second)
-			    .reset(key2.first,key2.second);
+			bpil_keys.push_back(bpil_key_t(key,key2));
 		    }	
 		}
 	    }
 	}
+	for (size_t k=0; k<loop_keys.size(); ++k) {
+	    arc_in_loop_probs_.reset(loop_keys[k].first,loop_keys[k].second);
+	}
+	for (size_t k=0; k<bpil_keys.size(); ++k) {
+	    const bpil_key_t &key = bpil_keys[k];
+	    arc_in_loop_probs_.ref(key.first.first,key.first.second)
+		.reset(key.second.first,key.second.second);
+	}
 
     }
 
@@ -1783,12 +2557,13 @@ namespace LocARNA {
         std::vector<vrna_plist_t> plist;
         size_type len = length();
         for(size_t i=1; i<=len; ++i) {
-            for(size_t j=1; j<=len; ++j) {
-                double p=arc_prob(i,j);
+            std::pair<size_type,size_type> row = sorted_arcs(i);
+            for(size_type k=row.first; k<row.second; ++k) {
+                double p=sorted_arc_prob(k);
                 if (p>0) {
                     vrna_plist_t x;
                     x.i=i;
-                    x.j=j;
+                    x.j=sorted_arc_right(k);
                     x.p=p;
                     x.type=0;
                     plist.push_back(x);
@@ -49,7 +49,7 @@ namespace LocARNA {
     public:
 	
 	//! arc probability matrix
-	typedef SparseMatrix<double> arc_prob_matrix_t;
+	typedef SparseMatrix<double,FlatHashBackend> arc_prob_matrix_t;
 	
 	typedef size_t size_type; //!< usual size type
 	
@@ -73,7 +73,8 @@ namespace LocARNA {
 	/** 
 	 * @brief Construct from file
 	 * 
-	 * @param filename input file name
+	 * @param filename input file name; "-" for standard input,
+	 * may be gzip compressed
 	 * @param p_bpcut cutoff probability
 	 * @param pfoldparams folding parameters
 	 * @param max_bps_length_ratio maximal ratio of number of base
@@ -83,11 +84,6 @@ namespace LocARNA {
 	 *
 	 * @note autodetect format of input; 
 	 * for fa or aln input formats, predict base pair probabilities 
-	 *
-	 * @todo consider to allow reading from istream; use
-	 * istream::seekg(0) to reset stream to beginning (needed for
-	 * format autodetect.) Is there a problem due to fail on
-	 * eofbit in C++98?
          *
          * @todo filter by maxBPspan when reading base pair probabilities from file.
          * currently maxBPspan in pfoldparams is only respected when folding  
@@ -201,9 +197,49 @@ namespace LocARNA {
 	 *
 	 * @return probability p_ij of basepair (i,j) if
 	 * p_ij>p_bpcut; otherwise, 0
+	 *
+	 * @note binary search among the base pairs with left end i
 	 */
 	double 
 	arc_prob(pos_type i, pos_type j) const;
+
+	/**
+	 * @brief Base pairs with a given left end
+	 *
+	 * @param i left sequence position
+	 *
+	 * @return range [first,second) of indices of the sorted base
+	 * pairs with left end i
+	 *
+	 * The base pairs with probability above cutoff are sorted by
+	 * left end, then by right end, and indexed in this order;
+	 * the range is empty if there is no base pair with left end
+	 * i.
+	 *
+	 * @see sorted_arc_right(), sorted_arc_prob()
+	 */
+	std::pair<size_type,size_type>
+	sorted_arcs(pos_type i) const;
+
+	/**
+	 * @brief Right end of a sorted base pair
+	 *
+	 * @param k index of the base pair
+	 * @return right end
+	 * @see sorted_arcs()
+	 */
+	pos_type
+	sorted_arc_right(size_type k) const;
+
+	/**
+	 * @brief Probability of a sorted base pair
+	 *
+	 * @param k index of the base pair
+	 * @return probability
+	 * @see sorted_arcs()
+	 */
+	double
+	sorted_arc_prob(size_type k) const;
                 
 	/** 
 	 * \brief maximum expected accuracy structure
@@ -282,7 +318,7 @@ namespace LocARNA {
 	 * 
 	 * \param i sequence position
 	 * \return probability that a position i is paired with a position j>i (upstream)
-	 * @note O(sequence.length()) implementation
+	 * @note constant time; the sums are precomputed on construction
 	 * @see prob_paired_downstream
 	 */
 	double
@@ -293,7 +329,7 @@ namespace LocARNA {
 	 * 
 	 * \param i sequence position
 	 * \return probability that a position i is paired with a position j<i (downstream)
-	 * @note O(sequence.length()) implementation
+	 * @note constant time; the sums are precomputed on construction
 	 * @see prob_paired_upstream
 	 */
 	double
@@ -303,7 +339,7 @@ namespace LocARNA {
 	 * \brief Unpaired probability 
 	 * \param i sequence position
 	 * \return probability that a position i is unpaired
-	 * @note O(sequence.length()) implementation
+	 * @note constant time
 	 */
 	double
 	prob_unpaired(pos_type i) const;
@@ -384,11 +420,35 @@ namespace LocARNA {
 	init_from_rna_ensemble(const RnaEnsemble &rna_ensemble,
 			       const PFoldParams &pfoldparams);
 	
+	/**
+	 * @brief initialize by local folding in sliding windows
+	 *
+	 * @param pfoldparams folding parameters
+         *  - window_size: size of the windows
+         *  - max_bp_span: maximum base pair span (at most window_size)
+         *  - stacking: whether to initialize stacking terms
+	 *
+	 * Folds overlapping windows of the sequence one after the
+	 * other (like RNAplfold) and sets each probability to its
+	 * average over all windows that contain the respective base
+	 * pair or base. Only window probabilities above the cutoff
+	 * are accumulated; thus, time is linear in the sequence
+	 * length and memory is dominated by the sparse result.
+	 *
+	 * @note can be overloaded to initialize with additional
+	 * information (in loop probabilities)
+	 *
+	 * @pre sequence is initialized; pfoldparams.window_size()>0
+	 */
+	virtual
+	void
+	init_from_local_folding(const PFoldParams &pfoldparams);
+
 
 	/** 
 	 * @brief read and initialize from file, autodetect format
 	 * 
-	 * @param filename name of input file
+	 * @param filename name of input file; "-" for standard input
 	 * @param pfoldparams folding parameters
          *  - stacking: whether to initialize stacking terms
          *  - max_bp_span: maximum base pair span
@@ -398,6 +458,12 @@ namespace LocARNA {
 	 * @note: this method is designed such that it can be used for
 	 * RnaData and ExtRnaData
 	 *
+	 * @note the input is opened once (gzip compressed input is
+	 * decompressed on the fly, see InputFile); the format is
+	 * recognized from the first lines, such that the input is
+	 * parsed only once (except for distinguishing the old pp
+	 * format from clustal alignments without header).
+	 *
          * @note the method delegates actual reading to methods
          * read_pp(), read_old_pp(), read_ps(), and the
          * MultipleAlignment class.
@@ -421,6 +487,65 @@ namespace LocARNA {
 	virtual
 	bool
 	inloopprobs_ok() const {return true;}
+
+	/**
+	 * @brief Key of the probabilities in the ensemble cache
+	 *
+	 * @param pfoldparams folding parameters
+	 *
+	 * @return string that describes the sequences, their
+	 * structure constraints, the folding parameters and the
+	 * cutoffs; sequence names are not part of the key
+	 *
+	 * @note overloaded to add the in loop cutoffs
+	 * @see EnsembleCache
+	 */
+	virtual
+	std::string
+	ensemble_cache_key(const PFoldParams &pfoldparams) const;
+
+	/**
+	 * @brief Write data in pp format with full precision
+	 *
+	 * @param out output stream
+	 *
+	 * @return stream
+	 *
+	 * Used for ensemble cache entries, which must reproduce the
+	 * computed probabilities exactly.
+	 *
+	 * @note overloaded to write the in loop probabilities
+	 */
+	virtual
+	std::ostream &
+	write_pp_exact(std::ostream &out) const;
+
+	/**
+	 * @brief Read probabilities from the ensemble cache
+	 *
+	 * @param filename name of the cache file
+	 *
+	 * @return whether complete probabilities were read
+	 *
+	 * Keeps the sequence (in particular, names and anchors) as
+	 * read from the input. Fails if the file does not exist, is
+	 * incomplete or has different sequences (hash collision).
+	 *
+	 * @note on failure, the probabilities are in an undefined
+	 * state and must be initialized again
+	 */
+	bool
+	read_ensemble_cache(const std::string &filename);
+
+	/**
+	 * @brief Write probabilities to the ensemble cache
+	 *
+	 * @param filename name of the cache file
+	 *
+	 * @see EnsembleCache::write()
+	 */
+	void
+	write_ensemble_cache(const std::string &filename) const;
 		
 	
 	/** 
@@ -464,7 +589,7 @@ namespace LocARNA {
 	/** 
 	 * Read data in the old pp format
 	 * 
-	 * @param filename name of input file 
+	 * @param in input stream
 	 *
 	 * Reads only base pairs with probabilities greater than
 	 * p_bpcut_; reads stacking probabilities only if
@@ -485,12 +610,12 @@ namespace LocARNA {
          * @todo move implementation to impl class
          */
         void
-	read_old_pp(const std::string &filename);
+	read_old_pp(std::istream &in);
 
 	/** 
 	 * Read data in Vienna's dot plot ps format
 	 * 
-	 * @param filename name of input file
+	 * @param in input stream
 	 *
 	 * Reads only base pairs with probabilities greater than
 	 * p_bpcut_; reads stacking probabilities only if
@@ -505,7 +630,7 @@ namespace LocARNA {
          * @todo move implementation to impl class
 	 */
 	void
-	read_ps(const std::string &filename);
+	read_ps(std::istream &in);
 	
     }; // end class RnaData
   
@@ -6,6 +6,7 @@
 #endif
 
 #include <iosfwd>
+#include <vector>
 #include "rna_data.hh"
 #include "sequence.hh"
 
@@ -16,6 +17,58 @@ namespace LocARNA {
     class PFoldParams;
     //    template<class T> class SparseVector<T>;
 
+    /**
+     * @brief Overlapping windows for local folding
+     *
+     * Windows of fixed size cover the sequence such that each
+     * subsequence of length at most span lies completely in at least
+     * one window; consecutive windows are shifted by about half of
+     * the slack (window size - span + 1), such that most base pairs
+     * occur in several windows. The last window ends at the end of
+     * the sequence.
+     */
+    class LocalFoldingWindows {
+	size_type window_size_; //!< size of the windows
+	size_type span_; //!< maximum base pair span
+	std::vector<size_type> starts_; //!< start positions (1-based, sorted)
+    public:
+	/**
+	 * @brief Construct
+	 *
+	 * @param length sequence length
+	 * @param window_size size of the windows
+	 * @param span maximum base pair span; limited to window size
+	 *
+	 * @pre window_size>0
+	 */
+	LocalFoldingWindows(size_type length,
+			    size_type window_size,
+			    size_type span);
+
+	//! @brief size of the windows
+	size_type
+	window_size() const {return window_size_;}
+
+	//! @brief maximum base pair span in the windows
+	size_type
+	span() const {return span_;}
+
+	//! @brief start positions of the windows
+	const std::vector<size_type> &
+	starts() const {return starts_;}
+
+	/**
+	 * @brief Number of windows that contain a subsequence
+	 *
+	 * @param i first position
+	 * @param j last position
+	 *
+	 * @return number of windows containing positions i..j
+	 */
+	size_type
+	count(size_type i, size_type j) const;
+    };
+
     /**
      * @brief Implementation of RnaData
      */
@@ -51,6 +104,36 @@ namespace LocARNA {
 	
 	//! whether stacking probabilities are available
 	bool has_stacking_; 
+
+	/**
+	 * row offsets of the base pair index: the base pairs with
+	 * left end i are the entries arc_right_[k] for
+	 * arc_row_[i] <= k < arc_row_[i+1]; size length+2
+	 *
+	 * @note The index (arc_row_, arc_right_, arc_row_probs_,
+	 * arc_row_joint_probs_, prob_paired_upstream_,
+	 * prob_paired_downstream_) is a read only copy of
+	 * arc_probs_ and arc_2_probs_ in compressed sparse row
+	 * layout. It is built by init_arc_index() after
+	 * construction; the sparse matrices remain the store while
+	 * reading and modifying probabilities.
+	 */
+	std::vector<size_type> arc_row_;
+
+	//! right ends of the base pairs, sorted within each row
+	std::vector<pos_type> arc_right_;
+
+	//! probabilities of the base pairs in arc_right_
+	std::vector<double> arc_row_probs_;
+
+	//! joint probabilities of the base pairs in arc_right_
+	std::vector<double> arc_row_joint_probs_;
+
+	//! per position sum of probabilities of pairs (i,j) with j>i
+	std::vector<double> prob_paired_upstream_;
+
+	//! per position sum of probabilities of pairs (j,i) with j<i
+	std::vector<double> prob_paired_downstream_;
 	
 	/** 
 	 * @brief Construct as consensus of two aligned RNAs
@@ -107,6 +190,46 @@ namespace LocARNA {
 	init_from_rna_ensemble(const RnaEnsemble &rna_ensemble,
 			       const PFoldParams &pfoldparams);
 
+	/**
+	 * @brief sequence of a window for local folding
+	 *
+	 * @param start first position of the window
+	 * @param window_size size of the window
+	 *
+	 * @return the columns start..start+window_size-1 of sequence_
+	 *
+	 * @note throws failure if sequence_ has a structure annotation,
+	 * since constraints cannot be cut into windows in general
+	 */
+	MultipleAlignment
+	window_sequence(size_type start, size_type window_size) const;
+
+	/**
+	 * @brief add probabilities of a window for local folding
+	 *
+	 * @param window data of the window
+	 * @param offset position of the window in the sequence minus 1
+	 *
+	 * Adds the (cut off) probabilities of the window to the
+	 * entries of arc_probs_ and arc_2_probs_, which hold sums
+	 * until finish_local_folding()
+	 */
+	void
+	add_local_window(const RnaData &window, size_type offset);
+
+	/**
+	 * @brief turn the accumulated window probabilities into averages
+	 *
+	 * @param windows the windows
+	 * @param pfoldparams folding parameters
+	 *
+	 * Divides each sum by the number of windows containing the base
+	 * pair and drops averages below the cutoff
+	 */
+	void
+	finish_local_folding(const LocalFoldingWindows &windows,
+			     const PFoldParams &pfoldparams);
+
 	/**
 	 * @brief read sequence section of pp-format
 	 *
@@ -148,6 +271,7 @@ namespace LocARNA {
 	 * @param stacking whether to write stacking probabilities; if
 	 *   stacking but !has_stacking_, no stacking terms are
 	 *   written but flag #STACKS is written to output
+	 * @param exact write probabilities with full precision
 	 *
 	 * @return stream
 	 *
@@ -157,7 +281,8 @@ namespace LocARNA {
 	std::ostream &
 	write_pp_arc_probabilities(std::ostream &out,
 				   double p_outbpcut,
-				   bool stacking) const;
+				   bool stacking,
+				   bool exact=false) const;
 
 
 	/** 
@@ -205,6 +330,30 @@ namespace LocARNA {
 			      double p_expA,
 			      double p_expB) const;
 
+	/**
+	 * @brief Consensus probability for given cutoff
+	 *
+	 * @param pA probability A
+	 * @param pB probability B
+	 * @param sizeA number of rows in sequence A
+	 * @param sizeB number of rows in sequence B
+	 * @param p_expA background probability A
+	 * @param p_expB background probability B
+	 * @param p_cut cutoff probability of the consensus
+	 *
+	 * @return consensus probability
+	 * @see consensus_probability(double,double,size_t,size_t,double,double)
+	 */
+	static
+	double
+	consensus_probability(double pA,
+			      double pB,
+			      size_t sizeA,
+			      size_t sizeB,
+			      double p_expA,
+			      double p_expB,
+			      double p_cut);
+
 	
 	template<class KEY>
 	class keyvec {
@@ -213,13 +362,39 @@ namespace LocARNA {
 	    
 	    typedef std::vector<kvpair_t> vec_t;
 	    
-	    // compare for min heap
+	    // compare for min heap; ties are broken by the key, such
+	    // that the dropped entries do not depend on the hash order
 	    static
 	    bool comp(const kvpair_t &x, const kvpair_t &y) {
-		return x.second>y.second;
+		return x.second>y.second
+		    || (x.second==y.second && x.first>y.first);
 	    }
 	};
 	
+	/**
+	 * @brief Build the base pair index from arc_probs_ and arc_2_probs_
+	 *
+	 * Sorts the base pairs by left and right end and sums up the
+	 * paired probabilities of each position in order of the
+	 * pairing partners. Must be called whenever construction of
+	 * the object has finished; later changes of the sparse
+	 * matrices are not seen by the index based accessors.
+	 */
+	void
+	init_arc_index();
+
+	/**
+	 * @brief Position of a base pair in the index
+	 *
+	 * @param i left end
+	 * @param j right end
+	 *
+	 * @return index k with arc_right_[k]==j in row i, or
+	 * arc_right_.size() if (i,j) is not stored
+	 */
+	size_type
+	arc_index(pos_type i, pos_type j) const;
+
 	/** 
 	 * @brief Drop base pairs with lowest probability
 	 * 
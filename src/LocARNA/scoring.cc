@@ -7,6 +7,7 @@
 #include "match_probs.hh"
 #include "ribosum.hh"
 #include "ribofit.hh"
+#include "sequence_profile.hh"
 
 
 #include <math.h>
@@ -24,6 +25,9 @@ namespace LocARNA {
     //! @see punB_tab
     std::vector<double> punB_tab;
 
+    const size_t Scoring::identity_min;
+    const size_t Scoring::identity_max;
+
     Scoring::Scoring(const Sequence &seqA_,
 		     const Sequence &seqB_,
 		     const RnaData &rna_dataA_,
@@ -201,6 +205,8 @@ namespace LocARNA {
 
 	lambda_ = lambda;
 
+	if (delta_lambda==0) return;
+
 	// subtract delta_lambda from precomputed tables
 	// * sigma_tab
 	// * gapcost_tabA
@@ -216,7 +222,12 @@ namespace LocARNA {
     void
     Scoring::precompute_sequence_identities() {
 	identity.resize(seqA.num_of_rows(),seqB.num_of_rows());
-	for (size_t i=0; i<seqA.num_of_rows(); i++) {
+
+	// the row pairs are independent
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (long i=0; i<(long)seqA.num_of_rows(); i++) {
 	    for (size_t j=0; j<seqB.num_of_rows(); j++) {
 		identity(i,j) = sequence_identity(seqA.seqentry(i).seq(),
 						  seqB.seqentry(j).seq());
@@ -224,8 +235,8 @@ namespace LocARNA {
 		//std::cout << "    "<<i<<" "<<j<<" SI="<<identity(i,j)<<std::endl;
 		
 		// don't use extreme identities!
-		identity(i,j) = std::max( identity(i,j), (size_t)20 );
-		identity(i,j) = std::min( identity(i,j), (size_t)95 );
+		identity(i,j) = std::max( identity(i,j), identity_min );
+		identity(i,j) = std::min( identity(i,j), identity_max );
 	    }
 	}
     }
@@ -238,16 +249,19 @@ namespace LocARNA {
 
 	sigma_tab.resize(lenA+1,lenB+1);
 
+	if (!params->mea_scoring) {
+	    precompute_sigma_profile(seqA.profile(),seqB.profile());
+	    return;
+	}
+
 	// precompute the unpaired probabilities and store in vectors
-	if (params->mea_scoring) {
-	    punA_tab.resize(lenA+1);
-	    for (size_type i=1; i<=lenA; ++i) {
-		punA_tab[i]=rna_dataA.prob_unpaired(i);
-	    }
-	    punB_tab.resize(lenB+1);
-	    for (size_type i=1; i<=lenB; ++i) {
-		punB_tab[i]=rna_dataB.prob_unpaired(i);
-	    }
+	punA_tab.resize(lenA+1);
+	for (size_type i=1; i<=lenA; ++i) {
+	    punA_tab[i]=rna_dataA.prob_unpaired(i);
+	}
+	punB_tab.resize(lenB+1);
+	for (size_type i=1; i<=lenB; ++i) {
+	    punB_tab[i]=rna_dataB.prob_unpaired(i);
 	}
 
 	for (size_type i=1; i<=lenA; ++i) {
@@ -257,6 +271,123 @@ namespace LocARNA {
 	}
     }
 
+    score_t
+    Scoring::symbol_pair_score(char a, char b, size_t identity) const {
+	// if we have a ribosum matrix, use it!
+	// !!! if ribosum and characters are not in the ribosum matrix
+	// we fall back to match/mismatch scoring !!!
+	
+	if (params->ribofit
+	    && params->ribofit->alphabet().in(a)
+	    && params->ribofit->alphabet().in(b)) {
+	    return
+		round2score(100.0 * params->ribofit->basematch_score(a,b,identity));
+	} else if (params->ribosum
+		   && params->ribosum->alphabet().in(a)
+		   && params->ribosum->alphabet().in(b)) {
+	    return
+		round2score(100.0 * params->ribosum->basematch_score_corrected(a,b));
+	} else if (a!='N' && b!='N') {
+	    return (a==b) ? params->basematch : params->basemismatch;
+	}
+	return 0;
+    }
+
+    void
+    Scoring::precompute_sigma_profile(const SequenceProfile &profA,
+				      const SequenceProfile &profB) {
+	typedef SequenceProfile::code_t code_t;
+	typedef SequenceProfile::const_iterator prof_iter_t;
+
+	size_type lenA = profA.length();
+	size_type lenB = profB.length();
+	size_type rowsA = profA.num_of_rows();
+	size_type rowsB = profB.num_of_rows();
+	size_type symsA = profA.num_of_symbols();
+	size_type symsB = profB.num_of_symbols();
+
+	// the sum of pairs is quite ad hoc
+	// e.g. matching - and - counts as match ...
+	// N is a wildcard, matchs with N don't count
+	//
+	// the average is computed over integral scores of all row
+	// pairs, such that the result does not depend on the order of
+	// summation
+
+	int num_pairs = (int)(rowsA*rowsB);
+
+	if (!params->ribofit) {
+	    // symbol pair scores do not depend on the row pair; score
+	    // the columns as product of their profiles
+	    Matrix<score_t> pair_score(symsA,symsB);
+	    for (code_t a=0; a<symsA; ++a) {
+		for (code_t b=0; b<symsB; ++b) {
+		    pair_score(a,b) =
+			symbol_pair_score(profA.symbol(a),profB.symbol(b),0);
+		}
+	    }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	    for (long i=1; i<=(long)lenA; ++i) {
+		for (size_type j=1; j<=lenB; ++j) {
+		    score_t score=0;
+		    for (prof_iter_t ea=profA.begin(i); ea!=profA.end(i); ++ea) {
+			for (prof_iter_t eb=profB.begin(j); eb!=profB.end(j); ++eb) {
+			    score += (score_t)(ea->count()*eb->count())
+				* pair_score(ea->code(),eb->code());
+			}
+		    }
+		    sigma_tab(i,j) = round2score(score / num_pairs);
+		}
+	    }
+	    return;
+	}
+
+	// for ribofit, symbol pair scores depend on the sequence
+	// identity of the rows; precompute one table of symbol pair
+	// scores for each occurring identity value
+	std::vector<Matrix<score_t> > pair_scores(identity_max-identity_min+1);
+	std::vector<bool> have_pair_scores(pair_scores.size(),false);
+	std::vector<const Matrix<score_t> *> row_pair_score(rowsA*rowsB);
+	for (size_type r=0; r<rowsA; ++r) {
+	    for (size_type s=0; s<rowsB; ++s) {
+		size_t id = identity(r,s);
+		size_t k = id-identity_min;
+		if (!have_pair_scores[k]) {
+		    pair_scores[k].resize(symsA,symsB);
+		    for (code_t a=0; a<symsA; ++a) {
+			for (code_t b=0; b<symsB; ++b) {
+			    pair_scores[k](a,b) =
+				symbol_pair_score(profA.symbol(a),profB.symbol(b),id);
+			}
+		    }
+		    have_pair_scores[k]=true;
+		}
+		row_pair_score[r*rowsB+s] = &pair_scores[k];
+	    }
+	}
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (long i=1; i<=(long)lenA; ++i) {
+	    const code_t *codesA = profA.column_codes(i);
+	    for (size_type j=1; j<=lenB; ++j) {
+		const code_t *codesB = profB.column_codes(j);
+		score_t score=0;
+		for (size_type r=0; r<rowsA; ++r) {
+		    const Matrix<score_t> * const *tabs = &row_pair_score[r*rowsB];
+		    for (size_type s=0; s<rowsB; ++s) {
+			score += (*tabs[s])(codesA[r],codesB[s]);
+		    }
+		}
+		sigma_tab(i,j) = round2score(score / num_pairs);
+	    }
+	}
+    }
+
 
     void Scoring::precompute_exp_sigma() {
 	size_type lenA = seqA.length();
@@ -273,76 +404,31 @@ namespace LocARNA {
 
 
     /**
-       returns similarity of two alignment columns
+       returns mea similarity of two alignment columns
     */
     score_t
     Scoring::sigma_(int ia, int ib) const {
+	assert(params->mea_scoring);
 
-	if (params->mea_scoring) {
-
-	    // for our mea alignment, we score basematchs
-	    // by the sum of
-	    //   the edge probability
-	    //   and a term for structural accuracy
+	// for our mea alignment, we score basematchs
+	// by the sum of
+	//   the edge probability
+	//   and a term for structural accuracy
 
-	    return
-		round2score
-		(
-		 params->probability_scale *
-		 ( match_probs->prob(ia,ib)
-		   +
-		   (params->alpha_factor/100.0)
-		   * (
-		      punA_tab[ia]
-		      +
-		      punB_tab[ib]
-		      )
-		   )
-		 );
-	} else {
-	    // compute average score for aligning the two alignment columns
-
-	    const Sequence::AliColumn &colA=seqA[ia];
-	    const Sequence::AliColumn &colB=seqB[ib];
-
-	    score_t score=0;
-
-	    // the sum of pairs is quite ad hoc
-	    // e.g. matching - and - counts as match ...
-	    // N is a wildcard, matchs with N don't count
-	    //
-	    for (size_t i=0; i<colA.size(); i++) {
-		for (size_t j=0; j<colB.size(); j++) {
-		    // if we have a ribosum matrix, use it!
-		    // !!! if ribosum and characters are not in the ribosum matrix
-		    // we fall back to match/mismatch scoring !!!
-
-		    //
-		    if (params->ribofit
-			&& params->ribofit->alphabet().in(colA[i])
-			&& params->ribofit->alphabet().in(colB[j])) {
-
-			score +=
-			    round2score(100.0 * params->ribofit->basematch_score(colA[i],colB[j],identity(i,j)));
-		    } else if (params->ribosum
-			&& params->ribosum->alphabet().in(colA[i])
-			&& params->ribosum->alphabet().in(colB[j])) {
-
-			score +=
-			    round2score(100.0 * params->ribosum->basematch_score_corrected(colA[i],colB[j]));
-		    } else {
-			if (colA[i]!='N' && colB[j]!='N') {
-			    score +=
-				(colA[i]==colB[j])
-				?params->basematch
-				:params->basemismatch;
-			}
-		    }
-		}
-	    }
-
-	    return  round2score(score / (int)(colA.size()*colB.size())) ;
-	}
+	return
+	    round2score
+	    (
+	     params->probability_scale *
+	     ( match_probs->prob(ia,ib)
+	       +
+	       (params->alpha_factor/100.0)
+	       * (
+		  punA_tab[ia]
+		  +
+		  punB_tab[ib]
+		  )
+	       )
+	     );
     }
 
     void
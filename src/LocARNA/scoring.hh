@@ -12,6 +12,7 @@
 
 #include "scoring_fwd.hh"
 #include "matrix.hh"
+#include "aligned_array.hh"
 #include "basepairs.hh"
 #ifndef NDEBUG
 #include "sequence.hh"
@@ -34,6 +35,7 @@ namespace LocARNA {
     class MatchProbs;
     class RnaData;
     class ExtRnaData;
+    class SequenceProfile;
     
     //! matrix of scores supporting infinity
     typedef std::vector<infty_score_t> ScoreVector;
@@ -43,10 +45,16 @@ namespace LocARNA {
     
 
     //! matrix of scores supporting infinity
-    typedef Matrix<infty_score_t> ScoreMatrix;
+    //! (DP matrix with cache line aligned rows)
+    typedef Matrix<infty_score_t,
+		   AlignedArray<infty_score_t>,
+		   AlignedRowLayout<> > ScoreMatrix;
 
     //! Matrix of partition functions
-    typedef Matrix<pf_score_t> PFScoreMatrix;
+    //! (DP matrix with cache line aligned rows)
+    typedef Matrix<pf_score_t,
+		   AlignedArray<pf_score_t>,
+		   AlignedRowLayout<> > PFScoreMatrix;
 
     //! Matrix of probabilities
     typedef Matrix<double> ProbMatrix;
@@ -439,6 +447,11 @@ namespace LocARNA {
 	
 	Matrix<size_t> identity; //!< sequence identities in percent
 
+	//! minimal sequence identity used for ribofit scores
+	static const size_t identity_min=20;
+	//! maximal sequence identity used for ribofit scores
+	static const size_t identity_max=95;
+
 	void
 	precompute_sequence_identities();
 
@@ -455,7 +468,7 @@ namespace LocARNA {
 	}
 
 	/** 
-	 * \brief Compute base similarity
+	 * \brief Compute base similarity for mea scoring
 	 * 
 	 * @param i position in A
 	 * @param j position in B
@@ -466,6 +479,23 @@ namespace LocARNA {
 	score_t
 	sigma_(int i, int j) const;
 
+	/**
+	 * \brief Score of a pair of symbols
+	 *
+	 * Uses ribofit or ribosum if available and both symbols are
+	 * in their alphabet; otherwise falls back to match/mismatch
+	 * scoring, where N is a wildcard that scores 0.
+	 *
+	 * @param a symbol in A
+	 * @param b symbol in B
+	 * @param identity sequence identity of the rows (only used
+	 * for ribofit)
+	 *
+	 * @return score of aligning a and b
+	 */
+	score_t
+	symbol_pair_score(char a, char b, size_t identity) const;
+
 	/**
 	 * \brief Precompute all base similarities
 	 * 
@@ -473,6 +503,25 @@ namespace LocARNA {
 	 */
 	void
 	precompute_sigma();
+
+	/**
+	 * \brief Precompute base similarities from column profiles
+	 *
+	 * Averages the symbol pair scores over all row pairs of the
+	 * columns. Without ribofit, the scores are computed as
+	 * product of the column profiles; since ribofit scores
+	 * depend on the row pair, in this case the symbol pair
+	 * scores are tabellized per identity value.
+	 *
+	 * @param profA profile of A
+	 * @param profB profile of B
+	 *
+	 * @note the profiles are independent of the scoring
+	 * parameters
+	 */
+	void
+	precompute_sigma_profile(const SequenceProfile &profA,
+				 const SequenceProfile &profB);
 	
 	/**
 	 * \brief Precompute all Boltzmann weights of base similarities
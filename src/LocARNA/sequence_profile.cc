@@ -0,0 +1,62 @@
+#include "sequence_profile.hh"
+#include "multiple_alignment.hh"
+
+namespace LocARNA {
+
+    SequenceProfile::SequenceProfile(const MultipleAlignment &ma)
+	: length_(ma.length()),
+	  num_of_rows_(ma.num_of_rows()),
+	  symbols_(),
+	  codes_(),
+	  col_start_(),
+	  entries_() {
+
+	// determine the occurring symbols and number them in
+	// lexicographic order
+	const size_t num_chars = 256;
+	std::vector<bool> occurs(num_chars,false);
+	for (size_type row=0; row<num_of_rows_; ++row) {
+	    const string1 &s = ma.seqentry(row).seq();
+	    for (size_type col=1; col<=length_; ++col) {
+		occurs[(unsigned char)s[col]] = true;
+	    }
+	}
+
+	std::vector<code_t> code_of(num_chars,0);
+	for (size_t c=0; c<num_chars; ++c) {
+	    if (occurs[c]) {
+		code_of[c] = (code_t)symbols_.length();
+		symbols_.push_back((char)c);
+	    }
+	}
+
+	// encode the alignment column by column
+	codes_.resize(length_*num_of_rows_);
+	for (size_type row=0; row<num_of_rows_; ++row) {
+	    const string1 &s = ma.seqentry(row).seq();
+	    for (size_type col=1; col<=length_; ++col) {
+		codes_[(col-1)*num_of_rows_+row] = code_of[(unsigned char)s[col]];
+	    }
+	}
+
+	// count symbols per column
+	col_start_.resize(length_+2);
+	std::vector<size_type> counts(symbols_.length(),0);
+	for (size_type col=1; col<=length_; ++col) {
+	    col_start_[col] = entries_.size();
+
+	    const code_t *codes = column_codes(col);
+	    for (size_type row=0; row<num_of_rows_; ++row) {
+		++counts[codes[row]];
+	    }
+	    for (size_type code=0; code<counts.size(); ++code) {
+		if (counts[code]>0) {
+		    entries_.push_back(entry_t((code_t)code,counts[code]));
+		    counts[code]=0;
+		}
+	    }
+	}
+	col_start_[length_+1] = entries_.size();
+    }
+
+} // end namespace LocARNA
@@ -0,0 +1,151 @@
+#ifndef LOCARNA_SEQUENCE_PROFILE_HH
+#define LOCARNA_SEQUENCE_PROFILE_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <vector>
+#include <string>
+
+#include "aux.hh"
+
+namespace LocARNA {
+
+    class MultipleAlignment;
+
+    /**
+     * @brief Column profile of a multiple alignment
+     *
+     * Reduces a (multiple) alignment once to an encoded form: the
+     * distinct symbols of the alignment are numbered by small codes,
+     * the symbols of each column are stored as codes, and for each
+     * column the list of occurring symbol codes together with their
+     * counts is stored compactly.
+     *
+     * Sum-of-pairs scores of two columns that depend only on the
+     * pair of symbols can then be computed as product of the two
+     * column profiles, i.e. in time proportional to the number of
+     * distinct symbols in the columns instead of the number of row
+     * pairs.
+     *
+     * The profile is independent of any scoring parameters and can
+     * therefore be constructed once and reused for computing
+     * similarities to many partners.
+     *
+     * Columns are 1-based, rows are 0-based like in
+     * MultipleAlignment.
+     *
+     * @see MultipleAlignment::profile()
+     */
+    class SequenceProfile {
+    public:
+	typedef unsigned char code_t; //!< type of symbol codes
+
+	/**
+	 * @brief entry of a column profile: symbol code and count
+	 */
+	class entry_t {
+	    code_t code_;
+	    size_type count_;
+	public:
+	    /**
+	     * @brief construct
+	     * @param code symbol code
+	     * @param count number of occurrences
+	     */
+	    entry_t(code_t code, size_type count)
+		: code_(code), count_(count) {}
+
+	    //! @brief symbol code
+	    code_t code() const { return code_; }
+
+	    //! @brief number of occurrences in column
+	    size_type count() const { return count_; }
+	};
+
+	//! iterator over the entries of a column profile
+	typedef std::vector<entry_t>::const_iterator const_iterator;
+
+    private:
+	size_type length_; //!< number of columns
+	size_type num_of_rows_; //!< number of rows
+
+	std::string symbols_; //!< symbols by code (sorted)
+
+	//! codes of symbols, column by column (column-major)
+	std::vector<code_t> codes_;
+
+	//! start of column profiles in entries_ (index 0..length+1)
+	std::vector<size_type> col_start_;
+
+	//! profile entries of all columns
+	std::vector<entry_t> entries_;
+
+    public:
+	/**
+	 * @brief Construct from multiple alignment
+	 * @param ma multiple alignment (or sequence)
+	 */
+	explicit
+	SequenceProfile(const MultipleAlignment &ma);
+
+	//! @brief number of columns
+	size_type
+	length() const { return length_; }
+
+	//! @brief number of rows
+	size_type
+	num_of_rows() const { return num_of_rows_; }
+
+	//! @brief number of distinct symbols
+	size_type
+	num_of_symbols() const { return symbols_.length(); }
+
+	/**
+	 * @brief symbol of code
+	 * @param code symbol code
+	 * @return symbol
+	 */
+	char
+	symbol(code_t code) const { return symbols_[code]; }
+
+	/**
+	 * @brief code of symbol in alignment
+	 * @param col column (1..length)
+	 * @param row row (0..num_of_rows-1)
+	 * @return code of the symbol in row and column
+	 */
+	code_t
+	code(size_type col, size_type row) const {
+	    return codes_[(col-1)*num_of_rows_+row];
+	}
+
+	/**
+	 * @brief codes of a column
+	 * @param col column (1..length)
+	 * @return pointer to the codes of the column by rows
+	 */
+	const code_t *
+	column_codes(size_type col) const {
+	    return &codes_[(col-1)*num_of_rows_];
+	}
+
+	/**
+	 * @brief begin of column profile
+	 * @param col column (1..length)
+	 */
+	const_iterator
+	begin(size_type col) const { return entries_.begin()+col_start_[col]; }
+
+	/**
+	 * @brief end of column profile
+	 * @param col column (1..length)
+	 */
+	const_iterator
+	end(size_type col) const { return entries_.begin()+col_start_[col+1]; }
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_SEQUENCE_PROFILE_HH
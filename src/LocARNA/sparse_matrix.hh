@@ -8,6 +8,7 @@
 #include <iostream>
 
 #include "aux.hh"
+#include "flat_hash_map.hh"
 
 namespace LocARNA {
 
@@ -19,11 +20,15 @@ namespace LocARNA {
      * non-sparse Matrix class. (A proxy class is used to provide the
      * same syntax for the interface.)
      *
-     * @see Matrix
+     * The hash map is selected by the backend, which is either
+     * StdHashBackend (unordered_map) or FlatHashBackend (open
+     * addressing).
+     *
+     * @see Matrix, FlatHashMap
      */
     
     
-    template <typename T>
+    template <typename T, class Backend = StdHashBackend>
     class SparseMatrix {
     public:
 	
@@ -35,7 +40,7 @@ namespace LocARNA {
 
     protected:
 		
-	typedef typename unordered_map<key_t,value_t,pair_of_size_t_hash>::type map_t; //!<map type 
+	typedef typename Backend::template map<key_t,value_t>::type map_t; //!<map type 
 	map_t the_map_; //!< internal representation of sparse matrix
 	value_t def_; //!< default value of matrix entries
     
@@ -59,7 +64,7 @@ namespace LocARNA {
 	 */
 	class element {
 	private:
-	    SparseMatrix<T> *m_;
+	    SparseMatrix *m_;
 	    key_t k_;
 	public:
 	    /** 
@@ -69,7 +74,7 @@ namespace LocARNA {
 	     * @param k key/index of entry in given sparse matrix
 	     *
 	     */
-	    element(SparseMatrix<T> *m,key_t k): m_(m),k_(k) {}
+	    element(SparseMatrix *m,key_t k): m_(m),k_(k) {}
 
 	    /** 
 	     * @brief Access entry for which the class acts as proxy
@@ -297,8 +302,31 @@ namespace LocARNA {
 	def() const {
 	    return def_;
 	}
+
+	/**
+	 * @brief Swap with other matrix
+	 * @param m other matrix
+	 */
+	void
+	swap(SparseMatrix &m) {
+	    the_map_.swap(m.the_map_);
+	    std::swap(def_,m.def_);
+	}
     };
 
+    /**
+     * @brief Swap sparse matrices
+     *
+     * Avoids copying the entries, e.g. when matrices of a sparse
+     * matrix of matrices are moved within a FlatHashMap.
+     */
+    template<class T, class Backend>
+    inline
+    void
+    swap(SparseMatrix<T,Backend> &m, SparseMatrix<T,Backend> &n) {
+	m.swap(n);
+    }
+
     /** 
      * @brief Output operator
      * 
@@ -307,11 +335,11 @@ namespace LocARNA {
      * 
      * @return output stream after writing
      */
-    template<class T>
+    template<class T, class Backend>
     inline
     std::ostream &
-    operator <<(std::ostream &out, const SparseMatrix<T> &m) {
-	for (typename SparseMatrix<T>::const_iterator it=m.begin();
+    operator <<(std::ostream &out, const SparseMatrix<T,Backend> &m) {
+	for (typename SparseMatrix<T,Backend>::const_iterator it=m.begin();
 	     m.end()!=it; 
 	     ++it) {
 	    out << "("<<it->first.first<<","<<it->first.second << ") " << it->second << std::endl;
@@ -8,6 +8,7 @@
 #include <iosfwd>
 
 #include "aux.hh"
+#include "flat_hash_map.hh"
 
 namespace LocARNA {
     
@@ -18,10 +19,13 @@ namespace LocARNA {
      * map. The class is designed to be largely exchangable with
      * non-sparse vectors.
      *
+     * Like in SparseMatrix, the hash map is selected by the
+     * backend.
+     *
      * @todo this code is basically a stripped down version of the SparseMatrix code;
      * likely one could reduce redundancy
      */
-    template <typename T>
+    template <typename T, class Backend = StdHashBackend>
     class SparseVector {
     public:
 	
@@ -33,7 +37,7 @@ namespace LocARNA {
 	
     protected:
 		
-	typedef typename unordered_map<key_t,value_t>::type map_t; //!< map type  
+	typedef typename Backend::template map<key_t,value_t>::type map_t; //!< map type  
 	map_t the_map_; //!< internal representation of sparse vector
 	value_t def_; //!< default value of vector entries
     
@@ -57,7 +61,7 @@ namespace LocARNA {
 	 */
 	class element {
 	private:
-	    SparseVector<T> *m_;
+	    SparseVector *m_;
 	    key_t k_;
 	public:
 	    /** 
@@ -67,7 +71,7 @@ namespace LocARNA {
 	     * @param k key/index of entry in given sparse vector
 	     *
 	     */
-	    element(SparseVector<T> *m,key_t k): m_(m),k_(k) {}
+	    element(SparseVector *m,key_t k): m_(m),k_(k) {}
 
 	    /** 
 	     * @brief Access entry for which the class acts as proxy
@@ -137,6 +141,11 @@ namespace LocARNA {
 	};
     
     
+	/** 
+	 * @brief Empty constructor (with default default value)
+	 */
+	SparseVector() : the_map_(),def_() {}
+	
 	/** 
 	 * @brief Construct with default value
 	 * 
@@ -253,9 +262,32 @@ namespace LocARNA {
 	const_iterator end() const {
 	    return the_map_.end();
 	}
+
+	/**
+	 * @brief Swap with other vector
+	 * @param v other vector
+	 */
+	void
+	swap(SparseVector &v) {
+	    the_map_.swap(v.the_map_);
+	    std::swap(def_,v.def_);
+	}
 	
     };
 
+    /**
+     * @brief Swap sparse vectors
+     *
+     * Avoids copying the entries, e.g. when vectors of a sparse
+     * matrix of vectors are moved within a FlatHashMap.
+     */
+    template<class T, class Backend>
+    inline
+    void
+    swap(SparseVector<T,Backend> &v, SparseVector<T,Backend> &w) {
+	v.swap(w);
+    }
+
     /** 
      * @brief Output operator
      * 
@@ -264,11 +296,11 @@ namespace LocARNA {
      * 
      * @return output stream after writing
      */
-    template<class T>
+    template<class T, class Backend>
     inline
     std::ostream &
-    operator <<(std::ostream &out, const SparseVector<T> &v) {
-	for (typename SparseVector<T>::const_iterator it=v.begin();
+    operator <<(std::ostream &out, const SparseVector<T,Backend> &v) {
+	for (typename SparseVector<T,Backend>::const_iterator it=v.begin();
 	     v.end()!=it; 
 	     ++it) {
 	    out <<it->first <<":" << it->second << " ";
@@ -4,6 +4,17 @@
 
 namespace LocARNA {
 
+void SparsificationMapper::compute_anchored_pos(){
+	const SequenceAnnotation &anchors =
+		rnadata.sequence().annotation(MultipleAlignment::AnnoType::anchors);
+	size_type seq_length = rnadata.length();
+	anchored_pos.resize(seq_length+2,false);
+	if (anchors.empty()) return;
+	for(size_type pos=1;pos<=seq_length;pos++){
+		anchored_pos[pos] = !anchors.is_neutral_pos(pos);
+	}
+}
+
 void SparsificationMapper::compute_mapping_idx_arcs(){
 	info_for_pos struct_pos;
 	left_adj_vec.resize(bps.num_bps());
@@ -195,9 +206,9 @@ void SparsificationMapper::iterate_left_adj_list(pos_type cur_left_end, pos_type
 	}
 }
 
-std::ostream &operator << (std::ostream &out, const std::vector<SparsificationMapper::InfoForPosVec> &pos_vecs_) {
+std::ostream &operator << (std::ostream &out, const arena_vector<SparsificationMapper::InfoForPosVec>::type &pos_vecs_) {
 	size_type idx = 0;
-	for (std::vector<SparsificationMapper::InfoForPosVec>::const_iterator it = pos_vecs_.begin();it!=pos_vecs_.end();++it){
+	for (arena_vector<SparsificationMapper::InfoForPosVec>::type::const_iterator it = pos_vecs_.begin();it!=pos_vecs_.end();++it){
 		out << "Idx " << idx << std::endl;
 		out << (*it) << std::endl;
 		idx++;
@@ -36,7 +36,7 @@ class SparsificationMapper{
 public:
     typedef BasePairs__Arc Arc; //!< type of arc
 	typedef size_t ArcIdx; //!< type of arc index
-	typedef std::vector<ArcIdx> ArcIdxVec; //!< vector of arc indices
+	typedef arena_vector<ArcIdx>::type ArcIdxVec; //!< vector of arc indices (allocated from the current memory arena)
 	typedef pos_type matidx_t; //!< type for a matrix position
 	typedef pos_type seq_pos_t; //!< type for a sequence position
     
@@ -62,7 +62,7 @@ public:
 		}
 	};
 
-	typedef std::vector<info_for_pos> InfoForPosVec;//!< vector of struct info_for_pos that is assigned to the index (either common left end or arc index)
+	typedef arena_vector<info_for_pos>::type InfoForPosVec;//!< vector of struct info_for_pos that is assigned to the index (either common left end or arc index)
 
 private:
 
@@ -71,17 +71,22 @@ private:
 	const double prob_unpaired_in_loop_threshold; //!threshold for a unpaired position under a loop
 	const double prob_basepair_in_loop_threshold; //!threshold for a basepair under a loop
 	size_type max_info_vec_size; //! the maximal size of the info vectors
+
+	//! for each sequence position, whether it carries an anchor
+	//! name; anchored positions are valid in every loop, since
+	//! anchor constraints require them to be matched
+	std::vector<bool> anchored_pos;
 	//! for each index all valid sequence positions with additional information is stored \n
 	//! index_t->matidx_t->info_for_pos
-	std::vector<InfoForPosVec> info_valid_seq_pos_vecs;
+	arena_vector<InfoForPosVec>::type info_valid_seq_pos_vecs;
 
 	//! for each index and each sequence position the first valid position in the matrix before the sequence position is stored \n
 	//! index_t->seq_pos_t->matidx_t
-	std::vector<std::vector<matidx_t> > valid_mat_pos_vecs_before_eq;
+	arena_vector<arena_vector<matidx_t>::type>::type valid_mat_pos_vecs_before_eq;
 
 	//! for each index and each sequence position all valid arcs that have the sequence position as common left end are stored \n
 	//! index_t->seq_pos_t->ArcIdxVec
-	std::vector<std::vector<ArcIdxVec > > left_adj_vec;
+	arena_vector<arena_vector<ArcIdxVec>::type>::type left_adj_vec;
 
 	//! computes the datastructures for sparsification mapping based on indexing the arcs
 	void compute_mapping_idx_arcs();
@@ -101,6 +106,9 @@ private:
 
 	void valid_pos_external(pos_type cur_pos,const Arc *inner_arc, info_for_pos &struct_pos);
 
+	//! determines the anchored positions from the anchor annotation of the sequence
+	void compute_anchored_pos();
+
 
 public:
 	/**
@@ -122,14 +130,15 @@ public:
 				rnadata(rnadata_),
 				prob_unpaired_in_loop_threshold(prob_unpaired_in_loop_threshold_),
 				prob_basepair_in_loop_threshold(prob_basepair_in_loop_threshold_),
-				max_info_vec_size(0)
+				max_info_vec_size(0),
+				anchored_pos()
 	{
+		compute_anchored_pos();
 		if(index_left_ends){
 			compute_mapping_idx_left_ends();
 		}
 		else{
 //			compute_mapping_idx_arcs();
-			std::cout << "Caution: Pankov alignment branch. Incompatibilities for running other aligner tools, please use the original/master LocARNA package." << std::endl;
 			compute_mapping_idx_arcs_external();
 		}
 	}
@@ -365,11 +374,13 @@ public:
 	 * @param arc Arc
 	 * @param pos sequence position
 	 * @return true, if the probability that the inner_arc occurs in the loop closed by the arc is
-	 * 				 greater or equal to the threshold for a basepair under a loop \n
+	 * 				 greater or equal to the threshold for a basepair under a loop,
+	 * 				 or if pos is anchored \n
 	 * 		   false, otherwise
 	 */
 	bool is_valid_pos(const Arc &arc,seq_pos_t pos, bool conditional=false) const{
 	    assert(arc.left()<pos && pos<arc.right());
+	    if (anchored_pos[pos]) return true;
 	    if (conditional){
 			double outer_prob = rnadata.arc_prob(arc.left(),arc.right());
 			double joint_prob = rnadata.unpaired_in_loop_prob(pos,arc.left(),arc.right());
@@ -398,9 +409,9 @@ public:
  * @param vec vector
  * @return output stream object
  */
-template <class T>
-std::ostream& operator<<(std::ostream& out, const std::vector<T>& vec){
-	for(typename std::vector<T>::const_iterator it = vec.begin();it!=vec.end();it++){
+template <class T, class Alloc>
+std::ostream& operator<<(std::ostream& out, const std::vector<T,Alloc>& vec){
+	for(typename std::vector<T,Alloc>::const_iterator it = vec.begin();it!=vec.end();it++){
 		out << *it << " ";
 	}
 	return out;
@@ -412,7 +423,7 @@ std::ostream& operator<<(std::ostream& out, const std::vector<T>& vec){
  * @param pos_vecs_ input vector
  * @return output stream object
  */
-std::ostream &operator << (std::ostream &out, const std::vector<SparsificationMapper::InfoForPosVec> &pos_vecs_);
+std::ostream &operator << (std::ostream &out, const arena_vector<SparsificationMapper::InfoForPosVec>::type &pos_vecs_);
 
 /**
  * prints all valid sequence positions with additional information for one index
@@ -4,6 +4,10 @@
 #include <iostream>
 #include <iomanip>
 
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
 
 
 namespace LocARNA {
@@ -24,8 +28,15 @@ namespace LocARNA {
 	print_on_exit=print_on_exit_;
     }
     
+    // timers are shared by all threads; start and stop calls from
+    // inside a parallel region (e.g. concurrent alignments in mpankov)
+    // would interleave, therefore they are ignored. Time such code
+    // from outside the parallel region.
     bool
     StopWatch::start(const std::string &name) {
+#ifdef _OPENMP
+	if (omp_in_parallel()) return false;
+#endif
 	timer_t &t=timers[name];
 	
 	if (t.running) return false;
@@ -38,6 +49,9 @@ namespace LocARNA {
 
     bool
     StopWatch::stop(const std::string &name) {
+#ifdef _OPENMP
+	if (omp_in_parallel()) return false;
+#endif
 	assert(timers.find(name)!=timers.end());
 	
 	timer_t &t=timers[name];
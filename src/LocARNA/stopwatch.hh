@@ -62,6 +62,9 @@ namespace LocARNA {
 	 * @param name timer name
 	 * 
 	 * @return success
+	 *
+	 * @note start and stop are ignored inside of OpenMP parallel
+	 * regions, since the timers are shared by all threads
 	 */
 	bool
 	start(const std::string &name);
@@ -2,6 +2,7 @@
 #include "matrix.hh"
 #include "alphabet.hh"
 #include "rna_data.hh"
+#include "sequence_profile.hh"
 
 #include <algorithm>
 
@@ -19,6 +20,8 @@ namespace LocARNA {
 	  seqB(rnaB.sequence()),
 	  sim_mat(sim_mat_),
 	  alphabet(alphabet_),
+	  alphabet_idxA(),
+	  alphabet_idxB(),
 	  pf_struct_weight(pf_struct_weight_),
 	  gap_opening(gap_opening_),
 	  gap_extension(gap_extension_)
@@ -26,17 +29,27 @@ namespace LocARNA {
 	// initialize the vectors
 	init_prob_vecs(rnaA,p_upA,p_downA,p_unA);
 	init_prob_vecs(rnaB,p_upB,p_downB,p_unB);
+
+	init_alphabet_idx(seqA,alphabet_idxA);
+	init_alphabet_idx(seqB,alphabet_idxB);
     }
 
     double StralScore::sigma(size_type i, size_type j) const {
 	//
 	//
+	typedef SequenceProfile::code_t code_t;
+	const code_t *codesA = seqA.profile().column_codes(i);
+	const code_t *codesB = seqB.profile().column_codes(j);
+
 	int pairs=0;
 	double seq_score=0;
 	for (size_type k=0; k<seqA.num_of_rows(); k++) {
+	    int a = alphabet_idxA[codesA[k]];
+	    if (a<0) continue;
 	    for (size_type l=0; l<seqB.num_of_rows(); l++) {
-		if (alphabet.in(seqA[i][k]) && alphabet.in(seqB[j][l])) {
-		    seq_score += sim_mat(alphabet.idx(seqA[i][k]),alphabet.idx(seqB[j][l]));
+		int b = alphabet_idxB[codesB[l]];
+		if (b>=0) {
+		    seq_score += sim_mat(a,b);
 		    pairs++;
 		}
 	    }
@@ -56,6 +69,17 @@ namespace LocARNA {
 	return res;
     }
 
+    void StralScore::init_alphabet_idx(const Sequence &seq,
+				       std::vector<int> &alphabet_idx) {
+	// the symbol codes of the profile are preserved by reverse()
+	const SequenceProfile &profile = seq.profile();
+	alphabet_idx.resize(profile.num_of_symbols());
+	for (size_type code=0; code<profile.num_of_symbols(); ++code) {
+	    char c = profile.symbol(code);
+	    alphabet_idx[code] = alphabet.in(c) ? (int)alphabet.idx(c) : -1;
+	}
+    }
+
     void StralScore::init_prob_vecs(const RnaData &rna,
 				    p_vec_t &p_up,
 				    p_vec_t &p_down,
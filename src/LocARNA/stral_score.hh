@@ -11,10 +11,10 @@
 
 #include "aux.hh"
 #include "sequence.hh"
+#include "matrix_fwd.hh"
 
 namespace LocARNA {
 
-    template <class T> class Matrix;
     template <class T> class Alphabet;
     class RnaData;
 
@@ -36,11 +36,20 @@ namespace LocARNA {
     
 	const Matrix<double> &sim_mat;
 	const Alphabet<char> &alphabet;
+
+	//! alphabet index of symbol codes of seqA (-1 if not in alphabet)
+	std::vector<int> alphabet_idxA;
+	//! alphabet index of symbol codes of seqB (-1 if not in alphabet)
+	std::vector<int> alphabet_idxB;
+
 	double pf_struct_weight;
 	double gap_opening;
 	double gap_extension;
     
     private:
+	void init_alphabet_idx(const Sequence &seq,
+			       std::vector<int> &alphabet_idx);
+
 	void init_prob_vecs(const RnaData &rna,
 			    p_vec_t &p_up,
 			    p_vec_t &p_down,
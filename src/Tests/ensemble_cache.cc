@@ -0,0 +1,37 @@
+#include "catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <../LocARNA/ensemble_cache.hh>
+
+using namespace LocARNA;
+
+/** @file some unit tests for the EnsembleCache class
+*/
+
+TEST_CASE("Ensemble cache maps keys to files by a stable hash") {
+    // FNV-1a test vectors
+    REQUIRE( EnsembleCache::hash("") == "cbf29ce484222325" );
+    REQUIRE( EnsembleCache::hash("a") == "af63dc4c8601ec8c" );
+
+    EnsembleCache cache(".");
+    REQUIRE( cache.filename("a") == "./af63dc4c8601ec8c.pp" );
+    REQUIRE( cache.filename("a") != cache.filename("b") );
+
+    SECTION("entries are written completely") {
+        std::string filename = cache.filename("test entry");
+        REQUIRE( EnsembleCache::write(filename,"#PP 2.0\n") );
+
+        std::ifstream in(filename.c_str());
+        std::ostringstream content;
+        content << in.rdbuf();
+        REQUIRE( content.str() == "#PP 2.0\n" );
+
+        std::remove(filename.c_str());
+    }
+
+    SECTION("failing writes are not fatal") {
+        REQUIRE( !EnsembleCache::write("no-such-dir/entry.pp","#PP 2.0\n") );
+    }
+}
@@ -0,0 +1,134 @@
+#include "catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <algorithm>
+
+#include <../LocARNA/pfold_params.hh>
+#include <../LocARNA/ext_rna_data.hh>
+#include <../LocARNA/sequence.hh>
+#include <../LocARNA/trace_controller.hh>
+#include <../LocARNA/anchor_constraints.hh>
+#include <../LocARNA/arc_matches.hh>
+#include <../LocARNA/sparsification_mapper.hh>
+#include <../LocARNA/exact_matcher.hh>
+
+using namespace LocARNA;
+
+/** @file some unit tests for ExactMatcher and LCSEPM
+
+    The expected EPMs and chain scores were computed by the
+    implementation before the sparse chaining and the level-wise
+    scoring of arc matches (with exparna_p default parameters).
+*/
+
+namespace {
+    //! @brief number and total score of the EPMs in a list
+    std::pair<int,int>
+    count_and_score(const PatternPairMap::patListTYPE &list) {
+        int score=0;
+        for (PatternPairMap::patListCITER it=list.begin(); it!=list.end(); ++it) {
+            score += (*it)->getScore();
+        }
+        return std::make_pair((int)list.size(),score);
+    }
+}
+
+TEST_CASE("ExactMatcher finds the same EPMs and chains as before") {
+    std::string filenameA="test_epm_A.pp";
+    std::string filenameB="test_epm_B.pp";
+
+    std::ofstream outA(filenameA.c_str());
+    outA << "seqA GGAGGAUUAGCUCAGCUGGGAGAGCAUCUGCCUUACAAGCAGAGGGUCGGCGGUUCGAGCCCGUCAUCCUCCA"<<std::endl
+         << "#FS  (((((((..((((........)))).(((((.......))))).....(((((.......))))))))))))."<<std::endl;
+    outA.close();
+
+    std::ofstream outB(filenameB.c_str());
+    outB << "seqB GGAGGAUUAGCUCAGCUGGUAGAGCAUCUGCCUUAUAAGCAGAGGGUCGACGGUUCGAGCCCGUCAUCCUCCA"<<std::endl
+         << "#FS  (((((((..(((..........))).(((((.......))))).....(((((.......))))))))))))."<<std::endl;
+    outB.close();
+
+    PFoldParams pfparams(false,true,-1,2);
+    ExtRnaData rna_dataA(filenameA,0.0005,0.01,0.01,0,0,0,pfparams);
+    ExtRnaData rna_dataB(filenameB,0.0005,0.01,0.01,0,0,0,pfparams);
+
+    std::remove(filenameA.c_str());
+    std::remove(filenameB.c_str());
+
+    const Sequence &seqA=rna_dataA.sequence();
+    const Sequence &seqB=rna_dataB.sequence();
+    size_t len = std::max(seqA.length(),seqB.length());
+
+    TraceController trace_controller(seqA,seqB,NULL,-1);
+    AnchorConstraints seq_constraints(seqA.length(),"",seqB.length(),"");
+
+    ArcMatches arc_matches(rna_dataA,rna_dataB,0.01,30,len,
+                           trace_controller,seq_constraints);
+
+    SparsificationMapper mapperA(arc_matches.get_base_pairsA(),rna_dataA,0.01,0.01,false);
+    SparsificationMapper mapperB(arc_matches.get_base_pairsB(),rna_dataB,0.01,0.01,false);
+    SparseTraceController sparse_trace_controller(mapperA,mapperB,trace_controller);
+
+    PatternPairMap epms;
+    ExactMatcher em(seqA,seqB,rna_dataA,rna_dataB,arc_matches,
+                    sparse_trace_controller,epms,
+                    1,5,5,  // alpha_1, alpha_2, alpha_3
+                    -1,     // difference to optimal score
+                    20,     // minimal score
+                    100,    // number of EPMs
+                    false,  // inexact struct match
+                    -10,    // struct mismatch score
+                    false,  // add filter
+                    false   // verbose
+                    );
+
+    em.compute_arcmatch_score();
+
+    SECTION("heuristic traceback") {
+        em.trace_EPMs(false);
+
+        std::ostringstream out;
+        out << epms.getList();
+
+        REQUIRE( out.str() ==
+                 "epm_id\t score\t structure\t positions\n"
+                 "0\t3400\t(())\t11:28 12:29 23:41 24:42 \n"
+                 "1\t3500\t(()).\t12:27 13:28 22:42 23:43 24:44 \n"
+                 "2\t3500\t(()).\t10:30 11:31 24:39 25:40 26:41 \n"
+                 "3\t7500\t.........((()))..........\t1:1 2:2 3:3 4:4 5:5 6:6 7:7 8:8 9:9 10:10 11:11 12:12 23:23 24:24 25:25 26:26 27:27 28:28 29:29 30:30 31:31 32:32 33:33 34:34 35:35 \n"
+                 "4\t3500\t(()).\t30:10 31:11 39:24 40:25 41:26 \n"
+                 "5\t3400\t(())\t28:11 29:12 41:23 42:24 \n"
+                 "6\t17800\t.........((())).(((((......)))))......\t1:1 2:2 3:3 4:4 5:5 6:6 7:7 8:8 9:9 10:10 11:11 12:12 23:23 24:24 25:25 26:26 27:27 28:28 29:29 30:30 31:31 32:32 33:33 34:34 35:35 37:37 38:38 39:39 40:40 41:41 42:42 43:43 44:44 45:45 46:46 47:47 48:48 49:49 \n"
+                 "7\t5600\t((()))\t4:1 5:2 6:3 67:70 68:71 69:72 \n"
+                 "8\t5600\t((()))\t1:4 2:5 3:6 70:67 71:68 72:69 \n"
+                 "9\t32700\t(((((((..((())).(((((......))))).....()))))))).\t1:1 2:2 3:3 4:4 5:5 6:6 7:7 8:8 9:9 10:10 11:11 12:12 23:23 24:24 25:25 26:26 27:27 28:28 29:29 30:30 31:31 32:32 33:33 34:34 35:35 37:37 38:38 39:39 40:40 41:41 42:42 43:43 44:44 45:45 46:46 47:47 48:48 49:49 65:65 66:66 67:67 68:68 69:69 70:70 71:71 72:72 73:73 \n"
+                 );
+
+        SECTION("and chain") {
+            PatternPairMap chain;
+            LCSEPM chaining(seqA,seqB,epms,chain);
+            chaining.calculateLCSEPM(true);
+
+            REQUIRE( chain.size() == 1 );
+            REQUIRE( chain.getMapEPMScore() == 32700 );
+            REQUIRE( chain.getMapBases() == 47 );
+        }
+    }
+
+    SECTION("suboptimal traceback") {
+        em.trace_EPMs(true);
+
+        REQUIRE( count_and_score(epms.getList()) == std::make_pair(64,730500) );
+
+        SECTION("and chain") {
+            PatternPairMap chain;
+            LCSEPM chaining(seqA,seqB,epms,chain);
+            chaining.calculateLCSEPM(true);
+
+            REQUIRE( chain.size() == 1 );
+            REQUIRE( chain.getMapEPMScore() == 32700 );
+            REQUIRE( chain.getMapBases() == 47 );
+        }
+    }
+}
@@ -5,6 +5,8 @@
 
 #include <../LocARNA/pfold_params.hh>
 #include <../LocARNA/ext_rna_data.hh>
+#include <../LocARNA/sequence.hh>
+#include <../LocARNA/alignment.hh>
 
 using namespace LocARNA;
 
@@ -107,3 +109,47 @@ TEST_CASE("ExtRnaData can initialize from fixed structure, even in the context o
         std::remove(filename.c_str());
     }
 }
+
+TEST_CASE("ExtRnaData can construct pairwise consensus in loop probabilities") {
+    std::string filenameA="test_ext_consensusA.pp";
+    std::string filenameB="test_ext_consensusB.pp";
+
+    std::ofstream outA(filenameA.c_str());
+    outA << "seqA CCCUCGGG"<<std::endl
+         << "#FS  ((...).)"<<std::endl;
+    outA.close();
+
+    std::ofstream outB(filenameB.c_str());
+    outB << "seqB CCCUUCGGG"<<std::endl
+         << "#FS  ((....).)"<<std::endl;
+    outB.close();
+
+    PFoldParams pfoldparams(false,false,-1,2);
+    ExtRnaData rna_dataA(filenameA, 0.01, 0.01, 0.01,
+                         -1, -1, -1, pfoldparams);
+    ExtRnaData rna_dataB(filenameB, 0.01, 0.01, 0.01,
+                         -1, -1, -1, pfoldparams);
+
+    std::remove(filenameA.c_str());
+    std::remove(filenameB.c_str());
+
+    Alignment alignment(rna_dataA.sequence(),rna_dataB.sequence(),
+                        Alignment::edges_t(Alignment::alistr_to_edge_ends("CCCU-CGGG"),
+                                           Alignment::alistr_to_edge_ends("CCCUUCGGG")));
+
+    ExtRnaData consensus(rna_dataA,rna_dataB,alignment,0.01,0.01);
+
+    REQUIRE( consensus.arc_prob(1,9) > 0.99 );
+    REQUIRE( consensus.arc_prob(2,7) > 0.99 );
+
+    REQUIRE( consensus.arc_external_prob(1,9) > 0.99 );
+    REQUIRE( consensus.arc_in_loop_prob(2,7,1,9) > 0.99 );
+
+    REQUIRE( consensus.unpaired_in_loop_prob(3,2,7) > 0.99 );
+    REQUIRE( consensus.unpaired_in_loop_prob(8,1,9) > 0.99 );
+    REQUIRE( consensus.unpaired_in_loop_prob(3,1,9) < 0.01 );
+
+    // unpaired only in B
+    REQUIRE( consensus.unpaired_in_loop_prob(5,2,7) > 0.01 );
+    REQUIRE( consensus.unpaired_in_loop_prob(5,2,7) < 0.99 );
+}
@@ -0,0 +1,58 @@
+#include "catch.hpp"
+
+#include <sstream>
+#include <../LocARNA/guide_tree.hh>
+
+using namespace LocARNA;
+
+/** @file some unit tests for the GuideTree class
+*/
+
+TEST_CASE("Guide trees join the most similar sequences first") {
+    // three pairs of similar sequences
+    double scores[] = {
+	    0, 5945, -3217, -2917, -1695, -1425,
+	 5945,    0, -2301, -2482, -1672, -1402,
+	-3217, -2301,    0,  6397, -2932, -2687,
+	-2917, -2482,  6397,    0, -2624, -3184,
+	-1695, -1672, -2932, -2624,    0,  5396,
+	-1425, -1402, -2687, -3184,  5396,    0
+    };
+    GuideTree::score_matrix_t m(6,6,scores);
+
+    std::vector<std::string> names;
+    names.push_back("a1");
+    names.push_back("a2");
+    names.push_back("b1");
+    names.push_back("b2");
+    names.push_back("c1");
+    names.push_back("c2");
+
+    SECTION("UPGMA") {
+	GuideTree tree(m,GuideTree::Method::UPGMA);
+
+	REQUIRE(tree.num_nodes() == 11);
+	REQUIRE(tree.root() == 10);
+	REQUIRE(tree.size(tree.root()) == 6);
+
+	std::ostringstream out;
+	tree.write_newick(out,names);
+	REQUIRE(out.str() == "(((a1,a2),(c1,c2)),(b1,b2));");
+    }
+
+    SECTION("neighbor joining") {
+	GuideTree tree(m,GuideTree::Method::NJ);
+
+	REQUIRE(tree.num_nodes() == 11);
+
+	// children are always constructed before their parents
+	for (size_type node=tree.num_leaves(); node<tree.num_nodes(); ++node) {
+	    REQUIRE(tree.left(node) < node);
+	    REQUIRE(tree.right(node) < node);
+	}
+
+	std::ostringstream out;
+	tree.write_newick(out,names);
+	REQUIRE(out.str() == "(((a1,a2),(c1,c2)),(b1,b2));");
+    }
+}
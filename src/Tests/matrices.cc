@@ -3,6 +3,9 @@
 #include <cassert>
 #include <algorithm>
 #include <../LocARNA/matrices.hh>
+#include <../LocARNA/aligned_array.hh>
+#include <../LocARNA/sparse_matrix.hh>
+#include <../LocARNA/sparse_vector.hh>
 
 using namespace LocARNA;
 
@@ -41,6 +44,55 @@ TEST_CASE("Matrix can be resized, filled, and transformed") {
     
 }
 
+TEST_CASE("Matrix with aligned storage and alternative layouts behaves like the default matrix") {
+    size_t x=13;
+    size_t y=21;
+
+    Matrix<size_t> m;
+    m.resize(x,y);
+    for(size_t i=0; i<x; i++) {
+        for(size_t j=0; j<y; j++) {
+            m(i,j) = i*100+j;
+        }
+    }
+
+    Matrix<size_t, AlignedArray<size_t>, AlignedRowLayout<> > ma;
+    Matrix<size_t, AlignedArray<size_t,false>, BlockedLayout<4> > mb;
+    ma.assign(x,y,1);
+    mb.resize(x,y);
+    mb.fill(1);
+    for(size_t i=0; i<x; i++) {
+        for(size_t j=0; j<y; j++) {
+            ma(i,j) += m(i,j);
+            mb(i,j) += m(i,j);
+        }
+    }
+
+    SECTION("entries are read again") {
+        bool ok=true;
+        for(size_t i=0; i<x; i++) {
+            for(size_t j=0; j<y; j++) {
+                ok &= ma(i,j)==m(i,j)+1 && mb(i,j)==m(i,j)+1;
+            }
+        }
+        REQUIRE(ok);
+    }
+
+    SECTION("rows are aligned") {
+        REQUIRE( (size_t)&ma(0,0) % 64 == 0 );
+        REQUIRE( (size_t)&ma(5,0) % 64 == 0 );
+        REQUIRE( &ma(5,0) - &ma(4,0) == 24 );
+    }
+
+    SECTION("copies are independent") {
+        Matrix<size_t, AlignedArray<size_t>, AlignedRowLayout<> > mc(ma);
+        mc.transform(mul2());
+        REQUIRE( mc(3,7) == 2*ma(3,7) );
+        ma = mc;
+        REQUIRE( ma(12,20) == mc(12,20) );
+    }
+}
+
 TEST_CASE("OMatrix can be filled and read again") {    
     size_t x=3;
     size_t y=4;
@@ -87,3 +139,117 @@ TEST_CASE("OMatrix can be filled and read again") {
         REQUIRE(reread_ok);
     }
 }
+
+TEST_CASE("RowMatrix allocates rows on demand and releases them") {
+    size_t x=3;
+    size_t y=4;
+
+    RowMatrix<size_t> m;
+    m.resize(x,y);
+    m.fill(7);
+
+    const RowMatrix<size_t> &cm = m;
+
+    // rows that were never written read as fill value
+    REQUIRE( cm(1,2) == 7 );
+
+    for(size_t i=0; i<x; i++) {
+	for(size_t j=0; j<y; j++) {
+	    m(i,j) += i*j;
+	}
+    }
+
+    m.release_row(0);
+
+    bool reread_ok=true;
+    for(size_t i=1; i<x; i++) {
+	for(size_t j=0; j<y; j++) {
+	    reread_ok &= ( cm(i,j) == 7+i*j );
+	}
+    }
+    REQUIRE(reread_ok);
+}
+
+TEST_CASE("SparseMatrix with flat hash backend behaves like the default backend") {
+    SparseMatrix<int> m(-1);
+    SparseMatrix<int,FlatHashBackend> fm(-1);
+
+    // pseudo random writes, increments and resets of a 100x100 matrix,
+    // such that tables grow and entries are erased from probe chains
+    size_t x=1;
+    for (size_t k=0; k<20000; k++) {
+	x = (x*1103515245+12345) % 2147483648UL;
+	size_t i = (x>>8) % 100;
+	size_t j = (x>>16) % 100;
+	switch (x%4) {
+	case 0: m.set(i,j,k); fm.set(i,j,k); break;
+	case 1: m(i,j) += 3; fm(i,j) += 3; break;
+	case 2: m.reset(i,j); fm.reset(i,j); break;
+	case 3: m(i,j) = -1; fm(i,j) = -1; break;
+	}
+    }
+
+    REQUIRE( m.size() == fm.size() );
+
+    const SparseMatrix<int,FlatHashBackend> &cfm = fm;
+    bool reread_ok=true;
+    for (size_t i=0; i<100; i++) {
+	for (size_t j=0; j<100; j++) {
+	    reread_ok &= ( m(i,j) == cfm(i,j) );
+	}
+    }
+    REQUIRE(reread_ok);
+
+    size_t visited=0;
+    for (SparseMatrix<int,FlatHashBackend>::const_iterator it=fm.begin();
+	 fm.end()!=it; ++it) {
+	reread_ok &= ( it->second == m(it->first.first,it->first.second) );
+	visited++;
+    }
+    REQUIRE(reread_ok);
+    REQUIRE( visited == m.size() );
+
+    fm.ref(7,8) = 42;
+    REQUIRE( cfm(7,8) == 42 );
+
+    SparseVector<double,FlatHashBackend> v(0.0);
+    v[3] = 0.5;
+    v[3] += 0.25;
+    v[5] = 0.0;
+    REQUIRE( v.size() == 1 );
+    const SparseVector<double,FlatHashBackend> &cv = v;
+    REQUIRE( cv[3] == 0.75 );
+    
+    fm.clear();
+    REQUIRE( fm.empty() );
+    REQUIRE( fm.begin() == fm.end() );
+}
+
+TEST_CASE("Nested sparse matrices with flat hash backend keep their entries on erase") {
+    typedef SparseMatrix<double,FlatHashBackend> inner_t;
+    SparseMatrix<inner_t,FlatHashBackend> mm((inner_t(0.0)));
+
+    // fill enough outer entries, such that erasing shifts entries
+    // of probe chains
+    for (size_t i=0; i<50; i++) {
+	for (size_t j=i+1; j<i+5; j++) {
+	    mm.ref(i,j).set(i,j,(double)(i+j));
+	}
+    }
+    for (size_t i=0; i<50; i+=2) {
+	mm.reset(i,i+1);
+    }
+
+    bool entries_ok=true;
+    for (size_t i=0; i<50; i++) {
+	for (size_t j=i+1; j<i+5; j++) {
+	    const inner_t &m = static_cast<const SparseMatrix<inner_t,FlatHashBackend> &>(mm)(i,j);
+	    bool erased = (i%2==0 && j==i+1);
+	    entries_ok &= erased
+		? m.empty()
+		: (m.size()==1 && m(i,j)==(double)(i+j));
+	}
+    }
+    REQUIRE(entries_ok);
+    REQUIRE( mm.size() == 50*4-25 );
+}
@@ -0,0 +1,132 @@
+#include "catch.hpp"
+
+#include <cstddef>
+#include <utility>
+#include <../LocARNA/memory_arena.hh>
+
+using namespace LocARNA;
+
+/** @file some unit tests for the MemoryArena class
+*/
+
+TEST_CASE("Memory arena serves containers in its scope and releases them at once") {
+    MemoryArena arena(1024);
+
+    SECTION("allocations are aligned and counted") {
+        char *p = static_cast<char *>(arena.allocate(3));
+        char *q = static_cast<char *>(arena.allocate(100));
+        REQUIRE( (size_t)p % MemoryArena::alignment == 0 );
+        REQUIRE( (size_t)q % MemoryArena::alignment == 0 );
+        REQUIRE( q-p == (std::ptrdiff_t)MemoryArena::alignment );
+
+        // large allocation gets a chunk of its own
+        arena.allocate(10000);
+        REQUIRE( arena.allocated_bytes() >= 10103 );
+        REQUIRE( arena.reserved_bytes() >= arena.allocated_bytes() );
+
+        arena.release();
+        REQUIRE( arena.allocated_bytes() == 0 );
+        REQUIRE( arena.reserved_bytes() == 0 );
+    }
+
+    SECTION("containers bind to the current arena") {
+        typedef arena_vector<int>::type vec_t;
+
+        REQUIRE( MemoryArena::current() == 0L );
+        vec_t outside;
+        {
+            ArenaScope scope(arena);
+            REQUIRE( MemoryArena::current() == &arena );
+
+            vec_t inside;
+            for (int i=0; i<1000; i++) {
+                inside.push_back(i);
+                outside.push_back(i);
+            }
+            REQUIRE( inside.get_allocator().arena() == &arena );
+            REQUIRE( arena.allocated_bytes() >= 1000*sizeof(int) );
+
+            // nested containers
+            arena_vector<vec_t>::type nested(10);
+            nested[9].push_back(1);
+            REQUIRE( nested[9].get_allocator().arena() == &arena );
+        }
+        REQUIRE( MemoryArena::current() == 0L );
+        REQUIRE( outside.get_allocator().arena() == 0L );
+        REQUIRE( outside[999] == 999 );
+    }
+}
+
+TEST_CASE("Copies of arena containers do not depend on the arena of the original") {
+    typedef arena_vector<int>::type vec_t;
+    typedef arena_vector<vec_t>::type vecvec_t;
+
+    MemoryArena arena(1024);
+
+    vecvec_t heap_copy;
+    vecvec_t heap_nested;
+    {
+        ArenaScope scope(arena);
+
+        vecvec_t original(10,vec_t(100,1));
+        std::size_t allocated = arena.allocated_bytes();
+        REQUIRE( allocated >= 10*100*sizeof(int) );
+
+        {
+            // copies and their nested containers go to the heap
+            // outside of an arena scope
+            ArenaScope heap_scope(0L);
+            heap_copy = original;
+            vecvec_t copy(original);
+            copy.swap(heap_copy);
+        }
+        REQUIRE( arena.allocated_bytes() == allocated );
+
+        // elements of a heap container stay on the heap, even if
+        // they are copied in the scope of an arena
+        heap_nested.push_back(original[0]);
+        heap_nested.resize(5);
+        REQUIRE( arena.allocated_bytes() == allocated );
+
+        // copies in the scope use the arena
+        vecvec_t arena_copy(original);
+        REQUIRE( arena.allocated_bytes() > allocated );
+    }
+    arena.release();
+
+    REQUIRE( heap_copy.size() == 10 );
+    REQUIRE( heap_copy[9].size() == 100 );
+    REQUIRE( heap_copy[9][99] == 1 );
+    heap_copy[9].push_back(2);
+    REQUIRE( arena.allocated_bytes() == 0 );
+    REQUIRE( heap_nested[0][99] == 1 );
+}
+
+#if __cplusplus >= 201103L
+TEST_CASE("Moved arena containers keep the arena of the original") {
+    typedef arena_vector<int>::type vec_t;
+
+    MemoryArena arena(1024);
+    ArenaScope scope(arena);
+
+    vec_t inside(100,1);
+    std::size_t allocated = arena.allocated_bytes();
+    {
+        // moves outside of the arena scope take over the arena
+        // memory; they must not free it on the heap
+        ArenaScope heap_scope(0L);
+        vec_t moved(std::move(inside));
+        REQUIRE( moved.size() == 100 );
+
+        vec_t assigned;
+        assigned = std::move(moved);
+        REQUIRE( assigned[99] == 1 );
+
+        vec_t swapped(10,2);
+        swapped.swap(assigned);
+        REQUIRE( swapped.size() == 100 );
+        REQUIRE( assigned.size() == 10 );
+    }
+    REQUIRE( arena.allocated_bytes() == allocated );
+}
+#endif
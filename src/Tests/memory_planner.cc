@@ -0,0 +1,130 @@
+#include "catch.hpp"
+
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+
+#include <../LocARNA/aux.hh>
+#include <../LocARNA/pfold_params.hh>
+#include <../LocARNA/ext_rna_data.hh>
+#include <../LocARNA/sequence.hh>
+#include <../LocARNA/trace_controller.hh>
+#include <../LocARNA/anchor_constraints.hh>
+#include <../LocARNA/arc_matches.hh>
+#include <../LocARNA/sparsification_mapper.hh>
+#include <../LocARNA/memory_planner.hh>
+
+using namespace LocARNA;
+
+/** @file some unit tests for the MemoryPlanner class
+*/
+
+TEST_CASE("Memory planner parses budgets and estimates memory") {
+    typedef MemoryPlanner::size_type size_type;
+
+    SECTION("memory sizes are parsed with binary suffixes") {
+        REQUIRE( MemoryPlanner::parse_size("1000") == 1000 );
+        REQUIRE( MemoryPlanner::parse_size("2K") == 2048 );
+        REQUIRE( MemoryPlanner::parse_size("1.5M") == 1536*1024 );
+        REQUIRE( MemoryPlanner::parse_size("4GB") == (size_type)4*1024*1024*1024 );
+        REQUIRE( MemoryPlanner::parse_size("3g") == (size_type)3*1024*1024*1024 );
+
+        REQUIRE_THROWS_AS( MemoryPlanner::parse_size(""), failure & );
+        REQUIRE_THROWS_AS( MemoryPlanner::parse_size("G"), failure & );
+        REQUIRE_THROWS_AS( MemoryPlanner::parse_size("12Q"), failure & );
+        REQUIRE_THROWS_AS( MemoryPlanner::parse_size("1MBx"), failure & );
+    }
+
+    SECTION("memory sizes are formatted") {
+        REQUIRE( MemoryPlanner::format_size(100) == "100B" );
+        REQUIRE( MemoryPlanner::format_size(1536) == "1.5K" );
+        REQUIRE( MemoryPlanner::format_size(4*1024*1024) == "4.0M" );
+    }
+
+    SECTION("estimates grow with the number of base pairs") {
+        MemoryPlanner::Aligner::type aligners[] =
+            { MemoryPlanner::Aligner::N,
+              MemoryPlanner::Aligner::NN,
+              MemoryPlanner::Aligner::P };
+
+        for (size_t i=0; i<3; i++) {
+            size_type small =
+                MemoryPlanner::estimate(aligners[i],200,200,100,100,20,20,2000);
+            size_type large =
+                MemoryPlanner::estimate(aligners[i],200,200,400,400,20,20,30000);
+            REQUIRE( small > 0 );
+            REQUIRE( small < large );
+        }
+    }
+
+    SECTION("the cutoff is tightened up to 1") {
+        REQUIRE( MemoryPlanner::tighter_cutoff(0) > 0 );
+        REQUIRE( MemoryPlanner::tighter_cutoff(0.01) == 0.02 );
+        REQUIRE( MemoryPlanner::tighter_cutoff(0.8) == 1.0 );
+    }
+}
+
+TEST_CASE("Memory planner fits arc matches into the budget") {
+    std::string filenameA="test_planner_A.pp";
+    std::string filenameB="test_planner_B.pp";
+
+    std::ofstream outA(filenameA.c_str());
+    outA << "seqA GGAGGAUUAGCUCAGCUGGGAGAGCAUCUGCCUUACAAGCAGAGGGUCGGCGGUUCGAGCCCGUCAUCCUCCA"<<std::endl
+         << "#FS  (((((((..((((........)))).(((((.......))))).....(((((.......))))))))))))."<<std::endl;
+    outA.close();
+
+    std::ofstream outB(filenameB.c_str());
+    outB << "seqB GGAGGAUUAGCUCAGCUGGUAGAGCAUCUGCCUUAUAAGCAGAGGGUCGACGGUUCGAGCCCGUCAUCCUCCA"<<std::endl
+         << "#FS  (((((((..(((..........))).(((((.......))))).....(((((.......))))))))))))."<<std::endl;
+    outB.close();
+
+    PFoldParams pfparams(false,true,-1,2);
+    ExtRnaData rna_dataA(filenameA,0.0005,0.01,0.01,0,0,0,pfparams);
+    ExtRnaData rna_dataB(filenameB,0.0005,0.01,0.01,0,0,0,pfparams);
+
+    std::remove(filenameA.c_str());
+    std::remove(filenameB.c_str());
+
+    const Sequence &seqA=rna_dataA.sequence();
+    const Sequence &seqB=rna_dataB.sequence();
+    size_t len = std::max(seqA.length(),seqB.length());
+
+    TraceController trace_controller(seqA,seqB,NULL,-1);
+    AnchorConstraints seq_constraints(seqA.length(),"",seqB.length(),"");
+
+    double min_prob=0.01;
+
+    SECTION("without budget, the arc matches are constructed once") {
+        MemoryPlanner planner(MemoryPlanner::Aligner::N,
+                              MemoryPlanner::unlimited,
+                              &rna_dataA,&rna_dataB,0.01,0.01);
+        ArcMatches *arc_matches =
+            planner.fit_arc_matches(rna_dataA,rna_dataB,min_prob,len,len,
+                                    trace_controller,seq_constraints);
+
+        REQUIRE( planner.fits() );
+        REQUIRE( min_prob == 0.01 );
+
+        // the mapper is built on demand
+        const SparsificationMapper &mapperA =
+            planner.sparsification_mapperA(arc_matches->get_base_pairsA());
+        REQUIRE( &mapperA ==
+                 &planner.sparsification_mapperA(arc_matches->get_base_pairsA()) );
+        REQUIRE( mapperA.get_max_info_vec_size() > 0 );
+
+        delete arc_matches;
+    }
+
+    SECTION("the cutoff is tightened until it reaches 1") {
+        MemoryPlanner planner(MemoryPlanner::Aligner::N, 1,
+                              &rna_dataA,&rna_dataB,0.01,0.01);
+        ArcMatches *arc_matches =
+            planner.fit_arc_matches(rna_dataA,rna_dataB,min_prob,len,len,
+                                    trace_controller,seq_constraints);
+
+        REQUIRE( !planner.fits() );
+        REQUIRE( min_prob == 1.0 );
+
+        delete arc_matches;
+    }
+}
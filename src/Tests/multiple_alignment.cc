@@ -3,6 +3,8 @@
 #include <iostream>
 #include <sstream>
 #include <../LocARNA/multiple_alignment.hh>
+#include <../LocARNA/multiple_alignment_comparison.hh>
+#include <../LocARNA/sequence_profile.hh>
 #include <../LocARNA/alignment.hh>
 #include <../LocARNA/sequence.hh>
 
@@ -135,3 +137,157 @@ TEST_CASE("multiple alignment can be constructed from file (fasta)") {
         }
     }
 }
+
+TEST_CASE("a multiple alignment can be compared to a reference alignment") {
+    MultipleAlignment ref("seqA","seqB",
+                          "A-CGT-U",
+                          "CCCG-CU");
+    
+    SECTION("the alignment is identical to itself") {
+        MultipleAlignmentComparison comparison(ref,ref);
+        
+        REQUIRE(comparison.deviation() == 0);
+        REQUIRE(comparison.sps(true) == 1.0);
+        REQUIRE(comparison.sps(false) == 1.0);
+        REQUIRE(comparison.avg_deviation_score() == 0.0);
+        REQUIRE(comparison.cmfinder_realignment_score() == 0.0);
+    }
+    
+    SECTION("scores of a different alignment agree with the single comparisons") {
+        MultipleAlignment ma("seqA","seqB",
+                             "ACGTU--",
+                             "-CCCGCU");
+        
+        MultipleAlignmentComparison comparison(ma,ref);
+        
+        REQUIRE(comparison.deviation() == 2);
+        REQUIRE(comparison.sps(true) == Approx(1.0/11.0));
+        REQUIRE(comparison.sps(false) == 0.0);
+        REQUIRE(comparison.avg_deviation_score() == Approx(17.0/11.0));
+        REQUIRE(comparison.cmfinder_realignment_score() == 1.0);
+        
+        REQUIRE(comparison.pairwise_deviation()(0,1) == 2);
+        REQUIRE(comparison.pairwise_sps(true)(1,0) == Approx(1.0/11.0));
+        
+        REQUIRE(ref.deviation(ma) == comparison.deviation());
+        REQUIRE(ref.sps(ma,true) == comparison.sps(true));
+        REQUIRE(ref.avg_deviation_score(ma) == comparison.avg_deviation_score());
+    }
+    
+    SECTION("comparing to a reference with missing sequences fails") {
+        MultipleAlignment ma("seqA","seqC",
+                             "ACGTU",
+                             "CCCGC");
+        
+        REQUIRE_THROWS_AS(MultipleAlignmentComparison(ma,ref), failure &);
+    }
+}
+
+TEST_CASE("multiple alignments can be read one at a time from a stream") {
+    std::ostringstream out;
+    
+    MultipleAlignment ma1("seqA","seqB",
+                          "A-CGT-U",
+                          "CCCG-CU");
+    MultipleAlignment ma2("seqC","seqD",
+                          "GGAC-U",
+                          "G-ACCU");
+    
+    SECTION("several entries of a stockholm stream are read in order") {
+        out << "# STOCKHOLM 1.0" << std::endl;
+        ma1.write(out,MultipleAlignment::FormatType::STOCKHOLM);
+        out << std::endl << "# STOCKHOLM 1.0" << std::endl;
+        ma2.write(out,3,MultipleAlignment::FormatType::STOCKHOLM);
+        
+        std::istringstream in(out.str());
+        MultipleAlignmentReader reader(in,MultipleAlignment::FormatType::STOCKHOLM);
+        
+        MultipleAlignment ma;
+        REQUIRE(reader.next(ma));
+        REQUIRE(ma.num_of_rows() == 2);
+        REQUIRE(ma.seqentry("seqA").seq().str() == "A-CGT-U");
+        REQUIRE(ma.seqentry("seqB").seq().str() == "CCCG-CU");
+        
+        // the second entry is written in blocks of width 3
+        REQUIRE(reader.next(ma));
+        REQUIRE(ma.num_of_rows() == 2);
+        REQUIRE(!ma.contains("seqA"));
+        REQUIRE(ma.seqentry("seqC").seq().str() == "GGAC-U");
+        REQUIRE(ma.seqentry("seqD").seq().str() == "G-ACCU");
+        
+        REQUIRE(!reader.next(ma));
+    }
+    
+    SECTION("anchor annotation is read from stockholm") {
+        std::vector<std::string> anchors;
+        anchors.push_back("..1..2.");
+        ma1.set_annotation(MultipleAlignment::AnnoType::anchors,
+                           SequenceAnnotation(anchors));
+        
+        out << "# STOCKHOLM 1.0" << std::endl;
+        ma1.write(out,MultipleAlignment::FormatType::STOCKHOLM);
+        
+        std::istringstream in(out.str());
+        MultipleAlignment ma(in,MultipleAlignment::FormatType::STOCKHOLM);
+        
+        REQUIRE(ma.has_annotation(MultipleAlignment::AnnoType::anchors));
+        REQUIRE(ma.annotation(MultipleAlignment::AnnoType::anchors).annotation_string(0)
+                == "..1..2.");
+    }
+}
+
+TEST_CASE("the column profile of a multiple alignment counts symbols") {
+    MultipleAlignment ma("seqA","seqB",
+                         "A-CGT-U",
+                         "CCCG-CU");
+    ma.append(MultipleAlignment::SeqEntry("seqC","A-CGNCU"));
+    
+    SequenceProfile profile(ma);
+    
+    REQUIRE(profile.length() == 7);
+    REQUIRE(profile.num_of_rows() == 3);
+    // symbols: - A C G N T U
+    REQUIRE(profile.num_of_symbols() == 7);
+    
+    for (size_type col=1; col<=ma.length(); ++col) {
+        size_type total=0;
+        for (SequenceProfile::const_iterator it=profile.begin(col);
+             it!=profile.end(col); ++it) {
+            size_type count=0;
+            for (size_type row=0; row<ma.num_of_rows(); ++row) {
+                REQUIRE(profile.symbol(profile.code(col,row))
+                        == ma.seqentry(row).seq()[col]);
+                if (profile.code(col,row)==it->code()) ++count;
+            }
+            REQUIRE(it->count() == count);
+            total += it->count();
+        }
+        REQUIRE(total == ma.num_of_rows());
+    }
+    
+    // column 1: A,C,A
+    REQUIRE(profile.end(1)-profile.begin(1) == 2);
+    REQUIRE(profile.symbol(profile.begin(1)->code()) == 'A');
+    REQUIRE(profile.begin(1)->count() == 2);
+}
+
+TEST_CASE("the profile of a multiple alignment follows modifications") {
+    MultipleAlignment ma("seqA","seqB",
+                         "A-CGT-UN",
+                         "CCCG-CUa");
+    
+    const SequenceProfile &profile = ma.profile();
+    
+    REQUIRE(profile.symbol(profile.code(1,0)) == 'A');
+    REQUIRE(profile.symbol(profile.code(2,0)) == '-');
+    REQUIRE(profile.symbol(profile.code(8,1)) == 'a');
+    
+    ma += 'G';
+    REQUIRE(ma.profile().length() == 9);
+    REQUIRE(ma.profile().symbol(ma.profile().code(9,1)) == 'G');
+    
+    MultipleAlignment copy(ma);
+    copy.reverse();
+    REQUIRE(copy.profile().symbol(copy.profile().code(1,0)) == 'G');
+    REQUIRE(ma.profile().symbol(ma.profile().code(1,0)) == 'A');
+}
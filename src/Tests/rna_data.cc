@@ -1,14 +1,25 @@
 #include "catch.hpp"
 
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <vector>
+#include <cctype>
 
 #include <../LocARNA/pfold_params.hh>
 #include <../LocARNA/sequence.hh>
 #include <../LocARNA/alignment.hh>
 #include <../LocARNA/rna_ensemble.hh>
 #include <../LocARNA/rna_data.hh>
+#include <../LocARNA/rna_data_impl.hh>
+
+#if defined(HAVE_LIBZ) && defined(HAVE_ZLIB_H)
+#  include <zlib.h>
+#endif
 
 
 using namespace LocARNA;
@@ -164,3 +175,280 @@ TEST_CASE("RnaData can initialize from fixed structure, even in the context of r
         std::remove(filename.c_str());
     }
 }
+
+TEST_CASE("Windows for local folding cover all base pairs of limited span") {
+    size_t length = 1000;
+    size_t span = 150;
+    LocalFoldingWindows windows(length,200,span);
+
+    REQUIRE( windows.starts().front() == 1 );
+    REQUIRE( windows.starts().back() + windows.window_size() - 1 == length );
+
+    bool covered = true;
+    for (size_t i=1; i<=length; i++) {
+        for (size_t j=i; j<=std::min(length,i+span-1); j++) {
+            covered = covered && windows.count(i,j) > 0;
+        }
+    }
+    REQUIRE( covered );
+    REQUIRE( windows.count(1,length) == 0 );
+
+    SECTION("short sequences are covered by a single window") {
+        LocalFoldingWindows single(100,200,span);
+        REQUIRE( single.starts().size() == 1 );
+        REQUIRE( single.count(1,100) == 1 );
+    }
+}
+
+TEST_CASE("RnaData provides per position paired probabilities and stacking probabilities") {
+    std::string filename="test_paired_probs.pp";
+    std::ofstream out(filename.c_str());
+    out
+        << "#PP 2.0" << std::endl << std::endl
+        << "test GGGAAACCCU" << std::endl << std::endl
+        << "#END" << std::endl << std::endl
+        << "#SECTION BASEPAIRS" << std::endl << std::endl
+        << "#BPCUT 0.01" << std::endl
+        << "#STACKS" << std::endl
+        << "1 9 0.5" << std::endl
+        << "2 8 0.6 0.4" << std::endl
+        << "1 10 0.25" << std::endl
+        << "3 7 0.7 0.5" << std::endl
+        << "2 9 0.125" << std::endl << std::endl
+        << "#END" << std::endl;
+    out.close();
+
+    PFoldParams pfoldparams(false,true,-1,2);
+    RnaData rd(filename,0.0,0.0,pfoldparams);
+
+    REQUIRE( rd.arc_prob(2,8) == 0.6 );
+    REQUIRE( rd.arc_prob(2,9) == 0.125 );
+    REQUIRE( rd.arc_prob(2,7) == 0.0 );
+    REQUIRE( rd.arc_prob(9,2) == 0.0 );
+    REQUIRE( rd.arc_prob(11,12) == 0.0 );
+    REQUIRE( rd.joint_arc_prob(3,7) == 0.5 );
+    REQUIRE( rd.joint_arc_prob(1,9) == 0.0 );
+    REQUIRE( rd.stacked_arc_prob(2,8) == Approx(0.4/0.7) );
+
+    REQUIRE( rd.prob_paired_upstream(1) == 0.75 );
+    REQUIRE( rd.prob_paired_upstream(9) == 0.0 );
+    REQUIRE( rd.prob_paired_downstream(9) == 0.625 );
+    REQUIRE( rd.prob_unpaired(2) == Approx(0.275) );
+    REQUIRE( rd.prob_unpaired(5) == 1.0 );
+
+    bool consistent = true;
+    for (size_t i=1; i<=rd.length(); i++) {
+        double up=0.0;
+        double down=0.0;
+        for (size_t j=1; j<=rd.length(); j++) {
+            up += rd.arc_prob(i,j);
+            down += rd.arc_prob(j,i);
+        }
+        consistent = consistent
+            && rd.prob_paired_upstream(i) == up
+            && rd.prob_paired_downstream(i) == down;
+    }
+    REQUIRE( consistent );
+
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("RnaData writes base pairs in canonical order") {
+    std::string filename="test_canonical_order.pp";
+    std::ofstream out(filename.c_str());
+    out
+        << "#PP 2.0" << std::endl << std::endl
+        << "test GGGGAAACCCCUU" << std::endl << std::endl
+        << "#END" << std::endl << std::endl
+        << "#SECTION BASEPAIRS" << std::endl << std::endl
+        << "#BPCUT 0.01" << std::endl << std::endl
+        << "4 12 0.3" << std::endl
+        << "1 13 0.2" << std::endl
+        << "2 11 0.4" << std::endl
+        << "1 12 0.5" << std::endl
+        << "3 10 0.6" << std::endl
+        << "2 12 0.1" << std::endl << std::endl
+        << "#END" << std::endl;
+    out.close();
+
+    PFoldParams pfoldparams(false,false,-1,2);
+    RnaData rd(filename,0.0,0.0,pfoldparams);
+    std::remove(filename.c_str());
+
+    std::ostringstream pp;
+    rd.write_pp(pp);
+
+    std::istringstream in(pp.str());
+    std::string line;
+    std::vector<std::string> bps;
+    while (std::getline(in,line)) {
+        if (!line.empty() && isdigit(line[0])) bps.push_back(line);
+    }
+
+    std::vector<std::string> expected;
+    expected.push_back("1 12 0.5");
+    expected.push_back("1 13 0.2");
+    expected.push_back("2 11 0.4");
+    expected.push_back("2 12 0.1");
+    expected.push_back("3 10 0.6");
+    expected.push_back("4 12 0.3");
+    REQUIRE( bps == expected );
+
+    SECTION("and the sorted base pairs agree with arc_prob") {
+        std::pair<size_t,size_t> row = rd.sorted_arcs(2);
+        REQUIRE( row.second-row.first == 2 );
+        REQUIRE( rd.sorted_arc_right(row.first) == 11 );
+        REQUIRE( rd.sorted_arc_prob(row.first) == rd.arc_prob(2,11) );
+        REQUIRE( rd.sorted_arcs(5).first == rd.sorted_arcs(5).second );
+    }
+}
+
+TEST_CASE("RnaData recognizes the input format and reads gzip compressed input") {
+    PFoldParams pfoldparams(false,false,-1,2);
+
+    SECTION("old pp format") {
+        std::string filename="test_autodetect_old.pp";
+        std::ofstream out(filename.c_str());
+        out
+            << "test GGGGAAACCCCUU" << std::endl
+            << "#" << std::endl
+            << "1 12 0.5" << std::endl
+            << "3 10 0.6" << std::endl;
+        out.close();
+
+        RnaData rd(filename,0.0,0.0,pfoldparams);
+        std::remove(filename.c_str());
+
+        REQUIRE( rd.sequence().seqentry(0).name() == "test" );
+        REQUIRE( rd.arc_prob(1,12) == 0.5 );
+        REQUIRE( rd.arc_prob(3,10) == 0.6 );
+    }
+
+#if defined(HAVE_LIBZ) && defined(HAVE_ZLIB_H)
+    SECTION("gzip compressed pp format") {
+        std::string filename="test_autodetect.pp.gz";
+        std::ostringstream out;
+        out
+            << "#PP 2.0" << std::endl << std::endl
+            << "test GGGGAAACCCCUU" << std::endl << std::endl
+            << "#END" << std::endl << std::endl
+            << "#SECTION BASEPAIRS" << std::endl << std::endl
+            << "1 12 0.5" << std::endl
+            << "3 10 0.6" << std::endl << std::endl
+            << "#END" << std::endl;
+        gzFile gz = gzopen(filename.c_str(),"wb");
+        REQUIRE( gz != NULL );
+        gzwrite(gz,out.str().data(),out.str().size());
+        gzclose(gz);
+
+        RnaData rd(filename,0.0,0.0,pfoldparams);
+        std::remove(filename.c_str());
+
+        REQUIRE( rd.arc_prob(1,12) == 0.5 );
+        REQUIRE( rd.arc_prob(3,10) == 0.6 );
+        REQUIRE( rd.arc_prob(2,11) == 0.0 );
+    }
+#endif
+}
+
+TEST_CASE("RnaData consensus dot plot agrees with the consensus of all column pairs") {
+    PFoldParams pfoldparams(false,false,-1,2);
+
+    std::string filenameA="test_consensus_A.pp";
+    std::string filenameB="test_consensus_B.pp";
+    {
+        std::ofstream out(filenameA.c_str());
+        out
+            << "#PP 2.0" << std::endl << std::endl
+            << "seqA GGGGAAACCCCAUGGGAAACCCU" << std::endl << std::endl
+            << "#END" << std::endl << std::endl
+            << "#SECTION BASEPAIRS" << std::endl << std::endl
+            << "#BPCUT 0.01" << std::endl << std::endl
+            << "1 11 0.5" << std::endl
+            << "2 10 0.6" << std::endl
+            << "1 12 0.02" << std::endl
+            << "14 22 0.7" << std::endl
+            << "15 21 0.3" << std::endl << std::endl
+            << "#END" << std::endl;
+    }
+    {
+        std::ofstream out(filenameB.c_str());
+        out
+            << "#PP 2.0" << std::endl << std::endl
+            << "seqB GGGAAACCCAUGGGGAAACCCCU" << std::endl << std::endl
+            << "#END" << std::endl << std::endl
+            << "#SECTION BASEPAIRS" << std::endl << std::endl
+            << "#BPCUT 0.01" << std::endl << std::endl
+            << "1 9 0.4" << std::endl
+            << "2 8 0.8" << std::endl
+            << "12 22 0.9" << std::endl
+            << "13 21 0.2" << std::endl << std::endl
+            << "#END" << std::endl;
+    }
+    RnaData rna_dataA(filenameA,0.0,0.0,pfoldparams);
+    RnaData rna_dataB(filenameB,0.0,0.0,pfoldparams);
+    std::remove(filenameA.c_str());
+    std::remove(filenameB.c_str());
+
+    std::string alistrA="GGGGAAACCCCAU-GGGAAACCC-U";
+    std::string alistrB="GGG-AAACCC-AUGGGGAAACCCCU";
+    Alignment alignment(rna_dataA.sequence(),rna_dataB.sequence(),
+                        Alignment::edges_t(Alignment::alistr_to_edge_ends(alistrA),
+                                           Alignment::alistr_to_edge_ends(alistrB)));
+
+    double p_exp=0.05;
+    RnaData consensus(rna_dataA,rna_dataB,alignment,p_exp,p_exp);
+
+    const Alignment::edges_t &edges = alignment.alignment_edges(false);
+    double p_cut = consensus.arc_cutoff_prob();
+
+    bool consistent=true;
+    size_t num_arcs=0;
+    for (size_t i=0; i<edges.size(); i++) {
+        for (size_t j=i+1; j<edges.size(); j++) {
+            double pA = (edges.first[i].is_gap() || edges.first[j].is_gap())
+                ? 0 : rna_dataA.arc_prob(edges.first[i], edges.first[j]);
+            double pB = (edges.second[i].is_gap() || edges.second[j].is_gap())
+                ? 0 : rna_dataB.arc_prob(edges.second[i], edges.second[j]);
+            double p = RnaDataImpl::consensus_probability(pA,pB,1,1,p_exp,p_exp,p_cut);
+            double expected = (p > p_cut) ? p : 0.0;
+            consistent &= ( consensus.arc_prob(i+1,j+1) == expected );
+            if (expected > 0) num_arcs++;
+        }
+    }
+    REQUIRE( consistent );
+    REQUIRE( num_arcs > 0 );
+
+    SECTION("and pp output formats probabilities like the stream operators") {
+        std::ostringstream pp;
+        consensus.write_pp(pp);
+
+        bool format_ok=true;
+        std::istringstream in(pp.str());
+        std::string line;
+        while (std::getline(in,line)) {
+            if (line.empty() || !isdigit(line[0])) continue;
+            std::istringstream linein(line);
+            size_t i,j;
+            std::string pstr;
+            linein >> i >> j >> pstr;
+
+            std::ostringstream expected;
+            expected.precision(3);
+            expected << consensus.arc_prob(i,j);
+            if (expected.str().length()>6) {
+                expected.str("");
+                expected.setf(std::ios::scientific, std::ios::floatfield);
+                expected.precision(2);
+                expected << consensus.arc_prob(i,j);
+                std::string s=expected.str();
+                size_t pos=s.find("e-0");
+                if (pos!=std::string::npos) s.replace(pos,3,"e-");
+                format_ok &= ( pstr == s );
+            } else {
+                format_ok &= ( pstr == expected.str() );
+            }
+        }
+        REQUIRE( format_ok );
+    }
+}
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <string>
 #include "LocARNA/multiple_alignment.hh"
+#include "LocARNA/multiple_alignment_comparison.hh"
 
 using namespace LocARNA;
 
@@ -49,15 +50,17 @@ main(int argc, char **argv) {
     MultipleAlignment ma((std::string)argv[1]);
     MultipleAlignment refma((std::string)argv[2]);
     
-    std::cout << "Deviation:     " << refma.deviation(ma) << std::endl;
+    MultipleAlignmentComparison comparison(ma,refma);
     
-    std::cout << "Realig. score: " << refma.cmfinder_realignment_score(ma) << std::endl;
+    std::cout << "Deviation:     " << comparison.deviation() << std::endl;
     
-    std::cout << "Match SPS:     " << refma.sps(ma,false) << std::endl;
+    std::cout << "Realig. score: " << comparison.cmfinder_realignment_score() << std::endl;
+    
+    std::cout << "Match SPS:     " << comparison.sps(false) << std::endl;
 
-    std::cout << "Compalign SPS: " << refma.sps(ma,true) << std::endl;
+    std::cout << "Compalign SPS: " << comparison.sps(true) << std::endl;
 
-    std::cout << "Deviation SPS: " << refma.avg_deviation_score(ma) << std::endl;
+    std::cout << "Deviation SPS: " << comparison.avg_deviation_score() << std::endl;
 
     return 0;
 }
@@ -116,6 +116,9 @@ struct command_line_parameters {
 
     int max_bp_span;
 
+    bool opt_ensemble_cache; //!< whether to use the ensemble cache
+    std::string ensemble_cache; //!< ensemble cache directory
+
     // ------------------------------------------------------------
     // File arguments
     std::string fileA;
@@ -213,6 +216,7 @@ option_def my_options[] = {
     {"",0,0,O_SECTION,0,O_NODEFAULT,"","Constraints"},
     {"noLP",0,&clp.no_lonely_pairs,O_NO_ARG,0,O_NODEFAULT,"bool","use --noLP option for folding"},
     {"maxBPspan",0,0,O_ARG_INT,&clp.max_bp_span,"-1","span","Limit maximum base pair span (default=off)"},
+    {"ensemble-cache",0,&clp.opt_ensemble_cache,O_ARG_STRING,&clp.ensemble_cache,O_NODEFAULT,"dir","Directory for caching pair probabilities of inputs without given probabilities; reuses the probabilities of earlier runs with the same sequences and folding parameters"},
 
     {"",0,0,O_SECTION,0,O_NODEFAULT,"","Miscalleneous"},
     {"stopwatch",0,&clp.opt_stopwatch,O_NO_ARG,0,O_NODEFAULT,"","Print run time information."},
@@ -295,6 +299,9 @@ main(int argc, char **argv) {
     //
 
     PFoldParams pfparams(clp.no_lonely_pairs,(!clp.no_stacking),clp.max_bp_span,2);
+    if (clp.opt_ensemble_cache) {
+	pfparams.set_ensemble_cache(clp.ensemble_cache);
+    }
 
     ExtRnaData *rna_dataA=0;
     try {
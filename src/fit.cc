@@ -8,11 +8,14 @@
 //
 
 #include <stdlib.h>
+#include <ctype.h>
 
 #include <iostream>
+#include <iterator>
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <vector>
 
 #include "LocARNA/fitonoff.hh"
 
@@ -23,18 +26,52 @@ using namespace LocARNA;
 // subs for reading input
 //
 
+/**
+ * @brief Read number sequences
+ *
+ * Reads the entire input at once and parses the numbers from
+ * the buffer. Reading stops at the first token that is not a
+ * number.
+ *
+ * @param in input stream
+ * @param[out] numseqs number sequences
+ * @param split if true, empty lines separate number sequences;
+ * otherwise, all numbers form a single sequence
+ */
 void
-read_number_sequence(string &filename,numseq_t &numseq) {
-    ifstream in(filename.c_str());
+read_number_sequences(istream &in, vector<numseq_t> &numseqs, bool split) {
+    string data((istreambuf_iterator<char>(in)),
+		istreambuf_iterator<char>());
+    
+    numseqs.clear();
+    numseqs.push_back(numseq_t());
     
-    double x;
-    while(in >> x) {numseq.push_back(x);}
+    const char *p = data.c_str();
+    while (true) {
+	// skip white space, count new lines
+	size_t newlines=0;
+	while (isspace((unsigned char)*p)) {
+	    if (*p=='\n') newlines++;
+	    ++p;
+	}
+	if (*p==0) break;
+	
+	char *end;
+	double x = strtod(p,&end);
+	if (end==p) break;
+	p=end;
+	
+	if (split && newlines>=2 && !numseqs.back().empty()) {
+	    numseqs.push_back(numseq_t());
+	}
+	numseqs.back().push_back(x);
+    }
 }
 
 void
-read_number_sequence(istream &in,numseq_t &numseq) {
-    double x;
-    while(in >> x) {numseq.push_back(x);}
+read_number_sequences(const string &filename, vector<numseq_t> &numseqs, bool split) {
+    ifstream in(filename.c_str());
+    read_number_sequences(in,numseqs,split);
 }
 
 // ------------------------------------------------------------
@@ -62,6 +99,8 @@ bool opt_once_on;
 
 bool opt_all_values;
 
+bool opt_batch;
+
 
 option_def my_options[] = {    
     {"help",'h',&opt_help,O_NO_ARG,0,O_NODEFAULT,"","This help"},
@@ -72,6 +111,7 @@ option_def my_options[] = {
     {"beta",'b',0,O_ARG_DOUBLE,&beta,"6","float","Inverse temperature"},
     {"once-on",0,&opt_once_on,O_NO_ARG,0,O_NODEFAULT,"","Fit a signal that is on only once"},
     {"all-values",0,&opt_all_values,O_NO_ARG,0,O_NODEFAULT,"","Show all function values of signal (instead of only ranges)"},
+    {"batch",0,&opt_batch,O_NO_ARG,0,O_NODEFAULT,"","Fit several sequences of numbers, which are separated by empty lines. Write the fits in input order, each followed by an empty line"},
     {"",0,0,O_ARG_STRING,&filename,"profile.dat","file","Input file with sequence of numbers"},
     {"",0,0,0,0,O_NODEFAULT,"",""}
 };
@@ -80,14 +120,62 @@ option_def my_options[] = {
 //END Options
 // ------------------------------------------------------------
 
+/**
+ * @brief Fit on/off-values to a number sequence and write the fit
+ *
+ * @param numseq number sequence
+ * @param out output stream
+ */
+void
+fit(numseq_t &numseq, ostream &out) {
+    double c0=0.2;
+    double c1=0.6; // initial on off values
+
+    // ----------------------------------------
+    // optimize on/off-values and compute fit
+    //
+    FitOnOff fns(numseq,delta_ab,delta_ba,beta);
+    
+    // double viterbi_score;
+    
+    //optimize
+    pair<double,double> opt = fns.optimize(c0,c1);
+    c0=opt.first;
+    c1=opt.second;
+
+    if (opt_once_on) {
+	// run once on optimization
+	double on=std::max(c0,c1);
+	double off=std::min(c0,c1);
+	
+	//viterbi_score = 
+	fns.best_once_on(off,on);
+	c0=off;
+	c1=on;
+    } else {
+	// run viterbi algo with optimal c0,c1
+	//viterbi_score = 
+	fns.viterbi(c0,c1,true);
+    }
+    // ----------------------------------------
+    // write best fit
+    //
+
+    if (!opt_all_values) {
+	if (opt_once_on) out << "ONOFF "<<min(c0,c1)<<" "<<max(c0,c1)<<endl;
+	else out << "ONOFF " << c0 << " " << c1 << endl;
+	out << "FIT ";
+	fns.write_viterbi_path_compact(out,c0,c1);
+    } else {
+	fns.write_viterbi_path(out,c0,c1);
+    }
+}
+
 
 int
 main(int argc, char **argv) {
     delta_ba = delta_ab; // always use same penalties for a->b and b->a
     
-    double c0=0.2;
-    double c1=0.6; // initial on off values
-    
     // ------------------------------------------------------------
     // Process options
     //
@@ -123,53 +211,38 @@ main(int argc, char **argv) {
     
     
     // ----------------------------------------
-    // read number sequence from file or stdin
+    // read number sequence(s) from file or stdin
     //
-    numseq_t numseq;
+    vector<numseq_t> numseqs;
     
     if (filename=="-") {
-	read_number_sequence(std::cin, numseq);
+	read_number_sequences(std::cin, numseqs, opt_batch);
     } else {
-	read_number_sequence(filename, numseq);
+	read_number_sequences(filename, numseqs, opt_batch);
     }
     
-    
+    if (!opt_batch) {
+	fit(numseqs[0],cout);
+	return 0;
+    }
+
     // ----------------------------------------
-    // optimize on/off-values and compute fit
+    // fit the sequences independently in parallel, write in input order
     //
-    FitOnOff fns(numseq,delta_ab,delta_ba,beta);
-    
-    // double viterbi_score;
+    vector<string> results(numseqs.size());
     
-    //optimize
-    pair<double,double> opt = fns.optimize(c0,c1);
-    c0=opt.first;
-    c1=opt.second;
-
-    if (opt_once_on) {
-	// run once on optimization
-	double on=std::max(c0,c1);
-	double off=std::min(c0,c1);
-	
-	//viterbi_score = 
-	fns.best_once_on(off,on);
-	c0=off;
-	c1=on;
-    } else {
-	// run viterbi algo with optimal c0,c1
-	//viterbi_score = 
-	fns.viterbi(c0,c1,true);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (long k=0; k<(long)numseqs.size(); k++) {
+	ostringstream out;
+	fit(numseqs[k],out);
+	results[k]=out.str();
     }
-    // ----------------------------------------
-    // write best fit
-    //
 
-    if (!opt_all_values) {
-	if (opt_once_on) cout << "ONOFF "<<min(c0,c1)<<" "<<max(c0,c1)<<endl;
-	else cout << "ONOFF " << c0 << " " << c1 << endl;
-	cout << "FIT ";
-	fns.write_viterbi_path_compact(cout,c0,c1);
-    } else {
-	fns.write_viterbi_path(cout,c0,c1);
+    for (size_t k=0; k<results.size(); k++) {
+	cout << results[k] << endl;
     }
+    
+    return 0;
 }
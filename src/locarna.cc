@@ -79,7 +79,11 @@ struct command_line_parameters : public MainHelper::std_command_line_parameters
 
     int normalized_L; //!< normalized_L
 
+    bool opt_normalized_fast; //!< whether to bracket lambda in parallel in normalized alignment
+
     bool opt_score_components; //!< whether to report score components
+
+    bool opt_score_only; //!< whether to compute only the score
 };
 
 //! \brief holds command line parameters of locarna  
@@ -131,6 +135,10 @@ option_def my_options[] = {
      " left end of second sequence, right end of second sequence."},
     {"normalized",0,&clp.opt_normalized,O_ARG_INT,&clp.normalized_L,"0","L",
      "Normalized local alignment with parameter L"},
+    {"normalized-fast",0,&clp.opt_normalized_fast,O_NO_ARG,0,O_NODEFAULT,"",
+     "Normalized alignment by bracketing the normalized score in parallel (one candidate per thread)"
+     " and certifying the optimum, starting from the previous result in k-best alignment;"
+     " needs one copy of the alignment matrices per thread"},
     {"penalized",0,&clp.opt_penalized,O_ARG_INT,&clp.position_penalty,"0","PP",
      "Penalized local alignment with penalty PP"},
 
@@ -157,6 +165,8 @@ option_def my_options[] = {
     {"score-components",0,&clp.opt_score_components,O_NO_ARG,0,O_NODEFAULT,"",
      "Output components of the score (experimental)"},
     {"stopwatch",0,&clp.opt_stopwatch,O_NO_ARG,0,O_NODEFAULT,"","Print run time information."},
+    {"score-only",0,&clp.opt_score_only,O_NO_ARG,0,O_NODEFAULT,"",
+     "Compute only the score (no traceback). Unlike in sparse and pankov, this does not save memory, since all matrices are needed for the score."},
     
     {"",0,0,O_SECTION,0,O_NODEFAULT,"","Heuristics for speed accuracy trade off"},
 
@@ -218,6 +228,7 @@ option_def my_options[] = {
 
     {"noLP",0,&clp.no_lonely_pairs,O_NO_ARG,0,O_NODEFAULT,"","No lonely pairs"},
     {"maxBPspan",0,0,O_ARG_INT,&clp.max_bp_span,"-1","span","Limit maximum base pair span (default=off)"},
+    {"ensemble-cache",0,&clp.opt_ensemble_cache,O_ARG_STRING,&clp.ensemble_cache,O_NODEFAULT,"dir","Directory for caching pair probabilities of inputs without given probabilities; reuses the probabilities of earlier runs with the same sequences and folding parameters"},
     
     {"",0,0,O_SECTION_HIDE,0,O_NODEFAULT,"","Hidden Options"},
 
@@ -315,11 +326,29 @@ main(int argc, char **argv) {
 	return -1;
     }
 
+    if (clp.opt_normalized_fast && !clp.opt_normalized) {
+	std::cerr << "Option --normalized-fast requires --normalized."<<std::endl;
+	return -1;
+    }
+
     if (clp.opt_normalized && clp.opt_penalized) {
     	std::cerr << "One cannot specify penalized and normalized simultaneously."<<std::endl;
     	return -1;
     }
 
+    if (clp.opt_score_only
+	&& (clp.opt_normalized || clp.opt_penalized || clp.opt_subopt || clp.opt_score_components)) {
+	std::cerr << "Normalized, penalized and suboptimal alignment as well as score components"
+		  << " require a traceback; they are not available with option --score-only."<<std::endl;
+	return -1;
+    }
+
+    if (clp.opt_score_only
+	&& (clp.opt_clustal_out || clp.opt_stockholm_out || clp.opt_pp_out)) {
+	std::cerr << "Alignment output is not available with option --score-only."<<std::endl;
+	return -1;
+    }
+
     // ----------------------------------------
     // temporarily turn off stacking unless background prob is set
     //
@@ -370,6 +399,9 @@ main(int argc, char **argv) {
     //
 
     PFoldParams pfparams(clp.no_lonely_pairs, clp.opt_stacking || clp.opt_new_stacking, clp.max_bp_span, 2);
+    if (clp.opt_ensemble_cache) {
+	pfparams.set_ensemble_cache(clp.ensemble_cache);
+    }
     
     RnaData *rna_dataA=0;
     try {
@@ -640,6 +672,8 @@ main(int argc, char **argv) {
 	. min_am_prob(clp.min_am_prob)
 	. min_bm_prob(clp.min_bm_prob)
 	. stacking(clp.opt_stacking || clp.opt_new_stacking)
+	. score_only(clp.opt_score_only)
+	. fast_normalized(clp.opt_normalized_fast)
 	. constraints(seq_constraints);
 
     // enumerate suboptimal alignments (using interval splitting)
@@ -687,7 +721,7 @@ main(int argc, char **argv) {
     // ------------------------------------------------------------
     // Traceback
     //
-    if ((!clp.opt_normalized && !clp.opt_penalized) && DO_TRACE) {
+    if ((!clp.opt_normalized && !clp.opt_penalized) && DO_TRACE && !clp.opt_score_only) {
 	
 	aligner.trace();
 	
@@ -758,7 +792,7 @@ main(int argc, char **argv) {
     
     int return_code=0;
 
-    if (clp.opt_normalized || clp.opt_penalized || DO_TRACE) {
+    if ((clp.opt_normalized || clp.opt_penalized || DO_TRACE) && !clp.opt_score_only) {
 	// if we did a trace (one way or the other)
 	
 	const Alignment &alignment = aligner.get_alignment();
@@ -866,6 +900,10 @@ main(int argc, char **argv) {
         
     stopwatch.stop("total");
 
+    if (clp.opt_verbose) {
+	std::cout << "Peak memory: " << peak_memory_kb() << " kB" << std::endl;
+    }
+
     // ----------------------------------------
     // DONE
     return return_code;
@@ -29,6 +29,7 @@
 #include "LocARNA/anchor_constraints.hh"
 #include "LocARNA/trace_controller.hh"
 #include "LocARNA/multiple_alignment.hh"
+#include "LocARNA/memory_planner.hh"
 #include "LocARNA/pfold_params.hh"
 #include "LocARNA/global_stopwatch.hh"
 #include "LocARNA/main_helper.icc"
@@ -153,6 +154,8 @@ option_def my_options[] = {
 
     {"",0,0,O_SECTION,0,O_NODEFAULT,"","Constraints"},
     {"maxBPspan",0,0,O_ARG_INT,&clp.max_bp_span,"-1","span","Limit maximum base pair span (default=off)"},
+    {"ensemble-cache",0,&clp.opt_ensemble_cache,O_ARG_STRING,&clp.ensemble_cache,O_NODEFAULT,"dir","Directory for caching pair probabilities of inputs without given probabilities; reuses the probabilities of earlier runs with the same sequences and folding parameters"},
+    {"max-memory",0,&clp.opt_max_memory,O_ARG_STRING,&clp.max_memory,O_NODEFAULT,"size","Memory budget (e.g. 512M or 4G); tightens the base pair cutoff (min-prob) until the estimated memory of the alignment fits, fails early otherwise"},
 
     {"",0,0,O_SECTION,0,O_NODEFAULT,"","Input_files RNA sequences and pair probabilities"},
 
@@ -226,12 +229,24 @@ main(int argc, char **argv) {
     if (clp.opt_verbose)
 	print_options(my_options);
 
+    MemoryPlanner::size_type max_memory=MemoryPlanner::unlimited;
+    if (clp.opt_max_memory) {
+	try {
+	    max_memory = MemoryPlanner::parse_size(clp.max_memory);
+	} catch (failure &f) {
+	    std::cerr << "ERROR: " << f.what() <<std::endl;
+	    return -1;
+	}
+    }
 
     // ------------------------------------------------------------
     // Get input data and generate data objects
     //
 
     PFoldParams pfparams(clp.no_lonely_pairs,clp.opt_stacking,clp.max_bp_span,2);
+    if (clp.opt_ensemble_cache) {
+	pfparams.set_ensemble_cache(clp.ensemble_cache);
+    }
     
     RnaData *rna_dataA=0;
     try {
@@ -327,19 +342,35 @@ main(int argc, char **argv) {
     // construct set of relevant arc matches
     //
     
-    // initialize from RnaData
-    ArcMatches *arc_matches = new ArcMatches(*rna_dataA,
-                                             *rna_dataB,
-                                             clp.min_prob,
-                                             clp.max_diff_am!=-1
-                                             ? (size_type)clp.max_diff_am
-                                             : std::max(lenA,lenB),
-                                             clp.max_diff_at_am!=-1
-                                             ? (size_type)clp.max_diff_at_am
-                                             : std::max(lenA,lenB),
-                                             trace_controller,
-                                             seq_constraints
-                                             );
+    // initialize from RnaData; with memory budget, tighten the
+    // base pair cutoff until the alignment fits
+    MemoryPlanner planner(MemoryPlanner::Aligner::P, max_memory);
+    
+    ArcMatches *arc_matches =
+	planner.fit_arc_matches(*rna_dataA,
+				*rna_dataB,
+				clp.min_prob,
+				clp.max_diff_am!=-1
+				? (size_type)clp.max_diff_am
+				: std::max(lenA,lenB),
+				clp.max_diff_at_am!=-1
+				? (size_type)clp.max_diff_at_am
+				: std::max(lenA,lenB),
+				trace_controller,
+				seq_constraints
+				);
+    
+    if (clp.opt_verbose && planner.has_budget()) {
+	planner.write(std::cout);
+    }
+    if (!planner.fits()) {
+	std::cerr << "ERROR: the alignment does not fit into the memory budget of "
+		  << clp.max_memory << "." <<std::endl;
+	delete arc_matches;
+	delete rna_dataA;
+	delete rna_dataB;
+	return -1;
+    }
 	
     // ----------------------------------------
     // report on input in verbose mode
@@ -0,0 +1,876 @@
+/**
+ * \file mpankov.cc
+ *
+ * \brief Defines main function of mpankov, the progressive multiple
+ * alignment driver of pankov
+ *
+ * Computes all pairwise pankov alignment scores, builds a guide tree
+ * and progressively aligns the profiles along the tree; all in one
+ * process without intermediate files. If compiled with OpenMP, the
+ * pairwise alignments and the alignments of independent subtrees
+ * run concurrently.
+ */
+
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+#include "LocARNA/sequence.hh"
+#include "LocARNA/basepairs.hh"
+#include "LocARNA/alignment.hh"
+#include "LocARNA/aligner_nn.hh"
+#include "LocARNA/rna_data.hh"
+#include "LocARNA/ext_rna_data.hh"
+#include "LocARNA/rna_ensemble.hh"
+#include "LocARNA/arc_matches.hh"
+#include "LocARNA/ribosum.hh"
+#include "LocARNA/ribofit.hh"
+#include "LocARNA/anchor_constraints.hh"
+#include "LocARNA/sequence_annotation.hh"
+#include "LocARNA/trace_controller.hh"
+#include "LocARNA/ribosum85_60.icc"
+#include "LocARNA/multiple_alignment.hh"
+#include "LocARNA/sparsification_mapper.hh"
+#include "LocARNA/global_stopwatch.hh"
+#include "LocARNA/pfold_params.hh"
+#include "LocARNA/guide_tree.hh"
+#include "LocARNA/memory_arena.hh"
+
+using namespace std;
+using namespace LocARNA;
+
+//! Version string (from configure.ac via autoconf system)
+const std::string
+VERSION_STRING = (std::string)PACKAGE_STRING;
+
+// ------------------------------------------------------------
+//
+// Options
+//
+#include "LocARNA/options.hh"
+
+//! \brief Structure for command line parameters of mpankov
+//!
+//! Encapsulating all command line parameters in a common structure
+//! avoids name conflicts and makes downstream code more informative.
+//!
+struct command_line_parameters {
+    //! only pairs with a probability of at least min_prob are taken into account
+    double min_prob;
+
+    //! maximal ratio of number of base pairs divided by sequence
+    //! length. This serves as a second filter on the "significant"
+    //! base pairs.
+    double max_bps_length_ratio;
+
+    double max_uil_length_ratio; // max unpaired in loop length ratio
+    double max_bpil_length_ratio; // max base pairs in loop length ratio
+
+    int match_score; //!< match score
+
+    int mismatch_score; //!< mismatch score
+
+    int indel_score; //!< indel extension score
+
+    int indel_score_loop; //!< indel extension score
+
+    int indel_opening_score; //!< indel opening score
+
+    int indel_opening_loop_score; //!< indel opening score for loops
+
+    int temperature; //!< temperature
+
+    int struct_weight; //!< structure weight
+
+    //! contribution of sequence similarity in an arc match (in percent)
+    int tau_factor;
+
+    bool no_lonely_pairs; //!< no lonely pairs option
+
+    //! maximal difference for positions of alignment
+    //! traces (only used for ends of arcs)
+    int max_diff;
+
+    //! maximal difference between two arc ends, -1 is off
+    int max_diff_am;
+
+    //! maximal difference for alignment traces, at arc match
+    //! positions
+    int max_diff_at_am;
+
+    //! expected probability of a base pair (null-model)
+    double exp_prob;
+
+    //! expected probability given?
+    bool opt_exp_prob;
+
+    //! width of alignment output
+    int output_width;
+
+    // ------------------------------------------------------------
+    // File arguments
+
+    //! input file (multiple fasta)
+    std::string input_file;
+
+    //! directory of pp files of the input sequences
+    std::string pp_dir;
+
+    bool opt_pp_dir; //!< whether to read pp files from pp_dir
+
+    std::string clustal_out; //!< name of clustal output file
+
+    bool opt_clustal_out; //!< whether to write clustal output to file
+
+    std::string pp_out; //!< name of pp output file
+
+    bool opt_pp_out; //!< whether to write pp output to file
+
+    std::string tree_out; //!< name of guide tree output file
+
+    bool opt_tree_out; //!< whether to write the guide tree to file
+
+    std::string tree_method; //!< guide tree method (upgma or nj)
+
+    int threads; //!< number of threads
+
+    bool opt_help; //!< whether to print help
+    bool opt_galaxy_xml; //!< whether to print a galaxy xml wrapper for the parameters
+    bool opt_version; //!< whether to print version
+    bool opt_verbose; //!< whether to print verbose output
+
+    bool opt_stopwatch; //!< whether to print verbose output
+
+    bool opt_track_closing_bp; //!< whether to track right end of a closing basepair
+    bool opt_use_conditional_scoring; //!< whether to use the conditional probability scoring
+    int opt_multiloop_deletion; //!< whether to allow aligning an entire branch of a multiloop to gap
+
+    std::string ribosum_file; //!< ribosum_file
+    bool use_ribosum; //!< use_ribosum
+
+    bool opt_ribofit; //!< ribofit
+
+    double min_am_prob; //!< only matched arc-pair with a probability of at least min_am_prob are taken into account
+    double min_bm_prob; //!< only matched base-pair with a probability of at least min_bm_prob are taken into account
+
+    double prob_unpaired_in_loop_threshold; //!< threshold for prob_unpaired_in_loop
+    double prob_basepair_in_loop_threshold; //!< threshold for prob_basepait_in_loop
+};
+
+
+//! \brief holds command line parameters of mpankov
+command_line_parameters clp;
+
+
+//! defines command line parameters
+option_def my_options[] = {
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","cmd_only"},
+
+    {"help",'h',&clp.opt_help,O_NO_ARG,0,O_NODEFAULT,"","Help"},
+    {"galaxy-xml",0,&clp.opt_galaxy_xml,O_NO_ARG,0,O_NODEFAULT,"","Galaxy xml wrapper"},
+    {"version",'V',&clp.opt_version,O_NO_ARG,0,O_NODEFAULT,"","Version info"},
+    {"verbose",'v',&clp.opt_verbose,O_NO_ARG,0,O_NODEFAULT,"","Verbose"},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Scoring_parameters"},
+
+    {"match",'m',0,O_ARG_INT,&clp.match_score,"50","score","Match score"},
+    {"mismatch",'M',0,O_ARG_INT,&clp.mismatch_score,"0","score","Mismatch score"},
+    {"ribosum-file",0,0,O_ARG_STRING,&clp.ribosum_file,"RIBOSUM85_60","f","Ribosum file"},
+    {"use-ribosum",0,0,O_ARG_BOOL,&clp.use_ribosum,"true","bool","Use ribosum scores"},
+    {"indel",'i',0,O_ARG_INT,&clp.indel_score,"-350","score","Indel score"},
+    {"indel-loop",'i',0,O_ARG_INT,&clp.indel_score_loop,"-350","score","Indel score for loops"},
+    {"indel-opening",0,0,O_ARG_INT,&clp.indel_opening_score,"-600","score","Indel opening score"},
+    {"indel-opening-loop",0,0,O_ARG_INT,&clp.indel_opening_loop_score,"-900","score","Indel opening score for loops"},
+    {"struct-weight",'s',0,O_ARG_INT,&clp.struct_weight,"200","score","Maximal weight of 1/2 arc match"},
+    {"exp-prob",'e',&clp.opt_exp_prob,O_ARG_DOUBLE,&clp.exp_prob,O_NODEFAULT,"prob","Expected probability"},
+    {"tau",'t',0,O_ARG_INT,&clp.tau_factor,"100","factor","Tau factor in percent"},
+    {"temperature",0,0,O_ARG_INT,&clp.temperature,"150","int","Temperature for PF-computation"},
+    {"track-closing-bp",0,&clp.opt_track_closing_bp,O_NO_ARG,0,O_NODEFAULT,"","Track right end of a closing basepair "},
+    {"use-conditional-scoring",0,&clp.opt_use_conditional_scoring,O_NO_ARG,0,O_NODEFAULT,"","Use conditional probability scoring "},
+    {"multiloop-deletion",0,0, O_ARG_INT,&clp.opt_multiloop_deletion,"0","diff","Maximum allowed length of a  multiloop branch to be aligned gap, "
+    		"value 0 disables computation "},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Multiple_alignment"},
+
+    {"tree-method",0,0,O_ARG_STRING,&clp.tree_method,"upgma","method","Guide tree construction: upgma or nj (neighbor joining)"},
+    {"threads",0,0,O_ARG_INT,&clp.threads,"0","int","Number of threads (default: OpenMP default)"},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Controlling_output"},
+
+    {"width",'w',0,O_ARG_INT,&clp.output_width,"120","columns","Output width"},
+    {"clustal",0,&clp.opt_clustal_out,O_ARG_STRING,&clp.clustal_out,O_NODEFAULT,"file","Clustal output"},
+    {"pp",0,&clp.opt_pp_out,O_ARG_STRING,&clp.pp_out,O_NODEFAULT,"file","PP output"},
+    {"tree",0,&clp.opt_tree_out,O_ARG_STRING,&clp.tree_out,O_NODEFAULT,"file","Write guide tree (newick format)"},
+
+    {"stopwatch",0,&clp.opt_stopwatch,O_NO_ARG,0,O_NODEFAULT,"","Print run time information."},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Heuristics for speed accuracy trade off"},
+
+    {"min-prob",'p',0,O_ARG_DOUBLE,&clp.min_prob,"0.0005","prob","Minimal probability"},
+    {"max-bps-length-ratio",0,0,O_ARG_DOUBLE,&clp.max_bps_length_ratio,"1.3","factor","Maximal ratio of #base pairs divided by sequence length (default: 1.3)"},
+    {"max-uil-length-ratio",0,0,O_ARG_DOUBLE,&clp.max_uil_length_ratio,"0.0","factor","Maximal ratio of #unpaired bases in loops divided by sequence length (default: no effect)"},
+    {"max-bpil-length-ratio",0,0,O_ARG_DOUBLE,&clp.max_bpil_length_ratio,"0.0","factor","Maximal ratio of #base pairs in loops divided by loop length (default: no effect)"},
+    {"max-diff-am",'D',0,O_ARG_INT,&clp.max_diff_am,"30","diff","Maximal difference for sizes of matched arcs"},
+    {"max-diff",'d',0,O_ARG_INT,&clp.max_diff,"-1","diff","Maximal difference for alignment traces"},
+    {"max-diff-at-am",0,0,O_ARG_INT,&clp.max_diff_at_am,"-1","diff","Maximal difference for alignment traces, only at arc match positions"},
+    {"min-am-prob",'a',0,O_ARG_DOUBLE,&clp.min_am_prob,"0.0005","amprob","Minimal Arc-match probability"},
+    {"min-bm-prob",'b',0,O_ARG_DOUBLE,&clp.min_bm_prob,"0.0005","bmprob","Minimal Base-match probability"},
+    {"prob-unpaired-in-loop-threshold",0,0,O_ARG_DOUBLE,&clp.prob_unpaired_in_loop_threshold,"0.00005","threshold","Threshold for prob_unpaired_in_loop"},
+    {"prob-basepair-in-loop-threshold",0,0,O_ARG_DOUBLE,&clp.prob_basepair_in_loop_threshold,"0.0001","threshold","Threshold for prob_basepair_in_loop"},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Constraints"},
+
+    {"noLP",0,&clp.no_lonely_pairs,O_NO_ARG,0,O_NODEFAULT,"","No lonely pairs"},
+
+    {"",0,0,O_SECTION_HIDE,0,O_NODEFAULT,"","Hidden Options"},
+    {"ribofit",0,0,O_ARG_BOOL,&clp.opt_ribofit,"false","bool","Use Ribofit base and arc match scores (overrides ribosum)"},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Input_files RNA sequences and pair probabilities"},
+
+    {"pp-dir",0,&clp.opt_pp_dir,O_ARG_STRING,&clp.pp_dir,O_NODEFAULT,"dir","Read pair probabilities of the sequences from <dir>/<name>.pp instead of folding"},
+    {"",0,0,O_ARG_STRING,&clp.input_file,O_NODEFAULT,"input","Input file (multiple fasta)"},
+    {"",0,0,0,0,O_NODEFAULT,"",""}
+};
+
+
+// ------------------------------------------------------------
+
+/**
+ * \brief Progressive multiple alignment by pankov
+ *
+ * Holds the scoring parameters shared by all pairwise alignments
+ * and the (extended) RNA data of the sequences and profiles at the
+ * nodes of the guide tree.
+ */
+class ProgressiveAligner {
+    const PFoldParams &pfparams_; //!< folding parameters
+    RibosumFreq *ribosum_; //!< ribosum (or 0L)
+    Ribofit *ribofit_; //!< ribofit (or 0L)
+
+    //! RNA data of the sequences and profiles, indexed by tree nodes
+    std::vector<ExtRnaData *> profiles_;
+
+    //! message of the first failure in a concurrent task (if failed_)
+    std::string failure_msg_;
+    bool failed_; //!< whether an alignment task failed
+
+public:
+    /**
+     * @brief Construct
+     * @param pfparams folding parameters
+     * @param ribosum ribosum (or 0L)
+     * @param ribofit ribofit (or 0L)
+     */
+    ProgressiveAligner(const PFoldParams &pfparams,
+		       RibosumFreq *ribosum,
+		       Ribofit *ribofit)
+	: pfparams_(pfparams),
+	  ribosum_(ribosum),
+	  ribofit_(ribofit),
+	  profiles_(),
+	  failure_msg_(),
+	  failed_(false)
+    {}
+
+    ~ProgressiveAligner() {
+	for (size_type i=0; i<profiles_.size(); ++i) {
+	    if (profiles_[i]) delete profiles_[i];
+	}
+    }
+
+    /**
+     * @brief Add input sequence
+     * @param rna_data RNA data of the sequence (owned by this object)
+     */
+    void
+    add_sequence(ExtRnaData *rna_data) { profiles_.push_back(rna_data); }
+
+    //! @brief number of sequences
+    size_type
+    num_of_sequences() const { return profiles_.size(); }
+
+    /**
+     * @brief RNA data of sequence or profile
+     * @param node node of the guide tree
+     */
+    const ExtRnaData &
+    profile(size_type node) const { return *profiles_[node]; }
+
+    /**
+     * @brief Fold sequence or alignment
+     * @param ma sequence or alignment
+     * @return RNA data with in-loop probabilities (to be deleted by the caller)
+     */
+    ExtRnaData *
+    fold(const MultipleAlignment &ma) const;
+
+    /**
+     * @brief Align two sequences or profiles
+     * @param rna_dataA RNA data A
+     * @param rna_dataB RNA data B
+     * @param[out] consensus if not 0L, *consensus is set to the RNA
+     * data of the optimal alignment (to be deleted by the caller)
+     * @return alignment score
+     *
+     * The RNA data of the alignment is the consensus of the in
+     * loop and base pair probabilities of A and B, such that the
+     * alignment does not have to be refolded.
+     */
+    infty_score_t
+    align(const ExtRnaData &rna_dataA,
+	  const ExtRnaData &rna_dataB,
+	  ExtRnaData **consensus) const;
+
+    /**
+     * @brief Compute all pairwise scores of the sequences
+     * @return symmetric matrix of scores
+     */
+    GuideTree::score_matrix_t
+    pairwise_scores() const;
+
+    /**
+     * @brief Align the profiles progressively along the guide tree
+     * @param tree guide tree
+     *
+     * Independent subtrees are aligned concurrently. Afterwards,
+     * the profile of the root is available via profile(tree.root()).
+     *
+     * @throw failure if any of the alignments failed
+     */
+    void
+    align_tree(const GuideTree &tree);
+
+private:
+    /**
+     * @brief Align the profiles of the subtree of node progressively
+     * @param tree guide tree
+     * @param node node of the guide tree
+     *
+     * Afterwards, the profile of node is available via
+     * profile(node); the profiles of the children are freed.
+     * Failures are recorded instead of thrown, since they must
+     * not escape the concurrent task.
+     */
+    void
+    align_subtree(const GuideTree &tree, size_type node);
+
+    /**
+     * @brief Record failure of a concurrent task
+     * @param f failure
+     * @note only the first failure is kept
+     */
+    void
+    record_failure(const failure &f);
+};
+
+ExtRnaData *
+ProgressiveAligner::fold(const MultipleAlignment &ma) const {
+    ExtRnaData *rna_data=0L;
+
+    // the folding library is not thread-safe
+#ifdef _OPENMP
+#pragma omp critical (vienna)
+#endif
+    {
+	RnaEnsemble rna_ensemble(ma,pfparams_,true,true);
+	rna_data = new ExtRnaData(rna_ensemble,
+				  clp.min_prob,
+				  clp.prob_basepair_in_loop_threshold,
+				  clp.prob_unpaired_in_loop_threshold,
+				  clp.max_bps_length_ratio,
+				  clp.max_uil_length_ratio,
+				  clp.max_bpil_length_ratio,
+				  pfparams_);
+    }
+    return rna_data;
+}
+
+infty_score_t
+ProgressiveAligner::align(const ExtRnaData &rna_dataA,
+			  const ExtRnaData &rna_dataB,
+			  ExtRnaData **consensus) const {
+    // the transient structures of the alignment (adjacency lists,
+    // arc match lists, sparsification) are allocated from an arena,
+    // which is released at once when the alignment is done
+    MemoryArena arena;
+    ArenaScope arena_scope(arena);
+
+    const Sequence &seqA=rna_dataA.sequence();
+    const Sequence &seqB=rna_dataB.sequence();
+
+    size_type lenA=seqA.length();
+    size_type lenB=seqB.length();
+
+    TraceController trace_controller(seqA,seqB,NULL,clp.max_diff,false);
+
+    AnchorConstraints seq_constraints(lenA,
+				      seqA.annotation(MultipleAlignment::AnnoType::anchors).single_string(),
+				      lenB,
+				      seqB.annotation(MultipleAlignment::AnnoType::anchors).single_string());
+
+    ArcMatches arc_matches(rna_dataA,
+			   rna_dataB,
+			   clp.min_prob,
+			   clp.max_diff_am!=-1
+			   ? (size_type)clp.max_diff_am
+			   : std::max(lenA,lenB),
+			   clp.max_diff_at_am!=-1
+			   ? (size_type)clp.max_diff_at_am
+			   : std::max(lenA,lenB),
+			   trace_controller,
+			   seq_constraints
+			   );
+
+    const BasePairs &bpsA = arc_matches.get_base_pairsA();
+    const BasePairs &bpsB = arc_matches.get_base_pairsB();
+
+    SparsificationMapper mapper_arcsA(bpsA, rna_dataA, clp.prob_unpaired_in_loop_threshold, clp.prob_basepair_in_loop_threshold, false);
+    SparsificationMapper mapper_arcsB(bpsB, rna_dataB, clp.prob_unpaired_in_loop_threshold, clp.prob_basepair_in_loop_threshold, false);
+
+    double my_exp_probA = clp.opt_exp_prob?clp.exp_prob:prob_exp_f(lenA);
+    double my_exp_probB = clp.opt_exp_prob?clp.exp_prob:prob_exp_f(lenB);
+
+    ScoringParams scoring_params(clp.match_score,
+				 clp.mismatch_score,
+				 clp.indel_score,
+				 clp.indel_score_loop,
+				 clp.indel_opening_score,
+				 clp.indel_opening_loop_score,
+				 ribosum_,
+				 ribofit_,
+				 0, //unpaired_weight
+				 clp.struct_weight,
+				 clp.tau_factor,
+				 0, // exclusion score
+				 my_exp_probA,
+				 my_exp_probB,
+				 clp.temperature,
+				 false, // stacking
+				 false, // new stacking
+				 false, // mea alignment
+				 0,
+				 0,
+				 0,
+				 10000
+				 );
+
+    Scoring scoring(seqA,
+		    seqB,
+		    rna_dataA,
+		    rna_dataB,
+		    arc_matches,
+		    0L,
+		    scoring_params,
+		    false, // no Boltzmann weights
+		    clp.opt_use_conditional_scoring
+		    );
+
+    AlignerNN aligner = AlignerNN::create()
+	. sparsification_mapper_arcsA(mapper_arcsA)
+	. sparsification_mapper_arcsB(mapper_arcsB)
+	. seqA(seqA)
+	. seqB(seqB)
+	. arc_matches(arc_matches)
+	. scoring(scoring)
+	. no_lonely_pairs(false) // ignore no lonely pairs in alignment algo
+	. struct_local(false)
+	. sequ_local(false)
+	. free_endgaps("----")
+	. max_diff_am(clp.max_diff_am)
+	. max_diff_at_am(clp.max_diff_at_am)
+	. trace_controller(trace_controller)
+	. min_am_prob(clp.min_am_prob)
+	. min_bm_prob(clp.min_bm_prob)
+	. stacking(false)
+	. track_closing_bp(clp.opt_track_closing_bp)
+	. multiloop_deletion(clp.opt_multiloop_deletion)
+	. constraints(seq_constraints);
+
+    infty_score_t score = aligner.align();
+
+    if (consensus) {
+	aligner.trace();
+	*consensus = new ExtRnaData(rna_dataA,
+				    rna_dataB,
+				    aligner.get_alignment(),
+				    my_exp_probA,
+				    my_exp_probB);
+    }
+
+    return score;
+}
+
+GuideTree::score_matrix_t
+ProgressiveAligner::pairwise_scores() const {
+    size_type n = profiles_.size();
+    GuideTree::score_matrix_t scores(n,n);
+    scores.fill(0.0);
+    std::string failure_msg;
+
+    // enumerate the pairs, such that they can be distributed
+    std::vector<std::pair<size_type,size_type> > pairs;
+    for (size_type i=0; i<n; ++i) {
+	for (size_type j=i+1; j<n; ++j) {
+	    pairs.push_back(std::make_pair(i,j));
+	}
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (long k=0; k<(long)pairs.size(); ++k) {
+	size_type i=pairs[k].first;
+	size_type j=pairs[k].second;
+	// exceptions must not escape the parallel loop; pass the
+	// first failure on to the master thread
+	try {
+	    infty_score_t score = align(*profiles_[i],*profiles_[j],0L);
+	    double s = score.is_finite() ? (double)score.finite_value() : -1e10;
+	    scores(i,j) = s;
+	    scores(j,i) = s;
+	} catch (failure &f) {
+#ifdef _OPENMP
+#pragma omp critical (progressive_failure)
+#endif
+	    if (failure_msg.empty()) failure_msg = f.what();
+	}
+    }
+
+    if (!failure_msg.empty()) throw failure(failure_msg);
+
+    return scores;
+}
+
+void
+ProgressiveAligner::align_subtree(const GuideTree &tree, size_type node) {
+    if (tree.is_leaf(node)) return;
+
+    size_type left = tree.left(node);
+    size_type right = tree.right(node);
+
+    // align the independent subtrees concurrently
+#ifdef _OPENMP
+#pragma omp task
+#endif
+    align_subtree(tree,left);
+#ifdef _OPENMP
+#pragma omp task
+#endif
+    align_subtree(tree,right);
+#ifdef _OPENMP
+#pragma omp taskwait
+#endif
+
+    // a failed subtree leaves its profile empty
+    if (profiles_[left]==0L || profiles_[right]==0L) return;
+
+    ExtRnaData *rna_data=0L;
+    try {
+	align(*profiles_[left],*profiles_[right],&rna_data);
+    } catch (failure &f) {
+	record_failure(f);
+	return;
+    }
+
+    // each task writes only the entries of its own subtree
+    profiles_[node] = rna_data;
+
+    delete profiles_[left];
+    profiles_[left]=0L;
+    delete profiles_[right];
+    profiles_[right]=0L;
+}
+
+void
+ProgressiveAligner::record_failure(const failure &f) {
+#ifdef _OPENMP
+#pragma omp critical (progressive_failure)
+#endif
+    if (!failed_) {
+	failure_msg_ = f.what();
+	failed_ = true;
+    }
+}
+
+void
+ProgressiveAligner::align_tree(const GuideTree &tree) {
+    // make room for the profiles of the inner nodes, such that
+    // concurrent tasks do not resize the profiles
+    profiles_.resize(tree.num_nodes(),0L);
+    failed_=false;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#pragma omp single
+#endif
+    align_subtree(tree,tree.root());
+
+    if (failed_) throw failure(failure_msg_);
+}
+
+
+// ------------------------------------------------------------
+// MAIN
+
+/**
+ * \brief Main method of executable mpankov
+ *
+ * @param argc argument counter
+ * @param argv argument vector
+ *
+ * @return success
+ */
+int
+main(int argc, char **argv) {
+    stopwatch.start("total");
+
+    // ------------------------------------------------------------
+    // Process options
+    bool process_success=process_options(argc,argv,my_options);
+
+    if (clp.opt_help) {
+	cout << "mpankov - progressive multiple alignment of RNAs by pankov"<<endl<<endl;
+
+	print_help(argv[0],my_options);
+
+	cout << "Report bugs to <miladim (at) informatik.uni-freiburg.de>."<<endl<<endl;
+	return 0;
+    }
+
+    if (clp.opt_galaxy_xml) {
+    	print_galaxy_xml((char *)"mpankov",my_options);
+    	return 0;
+    }
+
+    if (clp.opt_version || clp.opt_verbose) {
+	cout << "mpankov ("<< VERSION_STRING<<")"<<endl;
+	if (clp.opt_version) return 0; else cout <<endl;
+    }
+
+    if (!process_success) {
+	std::cerr << "ERROR --- "
+		  <<O_error_msg<<std::endl;
+	printf("USAGE: ");
+	print_usage(argv[0],my_options);
+	printf("\n");
+	return -1;
+    }
+
+    if (clp.opt_stopwatch) {
+	stopwatch.set_print_on_exit(true);
+    }
+
+    if (clp.opt_verbose) {
+	print_options(my_options);
+    }
+
+    // ------------------------------------------------------------
+    // parameter consistency
+    if (clp.struct_weight<0) {
+	std::cerr << "Structure weight must be greater equal 0."<<std::endl;
+	return -1;
+    }
+
+    if (clp.opt_use_conditional_scoring && !clp.opt_track_closing_bp ) {
+	std::cerr << "Error: conditonal scoring only works if track_closing_bp is enabled" << std::endl;
+    }
+
+    GuideTree::Method::type tree_method;
+    if (clp.tree_method=="upgma") {
+	tree_method = GuideTree::Method::UPGMA;
+    } else if (clp.tree_method=="nj") {
+	tree_method = GuideTree::Method::NJ;
+    } else {
+	std::cerr << "Unknown guide tree method "<<clp.tree_method<<"."<<std::endl;
+	return -1;
+    }
+
+#ifdef _OPENMP
+    if (clp.threads>0) {
+	omp_set_num_threads(clp.threads);
+    }
+#endif
+
+    // ----------------------------------------
+    // Ribosum matrix
+    //
+    RibosumFreq *ribosum=NULL;
+    Ribofit *ribofit=NULL;
+
+    if (clp.opt_ribofit) {
+	ribofit = new Ribofit_will2014;
+    }
+
+    if (clp.use_ribosum) {
+	if (clp.ribosum_file == "RIBOSUM85_60") {
+	    if (clp.opt_verbose) {
+		std::cout <<"Use built-in ribosum."<<std::endl;
+	    }
+            ribosum = new Ribosum85_60;
+	} else {
+	    ribosum = new RibosumFreq(clp.ribosum_file);
+	}
+    }
+
+    // ------------------------------------------------------------
+    // Get input data and generate data objects
+    //
+    PFoldParams pfparams(clp.no_lonely_pairs,false,-1,2);
+
+    ProgressiveAligner progressive_aligner(pfparams,ribosum,ribofit);
+    std::vector<std::string> names;
+
+    try {
+	MultipleAlignment input(clp.input_file,MultipleAlignment::FormatType::FASTA);
+
+	for (size_type i=0; i<input.num_of_rows(); ++i) {
+	    const MultipleAlignment::SeqEntry &entry = input.seqentry(i);
+	    names.push_back(entry.name());
+
+	    if (clp.opt_pp_dir) {
+		std::string filename = clp.pp_dir+"/"+entry.name()+".pp";
+		progressive_aligner
+		    .add_sequence(new ExtRnaData(filename,
+						 clp.min_prob,
+						 clp.prob_basepair_in_loop_threshold,
+						 clp.prob_unpaired_in_loop_threshold,
+						 clp.max_bps_length_ratio,
+						 clp.max_uil_length_ratio,
+						 clp.max_bpil_length_ratio,
+						 pfparams));
+	    } else {
+		// remove gaps from the input
+		std::string seqstr;
+		const string1 &seq = entry.seq();
+		for (size_type k=1; k<=seq.length(); ++k) {
+		    if (!is_gap_symbol(seq[k])) seqstr.push_back(seq[k]);
+		}
+		progressive_aligner
+		    .add_sequence(progressive_aligner.fold(Sequence(entry.name(),seqstr)));
+	    }
+	}
+    } catch (failure &f) {
+	std::cerr << "ERROR: failed to read input" <<std::endl
+		  << "       "<< f.what() <<std::endl;
+	if (ribosum) delete ribosum;
+	if (ribofit) delete ribofit;
+	return -1;
+    }
+
+    size_type n = progressive_aligner.num_of_sequences();
+    if (n==0) {
+	std::cerr << "ERROR: no input sequences." <<std::endl;
+	if (ribosum) delete ribosum;
+	if (ribofit) delete ribofit;
+	return -1;
+    }
+
+    // construct the profiles of the input sequences before the
+    // concurrent alignments share them
+    for (size_type i=0; i<n; ++i) {
+	progressive_aligner.profile(i).sequence().profile();
+    }
+
+    // ------------------------------------------------------------
+    // All pairwise scores and guide tree
+    //
+    std::cerr << "Caution: Pankov alignment branch. Incompatibilities for running other aligner tools, please use the original/master LocARNA package." << std::endl;
+    GuideTree::score_matrix_t scores;
+    try {
+	stopwatch.start("pairwise");
+	scores = progressive_aligner.pairwise_scores();
+	stopwatch.stop("pairwise");
+    } catch (failure &f) {
+	std::cerr << "ERROR: failed to compute pairwise scores" <<std::endl
+		  << "       "<< f.what() <<std::endl;
+	if (ribosum) delete ribosum;
+	if (ribofit) delete ribofit;
+	return -1;
+    }
+
+    if (clp.opt_verbose) {
+	std::cout << "Pairwise scores:" <<std::endl;
+	for (size_type i=0; i<n; ++i) {
+	    for (size_type j=0; j<n; ++j) {
+		std::cout << (j>0?" ":"") << scores(i,j);
+	    }
+	    std::cout << std::endl;
+	}
+    }
+
+    GuideTree tree(scores,tree_method);
+
+    if (clp.opt_verbose) {
+	std::cout << "Guide tree: ";
+	tree.write_newick(std::cout,names) << std::endl;
+    }
+
+    // ------------------------------------------------------------
+    // Progressive alignment
+    //
+    try {
+	stopwatch.start("progressive");
+	progressive_aligner.align_tree(tree);
+	stopwatch.stop("progressive");
+    } catch (failure &f) {
+	std::cerr << "ERROR: failed to align progressively" <<std::endl
+		  << "       "<< f.what() <<std::endl;
+	if (ribosum) delete ribosum;
+	if (ribofit) delete ribofit;
+	return -1;
+    }
+
+    const ExtRnaData &result = progressive_aligner.profile(tree.root());
+
+    // ----------------------------------------
+    // write output
+    //
+    int return_code=0;
+
+    result.sequence().write(std::cout,clp.output_width);
+    std::cout<<endl;
+
+    if (clp.opt_clustal_out) {
+	ofstream out(clp.clustal_out.c_str());
+	if (out.good()) {
+	    out << "CLUSTAL W --- "<<PACKAGE_STRING <<std::endl<<std::endl;
+	    result.sequence().write(out,clp.output_width);
+	} else {
+	    cerr << "Cannot write to "<<clp.clustal_out<<endl<<"! Exit.";
+	    return_code = -1;
+	}
+    }
+    if (clp.opt_pp_out) {
+	ofstream out(clp.pp_out.c_str());
+	if (out.good()) {
+	    result.write_pp(out);
+	} else {
+	    cerr << "Cannot write to "<<clp.pp_out<<endl<<"! Exit.";
+	    return_code = -1;
+	}
+    }
+    if (clp.opt_tree_out) {
+	ofstream out(clp.tree_out.c_str());
+	if (out.good()) {
+	    tree.write_newick(out,names) << std::endl;
+	} else {
+	    cerr << "Cannot write to "<<clp.tree_out<<endl<<"! Exit.";
+	    return_code = -1;
+	}
+    }
+
+    if (ribosum) delete ribosum;
+    if (ribofit) delete ribofit;
+
+    stopwatch.stop("total");
+
+    // ----------------------------------------
+    // DONE
+    return return_code;
+}
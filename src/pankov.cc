@@ -28,6 +28,7 @@
 #include "LocARNA/ribosum85_60.icc"
 #include "LocARNA/multiple_alignment.hh"
 #include "LocARNA/sparsification_mapper.hh"
+#include "LocARNA/memory_planner.hh"
 #include "LocARNA/global_stopwatch.hh"
 #include "LocARNA/pfold_params.hh"
 
@@ -90,6 +91,14 @@ struct command_line_parameters {
 
     bool no_lonely_pairs; //!< no lonely pairs option
 
+    int plfold_span; //!< maximum base pair span for local folding (-1: off)
+    int plfold_winsize; //!< window size for local folding
+
+    bool opt_ensemble_cache; //!< whether to use the ensemble cache
+    std::string ensemble_cache; //!< ensemble cache directory
+    bool opt_max_memory; //!< whether to plan for a memory budget
+    std::string max_memory; //!< memory budget
+
     //! allow exclusions for maximizing alignment of connected substructures
     bool struct_local;
 
@@ -163,6 +172,7 @@ struct command_line_parameters {
     bool opt_write_structure; //!< whether to write structure
     bool opt_special_gap_symbols; //!< whether to use special gap symbols in the alignment result
     bool opt_stopwatch; //!< whether to print verbose output
+    bool opt_score_only; //!< whether to compute only the score
 
     bool opt_stacking; //!< whether to use stacking scores
     bool opt_new_stacking; //!< whether to use new stacking scores
@@ -259,13 +269,12 @@ option_def my_options[] = {
     //    {"stacking",0,&clp.opt_stacking,O_NO_ARG,0,O_NODEFAULT,"","Use stacking terms (needs stack-probs by RNAfold -p2)"},
     //    {"new-stacking",0,&clp.opt_newstacking,O_NO_ARG,0,O_NODEFAULT,"","Use new stacking terms (needs stack-probs by RNAfold -p2)"},
 
-    /*    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Type of locality"},
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Type of locality"},
 
-          {"struct-local",0,0,O_ARG_BOOL,&clp.struct_local,"false","bool","Structure local"},
-          {"sequ-local",0,0,O_ARG_BOOL,&clp.sequ_local,"false","bool","Sequence local"},
-          {"free-endgaps",0,0,O_ARG_STRING,&clp.free_endgaps,"----","spec","Whether and which end gaps are free. order: L1,R1,L2,R2"},
-          {"normalized",0,&clp.opt_normalized,O_ARG_INT,&clp.normalized_L,"0","L","Normalized local alignment with parameter L"},
-    */
+    //    {"struct-local",0,0,O_ARG_BOOL,&clp.struct_local,"false","bool","Structure local"},
+    {"sequ-local",0,0,O_ARG_BOOL,&clp.sequ_local,"false","bool","Sequence local"},
+    {"free-endgaps",0,0,O_ARG_STRING,&clp.free_endgaps,"----","spec","Whether and which end gaps are free. order: L1,R1,L2,R2"},
+    //    {"normalized",0,&clp.opt_normalized,O_ARG_INT,&clp.normalized_L,"0","L","Normalized local alignment with parameter L"},
     
     {"",0,0,O_SECTION,0,O_NODEFAULT,"","Controlling_output"},
 
@@ -279,6 +288,7 @@ option_def my_options[] = {
     {"special-gap-symbols",0,&clp.opt_special_gap_symbols,O_NO_ARG,0,O_NODEFAULT,"","Special distinct gap symbols for loop gaps or gaps caused by sparsification"},
 
     {"stopwatch",0,&clp.opt_stopwatch,O_NO_ARG,0,O_NODEFAULT,"","Print run time information."},
+    {"score-only",0,&clp.opt_score_only,O_NO_ARG,0,O_NODEFAULT,"","Compute only the score (no traceback); saves memory"},
 
     {"",0,0,O_SECTION,0,O_NODEFAULT,"","Heuristics for speed accuracy trade off"},
 
@@ -326,6 +336,10 @@ option_def my_options[] = {
     {"",0,0,O_SECTION,0,O_NODEFAULT,"","Constraints"},
 
     {"noLP",0,&clp.no_lonely_pairs,O_NO_ARG,0,O_NODEFAULT,"","No lonely pairs"},
+    {"plfold-span",0,0,O_ARG_INT,&clp.plfold_span,"-1","span","Use local folding with this maximum base pair span for sequences without given probabilities (default: global folding)"},
+    {"plfold-winsize",0,0,O_ARG_INT,&clp.plfold_winsize,"0","size","Window size for local folding (default: 2*span)"},
+    {"ensemble-cache",0,&clp.opt_ensemble_cache,O_ARG_STRING,&clp.ensemble_cache,O_NODEFAULT,"dir","Directory for caching pair probabilities of inputs without given probabilities; reuses the probabilities of earlier runs with the same sequences and folding parameters"},
+    {"max-memory",0,&clp.opt_max_memory,O_ARG_STRING,&clp.max_memory,O_NODEFAULT,"size","Memory budget (e.g. 512M or 4G); tightens the base pair cutoff (min-prob) until the estimated memory of the alignment fits, fails early otherwise"},
     //    {"ignore-constraints",0,&clp.opt_ignore_constraints,O_NO_ARG,0,O_NODEFAULT,"","Ignore constraints in pp-file"},
     
 
@@ -418,22 +432,11 @@ main(int argc, char **argv) {
             std::cerr << "WARNING: No lonely pairs option is not supported by sparse algortihm" << std::endl;
             //	return -1;
         }
-    if( clp.sequ_local )
-        {
-            std::cerr << "Local sequence alignment is not supported" << std::endl;
-            return -1;
-        }
     if( clp.opt_stacking || clp.opt_new_stacking)
         {
             std::cerr << "Stacking is not supported" << std::endl;
             return -1;
         }
-    /*  if(clp.free_endgaps.compare("----") != 0 )
-        {
-	std::cerr << "Free end gaps is not supported" << std::endl;
-	return -1;
-        }
-    */
     if (clp.opt_subopt) {
     	std::cerr
             << "ERROR: suboptimal alignment not supported."
@@ -451,6 +454,11 @@ main(int argc, char **argv) {
 	return -1;
     }
     
+    if (clp.opt_score_only && (clp.opt_clustal_out || clp.opt_pp_out)) {
+	std::cerr << "Alignment output is not available with option --score-only."<<std::endl;
+	return -1;
+    }
+
     if (clp.probability_scale<=0) {
 	std::cerr << "Probability scale must be greater 0."<<std::endl;
 	return -1;
@@ -476,6 +484,19 @@ main(int argc, char **argv) {
 	clp.opt_stacking=false;
     }
 
+    // ----------------------------------------
+    // memory budget
+    //
+    MemoryPlanner::size_type max_memory=MemoryPlanner::unlimited;
+    if (clp.opt_max_memory) {
+	try {
+	    max_memory = MemoryPlanner::parse_size(clp.max_memory);
+	} catch (failure &f) {
+	    std::cerr << "ERROR: " << f.what() <<std::endl;
+	    return -1;
+	}
+    }
+
 
 
     // ----------------------------------------  
@@ -513,7 +534,19 @@ main(int argc, char **argv) {
     // Get input data and generate data objects
     //
 
-    PFoldParams pfparams(clp.no_lonely_pairs,clp.opt_stacking||clp.opt_new_stacking,-1, 2); //bpspan disabled
+    // bpspan disabled unless local folding
+    PFoldParams pfparams(clp.no_lonely_pairs,
+			 clp.opt_stacking||clp.opt_new_stacking,
+			 clp.plfold_span>0 ? clp.plfold_span : -1,
+			 2);
+    if (clp.plfold_span>0) {
+	pfparams.set_window_size(clp.plfold_winsize>0
+				 ? clp.plfold_winsize
+				 : 2*clp.plfold_span);
+    }
+    if (clp.opt_ensemble_cache) {
+	pfparams.set_ensemble_cache(clp.ensemble_cache);
+    }
     
     ExtRnaData *rna_dataA=0;
     try {
@@ -555,19 +588,6 @@ main(int argc, char **argv) {
     size_type lenB=seqB.length();
 
 
-    //---------------------------------------------------------------
-    //Anchor constraint alignment is not supported by sparse yet
-    if ( ! (seqA.annotation(MultipleAlignment::AnnoType::anchors).single_string()=="") ||
-         ! (seqB.annotation(MultipleAlignment::AnnoType::anchors).single_string()=="") ) {
-	std::cout << "WARNING sequence constraints found in the input but will be ignored."<<std::endl;
-
-    }
-    LocARNA::SequenceAnnotation emptyAnnotation;
-    rna_dataA->set_anchors(emptyAnnotation);
-    rna_dataB->set_anchors(emptyAnnotation);
-    //---------------------------------------------------------------
-
-
     // --------------------
     // handle max_diff restriction  
     
@@ -640,6 +660,14 @@ main(int argc, char **argv) {
     // ----------------------------------------
     // construct set of relevant arc matches
     //
+    // with memory budget, plan the memory of the alignment
+    MemoryPlanner planner(MemoryPlanner::Aligner::NN,
+			  max_memory,
+			  rna_dataA,
+			  rna_dataB,
+			  clp.prob_unpaired_in_loop_threshold,
+			  clp.prob_basepair_in_loop_threshold);
+    
     ArcMatches *arc_matches;
     
     // ------------------------------------------------------------
@@ -666,20 +694,34 @@ main(int argc, char **argv) {
 				     trace_controller,
 				     seq_constraints
 				     );
+	if (planner.has_budget()) planner.add_step(*arc_matches,clp.min_prob);
     } else {
-	// initialize from RnaData
-	arc_matches = new ArcMatches(*rna_dataA,
-				     *rna_dataB,
-				     clp.min_prob,
-				     clp.max_diff_am!=-1
-				     ? (size_type)clp.max_diff_am
-				     : std::max(lenA,lenB),
-				     clp.max_diff_at_am!=-1
-				     ? (size_type)clp.max_diff_at_am
-				     : std::max(lenA,lenB),
-				     trace_controller,
-				     seq_constraints
-				     );
+	// initialize from RnaData; with memory budget, tighten the
+	// base pair cutoff until the alignment fits
+	arc_matches = planner.fit_arc_matches(*rna_dataA,
+					      *rna_dataB,
+					      clp.min_prob,
+					      clp.max_diff_am!=-1
+					      ? (size_type)clp.max_diff_am
+					      : std::max(lenA,lenB),
+					      clp.max_diff_at_am!=-1
+					      ? (size_type)clp.max_diff_at_am
+					      : std::max(lenA,lenB),
+					      trace_controller,
+					      seq_constraints
+					      );
+    }
+    
+    if (clp.opt_verbose && planner.has_budget()) {
+	planner.write(std::cout);
+    }
+    if (!planner.fits()) {
+	std::cerr << "ERROR: the alignment does not fit into the memory budget of "
+		  << clp.max_memory << "." <<std::endl;
+	delete arc_matches;
+	delete rna_dataA;
+	delete rna_dataB;
+	return -1;
     }
     
     const BasePairs &bpsA = arc_matches->get_base_pairsA();
@@ -702,13 +744,15 @@ main(int argc, char **argv) {
     }
 
     // construct sparsification mapper for seqs A,B
+    std::cerr << "Caution: Pankov alignment branch. Incompatibilities for running other aligner tools, please use the original/master LocARNA package." << std::endl;
 //    SparsificationMapper mapperA(bpsA, *rna_dataA, clp.prob_unpaired_in_loop_threshold, clp.prob_basepair_in_loop_threshold, true);
 //    SparsificationMapper mapperB(bpsB, *rna_dataB, clp.prob_unpaired_in_loop_threshold, clp.prob_basepair_in_loop_threshold, true);
 
 	//TODO: It is inefficient to create mapper_arcsX, if track closing pair is not enabled
     //construct mappers where right_sdj list is indexed by arcIndex
-	SparsificationMapper mapper_arcsA(bpsA, *rna_dataA, clp.prob_unpaired_in_loop_threshold, clp.prob_basepair_in_loop_threshold, false);
-	SparsificationMapper mapper_arcsB(bpsB, *rna_dataB, clp.prob_unpaired_in_loop_threshold, clp.prob_basepair_in_loop_threshold, false);
+	// (reusing the mappers of the memory plan)
+	const SparsificationMapper &mapper_arcsA = planner.sparsification_mapperA(bpsA);
+	const SparsificationMapper &mapper_arcsB = planner.sparsification_mapperB(bpsB);
 
 
     // ------------------------------------------------------------
@@ -866,6 +910,7 @@ main(int argc, char **argv) {
 	. stacking(clp.opt_stacking || clp.opt_new_stacking)
 	. track_closing_bp(clp.opt_track_closing_bp)
 	. multiloop_deletion(clp.opt_multiloop_deletion)
+	. score_only(clp.opt_score_only)
 
 	. constraints(seq_constraints);
 
@@ -932,7 +977,7 @@ main(int argc, char **argv) {
     // ------------------------------------------------------------
     // Traceback
     //
-    if ((!clp.opt_normalized) && DO_TRACE) {
+    if ((!clp.opt_normalized) && DO_TRACE && !clp.opt_score_only) {
 	    
 	if (clp.opt_verbose) {
 	    std::cout << "Traceback."<<std::endl;
@@ -947,7 +992,7 @@ main(int argc, char **argv) {
 
     bool return_code=0;
     
-    if (clp.opt_normalized || DO_TRACE) { // if we did a trace (one way or
+    if ((clp.opt_normalized || DO_TRACE) && !clp.opt_score_only) { // if we did a trace (one way or
         // the other)
 
 	const Alignment &alignment = aligner.get_alignment();
@@ -1060,6 +1105,10 @@ main(int argc, char **argv) {
       
     stopwatch.stop("total");
 
+    if (clp.opt_verbose) {
+	std::cout << "Peak memory: " << peak_memory_kb() << " kB" << std::endl;
+    }
+
     // ----------------------------------------
     // DONE
     return return_code;
@@ -27,6 +27,7 @@
 #include "LocARNA/trace_controller.hh"
 #include "LocARNA/multiple_alignment.hh"
 #include "LocARNA/sparsification_mapper.hh"
+#include "LocARNA/memory_planner.hh"
 #include "LocARNA/global_stopwatch.hh"
 #include "LocARNA/pfold_params.hh"
 #include "LocARNA/main_helper.icc"
@@ -86,6 +87,8 @@ struct command_line_parameters : public MainHelper::std_command_line_parameters
 
     bool opt_track_closing_bp; //!< whether to track right end of a closing basepair
 
+    bool opt_score_only; //!< whether to compute only the score
+
 
 
 };
@@ -151,6 +154,8 @@ option_def my_options[] = {
     {"special-gap-symbols",0,&clp.opt_special_gap_symbols,O_NO_ARG,0,O_NODEFAULT,"",
      "Special distinct gap symbols for loop gaps or gaps caused by sparsification"},
     {"stopwatch",0,&clp.opt_stopwatch,O_NO_ARG,0,O_NODEFAULT,"","Print run time information."},
+    {"score-only",0,&clp.opt_score_only,O_NO_ARG,0,O_NODEFAULT,"",
+     "Compute only the score (no traceback); saves memory"},
 
     {"",0,0,O_SECTION,0,O_NODEFAULT,"","Heuristics for speed accuracy trade off"},
 
@@ -216,6 +221,8 @@ option_def my_options[] = {
 
     {"noLP",0,&clp.no_lonely_pairs,O_NO_ARG,0,O_NODEFAULT,"","No lonely pairs"},
     {"maxBPspan",0,0,O_ARG_INT,&clp.max_bp_span,"-1","span","Limit maximum base pair span (default=off)"},
+    {"ensemble-cache",0,&clp.opt_ensemble_cache,O_ARG_STRING,&clp.ensemble_cache,O_NODEFAULT,"dir","Directory for caching pair probabilities of inputs without given probabilities; reuses the probabilities of earlier runs with the same sequences and folding parameters"},
+    {"max-memory",0,&clp.opt_max_memory,O_ARG_STRING,&clp.max_memory,O_NODEFAULT,"size","Memory budget (e.g. 512M or 4G); tightens the base pair cutoff (min-prob) until the estimated memory of the alignment fits, fails early otherwise"},
 
     {"",0,0,O_SECTION_HIDE,0,O_NODEFAULT,"","Hidden Options"},
     // TODO: make ribofit visible
@@ -343,6 +350,12 @@ main(int argc, char **argv) {
 	return -1;
     }
     
+    if (clp.opt_score_only
+	&& (clp.opt_clustal_out || clp.opt_stockholm_out || clp.opt_pp_out)) {
+	std::cerr << "Alignment output is not available with option --score-only."<<std::endl;
+	return -1;
+    }
+
     if (clp.probability_scale<=0) {
 	std::cerr << "Probability scale must be greater 0."<<std::endl;
 	return -1;
@@ -363,6 +376,19 @@ main(int argc, char **argv) {
 	clp.opt_stacking=false;
     }
 
+    // ----------------------------------------
+    // memory budget
+    //
+    MemoryPlanner::size_type max_memory=MemoryPlanner::unlimited;
+    if (clp.opt_max_memory) {
+	try {
+	    max_memory = MemoryPlanner::parse_size(clp.max_memory);
+	} catch (failure &f) {
+	    std::cerr << "ERROR: " << f.what() <<std::endl;
+	    return -1;
+	}
+    }
+
 
     // ----------------------------------------  
     // Ribosum matrix
@@ -376,6 +402,9 @@ main(int argc, char **argv) {
     //
 
     PFoldParams pfparams(clp.no_lonely_pairs,clp.opt_stacking||clp.opt_new_stacking, clp.max_bp_span, 2);
+    if (clp.opt_ensemble_cache) {
+	pfparams.set_ensemble_cache(clp.ensemble_cache);
+    }
     
     ExtRnaData *rna_dataA=0;
     try {
@@ -510,6 +539,14 @@ main(int argc, char **argv) {
     // ----------------------------------------
     // construct set of relevant arc matches
     //
+    // with memory budget, plan the memory of the alignment
+    MemoryPlanner planner(MemoryPlanner::Aligner::N,
+			  max_memory,
+			  rna_dataA,
+			  rna_dataB,
+			  clp.prob_unpaired_in_loop_threshold,
+			  clp.prob_basepair_in_loop_threshold);
+    
     ArcMatches *arc_matches;
     
     // ------------------------------------------------------------
@@ -538,20 +575,34 @@ main(int argc, char **argv) {
 				     trace_controller,
 				     seq_constraints
 				     );
+	if (planner.has_budget()) planner.add_step(*arc_matches,clp.min_prob);
     } else {
-	// initialize from RnaData
-	arc_matches = new ArcMatches(*rna_dataA,
-				     *rna_dataB,
-				     clp.min_prob,
-				     clp.max_diff_am!=-1
-				     ? (size_type)clp.max_diff_am
-				     : std::max(lenA,lenB),
-				     clp.max_diff_at_am!=-1
-				     ? (size_type)clp.max_diff_at_am
-				     : std::max(lenA,lenB),
-				     trace_controller,
-				     seq_constraints
-				     );
+	// initialize from RnaData; with memory budget, tighten the
+	// base pair cutoff until the alignment fits
+	arc_matches = planner.fit_arc_matches(*rna_dataA,
+					      *rna_dataB,
+					      clp.min_prob,
+					      clp.max_diff_am!=-1
+					      ? (size_type)clp.max_diff_am
+					      : std::max(lenA,lenB),
+					      clp.max_diff_at_am!=-1
+					      ? (size_type)clp.max_diff_at_am
+					      : std::max(lenA,lenB),
+					      trace_controller,
+					      seq_constraints
+					      );
+    }
+    
+    if (clp.opt_verbose && planner.has_budget()) {
+	planner.write(std::cout);
+    }
+    if (!planner.fits()) {
+	std::cerr << "ERROR: the alignment does not fit into the memory budget of "
+		  << clp.max_memory << "." <<std::endl;
+	delete arc_matches;
+	delete rna_dataA;
+	delete rna_dataB;
+	return -1;
     }
     
     const BasePairs &bpsA = arc_matches->get_base_pairsA();
@@ -570,10 +621,9 @@ main(int argc, char **argv) {
 	// cout << "Base Identity: "<<(seq_identity(seqA,seqB)*100)<<endl; 
 
     // construct sparsification mapper for seqs A,B
-    SparsificationMapper mapperA(bpsA, *rna_dataA, clp.prob_unpaired_in_loop_threshold,
-                                 clp.prob_basepair_in_loop_threshold, true);
-    SparsificationMapper mapperB(bpsB, *rna_dataB, clp.prob_unpaired_in_loop_threshold,
-                                 clp.prob_basepair_in_loop_threshold, true);
+    // (reusing the mappers of the memory plan)
+    const SparsificationMapper &mapperA = planner.sparsification_mapperA(bpsA);
+    const SparsificationMapper &mapperB = planner.sparsification_mapperB(bpsB);
 
     //TODO: It is inefficient to create mapper_arcsX, if track closing pair is not enabled
 	//construct mappers where right_sdj list is indexed by arcIndex
@@ -703,6 +753,7 @@ main(int argc, char **argv) {
 	. min_bm_prob(clp.min_bm_prob)
 	. stacking(clp.opt_stacking || clp.opt_new_stacking)
 	. track_closing_bp(clp.opt_track_closing_bp)
+	. score_only(clp.opt_score_only)
 	. constraints(seq_constraints);
 
 
@@ -723,7 +774,7 @@ main(int argc, char **argv) {
     // ------------------------------------------------------------
     // Traceback
     //
-    if (DO_TRACE) {
+    if (DO_TRACE && !clp.opt_score_only) {
 	    
 	if (clp.opt_verbose) {
 	    std::cout << "Traceback."<<std::endl;
@@ -735,7 +786,7 @@ main(int argc, char **argv) {
 
     bool return_code=0;
     
-    if (DO_TRACE) { // if we did a trace (one way or
+    if (DO_TRACE && !clp.opt_score_only) { // if we did a trace (one way or
         // the other)
 
         // ----------------------------------------
@@ -800,6 +851,10 @@ main(int argc, char **argv) {
       
     stopwatch.stop("total");
 
+    if (clp.opt_verbose) {
+	std::cout << "Peak memory: " << peak_memory_kb() << " kB" << std::endl;
+    }
+
     // ----------------------------------------
     // DONE
     return return_code;